@@ -0,0 +1,101 @@
+//
+// Created by toru on 2026/10/17.
+//
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "gemm.hpp"
+
+using namespace nagato;
+
+/**
+ * @brief 素朴な 3 重ループによる行列積
+ */
+void NaiveGemm(std::size_t M,
+               std::size_t N,
+               std::size_t K,
+               const std::vector<double> &A,
+               const std::vector<double> &B,
+               std::vector<double> &C)
+{
+  for (std::size_t i = 0; i < M; ++i)
+  {
+    for (std::size_t j = 0; j < N; ++j)
+    {
+      double sum = 0;
+      for (std::size_t k = 0; k < K; ++k)
+      {
+        sum += A[i * K + k] * B[k * N + j];
+      }
+      C[i * N + j] = sum;
+    }
+  }
+}
+
+/**
+ * @brief 関数の実行時間を計測して GFLOPS を返す
+ */
+template<typename F>
+double MeasureGflops(std::size_t M, std::size_t N, std::size_t K, int repeat, F &&func)
+{
+  const auto start = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < repeat; ++i)
+  {
+    func();
+  }
+  const auto end = std::chrono::high_resolution_clock::now();
+  const double seconds = std::chrono::duration<double>(end - start).count() / repeat;
+  return 2.0 * M * N * K / seconds * 1e-9;
+}
+
+void Benchmark(std::size_t M, std::size_t N, std::size_t K, int repeat)
+{
+  std::mt19937 gen(0);
+  std::uniform_real_distribution<double> dis(-1.0, 1.0);
+  std::vector<double> A(M * K);
+  std::vector<double> B(K * N);
+  std::vector<double> C(M * N);
+  std::vector<double> C_naive(M * N);
+  for (auto &a : A)
+  {
+    a = dis(gen);
+  }
+  for (auto &b : B)
+  {
+    b = dis(gen);
+  }
+
+  const double naive = MeasureGflops(M, N, K, 1, [&]()
+  {
+    NaiveGemm(M, N, K, A, B, C_naive);
+  });
+  const double gemm = MeasureGflops(M, N, K, repeat, [&]()
+  {
+    Gemm(M, N, K, A.data(), K, 1, B.data(), N, 1, C.data(), N);
+  });
+
+  double max_error = 0;
+  for (std::size_t i = 0; i < M * N; ++i)
+  {
+    max_error = std::max(max_error, std::abs(C[i] - C_naive[i]));
+  }
+
+  std::cout << M << "x" << N << "x" << K
+            << " naive: " << naive << " GFLOPS"
+            << ", gemm: " << gemm << " GFLOPS"
+            << ", max error: " << max_error << std::endl;
+}
+
+int main()
+{
+  // MNIST の Affine 層相当の形状
+  Benchmark(100, 50, 784, 1000);
+  Benchmark(100, 784, 50, 1000);
+  Benchmark(784, 50, 100, 1000);
+
+  // 大きな正方行列
+  Benchmark(512, 512, 512, 10);
+  Benchmark(1024, 1024, 1024, 3);
+}
@@ -75,70 +75,43 @@ void two_layer_network()
 int main()
 {
   // Mnist のデータセットをcsvから読み込む
-  Tensor train_data = Tensor::FromCSV("../train_data.csv");
-  Tensor train_label = Tensor::FromCSV("../train_label.csv");
-  Tensor test_data = Tensor::FromCSV("../test_data.csv");
-  Tensor test_label = Tensor::FromCSV("../test_label.csv");
-  Tensor::PrintShape(train_data);
-  Tensor::PrintShape(train_label);
-  Tensor::PrintShape(test_data);
-  Tensor::PrintShape(test_label);
+  Tensorf train_data = Tensorf::FromCSV("../train_data.csv");
+  Tensorf train_label = Tensorf::FromCSV("../train_label.csv");
+  Tensorf test_data = Tensorf::FromCSV("../test_data.csv");
+  Tensorf test_label = Tensorf::FromCSV("../test_label.csv");
+  Tensorf::PrintShape(train_data);
+  Tensorf::PrintShape(train_label);
+  Tensorf::PrintShape(test_data);
+  Tensorf::PrintShape(test_label);
 
   // 学習用データを 0 ~ 1.0 に正規化する
   train_data = train_data / 255.0;
   test_data = test_data / 255.0;
 
-  Tensor train_label_one_hot = OneHot(train_label, 10);
-  Tensor test_label_one_hot = OneHot(test_label, 10);
+  Tensorf train_label_one_hot = OneHot(train_label, 10);
+  Tensorf test_label_one_hot = OneHot(test_label, 10);
 
   // データを一つ表示する
   PrintMNIST(train_data.Slice(0), train_label.Slice(0));
 
-  // ニューラルネットワークの生成
-  TwoLayerNet net(784, 50, 10);
-  SGD sgd(0.1);
+  // ニューラルネットワークの生成 (単精度で学習する)
+  TwoLayerNetf net(784, 50, 10);
+  SGDf sgd(0.1);
 
   constexpr std::size_t iter_num = 100000;
   constexpr std::size_t batch_size = 100;
-  constexpr Tensor::value_type learning_rate = 0.1;
+  constexpr Tensorf::value_type learning_rate = 0.1;
 
-  // 学習データの総数を取得（例としてtrain_dataの最初の次元がサンプル数だとする）
-  std::size_t data_size = train_data.shape()[0];
-
-  // 全サンプルのインデックスベクトルを作成
-  std::vector<std::size_t> all_indexes(data_size);
-  std::iota(all_indexes.begin(), all_indexes.end(), 0);
-
-  // 学習開始前に全体をシャッフルしておく
-  std::mt19937 rng(std::random_device{}());
-  std::shuffle(all_indexes.begin(), all_indexes.end(), rng);
+  // シャッフルとミニバッチの作成は DataLoader がワーカースレッドで先に行う
+  DataLoaderf loader(train_data, train_label_one_hot, batch_size);
 
   for (std::size_t i = 0; i < iter_num; ++i)
   {
-    // 必要ならエポック毎に再度全体をシャッフルする
-    if (i % (data_size / batch_size) == 0) {
-        std::shuffle(all_indexes.begin(), all_indexes.end(), rng);
-    }
-
-    // ミニバッチの開始インデックスを計算（例: 連続してとる場合）
-    std::size_t start = (i * batch_size) % data_size;
-    std::vector<Tensor> x_batches;
-    std::vector<Tensor> t_batches;
-
-    for (std::size_t j = 0; j < batch_size; ++j)
-    {
-      std::size_t index = all_indexes[start + j];
-      Tensor x_slice = train_data.Slice(index);
-      Tensor t_slice = train_label_one_hot.Slice(index);
-
-      x_batches.emplace_back(x_slice);
-      t_batches.emplace_back(t_slice);
-    }
-
-    Tensor x_batch = Tensor::Concat(x_batches);
-    Tensor t_batch = Tensor::Concat(t_batches);
+    const auto batch = loader.Next();
+    const Tensorf &x_batch = batch.x;
+    const Tensorf &t_batch = batch.t;
 
-    std::vector<std::pair<std::string, Tensor> > grads = net.gradient(x_batch, t_batch);
+    std::vector<std::pair<std::string, Tensorf> > grads = net.gradient(x_batch, t_batch);
 
     // パラメータの更新
     sgd.update(net.params, grads);
@@ -22,6 +22,12 @@ def main():
     np.savetxt("train_label.csv", y_train, delimiter=",", fmt="%d")
     np.savetxt("test_label.csv",  y_test,  delimiter=",", fmt="%d")
     
+    # 同じデータを .npz にも保存します (nagato::LoadNpz で読み込めます)。
+    # CSV より読み込みが速く、NpyLoadMode::MemoryMap ならコピーせずに使えます。
+    np.savez("mnist.npz",
+             train_data=x_train_flat, train_label=y_train,
+             test_data=x_test_flat, test_label=y_test)
+
     print("CSVファイルの作成が完了しました。")
 
 if __name__ == "__main__":
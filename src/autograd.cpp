@@ -0,0 +1,608 @@
+//
+// Created by toru on 2026/10/17.
+//
+
+#include "autograd.hpp"
+#include "network.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace nagato
+{
+namespace
+{
+/**
+ * @brief ReLU の逆伝播. 出力 y が正の位置だけ勾配を通す
+ */
+struct ReLUBackwardOp
+{
+  template<typename V>
+  V operator()(const V dout, const V y) const
+  {
+    return y > V(0) ? dout : V(0);
+  }
+};
+
+/**
+ * @brief ブロードキャストした勾配の総和を取り, 入力の形状に戻す
+ * @note 先頭に追加された軸と, 入力で長さ 1 だった軸の総和を取る
+ */
+template<typename T>
+BasicTensor<T> ReduceTo(const BasicTensor<T> &grad, const Shape &shape)
+{
+  if (grad.shape() == shape)
+  {
+    return grad;
+  }
+  if (grad.shape().size() < shape.size())
+  {
+    throw std::invalid_argument("gradient rank is smaller than the variable rank");
+  }
+
+  const std::size_t lead = grad.shape().size() - shape.size();
+  std::vector<std::size_t> axes;
+  for (std::size_t i = 0; i < grad.shape().size(); ++i)
+  {
+    if (i < lead || (shape[i - lead] == 1 && grad.shape()[i] != 1))
+    {
+      axes.push_back(i);
+    }
+  }
+  if (axes.empty())
+  {
+    return grad.Reshape(shape);
+  }
+  return BasicTensor<T>::Sum(grad, axes, true).Reshape(shape);
+}
+
+/**
+ * @brief 2 つの変数が同じテープに記録されているか確認する
+ */
+template<typename T>
+BasicTape<T> &SameTape(const BasicVariable<T> &a, const BasicVariable<T> &b)
+{
+  if (a.tape() == nullptr || a.tape() != b.tape())
+  {
+    throw std::invalid_argument("variables must be recorded on the same tape");
+  }
+  return *a.tape();
+}
+
+template<typename T>
+BasicTape<T> &TapeOf(const BasicVariable<T> &a)
+{
+  if (a.tape() == nullptr)
+  {
+    throw std::invalid_argument("variable is not recorded on a tape");
+  }
+  return *a.tape();
+}
+
+/**
+ * @brief 行列積の逆伝播で使う転置のビュー. 3次元の場合は後ろの 2 軸を入れ替える
+ */
+template<typename T>
+BasicTensor<T> TransposeMatrix(const BasicTensor<T> &a)
+{
+  if (a.shape().size() == 3)
+  {
+    return BasicTensor<T>::Transpose(a, {0, 2, 1});
+  }
+  return BasicTensor<T>::Transpose(a);
+}
+} // namespace
+
+template<typename T>
+BasicVariable<T>::BasicVariable(Tape *tape, std::size_t id) : tape_(tape), id_(id)
+{
+}
+
+template<typename T>
+const BasicTensor<T> &BasicVariable<T>::value() const
+{
+  const auto &node = TapeOf(*this).node(*this);
+  if (node.released)
+  {
+    throw std::invalid_argument("value was released by backward");
+  }
+  return node.value;
+}
+
+template<typename T>
+const Shape &BasicVariable<T>::shape() const
+{
+  return TapeOf(*this).node(*this).shape;
+}
+
+template<typename T>
+std::size_t BasicVariable<T>::id() const
+{
+  return id_;
+}
+
+template<typename T>
+BasicTape<T> *BasicVariable<T>::tape() const
+{
+  return tape_;
+}
+
+template<typename T>
+BasicVariable<T> BasicVariable<T>::Reshape(const Shape &shape) const
+{
+  const Shape original = this->shape();
+  const std::size_t id = id_;
+  return TapeOf(*this).record(value().Reshape(shape), {*this}, [original, id](Tape &tape, Tensor &&dout)
+  {
+    tape.accumulate(id, dout.Reshape(original));
+  });
+}
+
+template<typename T>
+BasicVariable<T> BasicVariable<T>::Matmul(const BasicVariable &a, const BasicVariable &b)
+{
+  Tape &tape = SameTape(a, b);
+  const std::size_t rank = a.shape().size();
+  if ((rank != 2 && rank != 3) || b.shape().size() != rank)
+  {
+    throw std::invalid_argument("Matmul supports 2D or 3D variables of the same rank");
+  }
+
+  // 入力の値はデータ領域を共有するだけなので, 保存しても追加のメモリは使わない
+  const Tensor x = a.value();
+  const Tensor y = b.value();
+  const std::size_t ia = a.id();
+  const std::size_t ib = b.id();
+  return tape.record(Tensor::Matmul(x, y), {a, b}, [x, y, ia, ib](Tape &tape, Tensor &&dout)
+  {
+    // 転置はビューのまま GEMM に渡すため, コピーは発生しない
+    if (tape.requires_grad(BasicVariable(&tape, ia)))
+    {
+      tape.accumulate(ia, Tensor::Matmul(dout, TransposeMatrix(y)));
+    }
+    if (tape.requires_grad(BasicVariable(&tape, ib)))
+    {
+      tape.accumulate(ib, Tensor::Matmul(TransposeMatrix(x), dout));
+    }
+  });
+}
+
+template<typename T>
+BasicVariable<T> BasicVariable<T>::Transpose(const BasicVariable &a)
+{
+  if (a.shape().size() != 2)
+  {
+    throw std::invalid_argument("Transpose supports 2D variables");
+  }
+  const std::size_t id = a.id();
+  return TapeOf(a).record(Tensor::Transpose(a.value()), {a}, [id](Tape &tape, Tensor &&dout)
+  {
+    tape.accumulate(id, Tensor::Transpose(dout));
+  });
+}
+
+template<typename T>
+BasicVariable<T> BasicVariable<T>::ReLU(const BasicVariable &a)
+{
+  Tensor y = a.value();
+  y.ReLU_();
+  const std::size_t id = a.id();
+  return TapeOf(a).record(y, {a}, [y, id](Tape &tape, Tensor &&dout)
+  {
+    // dout を単独で所有している場合はその領域に上書きする
+    dout = MakeBinaryExpression(ReLUBackwardOp{}, std::as_const(dout), y);
+    tape.accumulate(id, std::move(dout));
+  });
+}
+
+template<typename T>
+BasicVariable<T> BasicVariable<T>::Sigmoid(const BasicVariable &a)
+{
+  const Tensor y = Tensor::Sigmoid(a.value());
+  const std::size_t id = a.id();
+  return TapeOf(a).record(y, {a}, [y, id](Tape &tape, Tensor &&dout)
+  {
+    dout = std::as_const(dout) * (y * (T(1) - y));
+    tape.accumulate(id, std::move(dout));
+  });
+}
+
+template<typename T>
+BasicVariable<T> BasicVariable<T>::Exp(const BasicVariable &a)
+{
+  const Tensor y = Tensor::Exp(a.value());
+  const std::size_t id = a.id();
+  return TapeOf(a).record(y, {a}, [y, id](Tape &tape, Tensor &&dout)
+  {
+    dout *= y;
+    tape.accumulate(id, std::move(dout));
+  });
+}
+
+template<typename T>
+BasicVariable<T> BasicVariable<T>::Log(const BasicVariable &a)
+{
+  const Tensor x = a.value();
+  const std::size_t id = a.id();
+  return TapeOf(a).record(Tensor::Log(x), {a}, [x, id](Tape &tape, Tensor &&dout)
+  {
+    dout /= x;
+    tape.accumulate(id, std::move(dout));
+  });
+}
+
+template<typename T>
+BasicVariable<T> BasicVariable<T>::Sum(const BasicVariable &a, const std::vector<std::size_t> &axes, bool keepdims)
+{
+  // 縮約した軸を長さ 1 として残した形状. 勾配をこの形状に変えてから入力の形状にブロードキャストする
+  const Shape shape = a.shape();
+  Shape kept = shape;
+  for (std::size_t i = 0; i < kept.size(); ++i)
+  {
+    if (axes.empty() || std::find(axes.begin(), axes.end(), i) != axes.end())
+    {
+      kept[i] = 1;
+    }
+  }
+  const std::size_t id = a.id();
+  return TapeOf(a).record(Tensor::Sum(a.value(), axes, keepdims), {a}, [shape, kept, id](Tape &tape, Tensor &&dout)
+  {
+    Tensor dx = Tensor::Zeros(shape);
+    dx += dout.Reshape(kept);
+    tape.accumulate(id, std::move(dx));
+  });
+}
+
+template<typename T>
+BasicVariable<T> BasicVariable<T>::Mean(const BasicVariable &a, const std::vector<std::size_t> &axes, bool keepdims)
+{
+  const BasicVariable sum = Sum(a, axes, keepdims);
+  std::size_t count = 1;
+  for (const std::size_t dim : a.shape())
+  {
+    count *= dim;
+  }
+  for (const std::size_t dim : sum.shape())
+  {
+    count /= dim;
+  }
+  return sum * (T(1) / static_cast<T>(count));
+}
+
+template<typename T>
+BasicVariable<T> BasicVariable<T>::SoftmaxCrossEntropy(const BasicVariable &x, const Tensor &t)
+{
+  Tensor grad;
+  Tensor loss = nagato::SoftmaxCrossEntropy(x.value(), t, &grad);
+  const std::size_t id = x.id();
+  return TapeOf(x).record(std::move(loss), {x}, [grad = std::move(grad), id](Tape &tape, Tensor &&dout) mutable
+  {
+    const T scale = dout(0);
+    if (scale != T(1))
+    {
+      grad *= scale;
+    }
+    tape.accumulate(id, std::move(grad));
+  });
+}
+
+template<typename T>
+BasicVariable<T> operator+(const BasicVariable<T> &a, const BasicVariable<T> &b)
+{
+  using Tensor = BasicTensor<T>;
+  const std::size_t ia = a.id();
+  const std::size_t ib = b.id();
+  return SameTape(a, b).record(a.value() + b.value(), {a, b}, [ia, ib](BasicTape<T> &tape, Tensor &&dout)
+  {
+    // 同じ勾配を両方に渡す. データ領域は共有し, 書き換えるときに複製する
+    tape.accumulate(ia, Tensor(dout));
+    tape.accumulate(ib, std::move(dout));
+  });
+}
+
+template<typename T>
+BasicVariable<T> operator-(const BasicVariable<T> &a, const BasicVariable<T> &b)
+{
+  using Tensor = BasicTensor<T>;
+  const std::size_t ia = a.id();
+  const std::size_t ib = b.id();
+  return SameTape(a, b).record(a.value() - b.value(), {a, b}, [ia, ib](BasicTape<T> &tape, Tensor &&dout)
+  {
+    tape.accumulate(ia, Tensor(dout));
+    dout = -std::as_const(dout);
+    tape.accumulate(ib, std::move(dout));
+  });
+}
+
+template<typename T>
+BasicVariable<T> operator*(const BasicVariable<T> &a, const BasicVariable<T> &b)
+{
+  using Tensor = BasicTensor<T>;
+  const Tensor x = a.value();
+  const Tensor y = b.value();
+  const std::size_t ia = a.id();
+  const std::size_t ib = b.id();
+  return SameTape(a, b).record(x * y, {a, b}, [x, y, ia, ib](BasicTape<T> &tape, Tensor &&dout)
+  {
+    tape.accumulate(ia, Tensor(std::as_const(dout) * y));
+    dout = std::as_const(dout) * x;
+    tape.accumulate(ib, std::move(dout));
+  });
+}
+
+template<typename T>
+BasicVariable<T> operator/(const BasicVariable<T> &a, const BasicVariable<T> &b)
+{
+  using Tensor = BasicTensor<T>;
+  const Tensor x = a.value();
+  const Tensor y = b.value();
+  const std::size_t ia = a.id();
+  const std::size_t ib = b.id();
+  return SameTape(a, b).record(x / y, {a, b}, [x, y, ia, ib](BasicTape<T> &tape, Tensor &&dout)
+  {
+    tape.accumulate(ia, Tensor(std::as_const(dout) / y));
+    dout = -(std::as_const(dout) * x) / (y * y);
+    tape.accumulate(ib, std::move(dout));
+  });
+}
+
+template<typename T>
+BasicVariable<T> operator-(const BasicVariable<T> &a)
+{
+  using Tensor = BasicTensor<T>;
+  const std::size_t id = a.id();
+  return TapeOf(a).record(-a.value(), {a}, [id](BasicTape<T> &tape, Tensor &&dout)
+  {
+    dout = -std::as_const(dout);
+    tape.accumulate(id, std::move(dout));
+  });
+}
+
+template<typename T>
+BasicVariable<T> operator+(const BasicVariable<T> &a, std::type_identity_t<T> s)
+{
+  using Tensor = BasicTensor<T>;
+  const std::size_t id = a.id();
+  return TapeOf(a).record(a.value() + s, {a}, [id](BasicTape<T> &tape, Tensor &&dout)
+  {
+    tape.accumulate(id, std::move(dout));
+  });
+}
+
+template<typename T>
+BasicVariable<T> operator+(std::type_identity_t<T> s, const BasicVariable<T> &a)
+{
+  return a + s;
+}
+
+template<typename T>
+BasicVariable<T> operator-(const BasicVariable<T> &a, std::type_identity_t<T> s)
+{
+  return a + (-s);
+}
+
+template<typename T>
+BasicVariable<T> operator-(std::type_identity_t<T> s, const BasicVariable<T> &a)
+{
+  return -a + s;
+}
+
+template<typename T>
+BasicVariable<T> operator*(const BasicVariable<T> &a, std::type_identity_t<T> s)
+{
+  using Tensor = BasicTensor<T>;
+  const std::size_t id = a.id();
+  return TapeOf(a).record(a.value() * s, {a}, [s, id](BasicTape<T> &tape, Tensor &&dout)
+  {
+    dout *= s;
+    tape.accumulate(id, std::move(dout));
+  });
+}
+
+template<typename T>
+BasicVariable<T> operator*(std::type_identity_t<T> s, const BasicVariable<T> &a)
+{
+  return a * s;
+}
+
+template<typename T>
+BasicVariable<T> operator/(const BasicVariable<T> &a, std::type_identity_t<T> s)
+{
+  return a * (T(1) / s);
+}
+
+template<typename T>
+BasicVariable<T> BasicTape<T>::constant(const Tensor &value)
+{
+  Node node;
+  node.value = value;
+  node.leaf = true;
+  return push(std::move(node));
+}
+
+template<typename T>
+BasicVariable<T> BasicTape<T>::parameter(const Tensor &value)
+{
+  Node node;
+  node.value = value;
+  node.leaf = true;
+  node.requires_grad = true;
+  return push(std::move(node));
+}
+
+template<typename T>
+BasicVariable<T> BasicTape<T>::record(Tensor value, const std::vector<Variable> &inputs, Backward backward)
+{
+  Node node;
+  node.value = std::move(value);
+  for (const Variable &input : inputs)
+  {
+    if (input.tape() != this)
+    {
+      throw std::invalid_argument("input is not recorded on this tape");
+    }
+    node.requires_grad = node.requires_grad || nodes_[input.id()].requires_grad;
+  }
+  // 勾配が不要な演算は逆伝播の関数とそれが保存した活性をここで捨てる
+  if (node.requires_grad)
+  {
+    node.backward = std::move(backward);
+  }
+  return push(std::move(node));
+}
+
+template<typename T>
+void BasicTape<T>::accumulate(std::size_t id, Tensor &&grad)
+{
+  Node &node = nodes_.at(id);
+  if (!node.requires_grad)
+  {
+    return;
+  }
+  if (grad.shape() != node.shape)
+  {
+    grad = ReduceTo(grad, node.shape);
+  }
+  if (!node.grad)
+  {
+    node.grad = std::move(grad);
+  }
+  else
+  {
+    *node.grad += grad;
+  }
+}
+
+template<typename T>
+bool BasicTape<T>::requires_grad(const Variable &v) const
+{
+  return node(v).requires_grad;
+}
+
+template<typename T>
+void BasicTape<T>::backward(const Variable &loss)
+{
+  const Node &root = node(loss);
+  if (backward_done_)
+  {
+    throw std::invalid_argument("backward has already been run on this tape. call clear() before recording again");
+  }
+  if (root.released || root.value.size() != 1)
+  {
+    throw std::invalid_argument("loss must have exactly one element");
+  }
+  backward_done_ = true;
+
+  const std::size_t last = loss.id();
+  // loss より後に記録した演算は使わないので, 保存した活性を先に解放する
+  for (std::size_t i = last + 1; i < nodes_.size(); ++i)
+  {
+    nodes_[i].backward = nullptr;
+  }
+  if (!root.requires_grad)
+  {
+    return;
+  }
+
+  nodes_[last].grad = Tensor::Ones(root.shape);
+  for (std::size_t i = last + 1; i-- > 0;)
+  {
+    Node &node = nodes_[i];
+    if (node.backward && node.grad)
+    {
+      // 逆伝播の関数は呼び出した後にこのスコープで破棄し, 保存した活性を解放する
+      const Backward backward = std::move(node.backward);
+      node.backward = nullptr;
+      Tensor grad = std::move(*node.grad);
+      node.grad.reset();
+      backward(*this, std::move(grad));
+    }
+    node.backward = nullptr;
+
+    // 後の演算の逆伝播はすべて終わっているので, 途中の値を参照するものは残っていない
+    if (!node.leaf && i != last)
+    {
+      node.value = Tensor();
+      node.released = true;
+    }
+  }
+}
+
+template<typename T>
+const BasicTensor<T> &BasicTape<T>::gradient(const Variable &v) const
+{
+  const Node &n = node(v);
+  if (!n.grad)
+  {
+    throw std::invalid_argument("variable has no gradient");
+  }
+  return *n.grad;
+}
+
+template<typename T>
+std::vector<std::pair<std::string, BasicTensor<T> > > BasicTape<T>::gradients(
+  const std::vector<std::pair<std::string, Variable> > &variables) const
+{
+  std::vector<std::pair<std::string, Tensor> > grads;
+  grads.reserve(variables.size());
+  for (const auto &[name, v] : variables)
+  {
+    const Node &n = node(v);
+    grads.emplace_back(name, n.grad ? *n.grad : Tensor::Zeros(n.shape));
+  }
+  return grads;
+}
+
+template<typename T>
+void BasicTape<T>::clear()
+{
+  nodes_.clear();
+  backward_done_ = false;
+}
+
+template<typename T>
+std::size_t BasicTape<T>::size() const
+{
+  return nodes_.size();
+}
+
+template<typename T>
+BasicVariable<T> BasicTape<T>::push(Node node)
+{
+  node.shape = node.value.shape();
+  nodes_.push_back(std::move(node));
+  return Variable(this, nodes_.size() - 1);
+}
+
+template<typename T>
+const typename BasicTape<T>::Node &BasicTape<T>::node(const Variable &v) const
+{
+  if (v.tape() != this || v.id() >= nodes_.size())
+  {
+    throw std::invalid_argument("variable is not recorded on this tape");
+  }
+  return nodes_[v.id()];
+}
+
+// 要素型ごとの明示的インスタンス化
+#define NAGATO_INSTANTIATE_AUTOGRAD(T)                                                          \
+  template class BasicVariable<T>;                                                              \
+  template class BasicTape<T>;                                                                  \
+  template BasicVariable<T> operator+(const BasicVariable<T> &, const BasicVariable<T> &);      \
+  template BasicVariable<T> operator-(const BasicVariable<T> &, const BasicVariable<T> &);      \
+  template BasicVariable<T> operator*(const BasicVariable<T> &, const BasicVariable<T> &);      \
+  template BasicVariable<T> operator/(const BasicVariable<T> &, const BasicVariable<T> &);      \
+  template BasicVariable<T> operator-(const BasicVariable<T> &);                                \
+  template BasicVariable<T> operator+(const BasicVariable<T> &, std::type_identity_t<T>);       \
+  template BasicVariable<T> operator+(std::type_identity_t<T>, const BasicVariable<T> &);       \
+  template BasicVariable<T> operator-(const BasicVariable<T> &, std::type_identity_t<T>);       \
+  template BasicVariable<T> operator-(std::type_identity_t<T>, const BasicVariable<T> &);       \
+  template BasicVariable<T> operator*(const BasicVariable<T> &, std::type_identity_t<T>);       \
+  template BasicVariable<T> operator*(std::type_identity_t<T>, const BasicVariable<T> &);       \
+  template BasicVariable<T> operator/(const BasicVariable<T> &, std::type_identity_t<T>);
+
+NAGATO_INSTANTIATE_AUTOGRAD(float)
+NAGATO_INSTANTIATE_AUTOGRAD(double)
+
+#undef NAGATO_INSTANTIATE_AUTOGRAD
+
+} // namespace nagato
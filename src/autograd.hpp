@@ -0,0 +1,296 @@
+//
+// Created by toru on 2026/10/17.
+//
+
+#ifndef AUTOGRAD_HPP
+#define AUTOGRAD_HPP
+
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "tensor.hpp"
+
+namespace nagato
+{
+
+template<typename T>
+class BasicTape;
+
+/**
+ * @brief テープに記録したテンソルを指す変数
+ * @note 値はテープが保持し, 変数はテープと記録した位置だけを持つのでコピーは軽い.
+ *       演算は Tensor と同じく静的メンバ関数と演算子で表し, 結果を同じテープに記録する.
+ *       異なるテープの変数同士の演算は例外を送出する
+ * @tparam T 要素型 (float, double)
+ */
+template<typename T>
+class BasicVariable
+{
+  public:
+    using Tensor = BasicTensor<T>;
+    using Tape = BasicTape<T>;
+
+    BasicVariable() = default;
+
+    /**
+     * @brief 値
+     * @note 逆伝播で解放した途中の値を参照すると例外を送出する
+     */
+    const Tensor &value() const;
+
+    /**
+     * @brief 形状. 値を解放した後も参照できる
+     */
+    const Shape &shape() const;
+
+    /**
+     * @brief テープ上の位置
+     */
+    std::size_t id() const;
+
+    /**
+     * @brief 記録したテープ. 既定で構築した変数の場合は nullptr
+     */
+    Tape *tape() const;
+
+    /**
+     * @brief 形状を変える. 要素数は変えられない
+     * @param shape 新しい形状
+     * @return 変形した変数
+     */
+    BasicVariable Reshape(const Shape &shape) const;
+
+    /**
+     * @brief 行列の積. 2次元同士, または同じバッチサイズの3次元同士の積を計算する
+     * @param a 変数
+     * @param b 変数
+     * @return 行列の積
+     */
+    static BasicVariable Matmul(const BasicVariable &a, const BasicVariable &b);
+
+    /**
+     * @brief 2次元の変数を転置する
+     */
+    static BasicVariable Transpose(const BasicVariable &a);
+
+    static BasicVariable ReLU(const BasicVariable &a);
+
+    static BasicVariable Sigmoid(const BasicVariable &a);
+
+    static BasicVariable Exp(const BasicVariable &a);
+
+    static BasicVariable Log(const BasicVariable &a);
+
+    /**
+     * @brief 複数の軸に沿って総和を求める
+     * @param a 変数
+     * @param axes 軸. 空の場合はすべての軸
+     * @param keepdims 真の場合は縮約した軸を長さ 1 として残す
+     * @return 総和
+     */
+    static BasicVariable Sum(const BasicVariable &a, const std::vector<std::size_t> &axes = {}, bool keepdims = false);
+
+    /**
+     * @brief 複数の軸に沿って平均を求める
+     * @param a 変数
+     * @param axes 軸. 空の場合はすべての軸
+     * @param keepdims 真の場合は縮約した軸を長さ 1 として残す
+     * @return 平均
+     */
+    static BasicVariable Mean(const BasicVariable &a, const std::vector<std::size_t> &axes = {}, bool keepdims = false);
+
+    /**
+     * @brief Softmax と交差エントロピー誤差をまとめて計算する
+     * @note 順伝播で SoftmaxCrossEntropy (network.hpp) が損失と同時に求めた勾配を保存し, 逆伝播ではそれを返すだけにする
+     * @param x ロジット (N, C)
+     * @param t 教師データ. 勾配は求めない
+     * @return バッチで平均した損失 (要素数 1)
+     */
+    static BasicVariable SoftmaxCrossEntropy(const BasicVariable &x, const Tensor &t);
+
+  private:
+    friend class BasicTape<T>;
+
+    BasicVariable(Tape *tape, std::size_t id);
+
+    Tape *tape_ = nullptr;
+    std::size_t id_ = 0;
+};
+
+/**
+ * @brief 逆モードの自動微分のためにテンソルの演算を記録するテープ
+ * @note 演算は記録した順に並ぶため, 記録の逆順にたどるだけで出力から入力の順に勾配を伝播できる.
+ *       どの入力も勾配を必要としない演算は逆伝播の関数を保持しないので, 定数だけの計算は活性を残さない.
+ *       勾配は逆伝播の関数へ所有権ごと渡し, 要素ごとの演算は受け取った勾配の領域に入力の勾配を上書きする.
+ *       演算の逆伝播が終わった時点でその関数 (保存した活性) と出力の値, 出力の勾配を解放するので,
+ *       活性は最後に使われた直後に TensorMemoryPool へ戻り, 後に続く勾配の確保で再利用される.
+ *       勾配を保持するのは parameter で記録した変数だけである. 逆伝播は 1 つのテープにつき 1 回だけ行え,
+ *       次の反復では clear() してから記録し直す.
+ *       parameter はデータ領域を共有して記録するため, gradients で勾配を取り出して clear() してから
+ *       パラメータを更新すると, 更新時の複製が発生しない
+ * @tparam T 要素型 (float, double)
+ */
+template<typename T>
+class BasicTape
+{
+  public:
+    using Tensor = BasicTensor<T>;
+    using Variable = BasicVariable<T>;
+
+    /**
+     * @brief 逆伝播の関数. 出力の勾配を受け取り, accumulate で入力の勾配に足し込む.
+     * @note 勾配は所有権ごと渡すので, 書き換えてそのまま入力の勾配として渡してよい
+     */
+    using Backward = std::function<void(BasicTape &, Tensor &&)>;
+
+    BasicTape() = default;
+
+    // 変数がテープのアドレスを保持するため, コピーとムーブはできない
+    BasicTape(const BasicTape &) = delete;
+    BasicTape &operator=(const BasicTape &) = delete;
+
+    /**
+     * @brief 勾配を求めない値を記録する
+     * @param value 値. データ領域は共有し, コピーしない
+     */
+    Variable constant(const Tensor &value);
+
+    /**
+     * @brief 勾配を求める値を記録する
+     * @param value 値. データ領域は共有し, コピーしない
+     */
+    Variable parameter(const Tensor &value);
+
+    /**
+     * @brief 演算の結果を記録する
+     * @note 独自の演算を追加するときに使う. inputs のいずれも勾配を必要としない場合は backward を保持しない
+     * @param value 演算の結果
+     * @param inputs 演算の入力
+     * @param backward 逆伝播の関数
+     * @return 結果の変数
+     */
+    Variable record(Tensor value, const std::vector<Variable> &inputs, Backward backward);
+
+    /**
+     * @brief 変数の勾配に足し込む
+     * @note 形状が異なる場合はブロードキャストした軸の総和を取って変数の形状に戻す.
+     *       勾配を必要としない変数の場合は何もしない
+     * @param id 変数のテープ上の位置
+     * @param grad 勾配
+     */
+    void accumulate(std::size_t id, Tensor &&grad);
+
+    /**
+     * @brief 変数の勾配を求める必要があるかどうか
+     */
+    bool requires_grad(const Variable &v) const;
+
+    /**
+     * @brief loss から記録の逆順に勾配を伝播する
+     * @param loss 要素数 1 の変数
+     */
+    void backward(const Variable &loss);
+
+    /**
+     * @brief parameter で記録した変数の勾配
+     * @param v 変数
+     * @return 勾配. 逆伝播していない場合や勾配が伝わらなかった場合は例外を送出する
+     */
+    const Tensor &gradient(const Variable &v) const;
+
+    /**
+     * @brief 名前付きの変数の勾配を Optimizer の update に渡せる形でまとめる
+     * @note 勾配が伝わらなかった変数は 0 とする
+     * @param variables (名前, 変数) の組
+     * @return (名前, 勾配) の組
+     */
+    std::vector<std::pair<std::string, Tensor> > gradients(
+      const std::vector<std::pair<std::string, Variable> > &variables) const;
+
+    /**
+     * @brief 記録した演算と勾配をすべて破棄する. それまでの変数は使えなくなる
+     */
+    void clear();
+
+    /**
+     * @brief 記録した変数の数
+     */
+    std::size_t size() const;
+
+  private:
+    friend class BasicVariable<T>;
+
+    struct Node
+    {
+      Tensor value;
+      Shape shape;
+      bool requires_grad = false;
+      bool leaf = false;
+      bool released = false;
+      Backward backward;
+      std::optional<Tensor> grad;
+    };
+
+    Variable push(Node node);
+
+    const Node &node(const Variable &v) const;
+
+    std::vector<Node> nodes_;
+    bool backward_done_ = false;
+};
+
+template<typename T>
+BasicVariable<T> operator+(const BasicVariable<T> &a, const BasicVariable<T> &b);
+
+template<typename T>
+BasicVariable<T> operator-(const BasicVariable<T> &a, const BasicVariable<T> &b);
+
+template<typename T>
+BasicVariable<T> operator*(const BasicVariable<T> &a, const BasicVariable<T> &b);
+
+template<typename T>
+BasicVariable<T> operator/(const BasicVariable<T> &a, const BasicVariable<T> &b);
+
+template<typename T>
+BasicVariable<T> operator-(const BasicVariable<T> &a);
+
+/**
+ * @brief 変数とスカラーの演算. スカラーは変数の要素型に変換する
+ */
+template<typename T>
+BasicVariable<T> operator+(const BasicVariable<T> &a, std::type_identity_t<T> s);
+
+template<typename T>
+BasicVariable<T> operator+(std::type_identity_t<T> s, const BasicVariable<T> &a);
+
+template<typename T>
+BasicVariable<T> operator-(const BasicVariable<T> &a, std::type_identity_t<T> s);
+
+template<typename T>
+BasicVariable<T> operator-(std::type_identity_t<T> s, const BasicVariable<T> &a);
+
+template<typename T>
+BasicVariable<T> operator*(const BasicVariable<T> &a, std::type_identity_t<T> s);
+
+template<typename T>
+BasicVariable<T> operator*(std::type_identity_t<T> s, const BasicVariable<T> &a);
+
+template<typename T>
+BasicVariable<T> operator/(const BasicVariable<T> &a, std::type_identity_t<T> s);
+
+/// 倍精度の自動微分
+using Variable = BasicVariable<double>;
+using Tape = BasicTape<double>;
+
+/// 単精度の自動微分
+using Variablef = BasicVariable<float>;
+using Tapef = BasicTape<float>;
+
+} // namespace nagato
+
+#endif // AUTOGRAD_HPP
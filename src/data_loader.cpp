@@ -0,0 +1,177 @@
+//
+// Created by toru on 2026/10/17.
+//
+
+#include "data_loader.hpp"
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+namespace nagato
+{
+namespace
+{
+/**
+ * @brief order[start, start + rows) のサンプルを buffer に集める
+ * @note buffer の形状が同じ場合は確保せずにそのまま書き込む
+ */
+template<typename T>
+void GatherSamples(const BasicTensor<T> &source,
+                   const std::vector<std::size_t> &order,
+                   std::size_t start,
+                   std::size_t rows,
+                   BasicTensor<T> &buffer)
+{
+  const std::vector<std::size_t> indices(order.begin() + start, order.begin() + start + rows);
+  BasicTensor<T>::IndexSelect(source, 0, indices, buffer);
+}
+} // namespace
+
+template<typename T>
+BasicDataLoader<T>::BasicDataLoader(const Tensor &x,
+                                    const Tensor &t,
+                                    std::size_t batch_size,
+                                    bool shuffle,
+                                    std::size_t prefetch,
+                                    std::size_t num_workers,
+                                    bool drop_last,
+                                    std::uint32_t seed)
+  : x(x.Contiguous()),
+    t(t.Contiguous()),
+    sample_count(x.shape().empty() ? 0 : x.shape()[0]),
+    batch_size(batch_size),
+    shuffle(shuffle),
+    prefetch(prefetch),
+    batches_per_epoch(0),
+    rng(seed),
+    buffers(prefetch + 1)
+{
+  if (t.shape().empty() || t.shape()[0] != sample_count)
+  {
+    throw std::invalid_argument("DataLoader: x と t のサンプル数が一致しません");
+  }
+  if (sample_count == 0 || batch_size == 0 || (drop_last && batch_size > sample_count))
+  {
+    throw std::invalid_argument("DataLoader: バッチサイズはサンプル数以下の正の値にしてください");
+  }
+  batches_per_epoch = drop_last ? sample_count / batch_size : (sample_count + batch_size - 1) / batch_size;
+
+  if (num_workers > 0)
+  {
+    pool = std::make_unique<ThreadPool>(num_workers);
+  }
+  while (pending.size() < prefetch)
+  {
+    Schedule();
+  }
+}
+
+template<typename T>
+std::size_t BasicDataLoader<T>::DefaultNumWorkers()
+{
+  // 1 スレッドしか動かせない環境ではワーカーを作っても計算と重ならず, スレッドの切り替えの分だけ遅くなる
+  return std::thread::hardware_concurrency() > 1 ? 1 : 0;
+}
+
+template<typename T>
+BasicDataLoader<T>::~BasicDataLoader()
+{
+  // まだ始まっていない仕事は取り消し, 実行中の仕事だけ終わるのを待つ
+  for (auto &entry : pending)
+  {
+    entry.job->claimed.exchange(true);
+  }
+  for (auto &entry : pending)
+  {
+    if (entry.done.valid())
+    {
+      entry.done.wait();
+    }
+  }
+}
+
+template<typename T>
+typename BasicDataLoader<T>::Batch BasicDataLoader<T>::Next()
+{
+  if (pending.empty())
+  {
+    Schedule();
+  }
+  Pending front = std::move(pending.front());
+  pending.pop_front();
+  if (!front.job->claimed.exchange(true))
+  {
+    front.job->work();
+  }
+  else
+  {
+    front.done.get();
+  }
+
+  // 返したバッチのバッファは次の呼び出しまで使わないので, 1 つ前のバッチのバッファから埋め直す
+  Batch batch = buffers[consumed % buffers.size()];
+  ++consumed;
+  while (pending.size() < prefetch)
+  {
+    Schedule();
+  }
+  return batch;
+}
+
+template<typename T>
+std::size_t BasicDataLoader<T>::BatchesPerEpoch() const
+{
+  return batches_per_epoch;
+}
+
+template<typename T>
+std::size_t BasicDataLoader<T>::Epoch() const
+{
+  return consumed == 0 ? 0 : (consumed - 1) / batches_per_epoch;
+}
+
+template<typename T>
+void BasicDataLoader<T>::Schedule()
+{
+  const std::size_t seq = scheduled++;
+  const std::size_t index = seq % batches_per_epoch;
+  if (index == 0)
+  {
+    auto next = std::make_shared<std::vector<std::size_t> >(sample_count);
+    std::iota(next->begin(), next->end(), std::size_t(0));
+    if (shuffle)
+    {
+      std::shuffle(next->begin(), next->end(), rng);
+    }
+    order = std::move(next);
+  }
+
+  const std::size_t start = index * batch_size;
+  const std::size_t rows = std::min(batch_size, sample_count - start);
+  Batch &buffer = buffers[seq % buffers.size()];
+  auto job = std::make_shared<Job>();
+  job->work = [this, &buffer, samples = order, start, rows]()
+  {
+    GatherSamples(x, *samples, start, rows, buffer.x);
+    GatherSamples(t, *samples, start, rows, buffer.t);
+  };
+  std::future<void> done;
+  if (pool)
+  {
+    done = pool->EnqueuTask([job]()
+    {
+      if (!job->claimed.exchange(true))
+      {
+        job->work();
+      }
+    });
+  }
+  pending.push_back({std::move(job), std::move(done)});
+}
+
+template class BasicDataLoader<float>;
+template class BasicDataLoader<double>;
+
+} // namespace nagato
@@ -0,0 +1,159 @@
+//
+// Created by toru on 2026/10/17.
+//
+
+#ifndef DATA_LOADER_HPP
+#define DATA_LOADER_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "tensor.hpp"
+#include "thread.hpp"
+
+namespace nagato
+{
+
+/**
+ * @brief 入力と教師データからミニバッチを作るデータローダー
+ * @note エポックごとのシャッフルを受け持ち, 次の prefetch 個のバッチをワーカースレッド (ThreadPool) で
+ *       あらかじめ作っておく. バッチは prefetch + 1 個の使い回すバッファへサンプルの行を直接コピーして作るため,
+ *       定常状態ではバッチごとの確保が発生しない.
+ *       Next() で受け取ったバッチのバッファは次の Next() の呼び出しまで書き換えない. それより長く保持した場合も
+ *       テンソルのコピーオンライトによりワーカー側が新しい領域に書き込むため, 受け取ったバッチの値は変わらない.
+ *       Next() の時点でまだどのワーカーも取りかかっていないバッチは呼び出したスレッドで作るため,
+ *       ワーカーが CPU を得られない環境でもスレッドの切り替えを待たない.
+ *       ワーカーの数が 0 の場合はスレッドを作らず, 常に Next() の中でバッチを作る.
+ *       エポックの終わりに達すると自動的に次のエポックへ進むので, Next() は何回でも呼び出せる
+ */
+template<typename T>
+class BasicDataLoader
+{
+  public:
+    using Tensor = BasicTensor<T>;
+
+    /**
+     * @brief ミニバッチ
+     */
+    struct Batch
+    {
+      /**
+       * @brief 入力 (batch_size, ...)
+       */
+      Tensor x;
+
+      /**
+       * @brief 教師データ (batch_size, ...)
+       */
+      Tensor t;
+    };
+
+    /**
+     * @brief 既定のワーカースレッドの数
+     * @return ハードウェアスレッドが 2 つ以上ある場合は 1, 1 つしかない場合は 0
+     */
+    static std::size_t DefaultNumWorkers();
+
+    /**
+     * @param x 入力. 最初の軸がサンプル
+     * @param t 教師データ. 最初の軸がサンプルで, サンプル数は x と同じ
+     * @param batch_size バッチサイズ
+     * @param shuffle エポックごとにサンプルの順序をシャッフルするかどうか
+     * @param prefetch 先に作っておくバッチの数
+     * @param num_workers バッチを作るワーカースレッドの数. 0 の場合は Next() の中で作る
+     * @param drop_last バッチサイズに満たない最後のバッチを捨てるかどうか
+     * @param seed シャッフルの乱数のシード
+     */
+    BasicDataLoader(const Tensor &x,
+                    const Tensor &t,
+                    std::size_t batch_size,
+                    bool shuffle = true,
+                    std::size_t prefetch = 2,
+                    std::size_t num_workers = DefaultNumWorkers(),
+                    bool drop_last = true,
+                    std::uint32_t seed = std::random_device{}());
+
+    BasicDataLoader(const BasicDataLoader &) = delete;
+    BasicDataLoader &operator=(const BasicDataLoader &) = delete;
+
+    /**
+     * @note 作成中のバッチを待ってからワーカースレッドを終了する
+     */
+    ~BasicDataLoader();
+
+    /**
+     * @brief 次のバッチを取得する
+     * @note バッチができていない場合は完成するまで待つ
+     * @return バッチ
+     */
+    Batch Next();
+
+    /**
+     * @brief 1 エポックのバッチ数
+     */
+    std::size_t BatchesPerEpoch() const;
+
+    /**
+     * @brief 最後に Next() で返したバッチのエポック (0 始まり)
+     */
+    std::size_t Epoch() const;
+
+  private:
+    /**
+     * @brief 1 つのバッチを作る仕事. ワーカーと Next() のうち先に取りかかった方が実行する
+     */
+    struct Job
+    {
+      std::atomic<bool> claimed{false};
+      std::function<void()> work;
+    };
+
+    /**
+     * @brief スケジュール済みのバッチ
+     */
+    struct Pending
+    {
+      std::shared_ptr<Job> job;
+      std::future<void> done;
+    };
+
+    /**
+     * @brief 次のバッチ (scheduled 番目) をバッファへ作るタスクをワーカーに渡す
+     * @note エポックの最初のバッチではサンプルの順序を作り直す
+     */
+    void Schedule();
+
+    Tensor x;
+    Tensor t;
+    std::size_t sample_count;
+    std::size_t batch_size;
+    bool shuffle;
+    std::size_t prefetch;
+    std::size_t batches_per_epoch;
+    std::mt19937 rng;
+
+    /// スケジュール済みのバッチが属するエポックのサンプルの順序
+    std::shared_ptr<const std::vector<std::size_t> > order;
+
+    /// 使い回すバッファ. seq 番目のバッチは seq % buffers.size() 番目に作る
+    std::vector<Batch> buffers;
+    std::deque<Pending> pending;
+    std::size_t scheduled = 0;
+    std::size_t consumed = 0;
+
+    /// タスクがバッファを参照するため, 最後に宣言してバッファより先に破棄する. ワーカーが 0 の場合は nullptr
+    std::unique_ptr<ThreadPool> pool;
+};
+
+using DataLoader = BasicDataLoader<double>;
+using DataLoaderf = BasicDataLoader<float>;
+
+} // namespace nagato
+
+#endif // DATA_LOADER_HPP
@@ -0,0 +1,386 @@
+//
+// Created by toru on 2026/10/17.
+//
+
+#ifndef DTYPE_HPP
+#define DTYPE_HPP
+
+#include <bit>
+#include <cstdint>
+#include <ostream>
+#include <type_traits>
+
+#if defined(__F16C__)
+#include <immintrin.h>
+#endif
+
+namespace nagato
+{
+
+/**
+ * @brief テンソルの要素型として使用する 1 バイトの真偽値
+ * @note std::vector<bool> はビット単位で詰められ要素への参照を返せないため, bool の代わりに使用する
+ */
+struct Bool
+{
+  std::uint8_t value = 0;
+
+  constexpr Bool() noexcept = default;
+
+  constexpr Bool(bool v) noexcept : value(v ? 1 : 0)
+  {
+  }
+
+  template<typename U>
+    requires std::is_arithmetic_v<U>
+  constexpr Bool(U v) noexcept : value(v != U(0) ? 1 : 0)
+  {
+  }
+
+  constexpr operator bool() const noexcept
+  {
+    return value != 0;
+  }
+};
+
+inline std::ostream &operator<<(std::ostream &os, const Bool &b)
+{
+  return os << static_cast<int>(b.value);
+}
+
+/**
+ * @brief float を IEEE 754 の半精度 (binary16) のビット表現に変換する
+ * @note 最近接偶数丸め. 表現できない大きさの値は inf, NaN は quiet NaN になる. 非正規化数も正しく丸める.
+ *       F16C 命令を使える場合は実行時の変換にその命令を使う (結果は同じ)
+ * @param f 変換する値
+ * @return 半精度のビット表現
+ */
+constexpr std::uint16_t FloatToHalfBits(float f) noexcept
+{
+#if defined(__F16C__)
+  if !consteval
+  {
+    return static_cast<std::uint16_t>(_cvtss_sh(f, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+  }
+#endif
+  const std::uint32_t x = std::bit_cast<std::uint32_t>(f);
+  const auto sign = static_cast<std::uint16_t>((x >> 16) & 0x8000);
+  const std::uint32_t abs = x & 0x7fffffff;
+  if (abs > 0x7f800000)
+  {
+    return sign | 0x7e00 | static_cast<std::uint16_t>((abs >> 13) & 0x3ff);
+  }
+  // 65520 以上は半精度の最大値 65504 より inf に近い
+  if (abs >= 0x477ff000)
+  {
+    return sign | 0x7c00;
+  }
+  if (abs >= 0x38800000)
+  {
+    // 指数のバイアスを 127 から 15 に付け替え, 切り捨てる 13 ビットを最近接偶数に丸める
+    return sign | static_cast<std::uint16_t>((abs - 0x38000000 + 0xfff + ((abs >> 13) & 1)) >> 13);
+  }
+  // 2^-14 未満は 0.5 を加えて単位 2^-24 に丸め, 仮数部をそのまま非正規化数の仮数部として使う
+  const float denormal = std::bit_cast<float>(abs) + 0.5f;
+  return sign | static_cast<std::uint16_t>(std::bit_cast<std::uint32_t>(denormal) - 0x3f000000);
+}
+
+/**
+ * @brief IEEE 754 の半精度 (binary16) のビット表現を float に変換する
+ * @note 半精度の値はすべて float で正確に表現できる. signaling NaN は quiet NaN になる
+ * @param h 半精度のビット表現
+ * @return 変換した値
+ */
+constexpr float HalfBitsToFloat(std::uint16_t h) noexcept
+{
+#if defined(__F16C__)
+  if !consteval
+  {
+    return _cvtsh_ss(h);
+  }
+#endif
+  const std::uint32_t sign = static_cast<std::uint32_t>(h & 0x8000) << 16;
+  const std::uint32_t exponent = (h >> 10) & 0x1f;
+  const std::uint32_t mantissa = h & 0x3ff;
+  if (exponent == 0x1f)
+  {
+    // NaN は F16C の変換命令と同じく quiet NaN にする
+    return std::bit_cast<float>(sign | 0x7f800000 | (mantissa << 13) | (mantissa != 0 ? 0x400000 : 0));
+  }
+  if (exponent == 0)
+  {
+    return std::bit_cast<float>(sign | std::bit_cast<std::uint32_t>(static_cast<float>(mantissa) * 0x1p-24f));
+  }
+  return std::bit_cast<float>(sign | ((exponent + 112) << 23) | (mantissa << 13));
+}
+
+/**
+ * @brief float を bfloat16 のビット表現に変換する
+ * @note 最近接偶数丸め. NaN は quiet NaN になる.
+ *       非正規化数は AVX-512 BF16 の変換命令と同じく符号付きの 0 にするため, どちらで変換しても結果が一致する
+ * @param f 変換する値
+ * @return bfloat16 のビット表現
+ */
+constexpr std::uint16_t FloatToBFloat16Bits(float f) noexcept
+{
+  const std::uint32_t x = std::bit_cast<std::uint32_t>(f);
+  const std::uint32_t abs = x & 0x7fffffff;
+  if (abs > 0x7f800000)
+  {
+    return static_cast<std::uint16_t>((x >> 16) | 0x0040);
+  }
+  if (abs < 0x00800000)
+  {
+    return static_cast<std::uint16_t>((x >> 16) & 0x8000);
+  }
+  return static_cast<std::uint16_t>((x + 0x7fff + ((x >> 16) & 1)) >> 16);
+}
+
+/**
+ * @brief bfloat16 のビット表現を float に変換する
+ * @param b bfloat16 のビット表現
+ * @return 変換した値
+ */
+constexpr float BFloat16BitsToFloat(std::uint16_t b) noexcept
+{
+  return std::bit_cast<float>(static_cast<std::uint32_t>(b) << 16);
+}
+
+/**
+ * @brief テンソルの要素型として使用する IEEE 754 の半精度浮動小数点数 (binary16)
+ * @note 格納するだけの型で, 演算は float に変換して行う. 有効桁は 11 ビット, 最大値は 65504.
+ *       配列をまとめて変換する場合は VectorConvert を使う
+ */
+struct Half
+{
+  std::uint16_t bits = 0;
+
+  constexpr Half() noexcept = default;
+
+  template<typename U>
+    requires std::is_arithmetic_v<U>
+  constexpr Half(U v) noexcept : bits(FloatToHalfBits(static_cast<float>(v)))
+  {
+  }
+
+  constexpr operator float() const noexcept
+  {
+    return HalfBitsToFloat(bits);
+  }
+
+  /**
+   * @brief ビット表現から作る
+   */
+  static constexpr Half FromBits(std::uint16_t bits) noexcept
+  {
+    Half h;
+    h.bits = bits;
+    return h;
+  }
+
+  template<typename U>
+  constexpr Half &operator+=(const U &v) noexcept
+  {
+    return *this = Half(static_cast<float>(*this) + static_cast<float>(v));
+  }
+
+  template<typename U>
+  constexpr Half &operator-=(const U &v) noexcept
+  {
+    return *this = Half(static_cast<float>(*this) - static_cast<float>(v));
+  }
+
+  template<typename U>
+  constexpr Half &operator*=(const U &v) noexcept
+  {
+    return *this = Half(static_cast<float>(*this) * static_cast<float>(v));
+  }
+
+  template<typename U>
+  constexpr Half &operator/=(const U &v) noexcept
+  {
+    return *this = Half(static_cast<float>(*this) / static_cast<float>(v));
+  }
+};
+
+/**
+ * @brief テンソルの要素型として使用する bfloat16
+ * @note float の上位 16 ビットで, 指数部の範囲は float と同じだが有効桁は 8 ビットしかない.
+ *       Half と同じく格納するだけの型で, 演算は float に変換して行う
+ */
+struct BFloat16
+{
+  std::uint16_t bits = 0;
+
+  constexpr BFloat16() noexcept = default;
+
+  template<typename U>
+    requires std::is_arithmetic_v<U>
+  constexpr BFloat16(U v) noexcept : bits(FloatToBFloat16Bits(static_cast<float>(v)))
+  {
+  }
+
+  constexpr operator float() const noexcept
+  {
+    return BFloat16BitsToFloat(bits);
+  }
+
+  /**
+   * @brief ビット表現から作る
+   */
+  static constexpr BFloat16 FromBits(std::uint16_t bits) noexcept
+  {
+    BFloat16 b;
+    b.bits = bits;
+    return b;
+  }
+
+  template<typename U>
+  constexpr BFloat16 &operator+=(const U &v) noexcept
+  {
+    return *this = BFloat16(static_cast<float>(*this) + static_cast<float>(v));
+  }
+
+  template<typename U>
+  constexpr BFloat16 &operator-=(const U &v) noexcept
+  {
+    return *this = BFloat16(static_cast<float>(*this) - static_cast<float>(v));
+  }
+
+  template<typename U>
+  constexpr BFloat16 &operator*=(const U &v) noexcept
+  {
+    return *this = BFloat16(static_cast<float>(*this) * static_cast<float>(v));
+  }
+
+  template<typename U>
+  constexpr BFloat16 &operator/=(const U &v) noexcept
+  {
+    return *this = BFloat16(static_cast<float>(*this) / static_cast<float>(v));
+  }
+};
+
+inline std::ostream &operator<<(std::ostream &os, const Half &h)
+{
+  return os << static_cast<float>(h);
+}
+
+inline std::ostream &operator<<(std::ostream &os, const BFloat16 &b)
+{
+  return os << static_cast<float>(b);
+}
+
+/**
+ * @brief 16 ビットの浮動小数点数 (Half, BFloat16) かどうか
+ */
+template<typename T>
+inline constexpr bool is_reduced_precision_v = std::is_same_v<T, Half> || std::is_same_v<T, BFloat16>;
+
+/**
+ * @brief 型昇格の順位. 値が大きい型ほど表現できる範囲が広い
+ */
+template<typename T>
+struct dtype_rank;
+
+template<>
+struct dtype_rank<Bool> : std::integral_constant<int, 0>
+{
+};
+
+template<>
+struct dtype_rank<std::uint8_t> : std::integral_constant<int, 1>
+{
+};
+
+template<>
+struct dtype_rank<std::int32_t> : std::integral_constant<int, 2>
+{
+};
+
+template<>
+struct dtype_rank<BFloat16> : std::integral_constant<int, 3>
+{
+};
+
+template<>
+struct dtype_rank<Half> : std::integral_constant<int, 4>
+{
+};
+
+template<>
+struct dtype_rank<float> : std::integral_constant<int, 5>
+{
+};
+
+template<>
+struct dtype_rank<double> : std::integral_constant<int, 6>
+{
+};
+
+/**
+ * @brief 2つの要素型の演算結果の型
+ */
+template<typename A, typename B>
+struct promote
+{
+  using type = std::conditional_t<(dtype_rank<A>::value >= dtype_rank<B>::value), A, B>;
+};
+
+/**
+ * @note Half と BFloat16 は互いに相手の値を表現できないため float にする
+ */
+template<>
+struct promote<Half, BFloat16>
+{
+  using type = float;
+};
+
+template<>
+struct promote<BFloat16, Half>
+{
+  using type = float;
+};
+
+/**
+ * @brief 2つの要素型の演算結果の型
+ * @note Bool < uint8 < int32 < BFloat16 < Half < float < double の順に広い方の型へ昇格する.
+ *       整数と浮動小数点数の演算は浮動小数点数の型になる (int32 + float -> float).
+ *       Half と BFloat16 の演算は float になる
+ */
+template<typename A, typename B>
+using promote_t = typename promote<A, B>::type;
+
+/**
+ * @brief 要素型 T に対して超越関数などを計算するときの型
+ * @note float と 16 ビットの浮動小数点数は float で計算し, それ以外は double で計算する
+ */
+template<typename T>
+using compute_t = std::conditional_t<std::is_same_v<T, float> || is_reduced_precision_v<T>, float, double>;
+
+/**
+ * @brief 要素型を表示可能な型に変換する. uint8 が文字として表示されるのを防ぐ
+ */
+template<typename T>
+constexpr auto printable(const T &x) noexcept
+{
+  if constexpr (std::is_floating_point_v<T>)
+  {
+    return x;
+  }
+  else if constexpr (is_reduced_precision_v<T>)
+  {
+    return static_cast<float>(x);
+  }
+  else if constexpr (std::is_same_v<T, std::int32_t>)
+  {
+    return x;
+  }
+  else
+  {
+    return static_cast<int>(x);
+  }
+}
+
+} // namespace nagato
+
+#endif // DTYPE_HPP
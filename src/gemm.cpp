@@ -0,0 +1,438 @@
+//
+// Created by toru on 2026/10/17.
+//
+
+#include "gemm.hpp"
+#include "vector_math.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace nagato
+{
+namespace
+{
+// コンパイル時に利用できる SIMD レジスタのバイト数
+#if defined(__AVX512F__)
+constexpr std::size_t kSimdBytes = 64;
+#elif defined(__AVX__)
+constexpr std::size_t kSimdBytes = 32;
+#else
+constexpr std::size_t kSimdBytes = 16;
+#endif
+
+// パック領域のアライメント
+constexpr std::size_t kAlignment = 64;
+
+// この要素数 (M * N * K) 未満の行列積はパッキングせずに直接計算する
+constexpr std::size_t kSmallGemmThreshold = 32 * 32 * 32;
+
+/**
+ * @brief 要素型ごとのブロッキングパラメータ
+ * @note kMR x kNR がマイクロカーネルのレジスタタイル,
+ *       kKC x kNR の B パネルが L1, kMC x kKC の A ブロックが L2,
+ *       kKC x kNC の B ブロックが L3 に収まるように決める
+ */
+template<typename T>
+struct GemmTraits
+{
+  typedef T vector_type __attribute__((vector_size(kSimdBytes)));
+
+  static constexpr std::size_t kLanes = kSimdBytes / sizeof(T);
+  static constexpr std::size_t kNR = 2 * kLanes;
+  static constexpr std::size_t kMR = kSimdBytes == 64 ? 12 : 6;
+  static constexpr std::size_t kKC = 2048 / sizeof(T);
+  static constexpr std::size_t kMC = kMR * (sizeof(T) == 8 ? 10 : 20);
+  static constexpr std::size_t kNC = 4096;
+};
+
+/**
+ * @brief アライメントされた作業領域を返す. 呼び出しスレッドごとに再利用する
+ * @param slot 作業領域の識別子 (A 用, B 用)
+ * @param size 必要な要素数
+ * @return 作業領域の先頭ポインタ
+ */
+template<typename T>
+T *WorkBuffer(std::size_t slot, std::size_t size)
+{
+  thread_local std::vector<T> buffers[2];
+  auto &buffer = buffers[slot];
+  const std::size_t padding = kAlignment / sizeof(T);
+  if (buffer.size() < size + padding)
+  {
+    buffer.resize(size + padding);
+  }
+  const auto address = reinterpret_cast<std::uintptr_t>(buffer.data());
+  const auto aligned = (address + kAlignment - 1) & ~(kAlignment - 1);
+  return reinterpret_cast<T *>(aligned);
+}
+
+/**
+ * @brief A の mc x kc ブロックを kMR 行ごとのパネルに詰める. 端数の行は 0 で埋める
+ * @note S と T が異なる場合は T に変換しながら詰める
+ */
+template<typename T, typename S>
+void PackA(std::size_t mc,
+           std::size_t kc,
+           const S *A,
+           std::size_t rs_a,
+           std::size_t cs_a,
+           T *packed)
+{
+  constexpr std::size_t MR = GemmTraits<T>::kMR;
+  const std::size_t panels = (mc + MR - 1) / MR;
+
+#ifdef NAGATO_OPENMP
+  #pragma omp parallel for
+#endif
+  for (std::size_t p = 0; p < panels; ++p)
+  {
+    const std::size_t rows = std::min(MR, mc - p * MR);
+    const S *src = A + p * MR * rs_a;
+    T *dst = packed + p * MR * kc;
+    if constexpr (!std::is_same_v<T, S>)
+    {
+      // 行が連続している場合は 1 行ずつまとめて変換してから並べ替える
+      if (cs_a == 1)
+      {
+        alignas(kAlignment) T row[GemmTraits<T>::kKC];
+        std::size_t i = 0;
+        for (; i < rows; ++i)
+        {
+          VectorConvert(src + i * rs_a, row, kc);
+          for (std::size_t k = 0; k < kc; ++k)
+          {
+            dst[k * MR + i] = row[k];
+          }
+        }
+        for (; i < MR; ++i)
+        {
+          for (std::size_t k = 0; k < kc; ++k)
+          {
+            dst[k * MR + i] = 0;
+          }
+        }
+        continue;
+      }
+    }
+    for (std::size_t k = 0; k < kc; ++k)
+    {
+      std::size_t i = 0;
+      for (; i < rows; ++i)
+      {
+        dst[k * MR + i] = static_cast<T>(src[i * rs_a + k * cs_a]);
+      }
+      for (; i < MR; ++i)
+      {
+        dst[k * MR + i] = 0;
+      }
+    }
+  }
+}
+
+/**
+ * @brief B の kc x nc ブロックを kNR 列ごとのパネルに詰める. 端数の列は 0 で埋める
+ * @note S と T が異なる場合は T に変換しながら詰める. 連続した行は VectorConvert でまとめて変換する
+ */
+template<typename T, typename S>
+void PackB(std::size_t kc,
+           std::size_t nc,
+           const S *B,
+           std::size_t rs_b,
+           std::size_t cs_b,
+           T *packed)
+{
+  constexpr std::size_t NR = GemmTraits<T>::kNR;
+  const std::size_t panels = (nc + NR - 1) / NR;
+
+#ifdef NAGATO_OPENMP
+  #pragma omp parallel for
+#endif
+  for (std::size_t p = 0; p < panels; ++p)
+  {
+    const std::size_t cols = std::min(NR, nc - p * NR);
+    const S *src = B + p * NR * cs_b;
+    T *dst = packed + p * NR * kc;
+    for (std::size_t k = 0; k < kc; ++k)
+    {
+      const S *row = src + k * rs_b;
+      std::size_t j = 0;
+      if (cs_b == 1)
+      {
+        if constexpr (std::is_same_v<T, S>)
+        {
+          std::memcpy(dst + k * NR, row, cols * sizeof(T));
+        }
+        else
+        {
+          VectorConvert(row, dst + k * NR, cols);
+        }
+        j = cols;
+      }
+      for (; j < cols; ++j)
+      {
+        dst[k * NR + j] = static_cast<T>(row[j * cs_b]);
+      }
+      for (; j < NR; ++j)
+      {
+        dst[k * NR + j] = 0;
+      }
+    }
+  }
+}
+
+/**
+ * @brief kMR x kNR のタイルを計算するマイクロカーネル
+ * @param kc 内積の長さ
+ * @param a パック済みの A パネル
+ * @param b パック済みの B パネル
+ * @param c 出力先
+ * @param rs_c 出力先の行ストライド
+ * @param overwrite 真の場合は上書き, 偽の場合は加算する
+ */
+template<typename T>
+void MicroKernel(std::size_t kc,
+                 const T *__restrict a,
+                 const T *__restrict b,
+                 T *__restrict c,
+                 std::size_t rs_c,
+                 bool overwrite)
+{
+  using Traits = GemmTraits<T>;
+  using vector_type = typename Traits::vector_type;
+  constexpr std::size_t MR = Traits::kMR;
+  constexpr std::size_t NR = Traits::kNR;
+  constexpr std::size_t NV = NR / Traits::kLanes;
+
+  // アキュムレータはすべてレジスタに載るように展開する
+  vector_type acc[MR][NV] = {};
+  for (std::size_t k = 0; k < kc; ++k)
+  {
+    vector_type bv[NV];
+#pragma GCC unroll 4
+    for (std::size_t j = 0; j < NV; ++j)
+    {
+      bv[j] = *reinterpret_cast<const vector_type *>(b + j * Traits::kLanes);
+    }
+#pragma GCC unroll 16
+    for (std::size_t i = 0; i < MR; ++i)
+    {
+      const T av = a[i];
+#pragma GCC unroll 4
+      for (std::size_t j = 0; j < NV; ++j)
+      {
+        acc[i][j] += bv[j] * av;
+      }
+    }
+    a += MR;
+    b += NR;
+  }
+
+#pragma GCC unroll 16
+  for (std::size_t i = 0; i < MR; ++i)
+  {
+#pragma GCC unroll 4
+    for (std::size_t j = 0; j < NV; ++j)
+    {
+      T *dst = c + i * rs_c + j * Traits::kLanes;
+      vector_type value = acc[i][j];
+      if (!overwrite)
+      {
+        vector_type old;
+        std::memcpy(&old, dst, sizeof(vector_type));
+        value += old;
+      }
+      std::memcpy(dst, &value, sizeof(vector_type));
+    }
+  }
+}
+
+/**
+ * @brief パック済みの A ブロックと B ブロックの積を C に書き込む (マクロカーネル)
+ */
+template<typename T>
+void MacroKernel(std::size_t mc,
+                 std::size_t nc,
+                 std::size_t kc,
+                 const T *packed_a,
+                 const T *packed_b,
+                 T *C,
+                 std::size_t rs_c,
+                 bool overwrite)
+{
+  using Traits = GemmTraits<T>;
+  constexpr std::size_t MR = Traits::kMR;
+  constexpr std::size_t NR = Traits::kNR;
+  const std::size_t m_panels = (mc + MR - 1) / MR;
+  const std::size_t n_panels = (nc + NR - 1) / NR;
+  const std::size_t tiles = m_panels * n_panels;
+
+  // N 方向と M 方向のタイルをまとめて並列化する
+#ifdef NAGATO_OPENMP
+  #pragma omp parallel for schedule(static)
+#endif
+  for (std::size_t t = 0; t < tiles; ++t)
+  {
+    const std::size_t jr = t / m_panels;
+    const std::size_t ir = t % m_panels;
+    const std::size_t rows = std::min(MR, mc - ir * MR);
+    const std::size_t cols = std::min(NR, nc - jr * NR);
+    const T *a = packed_a + ir * MR * kc;
+    const T *b = packed_b + jr * NR * kc;
+    T *c = C + ir * MR * rs_c + jr * NR;
+
+    if (rows == MR && cols == NR)
+    {
+      MicroKernel(kc, a, b, c, rs_c, overwrite);
+      continue;
+    }
+
+    // 端数のタイルは一時領域で計算してから必要な部分だけ書き戻す
+    alignas(kAlignment) T tile[MR * NR];
+    MicroKernel(kc, a, b, tile, NR, true);
+    for (std::size_t i = 0; i < rows; ++i)
+    {
+      for (std::size_t j = 0; j < cols; ++j)
+      {
+        if (overwrite)
+        {
+          c[i * rs_c + j] = tile[i * NR + j];
+        }
+        else
+        {
+          c[i * rs_c + j] += tile[i * NR + j];
+        }
+      }
+    }
+  }
+}
+
+/**
+ * @brief 小さな行列積をパッキングせずに計算する
+ */
+template<typename T, typename S>
+void SmallGemm(std::size_t M,
+               std::size_t N,
+               std::size_t K,
+               const S *A,
+               std::size_t rs_a,
+               std::size_t cs_a,
+               const S *B,
+               std::size_t rs_b,
+               std::size_t cs_b,
+               T *C,
+               std::size_t rs_c,
+               bool accumulate)
+{
+  for (std::size_t i = 0; i < M; ++i)
+  {
+    T *c = C + i * rs_c;
+    if (!accumulate)
+    {
+      std::fill(c, c + N, T(0));
+    }
+    for (std::size_t k = 0; k < K; ++k)
+    {
+      const T a = static_cast<T>(A[i * rs_a + k * cs_a]);
+      const S *b = B + k * rs_b;
+      for (std::size_t j = 0; j < N; ++j)
+      {
+        c[j] += a * static_cast<T>(b[j * cs_b]);
+      }
+    }
+  }
+}
+} // namespace
+
+template<typename T, typename S>
+void Gemm(std::size_t M,
+          std::size_t N,
+          std::size_t K,
+          const S *A,
+          std::size_t rs_a,
+          std::size_t cs_a,
+          const S *B,
+          std::size_t rs_b,
+          std::size_t cs_b,
+          T *C,
+          std::size_t rs_c,
+          bool accumulate)
+{
+  if (M == 0 || N == 0)
+  {
+    return;
+  }
+
+  if (K == 0)
+  {
+    if (!accumulate)
+    {
+      for (std::size_t i = 0; i < M; ++i)
+      {
+        std::fill(C + i * rs_c, C + i * rs_c + N, T(0));
+      }
+    }
+    return;
+  }
+
+  if (M * N * K < kSmallGemmThreshold)
+  {
+    SmallGemm(M, N, K, A, rs_a, cs_a, B, rs_b, cs_b, C, rs_c, accumulate);
+    return;
+  }
+
+  using Traits = GemmTraits<T>;
+  constexpr std::size_t MR = Traits::kMR;
+  constexpr std::size_t NR = Traits::kNR;
+  constexpr std::size_t KC = Traits::kKC;
+  constexpr std::size_t MC = Traits::kMC;
+  constexpr std::size_t NC = Traits::kNC;
+
+  const std::size_t kc_max = std::min(KC, K);
+  T *packed_a = WorkBuffer<T>(0, ((std::min(MC, M) + MR - 1) / MR) * MR * kc_max);
+  T *packed_b = WorkBuffer<T>(1, ((std::min(NC, N) + NR - 1) / NR) * NR * kc_max);
+
+  // BLIS と同様の 5 重ループ (jc -> pc -> ic -> jr -> ir)
+  for (std::size_t jc = 0; jc < N; jc += NC)
+  {
+    const std::size_t nc = std::min(NC, N - jc);
+    for (std::size_t pc = 0; pc < K; pc += KC)
+    {
+      const std::size_t kc = std::min(KC, K - pc);
+      const bool overwrite = pc == 0 && !accumulate;
+      PackB(kc, nc, B + pc * rs_b + jc * cs_b, rs_b, cs_b, packed_b);
+
+      for (std::size_t ic = 0; ic < M; ic += MC)
+      {
+        const std::size_t mc = std::min(MC, M - ic);
+        PackA(mc, kc, A + ic * rs_a + pc * cs_a, rs_a, cs_a, packed_a);
+        MacroKernel(mc, nc, kc, packed_a, packed_b, C + ic * rs_c + jc, rs_c, overwrite);
+      }
+    }
+  }
+}
+
+// 要素型ごとの明示的インスタンス化. 16 ビットの浮動小数点数は float で累積する
+#define NAGATO_INSTANTIATE_GEMM(T, S)                                                                  \
+  template void Gemm<T, S>(std::size_t,                                                               \
+                           std::size_t,                                                               \
+                           std::size_t,                                                               \
+                           const S *,                                                                 \
+                           std::size_t,                                                               \
+                           std::size_t,                                                               \
+                           const S *,                                                                 \
+                           std::size_t,                                                               \
+                           std::size_t,                                                               \
+                           T *,                                                                       \
+                           std::size_t,                                                               \
+                           bool);
+
+NAGATO_INSTANTIATE_GEMM(float, float)
+NAGATO_INSTANTIATE_GEMM(double, double)
+NAGATO_INSTANTIATE_GEMM(float, Half)
+NAGATO_INSTANTIATE_GEMM(float, BFloat16)
+
+#undef NAGATO_INSTANTIATE_GEMM
+
+} // namespace nagato
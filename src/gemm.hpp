@@ -0,0 +1,53 @@
+//
+// Created by toru on 2026/10/17.
+//
+
+#ifndef GEMM_HPP
+#define GEMM_HPP
+
+#include <cstddef>
+
+#include "dtype.hpp"
+
+namespace nagato
+{
+
+/**
+ * @brief 行列積 C = A * B を計算する (GEMM)
+ * @note A, B は任意のストライドを持つことができる (転置済みの行列もコピーせずに渡せる).
+ *       C は行方向に連続している必要がある.
+ *       内部ではパネルへのパッキングと L1/L2/L3 キャッシュブロッキングを行い,
+ *       レジスタタイルのマイクロカーネル (AVX2/AVX-512 など, コンパイル時の SIMD 幅に合わせる) で計算する.
+ *       NAGATO_OPENMP が有効な場合は M/N 方向のブロックを並列に計算する.
+ *       A, B が 16 ビットの浮動小数点数 (Half, BFloat16) の場合はパッキングするときに float へ変換し,
+ *       float のマイクロカーネルで累積する (C は float)
+ * @param M A と C の行数
+ * @param N B と C の列数
+ * @param K A の列数 (B の行数)
+ * @param A 行列 A の先頭ポインタ
+ * @param rs_a A の行ストライド
+ * @param cs_a A の列ストライド
+ * @param B 行列 B の先頭ポインタ
+ * @param rs_b B の行ストライド
+ * @param cs_b B の列ストライド
+ * @param C 行列 C の先頭ポインタ
+ * @param rs_c C の行ストライド
+ * @param accumulate 真の場合は C += A * B, 偽の場合は C = A * B とする
+ */
+template<typename T, typename S>
+void Gemm(std::size_t M,
+          std::size_t N,
+          std::size_t K,
+          const S *A,
+          std::size_t rs_a,
+          std::size_t cs_a,
+          const S *B,
+          std::size_t rs_b,
+          std::size_t cs_b,
+          T *C,
+          std::size_t rs_c,
+          bool accumulate = false);
+
+} // namespace nagato
+
+#endif // GEMM_HPP
@@ -0,0 +1,57 @@
+//
+// Created by toru on 2026/10/17.
+//
+
+#include "mapped_file.hpp"
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace nagato
+{
+
+MappedFile::MappedFile(const std::string &filename, bool populate)
+{
+  const int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+  {
+    throw std::runtime_error("ファイルを開くことができませんでした: " + filename);
+  }
+  struct stat st{};
+  if (::fstat(fd, &st) != 0)
+  {
+    ::close(fd);
+    throw std::runtime_error("ファイルの大きさを取得できませんでした: " + filename);
+  }
+  size_ = static_cast<std::size_t>(st.st_size);
+  if (size_ == 0)
+  {
+    ::close(fd);
+    throw std::invalid_argument("file is empty: " + filename);
+  }
+
+  int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+  if (populate)
+  {
+    flags |= MAP_POPULATE;
+  }
+#endif
+  void *data = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, flags, fd, 0);
+  ::close(fd);
+  if (data == MAP_FAILED)
+  {
+    throw std::runtime_error("ファイルをメモリに割り当てることができませんでした: " + filename);
+  }
+  data_ = static_cast<unsigned char *>(data);
+}
+
+MappedFile::~MappedFile()
+{
+  ::munmap(data_, size_);
+}
+
+} // namespace nagato
@@ -0,0 +1,59 @@
+//
+// Created by toru on 2026/10/17.
+//
+
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <string>
+
+namespace nagato
+{
+
+/**
+ * @brief ファイル全体をプライベートにメモリへ割り当てる
+ * @note 割り当てた領域は書き込み可能だが, 書き込んだページだけ複製されるためファイルには反映されない.
+ *       破棄すると割り当てを解除する
+ */
+class MappedFile
+{
+  public:
+    /**
+     * @brief ファイルを割り当てる
+     * @param filename ファイル名
+     * @param populate すぐにすべてのページを読み込むかどうか. 全体を読む場合は true にするとページフォルトが減る
+     * @throws std::runtime_error ファイルを開けない場合
+     * @throws std::invalid_argument ファイルが空の場合
+     */
+    MappedFile(const std::string &filename, bool populate);
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    ~MappedFile();
+
+    /**
+     * @brief 割り当てた領域の先頭
+     */
+    unsigned char *data() const
+    {
+      return data_;
+    }
+
+    /**
+     * @brief ファイルのバイト数
+     */
+    std::size_t size() const
+    {
+      return size_;
+    }
+
+  private:
+    unsigned char *data_ = nullptr;
+    std::size_t size_ = 0;
+};
+
+} // namespace nagato
+
+#endif // MAPPED_FILE_HPP
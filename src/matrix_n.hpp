@@ -7,6 +7,7 @@
 #include "assert.hpp"
 #include "type_traits.hpp"
 #include "random.hpp"
+#include <cassert>
 #include <iostream>
 #include <vector>
 
@@ -11,8 +11,14 @@
 #include "matrix.hpp"
 #include "matrix_n.hpp"
 #include "thread.hpp"
+#include "gemm.hpp"
+#include "vector_math.hpp"
 #include "tensor.hpp"
 #include "network.hpp"
+#include "npy.hpp"
+#include "data_loader.hpp"
+#include "quantize.hpp"
+#include "autograd.hpp"
 #include "../Metal/timer.hpp"
 
 namespace nagato {
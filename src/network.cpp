@@ -4,12 +4,23 @@
 
 #include "network.hpp"
 #include "tensor.hpp"
+#include "gemm.hpp"
+#include "vector_math.hpp"
 #include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <utility>
+#include <vector>
 
 namespace nagato
 {
-Tensor MeanSquaredError(const Tensor &y, const Tensor &t)
+template<typename T>
+BasicTensor<T> MeanSquaredError(const BasicTensor<T> &y, const BasicTensor<T> &t)
 {
+  using Tensor = BasicTensor<T>;
   Tensor::IsSameShape(y, t);
   const Tensor diff = y - t;
   const Tensor square = diff * diff;
@@ -17,8 +28,10 @@ Tensor MeanSquaredError(const Tensor &y, const Tensor &t)
   return sum;
 }
 
-Tensor CrossEntropyError(const Tensor &y, const Tensor &t)
+template<typename T>
+BasicTensor<T> CrossEntropyError(const BasicTensor<T> &y, const BasicTensor<T> &t)
 {
+  using Tensor = BasicTensor<T>;
   // 入力テンソル y が (N, 1, D) の形状である場合, 1次元の軸を削除する.
   Tensor y_copy = y;
   if (y.shape().size() == 3 && y.shape()[1] == 1)
@@ -26,17 +39,17 @@ Tensor CrossEntropyError(const Tensor &y, const Tensor &t)
     y_copy = y_copy.Reshape({y_copy.shape()[0], y_copy.shape()[2]});
   }
   Tensor::IsSameShape(y_copy, t);
-  constexpr Tensor::value_type delta = 1e-7f;
+  constexpr T delta = 1e-7f;
   const auto &y_shape = y_copy.shape();
   size_t dim = y_shape.size();
 
   // 1次元の場合はバッチサイズ1として処理する
   if (dim == 1)
   {
-    size_t num_classes = y_copy.storage().size();
+    size_t num_classes = y_copy.size();
     // 教師データが one-hot vector の場合、argmax で正解ラベルのインデックスを取得
     size_t label_index = 0;
-    Tensor::value_type max_val = t(0);
+    T max_val = t(0);
     for (size_t i = 1; i < num_classes; ++i)
     {
       if (t(i) > max_val)
@@ -45,7 +58,7 @@ Tensor CrossEntropyError(const Tensor &y, const Tensor &t)
         label_index = i;
       }
     }
-    Tensor::value_type loss = -std::log(y_copy(label_index) + delta);
+    T loss = -std::log(y_copy(label_index) + delta);
     return Tensor::FromArray({loss});
   }
   // 2次元の場合 (バッチサイズ, クラス数)
@@ -55,12 +68,12 @@ Tensor CrossEntropyError(const Tensor &y, const Tensor &t)
     size_t num_classes = y_shape[1];
 
     // 教師データが one-hot vector の場合、全要素数が y と同じになる前提で処理する
-    if (t.storage().size() == y.storage().size())
+    if (t.size() == y.size())
     {
       std::vector<size_t> label_indices(batch_size, 0);
       for (size_t i = 0; i < batch_size; ++i)
       {
-        Tensor::value_type max_val = t(i, 0);
+        T max_val = t(i, 0);
         size_t max_index = 0;
         // 各行（サンプル）ごとに正解ラベルのインデックスを判定
         for (size_t j = 1; j < num_classes; ++j)
@@ -74,25 +87,27 @@ Tensor CrossEntropyError(const Tensor &y, const Tensor &t)
         label_indices[i] = max_index;
       }
 
-      Tensor::value_type total_loss = 0.0f;
+      T total_loss = 0.0f;
       for (size_t i = 0; i < batch_size; ++i)
       {
         total_loss += -std::log(y_copy(i, label_indices[i]) + delta);
       }
-      total_loss /= static_cast<Tensor::value_type>(batch_size); // バッチ平均
+      total_loss /= static_cast<T>(batch_size); // バッチ平均
       return Tensor::FromArray({total_loss});
     }
     else
     {
       // もし教師データがすでに正解クラスの確率情報（one-hot でない場合）なら、要素ごとの積を計算
-      Tensor::value_type total_loss = 0.0f;
-      const auto &y_storage = y_copy.storage();
-      const auto &t_storage = t.storage();
-      for (size_t i = 0; i < y_storage.size(); ++i)
+      T total_loss = 0.0f;
+      const Tensor y_values = y_copy.Contiguous();
+      const Tensor t_values = t.Contiguous();
+      const T *y_data = y_values.data();
+      const T *t_data = t_values.data();
+      for (size_t i = 0; i < y_values.size(); ++i)
       {
-        total_loss += -std::log(y_storage[i] + delta) * t_storage[i];
+        total_loss += -std::log(y_data[i] + delta) * t_data[i];
       }
-      total_loss /= static_cast<Tensor::value_type>(batch_size);
+      total_loss /= static_cast<T>(batch_size);
       return Tensor::FromArray({total_loss});
     }
   }
@@ -102,30 +117,151 @@ Tensor CrossEntropyError(const Tensor &y, const Tensor &t)
   }
 }
 
-Tensor Layer::get_dW() const
+namespace
+{
+/**
+ * @brief 1 行の勾配 (e / sum - t) / N を書き込み, 損失 Σ t * (lse - x) を返す
+ * @note g には exp(x - max) が入っている. 独立した累積変数で SIMD 命令を使えるようにする
+ */
+template<typename T>
+T SoftmaxCrossEntropyRow(const T *__restrict x,
+                         const T *__restrict t,
+                         T *__restrict g,
+                         std::size_t n,
+                         T lse,
+                         T inverse_sum,
+                         T inverse_rows)
+{
+  constexpr std::size_t kLanes = 8;
+  T acc[kLanes] = {};
+  std::size_t j = 0;
+  for (; j + kLanes <= n; j += kLanes)
+  {
+    for (std::size_t k = 0; k < kLanes; ++k)
+    {
+      acc[k] += t[j + k] * (lse - x[j + k]);
+      g[j + k] = (g[j + k] * inverse_sum - t[j + k]) * inverse_rows;
+    }
+  }
+  for (; j < n; ++j)
+  {
+    acc[0] += t[j] * (lse - x[j]);
+    g[j] = (g[j] * inverse_sum - t[j]) * inverse_rows;
+  }
+
+  T loss = 0;
+  for (const T a : acc)
+  {
+    loss += a;
+  }
+  return loss;
+}
+} // namespace
+
+template<typename T>
+BasicTensor<T> SoftmaxCrossEntropy(const BasicTensor<T> &x, const BasicTensor<T> &t, BasicTensor<T> *grad)
+{
+  using Tensor = BasicTensor<T>;
+  if (x.shape().empty() || x.size() == 0)
+  {
+    throw std::invalid_argument("SoftmaxCrossEntropy requires a non-empty tensor");
+  }
+  const std::size_t classes = x.shape().back();
+  const std::size_t rows = x.size() / classes;
+  // C == 1 のときは要素数が一致してしまうので, 形状で one-hot (x と同じ形状) とクラス番号 (N) を区別する
+  const bool labels = t.shape() != x.shape();
+  if (labels && t.shape() != Shape{rows})
+  {
+    throw std::invalid_argument("Target must have the same shape as the logits or one label per row");
+  }
+
+  const Tensor logits = x.Contiguous();
+  const Tensor target = t.Contiguous();
+  const T *x_data = logits.data();
+  const T *t_data = target.data();
+  if (labels)
+  {
+    for (std::size_t i = 0; i < rows; ++i)
+    {
+      // NaN や範囲外の値を整数に変換すると未定義動作になるため, 変換する前に確認する
+      if (!std::isfinite(t_data[i]) || t_data[i] < 0 || t_data[i] >= static_cast<T>(classes))
+      {
+        throw std::invalid_argument("Label is out of range");
+      }
+    }
+  }
+
+  // 勾配を求めない場合も exp の作業領域として使う
+  Tensor scratch;
+  Tensor &g = grad ? *grad : scratch;
+  g = Tensor(x.shape());
+  T *g_data = g.data();
+
+  const T inverse_rows = static_cast<T>(1) / static_cast<T>(rows);
+  std::vector<T> row_loss(rows);
+#ifdef NAGATO_OPENMP
+  #pragma omp parallel for if (x.size() > 65536)
+#endif
+  for (std::size_t i = 0; i < rows; ++i)
+  {
+    const T *xr = x_data + i * classes;
+    T *gr = g_data + i * classes;
+
+    // 1 行はキャッシュに載ったまま最大値, exp と合計, 損失と勾配の順に計算する
+    const T max = VectorMax(xr, classes);
+    const T sum = VectorExpSum(xr, max, gr, classes);
+    const T lse = max + std::log(sum);
+    const T inverse_sum = static_cast<T>(1) / sum;
+
+    if (labels)
+    {
+      const auto label = static_cast<std::size_t>(t_data[i]);
+      row_loss[i] = lse - xr[label];
+      const T scale = inverse_sum * inverse_rows;
+      for (std::size_t j = 0; j < classes; ++j)
+      {
+        gr[j] *= scale;
+      }
+      gr[label] -= inverse_rows;
+    }
+    else
+    {
+      row_loss[i] = SoftmaxCrossEntropyRow(xr, t_data + i * classes, gr, classes, lse, inverse_sum, inverse_rows);
+    }
+  }
+
+  // 行の順に足し合わせ, 並列化しても同じ結果にする
+  T total = 0;
+  for (const T loss : row_loss)
+  {
+    total += loss;
+  }
+  return Tensor::FromArray({total * inverse_rows});
+}
+
+template<typename T>
+BasicTensor<T> BasicLayer<T>::get_dW() const
 {
   return this->dW;
 }
 
-Tensor Layer::get_db() const
+template<typename T>
+BasicTensor<T> BasicLayer<T>::get_db() const
 {
   return this->db;
 }
-ReLU::ReLU()
+template<typename T>
+BasicReLU<T>::BasicReLU()
 {
 }
 
-Tensor ReLU::forward(const Tensor &x)
+template<typename T>
+BasicTensor<T> BasicReLU<T>::forward(const Tensor &x)
 {
   // backward で利用するため、入力の値（または mask）を保持
   this->input_ = x;
-  Tensor result = Tensor::Zeros(x.shape());
-  auto &x_storage = x.storage();
-  auto &result_storage = result.storage();
-  for (std::size_t i = 0; i < x_storage.size(); ++i)
-  {
-    result_storage[i] = std::max(static_cast<Tensor::value_type>(0), x_storage[i]);
-  }
+  Tensor result = x;
+  result.ReLU_();
 
   // 入出力層の形状を表示
   // std::cout << "ReLU forward input shape: ";
@@ -136,22 +272,26 @@ Tensor ReLU::forward(const Tensor &x)
   return result;
 }
 
-Tensor ReLU::forward(const Tensor &x, const Tensor &y)
+template<typename T>
+BasicTensor<T> BasicReLU<T>::forward(const Tensor &x, const Tensor &y)
 {
   throw std::invalid_argument("ReLU layer does not support two input tensors");
 }
 
-Tensor ReLU::backward(const Tensor &dout)
+template<typename T>
+BasicTensor<T> BasicReLU<T>::backward(const Tensor &dout)
 {
   // 保存しておいた入力に基づいて勾配を計算する:
   // x > 0 なら dout のまま、x <= 0 なら 0 とする
   Tensor dx = Tensor::Zeros(dout.shape());
-  auto &dx_storage = dx.storage();
-  auto &dout_storage = dout.storage();
-  auto &input_storage = this->input_.storage();
-  for (std::size_t i = 0; i < input_storage.size(); ++i)
+  const Tensor dout_values = dout.Contiguous();
+  const Tensor input_values = this->input_.Contiguous();
+  const T *dout_data = dout_values.data();
+  const T *input_data = input_values.data();
+  T *dx_data = dx.data();
+  for (std::size_t i = 0; i < input_values.size(); ++i)
   {
-    dx_storage[i] = (input_storage[i] > 0) ? dout_storage[i] : 0.0f;
+    dx_data[i] = (input_data[i] > 0) ? dout_data[i] : 0.0f;
   }
 
   // 入出力層の形状を表示
@@ -162,33 +302,50 @@ Tensor ReLU::backward(const Tensor &dout)
   return dx;
 }
 
-Tensor ReLU::ReluFunction(const Tensor &x)
+template<typename T>
+BasicTensor<T> BasicReLU<T>::ReluFunction(const Tensor &x)
 {
-  return Tensor::Transform(x, [](const Tensor::value_type &x) { return x > 0 ? x : 0; });
+  return Tensor::Transform(x, [](const T &x) { return x > 0 ? x : 0; });
 }
 
-Tensor Sigmoid::forward(const Tensor &x)
+template<typename T>
+BasicTensor<T> BasicSigmoid<T>::forward(const Tensor &x)
 {
-  out = 1.0 / (1.0 + Tensor::Exp(-x));
+  out = Tensor::Sigmoid(x);
   return out;
 }
 
-Tensor Sigmoid::forward(const Tensor &x, const Tensor &y)
+template<typename T>
+BasicTensor<T> BasicSigmoid<T>::forward(const Tensor &x, const Tensor &y)
 {
   throw std::invalid_argument("Sigmoid layer does not support two input tensors");
 }
 
-Tensor Sigmoid::backward(const Tensor &dout)
+template<typename T>
+BasicTensor<T> BasicSigmoid<T>::backward(const Tensor &dout)
 {
   return dout * (1.0 - out) * out;
 }
 
-Affine::Affine(const std::shared_ptr<Tensor> &W, const std::shared_ptr<Tensor> &b): W(W), b(b)
+template<typename T>
+BasicAffine<T>::BasicAffine(const std::shared_ptr<Tensor> &W,
+                            const std::shared_ptr<Tensor> &b,
+                            TrainingPrecision precision): W(W), b(b), precision(precision)
 {
 }
 
-Tensor Affine::forward(const Tensor &x)
+template<typename T>
+BasicTensor<T> BasicAffine<T>::forward(const Tensor &x)
 {
+  if (precision == TrainingPrecision::Half)
+  {
+    return forward_reduced(x, x_half, W_half);
+  }
+  if (precision == TrainingPrecision::BFloat16)
+  {
+    return forward_reduced(x, x_bf16, W_bf16);
+  }
+
   this->x = x;
 
   Tensor z = Tensor::Matmul(x, *W);
@@ -207,13 +364,24 @@ Tensor Affine::forward(const Tensor &x)
   return result;
 }
 
-Tensor Affine::forward(const Tensor &x, const Tensor &y)
+template<typename T>
+BasicTensor<T> BasicAffine<T>::forward(const Tensor &x, const Tensor &y)
 {
   throw std::invalid_argument("Affine layer does not support two input tensors");
 }
 
-Tensor Affine::backward(const Tensor &dout)
+template<typename T>
+BasicTensor<T> BasicAffine<T>::backward(const Tensor &dout)
 {
+  if (precision == TrainingPrecision::Half)
+  {
+    return backward_reduced(dout, x_half, W_half);
+  }
+  if (precision == TrainingPrecision::BFloat16)
+  {
+    return backward_reduced(dout, x_bf16, W_bf16);
+  }
+
   Tensor W_T = Tensor::Transpose(*W);
   Tensor x_T = Tensor::Transpose(x);
 
@@ -235,16 +403,42 @@ Tensor Affine::backward(const Tensor &dout)
   return dx;
 }
 
-Tensor SoftmaxWithLoss::forward(const Tensor &x)
+template<typename T>
+template<typename R>
+BasicTensor<T> BasicAffine<T>::forward_reduced(const Tensor &x, BasicTensor<R> &x_reduced, BasicTensor<R> &W_reduced)
+{
+  x_reduced = x.template AsType<R>();
+  W_reduced = W->template AsType<R>();
+
+  // 行列積は float で累積し, バイアスはマスターウェイトの精度で加える
+  Tensor z(MixedMatmul(x_reduced, W_reduced));
+  z += *b;
+  return z;
+}
+
+template<typename T>
+template<typename R>
+BasicTensor<T> BasicAffine<T>::backward_reduced(const Tensor &dout,
+                                                const BasicTensor<R> &x_reduced,
+                                                const BasicTensor<R> &W_reduced)
+{
+  const BasicTensor<R> dout_reduced = dout.template AsType<R>();
+  Tensor dx(MixedMatmul(dout_reduced, BasicTensor<R>::Transpose(W_reduced)));
+  this->dW = Tensor(MixedMatmul(BasicTensor<R>::Transpose(x_reduced), dout_reduced));
+  this->db = Tensor::Sum(dout, 0);
+  return dx;
+}
+
+template<typename T>
+BasicTensor<T> BasicSoftmaxWithLoss<T>::forward(const Tensor &x)
 {
   throw std::invalid_argument("SoftmaxWithLoss layer does not support one input tensor");
 }
 
-Tensor SoftmaxWithLoss::forward(const Tensor &x, const Tensor &t)
+template<typename T>
+BasicTensor<T> BasicSoftmaxWithLoss<T>::forward(const Tensor &x, const Tensor &t)
 {
-  this->t = t;
-  this->y = Tensor::Softmax(x);
-  this->loss = CrossEntropyError(y, t);
+  this->loss = SoftmaxCrossEntropy(x, t, &this->dx);
 
   // 入出力層の形状を表示
   // std::cout << "SoftmaxWithLoss forward input shape: ";
@@ -254,11 +448,10 @@ Tensor SoftmaxWithLoss::forward(const Tensor &x, const Tensor &t)
   return this->loss;
 }
 
-Tensor SoftmaxWithLoss::backward(const Tensor &dout)
+template<typename T>
+BasicTensor<T> BasicSoftmaxWithLoss<T>::backward(const Tensor &dout)
 {
-  Tensor dx = (y - t);
-  Tensor::value_type batch_size = static_cast<Tensor::value_type>(t.shape()[0]);
-  Tensor result = dx / batch_size;
+  Tensor result = this->dx;
 
   // 入出力層の形状を表示
   // std::cout << "SoftmaxWithLoss backward input shape: ";
@@ -268,41 +461,54 @@ Tensor SoftmaxWithLoss::backward(const Tensor &dout)
   return result;
 }
 
-TwoLayerNet::TwoLayerNet(const std::size_t input_size,
-                         const std::size_t hidden_size,
-                         const std::size_t output_size,
-                         const Tensor::value_type weight_init_std)
+template<typename T>
+BasicTwoLayerNet<T>::BasicTwoLayerNet(const std::size_t input_size,
+                                      const std::size_t hidden_size,
+                                      const std::size_t output_size,
+                                      const double weight_init_std,
+                                      const TrainingPrecision precision)
+  : precision(precision),
+    loss_scale(precision == TrainingPrecision::Half ? kInitialLossScale : T(1))
 {
   this->params = std::vector<std::pair<std::string, std::shared_ptr<Tensor> > >();
-  this->layers = std::vector<std::pair<std::string, std::unique_ptr<Layer> > >();
+  this->layers = std::vector<std::pair<std::string, std::unique_ptr<BasicLayer<T> > > >();
 
   // 重みの初期化.
   this->params.emplace_back("W1",
                             std::make_shared<Tensor>(
                               Tensor::RandomNormal({
                                 input_size, hidden_size
-                              }) * weight_init_std));
+                              }) * static_cast<T>(weight_init_std)));
   this->params.emplace_back("b1",
                             std::make_shared<Tensor>(
                               Tensor::Zeros({1, hidden_size})));
   this->params.emplace_back("W2",
                             std::make_shared<Tensor>(
                               Tensor::RandomNormal({hidden_size, output_size}) *
-                              weight_init_std));
+                              static_cast<T>(weight_init_std)));
   this->params.emplace_back("b2",
                             std::make_shared<Tensor>(
                               Tensor::Zeros({1, output_size})));
 
   // レイヤーの生成
   this->layers.emplace_back("Affine1",
-                            std::make_unique<Affine>(this->params[0].second,
-                                                     this->params[1].second));
-  this->layers.emplace_back("ReLU", std::make_unique<ReLU>());
+                            std::make_unique<BasicAffine<T> >(this->params[0].second,
+                                                     this->params[1].second,
+                                                     precision));
+  this->layers.emplace_back("ReLU", std::make_unique<BasicReLU<T> >());
   this->layers.emplace_back("Affine2",
-                            std::make_unique<Affine>(this->params[2].second,
-                                                     this->params[3].second));
+                            std::make_unique<BasicAffine<T> >(this->params[2].second,
+                                                     this->params[3].second,
+                                                     precision));
 }
-Tensor TwoLayerNet::predict(const Tensor &x)
+
+template<typename T>
+T BasicTwoLayerNet<T>::get_loss_scale() const
+{
+  return loss_scale;
+}
+template<typename T>
+BasicTensor<T> BasicTwoLayerNet<T>::predict(const Tensor &x)
 {
   Tensor result = x; // ローカル変数にコピー
   for (auto &layer : this->layers)
@@ -316,13 +522,15 @@ Tensor TwoLayerNet::predict(const Tensor &x)
   return result;
 }
 
-Tensor TwoLayerNet::loss(const Tensor &x, const Tensor &t)
+template<typename T>
+BasicTensor<T> BasicTwoLayerNet<T>::loss(const Tensor &x, const Tensor &t)
 {
   Tensor y = this->predict(x);
   return this->last_layer.forward(y, t);
 }
 
-Tensor::value_type TwoLayerNet::loss_batch(const Tensor &x, const Tensor &t)
+template<typename T>
+T BasicTwoLayerNet<T>::loss_batch(const Tensor &x, const Tensor &t)
 {
   Tensor y = this->predict(x);
   auto fow = this->last_layer.forward(y, t);
@@ -330,11 +538,12 @@ Tensor::value_type TwoLayerNet::loss_batch(const Tensor &x, const Tensor &t)
   return avg_loss(0);
 }
 
-Tensor::value_type TwoLayerNet::accuracy(const Tensor &x, const Tensor &t)
+template<typename T>
+T BasicTwoLayerNet<T>::accuracy(const Tensor &x, const Tensor &t)
 {
   Tensor y = this->predict(x);
-  Tensor result = y.Argmax();
-  Tensor ans = t.Argmax();
+  const Tensori result = y.Argmax();
+  const Tensori ans = t.Argmax();
 
   int count = 0;
   for (int i = 0; i < result.shape()[0]; ++i)
@@ -346,15 +555,17 @@ Tensor::value_type TwoLayerNet::accuracy(const Tensor &x, const Tensor &t)
   }
   std::cout << "## そのまま計算 correct / total: " << count << " / " << result.shape()[0] << std::endl;
 
-  Tensor equal = result == ans;
-  const auto sum = Tensor::Sum(equal)(0);
-  const auto batch_size = static_cast<Tensor::value_type>(x.shape()[0]);
+  // 一致したかどうかは 1 バイトのマスクで受け取り, 数えるときに T へ変換する
+  const Tensorb equal = result == ans;
+  const auto sum = Tensor::Sum(equal.template AsType<T>())(0);
+  const auto batch_size = static_cast<T>(x.shape()[0]);
   std::cout << "correct / total: " << sum << " / " << batch_size << std::endl;
   const auto acc = sum / batch_size;
   return acc;
 }
 
-std::vector<std::pair<std::string, Tensor> > TwoLayerNet::numerical_gradient(
+template<typename T>
+std::vector<std::pair<std::string, BasicTensor<T> > > BasicTwoLayerNet<T>::numerical_gradient(
   const Tensor &x,
   const Tensor &t)
 {
@@ -382,17 +593,23 @@ std::vector<std::pair<std::string, Tensor> > TwoLayerNet::numerical_gradient(
   return grads;
 }
 
-std::vector<std::pair<std::string, Tensor> >
-TwoLayerNet::gradient(const Tensor &x,
-                      const Tensor &t)
+template<typename T>
+std::vector<std::pair<std::string, BasicTensor<T> > >
+BasicTwoLayerNet<T>::gradient(const Tensor &x,
+                              const Tensor &t)
 {
   // forward
   this->loss(x, t);
 
   // backward
-  constexpr Tensor::value_type dout = 1;
+  constexpr T dout = 1;
   Tensor dout_tensor = Tensor::FromArray({dout});
   Tensor dx = this->last_layer.backward(dout_tensor);
+  if (this->precision == TrainingPrecision::Half)
+  {
+    // 半精度に変換したときに小さな勾配が 0 にならないように拡大してから逆伝播する
+    dx *= this->loss_scale;
+  }
 
   // 逆順でレイヤーを処理する
   for (int i = this->layers.size() - 1; i >= 0; --i)
@@ -406,70 +623,796 @@ TwoLayerNet::gradient(const Tensor &x,
   grads.emplace_back("b1", this->layers[0].second->get_db());
   grads.emplace_back("W2", this->layers[2].second->get_dW());
   grads.emplace_back("b2", this->layers[2].second->get_db());
+  if (this->precision == TrainingPrecision::Half)
+  {
+    this->unscale_gradients(grads);
+  }
   return grads;
 }
 
-Tensor im2col(
-  const Tensor &input,
-  const std::size_t &filter_h,
-  const std::size_t &filter_w,
-  const std::size_t &stride,
-  const std::size_t &pad)
+template<typename T>
+void BasicTwoLayerNet<T>::unscale_gradients(std::vector<std::pair<std::string, Tensor> > &grads)
+{
+  bool finite = true;
+  for (const auto &grad : grads)
+  {
+    const Tensor values = grad.second.Contiguous();
+    finite = finite && std::all_of(values.data(), values.data() + values.size(), [](const T v) { return std::isfinite(v); });
+  }
+
+  if (!finite)
+  {
+    // オーバーフローした回は更新しないように勾配を 0 にする
+    for (auto &grad : grads)
+    {
+      grad.second = Tensor::Zeros(grad.second.shape());
+    }
+    this->loss_scale /= 2;
+    this->good_steps = 0;
+    return;
+  }
+
+  const T inverse = T(1) / this->loss_scale;
+  for (auto &grad : grads)
+  {
+    grad.second *= inverse;
+  }
+  if (++this->good_steps == kLossScaleGrowthInterval)
+  {
+    this->loss_scale *= 2;
+    this->good_steps = 0;
+  }
+}
+
+namespace
 {
-  // 入力したテンソルが4次元であることを確認する
-  if (input.shape().size() != 4)
+/**
+ * @brief 畳み込みの入力・フィルタ・出力の大きさ
+ */
+struct ConvolutionShape
+{
+  std::size_t N;        // バッチサイズ
+  std::size_t C;        // チャンネル数
+  std::size_t H;        // 入力の高さ
+  std::size_t W;        // 入力の幅
+  std::size_t filter_h; // フィルタの高さ
+  std::size_t filter_w; // フィルタの幅
+  std::size_t stride;   // ストライド
+  std::size_t pad;      // パディング
+  std::size_t out_h;    // 出力の高さ
+  std::size_t out_w;    // 出力の幅
+
+  /**
+   * @brief im2col した行列の行数 (出力位置の数)
+   */
+  std::size_t rows() const
+  {
+    return N * out_h * out_w;
+  }
+
+  /**
+   * @brief im2col した行列の列数 (パッチの要素数)
+   */
+  std::size_t row_size() const
+  {
+    return C * filter_h * filter_w;
+  }
+};
+
+/**
+ * @brief 畳み込みの出力サイズを計算する
+ * @param size 入力の高さまたは幅
+ * @param filter フィルタの高さまたは幅
+ * @param stride ストライド
+ * @param pad パディング
+ * @return 出力の高さまたは幅
+ */
+std::size_t ConvolutionOutputSize(std::size_t size, std::size_t filter, std::size_t stride, std::size_t pad)
+{
+  if (stride == 0)
+  {
+    throw std::invalid_argument("stride must be positive");
+  }
+  if (filter == 0 || size + 2 * pad < filter)
+  {
+    throw std::invalid_argument("filter is larger than the padded input");
+  }
+  return (size + 2 * pad - filter) / stride + 1;
+}
+
+/**
+ * @brief 入力の形状とフィルタから畳み込みの大きさを求める
+ * @param input_shape 入力の形状 (N, C, H, W)
+ * @param filter_h フィルタの高さ
+ * @param filter_w フィルタの幅
+ * @param stride ストライド
+ * @param pad パディング
+ * @return 畳み込みの大きさ
+ */
+ConvolutionShape MakeConvolutionShape(const Shape &input_shape,
+                                      std::size_t filter_h,
+                                      std::size_t filter_w,
+                                      std::size_t stride,
+                                      std::size_t pad)
+{
+  if (input_shape.size() != 4)
   {
     throw std::invalid_argument("input must be 4D tensor");
   }
-  
-  // 入力サイズの取得
-  const auto N = input.shape()[0]; // バッチサイズ
-  const auto C = input.shape()[1]; // チャンネル数
-  const auto H = input.shape()[2]; // 高さ
-  const auto W = input.shape()[3]; // 幅
-
-  // 出力の高さ・幅を計算する
-  const auto out_h = (H - filter_h + 2 * pad) / stride + 1;
-  const auto out_w = (W - filter_w + 2 * pad) / stride + 1;
-
-  // パディングを行うための各次元のパディング量を設定
-  // N, C 軸はそのまま、H, W 軸にそれぞれ前後 pad 個ずつ追加する
-  std::vector<std::pair<std::size_t, std::size_t>> pad_dims = {
-    {0, 0}, {0, 0}, {pad, pad}, {pad, pad}
-  };
-  // Pad 関数を利用してパディングを実施する
-  Tensor img = Tensor::Pad(input, pad_dims);
-  
-  // 出力テンソルを初期化する (形状は [N, C, filter_h, filter_w, out_h, out_w] )
-  Tensor out = Tensor::Zeros({N, C, filter_h, filter_w, out_h, out_w});
-
-  // 6重ループにより、パディング済みの img からスライスして out に値をコピーする
-  for (std::size_t n = 0; n < N; ++n)
-  {
-    for (std::size_t c = 0; c < C; ++c)
+  ConvolutionShape conv{};
+  conv.N = input_shape[0];
+  conv.C = input_shape[1];
+  conv.H = input_shape[2];
+  conv.W = input_shape[3];
+  conv.filter_h = filter_h;
+  conv.filter_w = filter_w;
+  conv.stride = stride;
+  conv.pad = pad;
+  conv.out_h = ConvolutionOutputSize(conv.H, filter_h, stride, pad);
+  conv.out_w = ConvolutionOutputSize(conv.W, filter_w, stride, pad);
+  return conv;
+}
+
+/**
+ * @brief フィルタの 1 行 [0, filter_w) のうち, 入力の幅 [0, W) に収まる範囲を求める
+ * @param x0 フィルタの左端に対応する入力の位置 (パディングを含めない座標. 負になりうる)
+ * @param filter_w フィルタの幅
+ * @param W 入力の幅
+ * @param begin 範囲の先頭
+ * @param end 範囲の末尾
+ */
+void ValidFilterRange(std::ptrdiff_t x0, std::size_t filter_w, std::size_t W, std::size_t &begin, std::size_t &end)
+{
+  const auto width = static_cast<std::ptrdiff_t>(W);
+  const auto filter = static_cast<std::ptrdiff_t>(filter_w);
+  begin = static_cast<std::size_t>(std::clamp<std::ptrdiff_t>(-x0, 0, filter));
+  end = static_cast<std::size_t>(std::clamp<std::ptrdiff_t>(width - x0, 0, filter));
+  end = std::max(begin, end);
+}
+
+/**
+ * @brief フィルタの 1 行分の要素をコピーする
+ * @note フィルタの幅は小さいことが多いので, 幅 8 までは長さの決まったコピーにして memcpy の呼び出しを避ける
+ * @param src コピー元
+ * @param dst コピー先
+ * @param width 要素数
+ */
+template<typename T>
+inline void CopyFilterRow(const T *src, T *dst, std::size_t width)
+{
+  switch (width)
+  {
+    case 1: std::memcpy(dst, src, 1 * sizeof(T)); break;
+    case 2: std::memcpy(dst, src, 2 * sizeof(T)); break;
+    case 3: std::memcpy(dst, src, 3 * sizeof(T)); break;
+    case 4: std::memcpy(dst, src, 4 * sizeof(T)); break;
+    case 5: std::memcpy(dst, src, 5 * sizeof(T)); break;
+    case 6: std::memcpy(dst, src, 6 * sizeof(T)); break;
+    case 7: std::memcpy(dst, src, 7 * sizeof(T)); break;
+    case 8: std::memcpy(dst, src, 8 * sizeof(T)); break;
+    default: std::copy(src, src + width, dst); break;
+  }
+}
+
+/**
+ * @brief 連続した入力 (N, C, H, W) を im2col した行列 (rows, row_size) に書き込む
+ * @note 出力の 1 行は 1 つの出力位置のパッチ (C, filter_h, filter_w) になる.
+ *       パディングは一時的なテンソルを作らず, 入力の範囲外を 0 で埋めて扱う.
+ *       フィルタの 1 行は入力の 1 行の連続した区間なので, まとめてコピーする
+ * @param src 入力の先頭ポインタ
+ * @param conv 畳み込みの大きさ
+ * @param dst 出力の先頭ポインタ
+ */
+template<typename T>
+void Im2ColKernel(const T *src, const ConvolutionShape &conv, T *dst)
+{
+  const auto [N, C, H, W, filter_h, filter_w, stride, pad, out_h, out_w] = conv;
+  const std::size_t row_size = conv.row_size();
+
+#ifdef NAGATO_OPENMP
+  #pragma omp parallel for if (conv.rows() * row_size > 65536)
+#endif
+  for (std::size_t row_group = 0; row_group < N * out_h; ++row_group)
+  {
+    const std::size_t n = row_group / out_h;
+    const std::size_t i = row_group % out_h;
+    const std::ptrdiff_t y0 = static_cast<std::ptrdiff_t>(i * stride) - static_cast<std::ptrdiff_t>(pad);
+    for (std::size_t j = 0; j < out_w; ++j)
+    {
+      const std::ptrdiff_t x0 = static_cast<std::ptrdiff_t>(j * stride) - static_cast<std::ptrdiff_t>(pad);
+      std::size_t x_begin;
+      std::size_t x_end;
+      ValidFilterRange(x0, filter_w, W, x_begin, x_end);
+
+      T *out = dst + (row_group * out_w + j) * row_size;
+      for (std::size_t c = 0; c < C; ++c)
+      {
+        const T *image = src + (n * C + c) * H * W;
+        for (std::size_t y = 0; y < filter_h; ++y, out += filter_w)
+        {
+          const std::ptrdiff_t iy = y0 + static_cast<std::ptrdiff_t>(y);
+          if (iy < 0 || iy >= static_cast<std::ptrdiff_t>(H))
+          {
+            std::fill(out, out + filter_w, T(0));
+            continue;
+          }
+          // フィルタの x_begin 列目に対応する入力の要素から x_end - x_begin 個をコピーする
+          const T *line = image + static_cast<std::size_t>(iy) * W + static_cast<std::size_t>(x0 + static_cast<std::ptrdiff_t>(x_begin));
+          if (x_begin == 0 && x_end == filter_w)
+          {
+            CopyFilterRow(line, out, filter_w);
+            continue;
+          }
+          std::fill(out, out + x_begin, T(0));
+          std::copy(line, line + (x_end - x_begin), out + x_begin);
+          std::fill(out + x_end, out + filter_w, T(0));
+        }
+      }
+    }
+  }
+}
+
+/**
+ * @brief im2col した行列 (rows, row_size) を入力の形状 (N, C, H, W) に足し込む
+ * @note パッチが重なる位置では値を足し合わせ, パディングの位置の値は捨てる.
+ *       画像 (n, c) ごとに書き込み先が重ならないので, 画像単位で並列化する
+ * @param src im2col した行列の先頭ポインタ
+ * @param conv 畳み込みの大きさ
+ * @param dst 出力の先頭ポインタ. 0 で初期化しておく
+ */
+template<typename T>
+void Col2ImKernel(const T *src, const ConvolutionShape &conv, T *dst)
+{
+  const auto [N, C, H, W, filter_h, filter_w, stride, pad, out_h, out_w] = conv;
+  const std::size_t row_size = conv.row_size();
+
+#ifdef NAGATO_OPENMP
+  #pragma omp parallel for if (conv.rows() * row_size > 65536)
+#endif
+  for (std::size_t plane = 0; plane < N * C; ++plane)
+  {
+    const std::size_t n = plane / C;
+    const std::size_t c = plane % C;
+    T *out = dst + plane * H * W;
+    for (std::size_t i = 0; i < out_h; ++i)
     {
-      for (std::size_t y = 0; y < filter_h; ++y)
+      const std::ptrdiff_t y0 = static_cast<std::ptrdiff_t>(i * stride) - static_cast<std::ptrdiff_t>(pad);
+      for (std::size_t j = 0; j < out_w; ++j)
       {
-        for (std::size_t x = 0; x < filter_w; ++x)
+        const std::ptrdiff_t x0 = static_cast<std::ptrdiff_t>(j * stride) - static_cast<std::ptrdiff_t>(pad);
+        std::size_t x_begin;
+        std::size_t x_end;
+        ValidFilterRange(x0, filter_w, W, x_begin, x_end);
+
+        const T *patch = src + ((n * out_h + i) * out_w + j) * row_size + c * filter_h * filter_w;
+        for (std::size_t y = 0; y < filter_h; ++y, patch += filter_w)
         {
-          for (std::size_t i = 0; i < out_h; ++i)
+          const std::ptrdiff_t iy = y0 + static_cast<std::ptrdiff_t>(y);
+          if (iy < 0 || iy >= static_cast<std::ptrdiff_t>(H))
           {
-            for (std::size_t j = 0; j < out_w; ++j)
-            {
-              out(n, c, y, x, i, j) = img(n, c, y + i * stride, x + j * stride);
-            }
+            continue;
+          }
+          T *line = out + static_cast<std::size_t>(iy) * W + static_cast<std::size_t>(x0 + static_cast<std::ptrdiff_t>(x_begin));
+          for (std::size_t x = x_begin; x < x_end; ++x)
+          {
+            line[x - x_begin] += patch[x];
           }
         }
       }
     }
   }
+}
+
+/**
+ * @brief ワークスペースのテンソルを指定した形状にする
+ * @note 形状が同じでデータ領域を単独で所有している場合は, 確保済みの領域をそのまま使う
+ * @param workspace ワークスペース
+ * @param shape 形状
+ * @return 書き込み先の先頭ポインタ
+ */
+template<typename T>
+T *PrepareWorkspace(BasicTensor<T> &workspace, const Shape &shape)
+{
+  if (workspace.shape() != shape || !workspace.IsContiguous())
+  {
+    workspace = BasicTensor<T>(shape);
+  }
+  return workspace.data();
+}
+} // namespace
 
-  // Python実装と同様に、6次元テンソル (N, C, filter_h, filter_w, out_h, out_w)
-  // を、転置して (N, out_h, out_w, C, filter_h, filter_w) に変換し、
-  // さらに reshape して 2次元テンソル [N*out_h*out_w, C*filter_h*filter_w] とする
-  Tensor col = Tensor::Transpose(out, {0, 4, 5, 1, 2, 3});
-  col = col.Reshape({N * out_h * out_w, C * filter_h * filter_w});
+template<typename T>
+BasicTensor<T> im2col(
+  const BasicTensor<T> &input,
+  const std::size_t &filter_h,
+  const std::size_t &filter_w,
+  const std::size_t &stride,
+  const std::size_t &pad)
+{
+  using Tensor = BasicTensor<T>;
+  const ConvolutionShape conv = MakeConvolutionShape(input.shape(), filter_h, filter_w, stride, pad);
+
+  const Tensor source = input.Contiguous();
+  Tensor col({conv.rows(), conv.row_size()});
+  Im2ColKernel(source.data(), conv, col.data());
   return col;
 }
 
+template<typename T>
+BasicTensor<T> col2im(
+  const BasicTensor<T> &col,
+  const Shape &input_shape,
+  const std::size_t &filter_h,
+  const std::size_t &filter_w,
+  const std::size_t &stride,
+  const std::size_t &pad)
+{
+  using Tensor = BasicTensor<T>;
+  const ConvolutionShape conv = MakeConvolutionShape(input_shape, filter_h, filter_w, stride, pad);
+  if (col.shape().size() != 2 || col.shape()[0] != conv.rows() || col.shape()[1] != conv.row_size())
+  {
+    throw std::invalid_argument("col shape does not match the input shape and filter");
+  }
+
+  const Tensor source = col.Contiguous();
+  Tensor image = Tensor::Zeros(input_shape);
+  Col2ImKernel(source.data(), conv, image.data());
+  return image;
+}
+
+template<typename T>
+BasicConvolution<T>::BasicConvolution(const std::shared_ptr<Tensor> &W,
+                                      const std::shared_ptr<Tensor> &b,
+                                      std::size_t stride,
+                                      std::size_t pad)
+  : W(W), b(b), stride(stride), pad(pad)
+{
+  if (W->shape().size() != 4)
+  {
+    throw std::invalid_argument("filter must be 4D tensor (FN, C, FH, FW)");
+  }
+  if (b->size() != W->shape()[0])
+  {
+    throw std::invalid_argument("bias size must be equal to the number of filters");
+  }
+}
+
+template<typename T>
+BasicTensor<T> BasicConvolution<T>::forward(const Tensor &x)
+{
+  const std::size_t FN = W->shape()[0];
+  if (x.shape().size() != 4 || x.shape()[1] != W->shape()[1])
+  {
+    throw std::invalid_argument("input must be 4D tensor with the same channels as the filter");
+  }
+  const ConvolutionShape conv = MakeConvolutionShape(x.shape(), W->shape()[2], W->shape()[3], stride, pad);
+  const std::size_t K = conv.row_size();
+  const std::size_t P = conv.out_h * conv.out_w;
+  const std::size_t image_size = conv.C * conv.H * conv.W;
+
+  // 入力は逆伝播で im2col し直すために保持する (データ領域は共有される)
+  this->x = x.Contiguous();
+  const T *x_data = std::as_const(this->x).data();
+  const Tensor filter = W->Contiguous();
+  const Tensor bias = b->Contiguous();
+  const T *w_data = filter.data();
+  const T *b_data = bias.data();
+
+  // 1 枚ずつ im2col してキャッシュに載ったまま積を計算する. 列の行列の領域は呼び出しをまたいで使い回す
+  ConvolutionShape single = conv;
+  single.N = 1;
+  T *col_data = PrepareWorkspace(col, Shape{P, K});
+
+  // out_n (FN, P) = W (FN, K) * col_n^T (K, P) を計算すると, 転置せずに (N, FN, out_h, out_w) になる.
+  // 出力をバイアスで初期化してから積を足し込む
+  Tensor out({conv.N, FN, conv.out_h, conv.out_w});
+  T *out_data = out.data();
+  for (std::size_t n = 0; n < conv.N; ++n)
+  {
+    Im2ColKernel(x_data + n * image_size, single, col_data);
+    T *out_n = out_data + n * FN * P;
+    for (std::size_t f = 0; f < FN; ++f)
+    {
+      std::fill(out_n + f * P, out_n + (f + 1) * P, b_data[f]);
+    }
+    Gemm(FN, P, K, w_data, K, 1, col_data, 1, K, out_n, P, true);
+  }
+  return out;
+}
+
+template<typename T>
+BasicTensor<T> BasicConvolution<T>::forward(const Tensor &x, const Tensor &y)
+{
+  throw std::invalid_argument("Convolution layer does not support two input tensors");
+}
+
+template<typename T>
+BasicTensor<T> BasicConvolution<T>::backward(const Tensor &dout)
+{
+  const std::size_t FN = W->shape()[0];
+  const ConvolutionShape conv = MakeConvolutionShape(x.shape(), W->shape()[2], W->shape()[3], stride, pad);
+  const std::size_t K = conv.row_size();
+  const std::size_t P = conv.out_h * conv.out_w;
+  const std::size_t image_size = conv.C * conv.H * conv.W;
+  if (dout.size() != conv.N * FN * P)
+  {
+    throw std::invalid_argument("dout shape does not match the forward output");
+  }
+
+  const Tensor grad = dout.Contiguous();
+  const Tensor filter = W->Contiguous();
+  const T *g_data = grad.data();
+  const T *w_data = filter.data();
+  const T *x_data = std::as_const(this->x).data();
+
+  ConvolutionShape single = conv;
+  single.N = 1;
+  T *col_data = PrepareWorkspace(col, Shape{P, K});
+  T *dcol_data = PrepareWorkspace(dcol, Shape{P, K});
+
+  this->db = Tensor::Zeros({FN});
+  this->dW = Tensor(W->shape());
+  Tensor dx = Tensor::Zeros(x.shape());
+  T *db_data = this->db.data();
+  T *dw_data = this->dW.data();
+  T *dx_data = dx.data();
+
+  for (std::size_t n = 0; n < conv.N; ++n)
+  {
+    const T *g_n = g_data + n * FN * P;
+
+    // db[f] += Σ_p dout_n[f, p]
+    for (std::size_t f = 0; f < FN; ++f)
+    {
+      db_data[f] += std::accumulate(g_n + f * P, g_n + (f + 1) * P, T(0));
+    }
+
+    // dW (FN, K) += dout_n (FN, P) * col_n (P, K)
+    Im2ColKernel(x_data + n * image_size, single, col_data);
+    Gemm(FN, K, P, g_n, P, 1, col_data, K, 1, dw_data, K, n > 0);
+
+    // dcol_n (P, K) = dout_n^T (P, FN) * W (FN, K) を col2im で入力の形状に戻す
+    Gemm(P, K, FN, g_n, 1, P, w_data, K, 1, dcol_data, K);
+    Col2ImKernel(std::as_const(dcol).data(), single, dx_data + n * image_size);
+  }
+  return dx;
+}
+
+namespace
+{
+/**
+ * @brief フィルタの x 列目が入力の幅 [0, W) に収まる出力位置の範囲 [begin, end) を求める
+ * @param x フィルタ内の列
+ * @param conv 畳み込みの大きさ
+ * @param begin 範囲の先頭
+ * @param end 範囲の末尾
+ */
+void ValidOutputRange(std::size_t x, const ConvolutionShape &conv, std::size_t &begin, std::size_t &end)
+{
+  // 入力の位置 j * stride + x - pad が 0 以上 W 未満になる j
+  const std::size_t stride = conv.stride;
+  begin = x >= conv.pad ? 0 : (conv.pad - x + stride - 1) / stride;
+  end = conv.W + conv.pad > x ? std::min(conv.out_w, (conv.W + conv.pad - x - 1) / stride + 1) : 0;
+  end = std::max(begin, end);
+}
+
+/**
+ * @brief プーリングの形状を確認して求める
+ * @param input_shape 入力の形状 (N, C, H, W)
+ * @param pool_h プーリングの高さ
+ * @param pool_w プーリングの幅
+ * @param stride ストライド
+ * @param pad パディング
+ * @return プーリングの大きさ
+ */
+ConvolutionShape MakePoolingShape(const Shape &input_shape,
+                                  std::size_t pool_h,
+                                  std::size_t pool_w,
+                                  std::size_t stride,
+                                  std::size_t pad)
+{
+  // パディングだけの窓ができないようにする
+  if (pad >= pool_h || pad >= pool_w)
+  {
+    throw std::invalid_argument("pad must be smaller than the pooling window");
+  }
+  return MakeConvolutionShape(input_shape, pool_h, pool_w, stride, pad);
+}
+
+/**
+ * @brief 1 枚の画像 (H, W) の最大値プーリングを計算する
+ * @note 出力の 1 行分を幅方向のベクトルとして, 窓内の位置ごとに比較と選択を行う (stride が 1 の場合は連続アクセスになる).
+ *       最大値の位置は画像内の添字 (y * W + x) として保存する
+ * @param src 入力の先頭ポインタ
+ * @param conv プーリングの大きさ
+ * @param dst 出力の先頭ポインタ
+ * @param argmax 最大値の位置の先頭ポインタ
+ */
+template<typename T>
+void MaxPoolPlane(const T *__restrict src, const ConvolutionShape &conv, T *__restrict dst, std::int32_t *__restrict argmax)
+{
+  for (std::size_t i = 0; i < conv.out_h; ++i)
+  {
+    T *__restrict out = dst + i * conv.out_w;
+    std::int32_t *__restrict arg = argmax + i * conv.out_w;
+    std::fill(out, out + conv.out_w, -std::numeric_limits<T>::infinity());
+    std::fill(arg, arg + conv.out_w, -1);
+
+    for (std::size_t y = 0; y < conv.filter_h; ++y)
+    {
+      const std::ptrdiff_t iy = static_cast<std::ptrdiff_t>(i * conv.stride + y) - static_cast<std::ptrdiff_t>(conv.pad);
+      if (iy < 0 || iy >= static_cast<std::ptrdiff_t>(conv.H))
+      {
+        continue;
+      }
+      const std::size_t row = static_cast<std::size_t>(iy) * conv.W;
+      for (std::size_t x = 0; x < conv.filter_w; ++x)
+      {
+        std::size_t j_begin;
+        std::size_t j_end;
+        ValidOutputRange(x, conv, j_begin, j_end);
+        for (std::size_t j = j_begin; j < j_end; ++j)
+        {
+          const std::size_t index = row + j * conv.stride + x - conv.pad;
+          const T value = src[index];
+          // 窓内の最初の要素は必ず選ぶ
+          const bool take = value > out[j] || arg[j] < 0;
+          out[j] = take ? value : out[j];
+          arg[j] = take ? static_cast<std::int32_t>(index) : arg[j];
+        }
+      }
+    }
+  }
+}
+
+/**
+ * @brief 1 枚の画像 (H, W) の平均値プーリングを計算する
+ * @note パディングの位置は 0 として窓の大きさ pool_h * pool_w で割る
+ * @param src 入力の先頭ポインタ
+ * @param conv プーリングの大きさ
+ * @param dst 出力の先頭ポインタ
+ */
+template<typename T>
+void AvgPoolPlane(const T *__restrict src, const ConvolutionShape &conv, T *__restrict dst)
+{
+  const T scale = T(1) / static_cast<T>(conv.filter_h * conv.filter_w);
+  for (std::size_t i = 0; i < conv.out_h; ++i)
+  {
+    T *__restrict out = dst + i * conv.out_w;
+    std::fill(out, out + conv.out_w, T(0));
+
+    for (std::size_t y = 0; y < conv.filter_h; ++y)
+    {
+      const std::ptrdiff_t iy = static_cast<std::ptrdiff_t>(i * conv.stride + y) - static_cast<std::ptrdiff_t>(conv.pad);
+      if (iy < 0 || iy >= static_cast<std::ptrdiff_t>(conv.H))
+      {
+        continue;
+      }
+      const T *line = src + static_cast<std::size_t>(iy) * conv.W;
+      for (std::size_t x = 0; x < conv.filter_w; ++x)
+      {
+        std::size_t j_begin;
+        std::size_t j_end;
+        ValidOutputRange(x, conv, j_begin, j_end);
+        for (std::size_t j = j_begin; j < j_end; ++j)
+        {
+          out[j] += line[j * conv.stride + x - conv.pad];
+        }
+      }
+    }
+    for (std::size_t j = 0; j < conv.out_w; ++j)
+    {
+      out[j] *= scale;
+    }
+  }
+}
+
+/**
+ * @brief 1 枚の画像 (H, W) について平均値プーリングの勾配を求める
+ * @param dout 出力の勾配の先頭ポインタ
+ * @param conv プーリングの大きさ
+ * @param dx 入力の勾配の先頭ポインタ. 0 で初期化しておく
+ */
+template<typename T>
+void AvgPoolBackwardPlane(const T *__restrict dout, const ConvolutionShape &conv, T *__restrict dx)
+{
+  const T scale = T(1) / static_cast<T>(conv.filter_h * conv.filter_w);
+  for (std::size_t i = 0; i < conv.out_h; ++i)
+  {
+    const T *__restrict grad = dout + i * conv.out_w;
+    for (std::size_t y = 0; y < conv.filter_h; ++y)
+    {
+      const std::ptrdiff_t iy = static_cast<std::ptrdiff_t>(i * conv.stride + y) - static_cast<std::ptrdiff_t>(conv.pad);
+      if (iy < 0 || iy >= static_cast<std::ptrdiff_t>(conv.H))
+      {
+        continue;
+      }
+      T *line = dx + static_cast<std::size_t>(iy) * conv.W;
+      for (std::size_t x = 0; x < conv.filter_w; ++x)
+      {
+        std::size_t j_begin;
+        std::size_t j_end;
+        ValidOutputRange(x, conv, j_begin, j_end);
+        for (std::size_t j = j_begin; j < j_end; ++j)
+        {
+          line[j * conv.stride + x - conv.pad] += grad[j] * scale;
+        }
+      }
+    }
+  }
+}
+} // namespace
+
+template<typename T>
+BasicMaxPooling<T>::BasicMaxPooling(std::size_t pool_h, std::size_t pool_w, std::size_t stride, std::size_t pad)
+  : pool_h(pool_h), pool_w(pool_w), stride(stride), pad(pad)
+{
+}
+
+template<typename T>
+BasicTensor<T> BasicMaxPooling<T>::forward(const Tensor &x)
+{
+  const ConvolutionShape conv = MakePoolingShape(x.shape(), pool_h, pool_w, stride, pad);
+  if (conv.H * conv.W > static_cast<std::size_t>(std::numeric_limits<std::int32_t>::max()))
+  {
+    throw std::invalid_argument("input image is too large for int32 argmax indices");
+  }
+  const std::size_t planes = conv.N * conv.C;
+  const std::size_t image_size = conv.H * conv.W;
+  const std::size_t out_size = conv.out_h * conv.out_w;
+  input_shape = x.shape();
+
+  const Tensor source = x.Contiguous();
+  const T *src = source.data();
+  Tensor out({conv.N, conv.C, conv.out_h, conv.out_w});
+  argmax = BasicTensor<std::int32_t>(out.shape());
+  T *dst = out.data();
+  std::int32_t *arg = argmax.data();
+
+#ifdef NAGATO_OPENMP
+  #pragma omp parallel for if (source.size() > 65536)
+#endif
+  for (std::size_t plane = 0; plane < planes; ++plane)
+  {
+    MaxPoolPlane(src + plane * image_size, conv, dst + plane * out_size, arg + plane * out_size);
+  }
+  return out;
+}
+
+template<typename T>
+BasicTensor<T> BasicMaxPooling<T>::forward(const Tensor &x, const Tensor &y)
+{
+  throw std::invalid_argument("MaxPooling layer does not support two input tensors");
+}
+
+template<typename T>
+BasicTensor<T> BasicMaxPooling<T>::backward(const Tensor &dout)
+{
+  if (dout.size() != argmax.size())
+  {
+    throw std::invalid_argument("dout shape does not match the forward output");
+  }
+  const std::size_t planes = input_shape[0] * input_shape[1];
+  const std::size_t image_size = input_shape[2] * input_shape[3];
+  const std::size_t out_size = argmax.size() / planes;
+
+  const Tensor grad = dout.Contiguous();
+  const T *g = grad.data();
+  const std::int32_t *arg = std::as_const(argmax).data();
+  Tensor dx = Tensor::Zeros(input_shape);
+  T *d = dx.data();
+
+  // 保存した最大値の位置に勾配を足し込む. 書き込み先は画像ごとに分かれる
+#ifdef NAGATO_OPENMP
+  #pragma omp parallel for if (dx.size() > 65536)
+#endif
+  for (std::size_t plane = 0; plane < planes; ++plane)
+  {
+    const T *g_plane = g + plane * out_size;
+    const std::int32_t *arg_plane = arg + plane * out_size;
+    T *d_plane = d + plane * image_size;
+    for (std::size_t p = 0; p < out_size; ++p)
+    {
+      d_plane[arg_plane[p]] += g_plane[p];
+    }
+  }
+  return dx;
+}
+
+template<typename T>
+BasicAvgPooling<T>::BasicAvgPooling(std::size_t pool_h, std::size_t pool_w, std::size_t stride, std::size_t pad)
+  : pool_h(pool_h), pool_w(pool_w), stride(stride), pad(pad)
+{
+}
+
+template<typename T>
+BasicTensor<T> BasicAvgPooling<T>::forward(const Tensor &x)
+{
+  const ConvolutionShape conv = MakePoolingShape(x.shape(), pool_h, pool_w, stride, pad);
+  const std::size_t planes = conv.N * conv.C;
+  const std::size_t image_size = conv.H * conv.W;
+  const std::size_t out_size = conv.out_h * conv.out_w;
+  input_shape = x.shape();
+
+  const Tensor source = x.Contiguous();
+  const T *src = source.data();
+  Tensor out({conv.N, conv.C, conv.out_h, conv.out_w});
+  T *dst = out.data();
+
+#ifdef NAGATO_OPENMP
+  #pragma omp parallel for if (source.size() > 65536)
+#endif
+  for (std::size_t plane = 0; plane < planes; ++plane)
+  {
+    AvgPoolPlane(src + plane * image_size, conv, dst + plane * out_size);
+  }
+  return out;
+}
+
+template<typename T>
+BasicTensor<T> BasicAvgPooling<T>::forward(const Tensor &x, const Tensor &y)
+{
+  throw std::invalid_argument("AvgPooling layer does not support two input tensors");
+}
+
+template<typename T>
+BasicTensor<T> BasicAvgPooling<T>::backward(const Tensor &dout)
+{
+  const ConvolutionShape conv = MakePoolingShape(input_shape, pool_h, pool_w, stride, pad);
+  const std::size_t planes = conv.N * conv.C;
+  const std::size_t image_size = conv.H * conv.W;
+  const std::size_t out_size = conv.out_h * conv.out_w;
+  if (dout.size() != planes * out_size)
+  {
+    throw std::invalid_argument("dout shape does not match the forward output");
+  }
+
+  const Tensor grad = dout.Contiguous();
+  const T *g = grad.data();
+  Tensor dx = Tensor::Zeros(input_shape);
+  T *d = dx.data();
+
+#ifdef NAGATO_OPENMP
+  #pragma omp parallel for if (dx.size() > 65536)
+#endif
+  for (std::size_t plane = 0; plane < planes; ++plane)
+  {
+    AvgPoolBackwardPlane(g + plane * out_size, conv, d + plane * image_size);
+  }
+  return dx;
+}
+
+// 要素型ごとの明示的インスタンス化
+#define NAGATO_INSTANTIATE_NETWORK(T)                                                      \
+  template BasicTensor<T> MeanSquaredError(const BasicTensor<T> &, const BasicTensor<T> &);  \
+  template BasicTensor<T> CrossEntropyError(const BasicTensor<T> &, const BasicTensor<T> &); \
+  template BasicTensor<T> SoftmaxCrossEntropy(const BasicTensor<T> &,                      \
+                                              const BasicTensor<T> &,                      \
+                                              BasicTensor<T> *);                           \
+  template BasicTensor<T> im2col(const BasicTensor<T> &,                                   \
+                                 const std::size_t &,                                      \
+                                 const std::size_t &,                                      \
+                                 const std::size_t &,                                      \
+                                 const std::size_t &);                                     \
+  template BasicTensor<T> col2im(const BasicTensor<T> &,                                   \
+                                 const Shape &,                                            \
+                                 const std::size_t &,                                      \
+                                 const std::size_t &,                                      \
+                                 const std::size_t &,                                      \
+                                 const std::size_t &);                                     \
+  template class BasicLayer<T>;                                                            \
+  template class BasicReLU<T>;                                                             \
+  template class BasicSigmoid<T>;                                                          \
+  template class BasicAffine<T>;                                                           \
+  template class BasicConvolution<T>;                                                      \
+  template class BasicMaxPooling<T>;                                                       \
+  template class BasicAvgPooling<T>;                                                       \
+  template class BasicSoftmaxWithLoss<T>;                                                  \
+  template class BasicTwoLayerNet<T>;
+
+NAGATO_INSTANTIATE_NETWORK(float)
+NAGATO_INSTANTIATE_NETWORK(double)
+
+#undef NAGATO_INSTANTIATE_NETWORK
+
 } // namespace nagato
@@ -9,21 +9,63 @@
 
 namespace nagato
 {
-Tensor MeanSquaredError(const Tensor &y, const Tensor &t);
+template<typename T>
+BasicTensor<T> MeanSquaredError(const BasicTensor<T> &y, const BasicTensor<T> &t);
 
 // バッチ対応の交差エントロピー誤差
-Tensor CrossEntropyError(const Tensor &y, const Tensor &t);
+template<typename T>
+BasicTensor<T> CrossEntropyError(const BasicTensor<T> &y, const BasicTensor<T> &t);
+
+/**
+ * @brief Softmax と交差エントロピー誤差, その勾配をまとめて計算する
+ * @note 最後の軸をクラス, それ以外をバッチとして行ごとに計算する. 各行は
+ *       log-sum-exp (max + log(Σexp(x - max))) で安定に計算し, 損失 Σ t * (lse - x) と
+ *       勾配 (softmax(x) - t) / N を 1 行ずつキャッシュに載ったまま求める.
+ *       NAGATO_OPENMP が有効な場合は行ごとに並列に計算する
+ * @param x ロジット (N, C). 1次元の場合はバッチサイズ 1 として扱う
+ * @param t 教師データ. x と同じ形状の one-hot または確率, あるいは形状 (N) のクラス番号
+ * @param grad nullptr でなければ x に対する勾配を x と同じ形状で書き込む
+ * @return バッチで平均した損失 (要素数 1)
+ */
+template<typename T>
+BasicTensor<T> SoftmaxCrossEntropy(const BasicTensor<T> &x, const BasicTensor<T> &t, BasicTensor<T> *grad = nullptr);
+
+/**
+ * @brief 学習時の行列積と活性の精度
+ */
+enum class TrainingPrecision
+{
+  /**
+   * @brief すべて要素型 T で計算する (既定)
+   */
+  Full,
+
+  /**
+   * @brief 半精度 (Half) の活性と行列積の入力を使い, float で累積する. 損失スケーリングを行う
+   */
+  Half,
+
+  /**
+   * @brief bfloat16 の活性と行列積の入力を使い, float で累積する.
+   * @note 指数部の範囲は float と同じなので損失スケーリングは行わない
+   */
+  BFloat16,
+};
 
 /**
  * @brief レイヤーの基底クラス
+ * @tparam T 要素型 (float, double)
  */
-class Layer
+template<typename T>
+class BasicLayer
 {
   public:
+    using Tensor = BasicTensor<T>;
+
     virtual Tensor forward(const Tensor &x) = 0;
     virtual Tensor forward(const Tensor &x, const Tensor &y) = 0;
     virtual Tensor backward(const Tensor &dout) = 0;
-    virtual ~Layer() = default;
+    virtual ~BasicLayer() = default;
     Tensor get_dW() const;
 
     Tensor get_db() const;
@@ -36,10 +78,13 @@ class Layer
 /**
  * @brief LeRU レイヤー
  */
-class ReLU : public Layer
+template<typename T>
+class BasicReLU : public BasicLayer<T>
 {
   public:
-    ReLU();
+    using Tensor = BasicTensor<T>;
+
+    BasicReLU();
 
     Tensor forward(const Tensor &x) override;
 
@@ -55,10 +100,13 @@ class ReLU : public Layer
 /**
  * @brief シグモイドレイヤー
  */
-class Sigmoid : public Layer
+template<typename T>
+class BasicSigmoid : public BasicLayer<T>
 {
   public:
-    Sigmoid() = default;
+    using Tensor = BasicTensor<T>;
+
+    BasicSigmoid() = default;
 
     Tensor forward(const Tensor &x) override;
 
@@ -72,41 +120,188 @@ class Sigmoid : public Layer
 
 /**
  * @brief Affine レイヤー
+ * @note precision が Full 以外の場合は混合精度で計算する. 重み W, b は T のまま保持し (マスターウェイト),
+ *       順伝播のたびに入力と W を 16 ビットに変換して行列積を float で累積する.
+ *       逆伝播のために保持する入力も 16 ビットのままにするため, 活性のメモリと読み込む量が float の半分になる.
+ *       dout も 16 ビットに変換してから掛けるので, Half の場合は損失スケーリングで下位の桁が失われないようにすること
+ */
+template<typename T>
+class BasicAffine : public BasicLayer<T>
+{
+  public:
+    using Tensor = BasicTensor<T>;
+
+    BasicAffine(const std::shared_ptr<Tensor> &W,
+                const std::shared_ptr<Tensor> &b,
+                TrainingPrecision precision = TrainingPrecision::Full);
+
+    Tensor forward(const Tensor &x) override;
+
+    Tensor forward(const Tensor &x, const Tensor &y) override;
+
+    Tensor backward(const Tensor &dout) override;
+
+  private:
+    /**
+     * @brief 入力と W を要素型 R に変換して順伝播する
+     */
+    template<typename R>
+    Tensor forward_reduced(const Tensor &x, BasicTensor<R> &x_reduced, BasicTensor<R> &W_reduced);
+
+    /**
+     * @brief 順伝播で保持した要素型 R の入力と W で逆伝播する
+     */
+    template<typename R>
+    Tensor backward_reduced(const Tensor &dout, const BasicTensor<R> &x_reduced, const BasicTensor<R> &W_reduced);
+
+    std::shared_ptr<Tensor> W;
+    std::shared_ptr<Tensor> b;
+    TrainingPrecision precision;
+    Tensor x;
+    BasicTensor<Half> x_half;
+    BasicTensor<Half> W_half;
+    BasicTensor<BFloat16> x_bf16;
+    BasicTensor<BFloat16> W_bf16;
+};
+
+/**
+ * @brief 畳み込みレイヤー
+ * @note 入力 (N, C, H, W) を 1 枚ずつ im2col で行列にし, フィルタとの積を GEMM で計算する.
+ *       逆伝播では dW, db と, col2im による入力の勾配を求める.
+ *       列の行列はバッチ全体ではなく 1 枚分 (out_h * out_w, C * FH * FW) だけ確保してキャッシュに載せ,
+ *       形状が変わらない限り呼び出しをまたいで使い回す
  */
-class Affine : public Layer
+template<typename T>
+class BasicConvolution : public BasicLayer<T>
 {
   public:
-    Affine(const std::shared_ptr<Tensor> &W, const std::shared_ptr<Tensor> &b);
+    using Tensor = BasicTensor<T>;
+
+    /**
+     * @param W フィルタ (FN, C, FH, FW)
+     * @param b バイアス (要素数 FN)
+     * @param stride ストライド
+     * @param pad パディング
+     */
+    BasicConvolution(const std::shared_ptr<Tensor> &W,
+                     const std::shared_ptr<Tensor> &b,
+                     std::size_t stride = 1,
+                     std::size_t pad = 0);
 
+    /**
+     * @param x 入力 (N, C, H, W)
+     * @return 出力 (N, FN, out_h, out_w)
+     */
     Tensor forward(const Tensor &x) override;
 
     Tensor forward(const Tensor &x, const Tensor &y) override;
 
+    /**
+     * @param dout 出力の勾配 (N, FN, out_h, out_w)
+     * @return 入力の勾配 (N, C, H, W)
+     */
     Tensor backward(const Tensor &dout) override;
 
   private:
     std::shared_ptr<Tensor> W;
     std::shared_ptr<Tensor> b;
+    std::size_t stride;
+    std::size_t pad;
     Tensor x;
+    Tensor col;
+    Tensor dcol;
+};
+
+/**
+ * @brief 最大値プーリングレイヤー
+ * @note im2col を使わずに NCHW のまま窓を走査し, 出力の行を幅方向にまとめて計算する.
+ *       順伝播で最大値の位置を画像内の int32 の添字として保存し, 逆伝播はその位置へ勾配を足し込むだけにする.
+ *       パディングの位置は最大値の候補にしない. NAGATO_OPENMP が有効な場合は N * C 枚の画像ごとに並列に計算する
+ */
+template<typename T>
+class BasicMaxPooling : public BasicLayer<T>
+{
+  public:
+    using Tensor = BasicTensor<T>;
+
+    /**
+     * @param pool_h プーリングの高さ
+     * @param pool_w プーリングの幅
+     * @param stride ストライド
+     * @param pad パディング. 窓の大きさ未満
+     */
+    BasicMaxPooling(std::size_t pool_h, std::size_t pool_w, std::size_t stride = 1, std::size_t pad = 0);
+
+    Tensor forward(const Tensor &x) override;
+
+    Tensor forward(const Tensor &x, const Tensor &y) override;
+
+    Tensor backward(const Tensor &dout) override;
+
+  private:
+    std::size_t pool_h;
+    std::size_t pool_w;
+    std::size_t stride;
+    std::size_t pad;
+    Shape input_shape;
+    BasicTensor<std::int32_t> argmax;
+};
+
+/**
+ * @brief 平均値プーリングレイヤー
+ * @note 最大値プーリングと同じく NCHW のまま計算する. パディングの位置は 0 として窓の大きさ pool_h * pool_w で割る
+ */
+template<typename T>
+class BasicAvgPooling : public BasicLayer<T>
+{
+  public:
+    using Tensor = BasicTensor<T>;
+
+    /**
+     * @param pool_h プーリングの高さ
+     * @param pool_w プーリングの幅
+     * @param stride ストライド
+     * @param pad パディング. 窓の大きさ未満
+     */
+    BasicAvgPooling(std::size_t pool_h, std::size_t pool_w, std::size_t stride = 1, std::size_t pad = 0);
+
+    Tensor forward(const Tensor &x) override;
+
+    Tensor forward(const Tensor &x, const Tensor &y) override;
+
+    Tensor backward(const Tensor &dout) override;
+
+  private:
+    std::size_t pool_h;
+    std::size_t pool_w;
+    std::size_t stride;
+    std::size_t pad;
+    Shape input_shape;
 };
 
 /**
  * @brief Softmax-with-Loss レイヤー
  */
-class SoftmaxWithLoss : public Layer
+template<typename T>
+class BasicSoftmaxWithLoss : public BasicLayer<T>
 {
   public:
-    SoftmaxWithLoss() = default;
+    using Tensor = BasicTensor<T>;
+
+    BasicSoftmaxWithLoss() = default;
 
     Tensor forward(const Tensor &x) override;
 
     Tensor forward(const Tensor &x, const Tensor &t) override;
 
+    /**
+     * @brief forward で計算した勾配 (softmax(x) - t) / N を返す
+     * @note dout は 1 として扱う
+     */
     Tensor backward(const Tensor &dout) override;
 
   private:
-    Tensor y;
-    Tensor t;
+    Tensor dx;
     Tensor loss;
 };
 
@@ -117,8 +312,12 @@ class SoftmaxWithLoss : public Layer
  * @param x 入力. 一番最初の次元はバッチサイズ
  * @return 勾配
  */
-inline Tensor numerical_gradient_(std::function<Tensor(const Tensor &)> func, const Tensor &x)
+template<typename T>
+BasicTensor<T> numerical_gradient_(
+  std::type_identity_t<std::function<BasicTensor<T>(const BasicTensor<T> &)> > func,
+  const BasicTensor<T> &x)
 {
+  using Tensor = BasicTensor<T>;
   constexpr float h = 1e-3;
 
   // x と同じ形状を持つゼロ初期化のテンソルを作成する
@@ -138,7 +337,7 @@ inline Tensor numerical_gradient_(std::function<Tensor(const Tensor &)> func, co
     }
 
     // 現在の値を記憶
-    float tmp_val = x_copy.storage()[idx];
+    const T tmp_val = x_copy.storage()[idx];
 
     // x + h における f の値を計算
     x_copy.storage()[idx] = tmp_val + h;
@@ -162,17 +361,37 @@ inline Tensor numerical_gradient_(std::function<Tensor(const Tensor &)> func, co
 
 /**
  * @brief 2層ニューラルネットワーク
+ * @tparam T 要素型 (float, double)
+ * @note precision が Full 以外の場合は Affine レイヤーを混合精度で計算する (params は T のまま).
+ *       Half の場合は動的な損失スケーリングを行う. gradient() で損失の勾配に loss_scale を掛けて逆伝播し,
+ *       求めた勾配を T で 1 / loss_scale 倍に戻す. 勾配に inf / NaN が含まれた場合は loss_scale を半分にして
+ *       その回の勾配をすべて 0 にし, kLossScaleGrowthInterval 回続けて有限だった場合は loss_scale を 2 倍にする
  */
-class TwoLayerNet
+template<typename T>
+class BasicTwoLayerNet
 {
   public:
-    TwoLayerNet(
+    using Tensor = BasicTensor<T>;
+
+    /// 損失スケールの初期値
+    static constexpr T kInitialLossScale = 65536;
+
+    /// 損失スケールを 2 倍にするまでに続けて有限の勾配が得られる回数
+    static constexpr std::size_t kLossScaleGrowthInterval = 2000;
+
+    BasicTwoLayerNet(
       const std::size_t input_size,
       const std::size_t hidden_size,
       const std::size_t output_size,
-      const Tensor::value_type weight_init_std = 0.01
+      const double weight_init_std = 0.01,
+      const TrainingPrecision precision = TrainingPrecision::Full
     );
 
+    /**
+     * @brief 現在の損失スケール. 損失スケーリングを行わない場合は 1
+     */
+    T get_loss_scale() const;
+
     Tensor predict(const Tensor &x);
 
     Tensor loss(const Tensor &x, const Tensor &t);
@@ -183,9 +402,9 @@ class TwoLayerNet
      * @param t 正解ラベル
      * @return 平均loss
      */
-    Tensor::value_type loss_batch(const Tensor &x, const Tensor &t);
+    T loss_batch(const Tensor &x, const Tensor &t);
 
-    Tensor::value_type accuracy(const Tensor &x, const Tensor &t);
+    T accuracy(const Tensor &x, const Tensor &t);
 
     std::vector<std::pair<std::string, Tensor> > numerical_gradient(
       const Tensor &x,
@@ -194,16 +413,28 @@ class TwoLayerNet
     std::vector<std::pair<std::string, Tensor> > gradient(const Tensor &x, const Tensor &t);
 
     std::vector<std::pair<std::string, std::shared_ptr<Tensor> > > params;
-    std::vector<std::pair<std::string, std::unique_ptr<Layer> > > layers;
-    SoftmaxWithLoss last_layer;
+    std::vector<std::pair<std::string, std::unique_ptr<BasicLayer<T> > > > layers;
+    BasicSoftmaxWithLoss<T> last_layer;
+
+  private:
+    /**
+     * @brief 損失スケールを掛けた勾配を元に戻し, オーバーフローしていれば損失スケールを下げる
+     * @param grads 損失スケールを掛けた勾配
+     */
+    void unscale_gradients(std::vector<std::pair<std::string, Tensor> > &grads);
+
+    TrainingPrecision precision;
+    T loss_scale;
+    std::size_t good_steps = 0;
 };
 
-inline Tensor OneHot(const Tensor &x, const std::size_t &num_classes)
+template<typename T>
+BasicTensor<T> OneHot(const BasicTensor<T> &x, const std::size_t &num_classes)
 {
-  Tensor one_hot = Tensor::Zeros({x.shape()[0], num_classes});
+  BasicTensor<T> one_hot = BasicTensor<T>::Zeros({x.shape()[0], num_classes});
   for (std::size_t i = 0; i < x.shape()[0]; ++i)
   {
-    one_hot(i, x(i, 0)) = 1.0;
+    one_hot(i, static_cast<std::size_t>(x(i, 0))) = 1;
   }
   return one_hot;
 }
@@ -214,8 +445,10 @@ inline Tensor OneHot(const Tensor &x, const std::size_t &num_classes)
  * @param x データ (28 x 28)
  * @param label ラベル
  */
-inline void PrintMNIST(const Tensor &x, const Tensor &label)
+template<typename T>
+void PrintMNIST(const BasicTensor<T> &x, const BasicTensor<T> &label)
 {
+  using Tensor = BasicTensor<T>;
   Tensor x_copy = x;
 
   // x が (28, 28) の行列であることを確認し違う場合は変形する
@@ -260,21 +493,28 @@ inline void PrintMNIST(const Tensor &x, const Tensor &label)
 /**
  * @brief 最適化手法の基底クラス
  */
-class Optimizer
+template<typename T>
+class BasicOptimizer
 {
   public:
+  using Tensor = BasicTensor<T>;
+
+
   virtual void update(std::vector<std::pair<std::string, std::shared_ptr<Tensor> > > &params,
                       const std::vector<std::pair<std::string, Tensor> > &grads) = 0;
-  virtual ~Optimizer() = default;
+  virtual ~BasicOptimizer() = default;
 };
 
 /**
  * @brief 確率的勾配降下法
  */
-class SGD : public Optimizer
+template<typename T>
+class BasicSGD : public BasicOptimizer<T>
 {
   public:
-  SGD(const Tensor::value_type learning_rate) : learning_rate_(learning_rate) {}
+  using Tensor = BasicTensor<T>;
+
+  BasicSGD(const double learning_rate) : learning_rate_(static_cast<T>(learning_rate)) {}
 
   void update(std::vector<std::pair<std::string, std::shared_ptr<Tensor> > > &params,
               const std::vector<std::pair<std::string, Tensor> > &grads)
@@ -287,21 +527,24 @@ class SGD : public Optimizer
         throw std::invalid_argument("parameter name is not same");
       }
 
-      *params[i].second = *params[i].second - learning_rate_ * grads[i].second;
+      *params[i].second -= learning_rate_ * grads[i].second;
     }
   }
   private:
-  Tensor::value_type learning_rate_;
+  T learning_rate_;
 };
 
 /**
  * @brief モメンタム
  */
-class Momentum : public Optimizer
+template<typename T>
+class BasicMomentum : public BasicOptimizer<T>
 {
   public:
-  Momentum(const Tensor::value_type learning_rate, const Tensor::value_type momentum) : 
-  learning_rate_(learning_rate), momentum_(momentum), v({}) {}
+  using Tensor = BasicTensor<T>;
+
+  BasicMomentum(const double learning_rate, const double momentum) :
+  learning_rate_(static_cast<T>(learning_rate)), momentum_(static_cast<T>(momentum)), v({}) {}
 
   void update(std::vector<std::pair<std::string, std::shared_ptr<Tensor> > > &params,
               const std::vector<std::pair<std::string, Tensor> > &grads)
@@ -320,19 +563,28 @@ class Momentum : public Optimizer
         throw std::invalid_argument("parameter name is not same");
       }
 
+      // 初回は勾配と同じ形状のゼロで初期化し, 以降は確保済みの領域を使い回す
+      if (v[i].second.shape() != grads[i].second.shape())
+      {
+        v[i].second = Tensor::Zeros(grads[i].second.shape());
+      }
+
       v[i].second = momentum_ * v[i].second - learning_rate_ * grads[i].second;
-      *params[i].second = *params[i].second + v[i].second;
+      *params[i].second += v[i].second;
     }
   }
 
   private:
-  Tensor::value_type learning_rate_;
-  Tensor::value_type momentum_;
+  T learning_rate_;
+  T momentum_;
   std::vector<std::pair<std::string, Tensor> > v;
 };
 
 /**
  * @brief im2col を行う関数
+ * @note 入力 (N, C, H, W) の各出力位置のパッチを 1 行として, (N * out_h * out_w, C * filter_h * filter_w) の
+ *       行列に直接書き込む. パディングはコピーを作らずに範囲外を 0 として扱う.
+ *       NAGATO_OPENMP が有効な場合は出力の行ごとに並列に処理する
  * @param input 入力
  * @param filter_h フィルタの高さ
  * @param filter_w フィルタの幅
@@ -340,15 +592,64 @@ class Momentum : public Optimizer
  * @param pad パディング
  * @return im2col したテンソル
  */
-Tensor im2col(
-  const Tensor &input,
+template<typename T>
+BasicTensor<T> im2col(
+  const BasicTensor<T> &input,
   const std::size_t &filter_h,
   const std::size_t &filter_w,
   const std::size_t &stride,
   const std::size_t &pad
 );
 
+/**
+ * @brief col2im を行う関数 (im2col の逆変換)
+ * @note 重なったパッチの値は足し合わせる. 畳み込みの逆伝播で入力の勾配を求めるのに使う.
+ *       パディングの位置の値は捨てる
+ * @param col im2col した形状 (N * out_h * out_w, C * filter_h * filter_w) のテンソル
+ * @param input_shape 元の入力の形状 (N, C, H, W)
+ * @param filter_h フィルタの高さ
+ * @param filter_w フィルタの幅
+ * @param stride ストライド
+ * @param pad パディング
+ * @return 形状 input_shape のテンソル
+ */
+template<typename T>
+BasicTensor<T> col2im(
+  const BasicTensor<T> &col,
+  const Shape &input_shape,
+  const std::size_t &filter_h,
+  const std::size_t &filter_w,
+  const std::size_t &stride,
+  const std::size_t &pad
+);
 
+/// 倍精度のレイヤー・ネットワーク
+using Layer = BasicLayer<double>;
+using ReLU = BasicReLU<double>;
+using Sigmoid = BasicSigmoid<double>;
+using Affine = BasicAffine<double>;
+using Convolution = BasicConvolution<double>;
+using MaxPooling = BasicMaxPooling<double>;
+using AvgPooling = BasicAvgPooling<double>;
+using SoftmaxWithLoss = BasicSoftmaxWithLoss<double>;
+using TwoLayerNet = BasicTwoLayerNet<double>;
+using Optimizer = BasicOptimizer<double>;
+using SGD = BasicSGD<double>;
+using Momentum = BasicMomentum<double>;
+
+/// 単精度のレイヤー・ネットワーク
+using Layerf = BasicLayer<float>;
+using ReLUf = BasicReLU<float>;
+using Sigmoidf = BasicSigmoid<float>;
+using Affinef = BasicAffine<float>;
+using Convolutionf = BasicConvolution<float>;
+using MaxPoolingf = BasicMaxPooling<float>;
+using AvgPoolingf = BasicAvgPooling<float>;
+using SoftmaxWithLossf = BasicSoftmaxWithLoss<float>;
+using TwoLayerNetf = BasicTwoLayerNet<float>;
+using Optimizerf = BasicOptimizer<float>;
+using SGDf = BasicSGD<float>;
+using Momentumf = BasicMomentum<float>;
 
 } // namespace nagato
 
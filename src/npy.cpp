@@ -0,0 +1,801 @@
+//
+// Created by toru on 2026/10/17.
+//
+
+#include "npy.hpp"
+#include "mapped_file.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace nagato
+{
+namespace
+{
+/// .npy ファイルの先頭のマジックナンバー
+constexpr char kNpyMagic[] = "\x93NUMPY";
+constexpr std::size_t kNpyMagicSize = 6;
+
+/// ヘッダとデータをこの境界に揃える (numpy と同じ)
+constexpr std::size_t kNpyAlignment = 64;
+
+/**
+ * @brief 割り当てたファイルの一部をテンソルのデータ領域として 1 回だけ渡すメモリリソース
+ * @note データ領域の解放時にファイルへの参照を手放し, 自身も破棄する
+ */
+class MappedStorageResource : public std::pmr::memory_resource
+{
+  public:
+    MappedStorageResource(std::shared_ptr<MappedFile> file, unsigned char *data, std::size_t bytes)
+      : file_(std::move(file)), data_(data), bytes_(bytes)
+    {
+    }
+
+  private:
+    void *do_allocate(std::size_t bytes, std::size_t alignment) override
+    {
+      if (allocated_ || bytes != bytes_)
+      {
+        throw std::bad_alloc();
+      }
+      allocated_ = true;
+      return data_;
+    }
+
+    void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override
+    {
+      delete this;
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+    {
+      return this == &other;
+    }
+
+    std::shared_ptr<MappedFile> file_;
+    unsigned char *data_;
+    std::size_t bytes_;
+    bool allocated_ = false;
+};
+
+/**
+ * @brief .npy のヘッダから読み取った配列の情報
+ */
+struct NpyArray
+{
+  /// バイト順 ('<', '>', '|')
+  char byte_order = '|';
+
+  /// 要素の種類 ('b', 'i', 'u', 'f')
+  char kind = 'f';
+
+  /// 要素のバイト数
+  std::size_t item_size = 0;
+
+  /// 列優先で格納されているかどうか
+  bool fortran_order = false;
+
+  /// 形状. 0 次元の場合は空
+  Shape shape;
+
+  /// データの先頭
+  unsigned char *data = nullptr;
+};
+
+/**
+ * @brief 実行環境のバイト順を表す文字
+ */
+constexpr char NativeByteOrder()
+{
+  return std::endian::native == std::endian::little ? '<' : '>';
+}
+
+/**
+ * @brief 要素型に対応する .npy の型文字列
+ */
+template<typename T>
+std::string NpyDescr()
+{
+  if constexpr (std::is_same_v<T, Bool>)
+  {
+    return "|b1";
+  }
+  else if constexpr (sizeof(T) == 1)
+  {
+    return std::is_signed_v<T> ? "|i1" : "|u1";
+  }
+  else
+  {
+    const char kind = std::is_floating_point_v<T> || std::is_same_v<T, Half> ? 'f' : (std::is_signed_v<T> ? 'i' : 'u');
+    return std::string{NativeByteOrder(), kind} + std::to_string(sizeof(T));
+  }
+}
+
+/**
+ * @brief リトルエンディアンの整数を読み取る
+ */
+template<typename U>
+U ReadLE(const unsigned char *p)
+{
+  U value = 0;
+  for (std::size_t i = 0; i < sizeof(U); ++i)
+  {
+    value |= static_cast<U>(p[i]) << (8 * i);
+  }
+  return value;
+}
+
+/**
+ * @brief リトルエンディアンの整数を追加する
+ */
+template<typename U>
+void AppendLE(std::string &out, U value)
+{
+  for (std::size_t i = 0; i < sizeof(U); ++i)
+  {
+    out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+  }
+}
+
+/**
+ * @brief ヘッダの辞書から key の値の先頭位置を探す
+ */
+std::size_t FindHeaderValue(std::string_view header, std::string_view key)
+{
+  for (const char quote : {'\'', '"'})
+  {
+    const std::string quoted = std::string(1, quote) + std::string(key) + quote;
+    const std::size_t pos = header.find(quoted);
+    if (pos == std::string_view::npos)
+    {
+      continue;
+    }
+    std::size_t colon = header.find(':', pos + quoted.size());
+    if (colon == std::string_view::npos)
+    {
+      break;
+    }
+    ++colon;
+    while (colon < header.size() && header[colon] == ' ')
+    {
+      ++colon;
+    }
+    return colon;
+  }
+  throw std::invalid_argument("npy header does not contain '" + std::string(key) + "'");
+}
+
+/**
+ * @brief .npy の先頭からヘッダを解析する
+ * @param p ファイル (または zip の要素) の先頭
+ * @param size バイト数
+ * @return 配列の情報
+ */
+NpyArray ParseNpy(unsigned char *p, std::size_t size)
+{
+  if (size < kNpyMagicSize + 4 || std::memcmp(p, kNpyMagic, kNpyMagicSize) != 0)
+  {
+    throw std::invalid_argument("not a npy file");
+  }
+  const unsigned major = p[6];
+  std::size_t header_size;
+  std::size_t prefix_size;
+  if (major == 1)
+  {
+    header_size = ReadLE<std::uint16_t>(p + 8);
+    prefix_size = 10;
+  }
+  else if (major == 2 || major == 3)
+  {
+    if (size < 12)
+    {
+      throw std::invalid_argument("npy header is truncated");
+    }
+    header_size = ReadLE<std::uint32_t>(p + 8);
+    prefix_size = 12;
+  }
+  else
+  {
+    throw std::invalid_argument("unsupported npy version: " + std::to_string(major));
+  }
+  if (prefix_size + header_size > size)
+  {
+    throw std::invalid_argument("npy header is truncated");
+  }
+  const std::string_view header(reinterpret_cast<const char *>(p + prefix_size), header_size);
+
+  NpyArray array;
+
+  // 'descr': '<f8'
+  std::size_t pos = FindHeaderValue(header, "descr");
+  const char quote = header[pos];
+  const std::size_t end = header.find(quote, pos + 1);
+  if ((quote != '\'' && quote != '"') || end == std::string_view::npos)
+  {
+    throw std::invalid_argument("npy descr must be a simple type string");
+  }
+  const std::string descr(header.substr(pos + 1, end - pos - 1));
+  if (descr.size() < 3 || std::string_view("<>|=").find(descr[0]) == std::string_view::npos)
+  {
+    throw std::invalid_argument("unsupported npy dtype: " + descr);
+  }
+  array.byte_order = descr[0] == '=' ? NativeByteOrder() : descr[0];
+  array.kind = descr[1];
+  array.item_size = std::stoul(descr.substr(2));
+  const bool supported = (array.kind == 'b' && array.item_size == 1) ||
+                         ((array.kind == 'i' || array.kind == 'u') &&
+                          (array.item_size == 1 || array.item_size == 2 || array.item_size == 4 || array.item_size == 8)) ||
+                         (array.kind == 'f' && (array.item_size == 2 || array.item_size == 4 || array.item_size == 8));
+  if (!supported)
+  {
+    throw std::invalid_argument("unsupported npy dtype: " + descr);
+  }
+
+  // 'fortran_order': False
+  pos = FindHeaderValue(header, "fortran_order");
+  array.fortran_order = header.substr(pos, 4) == "True";
+
+  // 'shape': (60000, 784)
+  pos = FindHeaderValue(header, "shape");
+  if (header[pos] != '(')
+  {
+    throw std::invalid_argument("npy shape must be a tuple");
+  }
+  const std::size_t close = header.find(')', pos);
+  if (close == std::string_view::npos)
+  {
+    throw std::invalid_argument("npy shape must be a tuple");
+  }
+  std::size_t count = 1;
+  for (std::size_t i = pos + 1; i < close;)
+  {
+    if (header[i] >= '0' && header[i] <= '9')
+    {
+      std::size_t dim = 0;
+      while (i < close && header[i] >= '0' && header[i] <= '9')
+      {
+        dim = dim * 10 + static_cast<std::size_t>(header[i] - '0');
+        ++i;
+      }
+      array.shape.push_back(dim);
+      count *= dim;
+    }
+    else
+    {
+      ++i;
+    }
+  }
+
+  const std::size_t data_offset = prefix_size + header_size;
+  if (count * array.item_size > size - data_offset)
+  {
+    throw std::invalid_argument("npy data is truncated");
+  }
+  array.data = p + data_offset;
+  return array;
+}
+
+/**
+ * @brief 配列の要素型とバイト順がテンソルの要素型と一致するかどうか
+ */
+template<typename T>
+bool MatchesDescr(const NpyArray &array)
+{
+  const std::string descr = NpyDescr<T>();
+  return array.kind == descr[1] && array.item_size == sizeof(T) &&
+         (array.item_size == 1 || array.byte_order == NativeByteOrder());
+}
+
+/**
+ * @brief 要素型 S の配列を変換してコピーする
+ * @param src 配列の先頭
+ * @param count 要素数
+ * @param swap バイト順を入れ替えるかどうか
+ * @param dst コピー先
+ */
+template<typename S, typename T>
+void ConvertElements(const unsigned char *src, std::size_t count, bool swap, T *dst)
+{
+  using U = std::conditional_t<sizeof(S) == 1, std::uint8_t,
+            std::conditional_t<sizeof(S) == 2, std::uint16_t,
+            std::conditional_t<sizeof(S) == 4, std::uint32_t, std::uint64_t> > >;
+
+#ifdef NAGATO_OPENMP
+  #pragma omp parallel for if (count > 65536)
+#endif
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    U bits;
+    std::memcpy(&bits, src + i * sizeof(S), sizeof(S));
+    if (swap)
+    {
+      bits = std::byteswap(bits);
+    }
+    const S value = std::bit_cast<S>(bits);
+    if constexpr (std::is_same_v<S, Half>)
+    {
+      dst[i] = static_cast<T>(static_cast<float>(value));
+    }
+    else
+    {
+      dst[i] = static_cast<T>(value);
+    }
+  }
+}
+
+/**
+ * @brief 配列の要素をテンソルの要素型に変換してコピーする
+ */
+template<typename T>
+void ConvertNpyData(const NpyArray &array, std::size_t count, T *dst)
+{
+  const bool swap = array.item_size > 1 && array.byte_order != NativeByteOrder();
+  switch (array.kind)
+  {
+    case 'b':
+    case 'u':
+      switch (array.item_size)
+      {
+        case 1: return ConvertElements<std::uint8_t>(array.data, count, swap, dst);
+        case 2: return ConvertElements<std::uint16_t>(array.data, count, swap, dst);
+        case 4: return ConvertElements<std::uint32_t>(array.data, count, swap, dst);
+        default: return ConvertElements<std::uint64_t>(array.data, count, swap, dst);
+      }
+    case 'i':
+      switch (array.item_size)
+      {
+        case 1: return ConvertElements<std::int8_t>(array.data, count, swap, dst);
+        case 2: return ConvertElements<std::int16_t>(array.data, count, swap, dst);
+        case 4: return ConvertElements<std::int32_t>(array.data, count, swap, dst);
+        default: return ConvertElements<std::int64_t>(array.data, count, swap, dst);
+      }
+    default:
+      if (array.item_size == 2)
+      {
+        return ConvertElements<Half>(array.data, count, swap, dst);
+      }
+      if (array.item_size == 4)
+      {
+        return ConvertElements<float>(array.data, count, swap, dst);
+      }
+      return ConvertElements<double>(array.data, count, swap, dst);
+  }
+}
+
+/**
+ * @brief 配列の情報からテンソルを作成する
+ * @param array 配列の情報
+ * @param file 配列を含む割り当てたファイル
+ * @param mode 読み込み方法
+ * @return テンソル
+ */
+template<typename T>
+BasicTensor<T> MakeTensor(const NpyArray &array, const std::shared_ptr<MappedFile> &file, NpyLoadMode mode)
+{
+  using Tensor = BasicTensor<T>;
+  using storage_type = typename Tensor::storage_type;
+
+  // 列優先の配列は軸を逆にした行優先の配列として読み込み, 転置して詰め直す
+  Shape shape = array.shape;
+  if (array.fortran_order)
+  {
+    std::reverse(shape.begin(), shape.end());
+  }
+  if (shape.empty())
+  {
+    shape.push_back(1);
+  }
+  std::size_t count = 1;
+  for (const std::size_t dim : shape)
+  {
+    count *= dim;
+  }
+
+  Tensor tensor;
+  const bool mappable = mode == NpyLoadMode::MemoryMap && count > 0 && MatchesDescr<T>(array) &&
+                        std::is_trivially_default_constructible_v<T> &&
+                        reinterpret_cast<std::uintptr_t>(array.data) % alignof(T) == 0;
+  if (mappable)
+  {
+    // 割り当てた領域をそのままデータ領域にする. 要素は既定初期化なので内容は書き換わらない
+    auto resource = std::make_unique<MappedStorageResource>(file, array.data, count * sizeof(T));
+    auto storage = std::allocate_shared<storage_type>(TensorAllocator<storage_type>(), count,
+                                                      TensorAllocator<T>(resource.get()));
+    resource.release();
+    tensor = Tensor(shape, std::move(storage));
+  }
+  else
+  {
+    tensor = Tensor(shape);
+    T *dst = tensor.data();
+    if (MatchesDescr<T>(array))
+    {
+      std::memcpy(static_cast<void *>(dst), array.data, count * sizeof(T));
+    }
+    else
+    {
+      ConvertNpyData(array, count, dst);
+    }
+  }
+
+  if (array.fortran_order && shape.size() > 1)
+  {
+    std::vector<std::size_t> axes(shape.size());
+    for (std::size_t i = 0; i < axes.size(); ++i)
+    {
+      axes[i] = axes.size() - 1 - i;
+    }
+    tensor = Tensor::Transpose(tensor, axes).Contiguous();
+  }
+  return tensor;
+}
+
+/**
+ * @brief .npy のヘッダ (マジックナンバーからデータの直前まで) を作成する
+ * @param descr 型文字列
+ * @param shape 形状
+ * @param base_offset ファイル内でのヘッダの位置. データの位置を 64 バイト境界に揃えるために使う
+ * @return ヘッダ
+ */
+std::string MakeNpyHeader(const std::string &descr, const Shape &shape, std::size_t base_offset)
+{
+  std::string dict = "{'descr': '" + descr + "', 'fortran_order': False, 'shape': (";
+  for (std::size_t i = 0; i < shape.size(); ++i)
+  {
+    dict += std::to_string(shape[i]);
+    if (i + 1 < shape.size() || shape.size() == 1)
+    {
+      dict += ",";
+    }
+    if (i + 1 < shape.size())
+    {
+      dict += " ";
+    }
+  }
+  dict += "), }";
+
+  // 改行を含めてデータの位置が 64 バイト境界になるまで空白で埋める
+  std::size_t prefix_size = 10;
+  std::size_t padding = kNpyAlignment - (base_offset + prefix_size + dict.size() + 1) % kNpyAlignment;
+  if (dict.size() + padding + 1 > 0xFFFF)
+  {
+    prefix_size = 12;
+    padding = kNpyAlignment - (base_offset + prefix_size + dict.size() + 1) % kNpyAlignment;
+  }
+  padding %= kNpyAlignment;
+  dict.append(padding, ' ');
+  dict.push_back('\n');
+
+  std::string header(kNpyMagic, kNpyMagicSize);
+  if (prefix_size == 10)
+  {
+    header.push_back(1);
+    header.push_back(0);
+    AppendLE(header, static_cast<std::uint16_t>(dict.size()));
+  }
+  else
+  {
+    header.push_back(2);
+    header.push_back(0);
+    AppendLE(header, static_cast<std::uint32_t>(dict.size()));
+  }
+  return header + dict;
+}
+
+/**
+ * @brief zip の要素の CRC-32 を更新する
+ * @param crc これまでの CRC (初期値 0)
+ * @param data データ
+ * @param size バイト数
+ * @return 更新した CRC
+ */
+std::uint32_t UpdateCrc32(std::uint32_t crc, const unsigned char *data, std::size_t size)
+{
+  static const auto table = []
+  {
+    std::array<std::uint32_t, 256> t{};
+    for (std::uint32_t i = 0; i < 256; ++i)
+    {
+      std::uint32_t c = i;
+      for (int k = 0; k < 8; ++k)
+      {
+        c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+      }
+      t[i] = c;
+    }
+    return t;
+  }();
+
+  crc = ~crc;
+  for (std::size_t i = 0; i < size; ++i)
+  {
+    crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+/**
+ * @brief ファイルの範囲を確認する
+ */
+void CheckRange(std::size_t offset, std::size_t size, std::size_t file_size)
+{
+  if (offset > file_size || size > file_size - offset)
+  {
+    throw std::invalid_argument("npz file is corrupted");
+  }
+}
+} // namespace
+
+template<typename T>
+BasicTensor<T> LoadNpy(const std::string &filename, NpyLoadMode mode)
+{
+  const auto file = std::make_shared<MappedFile>(filename, mode == NpyLoadMode::Copy);
+  const NpyArray array = ParseNpy(file->data(), file->size());
+  return MakeTensor<T>(array, file, mode);
+}
+
+template<typename T>
+void SaveNpy(const std::string &filename, const BasicTensor<T> &tensor)
+{
+  std::ofstream file(filename, std::ios::binary);
+  if (!file.is_open())
+  {
+    throw std::runtime_error("ファイルを開くことができませんでした: " + filename);
+  }
+  const BasicTensor<T> source = tensor.Contiguous();
+  const std::string header = MakeNpyHeader(NpyDescr<T>(), source.shape(), 0);
+  file.write(header.data(), static_cast<std::streamsize>(header.size()));
+  file.write(reinterpret_cast<const char *>(source.data()), static_cast<std::streamsize>(source.size() * sizeof(T)));
+  if (!file)
+  {
+    throw std::runtime_error("ファイルに書き込むことができませんでした: " + filename);
+  }
+}
+
+template<typename T>
+std::map<std::string, BasicTensor<T> > LoadNpz(const std::string &filename, NpyLoadMode mode)
+{
+  const auto file = std::make_shared<MappedFile>(filename, mode == NpyLoadMode::Copy);
+  unsigned char *base = file->data();
+  const std::size_t size = file->size();
+
+  // 末尾の End of Central Directory を探す (後ろに最大 65535 バイトのコメントがある)
+  constexpr std::size_t kEocdSize = 22;
+  if (size < kEocdSize)
+  {
+    throw std::invalid_argument("not a npz file");
+  }
+  std::size_t eocd = size - kEocdSize;
+  const std::size_t lowest = size > kEocdSize + 0xFFFF ? size - kEocdSize - 0xFFFF : 0;
+  while (ReadLE<std::uint32_t>(base + eocd) != 0x06054b50)
+  {
+    if (eocd == lowest)
+    {
+      throw std::invalid_argument("not a npz file");
+    }
+    --eocd;
+  }
+  std::uint64_t entries = ReadLE<std::uint16_t>(base + eocd + 10);
+  std::uint64_t directory_size = ReadLE<std::uint32_t>(base + eocd + 12);
+  std::uint64_t directory_offset = ReadLE<std::uint32_t>(base + eocd + 16);
+
+  // ZIP64 の場合は直前のロケータから ZIP64 End of Central Directory を読む
+  if (entries == 0xFFFF || directory_size == 0xFFFFFFFF || directory_offset == 0xFFFFFFFF)
+  {
+    if (eocd < 20 || ReadLE<std::uint32_t>(base + eocd - 20) != 0x07064b50)
+    {
+      throw std::invalid_argument("npz file is corrupted");
+    }
+    const std::uint64_t zip64_eocd = ReadLE<std::uint64_t>(base + eocd - 20 + 8);
+    CheckRange(zip64_eocd, 56, size);
+    if (ReadLE<std::uint32_t>(base + zip64_eocd) != 0x06064b50)
+    {
+      throw std::invalid_argument("npz file is corrupted");
+    }
+    entries = ReadLE<std::uint64_t>(base + zip64_eocd + 32);
+    directory_size = ReadLE<std::uint64_t>(base + zip64_eocd + 40);
+    directory_offset = ReadLE<std::uint64_t>(base + zip64_eocd + 48);
+  }
+  CheckRange(directory_offset, directory_size, size);
+
+  std::map<std::string, BasicTensor<T> > tensors;
+  std::size_t pos = directory_offset;
+  for (std::uint64_t e = 0; e < entries; ++e)
+  {
+    CheckRange(pos, 46, size);
+    const unsigned char *entry = base + pos;
+    if (ReadLE<std::uint32_t>(entry) != 0x02014b50)
+    {
+      throw std::invalid_argument("npz file is corrupted");
+    }
+    const std::uint16_t flags = ReadLE<std::uint16_t>(entry + 8);
+    const std::uint16_t method = ReadLE<std::uint16_t>(entry + 10);
+    std::uint64_t stored_size = ReadLE<std::uint32_t>(entry + 20);
+    std::uint64_t uncompressed_size = ReadLE<std::uint32_t>(entry + 24);
+    const std::size_t name_size = ReadLE<std::uint16_t>(entry + 28);
+    const std::size_t extra_size = ReadLE<std::uint16_t>(entry + 30);
+    const std::size_t comment_size = ReadLE<std::uint16_t>(entry + 32);
+    std::uint64_t local_offset = ReadLE<std::uint32_t>(entry + 42);
+    CheckRange(pos + 46, name_size + extra_size + comment_size, size);
+    std::string name(reinterpret_cast<const char *>(entry + 46), name_size);
+
+    // ZIP64 の拡張フィールドには 0xFFFFFFFF になっている値だけがこの順に入る
+    const unsigned char *extra = entry + 46 + name_size;
+    for (std::size_t i = 0; i + 4 <= extra_size;)
+    {
+      const std::uint16_t id = ReadLE<std::uint16_t>(extra + i);
+      const std::size_t field_size = ReadLE<std::uint16_t>(extra + i + 2);
+      if (id == 0x0001)
+      {
+        const unsigned char *value = extra + i + 4;
+        const unsigned char *value_end = value + std::min(field_size, extra_size - i - 4);
+        for (std::uint64_t *field : {&uncompressed_size, &stored_size, &local_offset})
+        {
+          if (*field == 0xFFFFFFFF && value + 8 <= value_end)
+          {
+            *field = ReadLE<std::uint64_t>(value);
+            value += 8;
+          }
+        }
+      }
+      i += 4 + field_size;
+    }
+
+    if ((flags & 0x1) != 0 || method != 0 || stored_size != uncompressed_size)
+    {
+      throw std::invalid_argument("compressed or encrypted npz entries are not supported: " + name);
+    }
+
+    CheckRange(local_offset, 30, size);
+    const unsigned char *local = base + local_offset;
+    if (ReadLE<std::uint32_t>(local) != 0x04034b50)
+    {
+      throw std::invalid_argument("npz file is corrupted");
+    }
+    const std::size_t data_offset = local_offset + 30 + ReadLE<std::uint16_t>(local + 26) +
+                                    ReadLE<std::uint16_t>(local + 28);
+    CheckRange(data_offset, uncompressed_size, size);
+
+    const NpyArray array = ParseNpy(base + data_offset, uncompressed_size);
+    if (name.size() >= 4 && name.compare(name.size() - 4, 4, ".npy") == 0)
+    {
+      name.resize(name.size() - 4);
+    }
+    tensors.insert_or_assign(name, MakeTensor<T>(array, file, mode));
+    pos += 46 + name_size + extra_size + comment_size;
+  }
+  return tensors;
+}
+
+template<typename T>
+void SaveNpz(const std::string &filename, const std::map<std::string, BasicTensor<T> > &tensors)
+{
+  std::ofstream file(filename, std::ios::binary);
+  if (!file.is_open())
+  {
+    throw std::runtime_error("ファイルを開くことができませんでした: " + filename);
+  }
+
+  // 日付は 1980-01-01 00:00 とする
+  constexpr std::uint16_t kDosDate = (1 << 5) | 1;
+  constexpr std::uint64_t kZipLimit = 0xFFFFFFFF;
+
+  std::string directory;
+  std::uint64_t offset = 0;
+  for (const auto &[key, tensor] : tensors)
+  {
+    const std::string name = key + ".npy";
+    const BasicTensor<T> source = tensor.Contiguous();
+    const std::size_t data_size = source.size() * sizeof(T);
+
+    // 要素の先頭 (.npy のヘッダ) を拡張フィールドの詰め物で 64 バイト境界に揃える.
+    // 詰め物の ID は zipalign と同じ 0xD935 を使う
+    std::size_t padding = (kNpyAlignment - (offset + 30 + name.size()) % kNpyAlignment) % kNpyAlignment;
+    if (padding > 0 && padding < 4)
+    {
+      padding += kNpyAlignment;
+    }
+    const std::string header = MakeNpyHeader(NpyDescr<T>(), source.shape(), 0);
+    const std::uint64_t entry_size = header.size() + data_size;
+    if (entry_size >= kZipLimit || offset >= kZipLimit)
+    {
+      throw std::invalid_argument("npz entries must be smaller than 4 GiB: " + key);
+    }
+
+    std::uint32_t crc = UpdateCrc32(0, reinterpret_cast<const unsigned char *>(header.data()), header.size());
+    crc = UpdateCrc32(crc, reinterpret_cast<const unsigned char *>(source.data()), data_size);
+
+    std::string local;
+    AppendLE<std::uint32_t>(local, 0x04034b50);
+    AppendLE<std::uint16_t>(local, 20);
+    AppendLE<std::uint16_t>(local, 0);
+    AppendLE<std::uint16_t>(local, 0);
+    AppendLE<std::uint16_t>(local, 0);
+    AppendLE<std::uint16_t>(local, kDosDate);
+    AppendLE<std::uint32_t>(local, crc);
+    AppendLE<std::uint32_t>(local, static_cast<std::uint32_t>(entry_size));
+    AppendLE<std::uint32_t>(local, static_cast<std::uint32_t>(entry_size));
+    AppendLE<std::uint16_t>(local, static_cast<std::uint16_t>(name.size()));
+    AppendLE<std::uint16_t>(local, static_cast<std::uint16_t>(padding));
+    local += name;
+    if (padding > 0)
+    {
+      AppendLE<std::uint16_t>(local, 0xD935);
+      AppendLE<std::uint16_t>(local, static_cast<std::uint16_t>(padding - 4));
+      local.append(padding - 4, '\0');
+    }
+
+    AppendLE<std::uint32_t>(directory, 0x02014b50);
+    AppendLE<std::uint16_t>(directory, 20);
+    AppendLE<std::uint16_t>(directory, 20);
+    AppendLE<std::uint16_t>(directory, 0);
+    AppendLE<std::uint16_t>(directory, 0);
+    AppendLE<std::uint16_t>(directory, 0);
+    AppendLE<std::uint16_t>(directory, kDosDate);
+    AppendLE<std::uint32_t>(directory, crc);
+    AppendLE<std::uint32_t>(directory, static_cast<std::uint32_t>(entry_size));
+    AppendLE<std::uint32_t>(directory, static_cast<std::uint32_t>(entry_size));
+    AppendLE<std::uint16_t>(directory, static_cast<std::uint16_t>(name.size()));
+    AppendLE<std::uint16_t>(directory, 0);
+    AppendLE<std::uint16_t>(directory, 0);
+    AppendLE<std::uint16_t>(directory, 0);
+    AppendLE<std::uint16_t>(directory, 0);
+    AppendLE<std::uint32_t>(directory, 0);
+    AppendLE<std::uint32_t>(directory, static_cast<std::uint32_t>(offset));
+    directory += name;
+
+    file.write(local.data(), static_cast<std::streamsize>(local.size()));
+    file.write(header.data(), static_cast<std::streamsize>(header.size()));
+    file.write(reinterpret_cast<const char *>(source.data()), static_cast<std::streamsize>(data_size));
+    offset += local.size() + entry_size;
+  }
+
+  if (offset >= kZipLimit || tensors.size() >= 0xFFFF)
+  {
+    throw std::invalid_argument("npz file must be smaller than 4 GiB");
+  }
+  std::string end;
+  AppendLE<std::uint32_t>(end, 0x06054b50);
+  AppendLE<std::uint16_t>(end, 0);
+  AppendLE<std::uint16_t>(end, 0);
+  AppendLE<std::uint16_t>(end, static_cast<std::uint16_t>(tensors.size()));
+  AppendLE<std::uint16_t>(end, static_cast<std::uint16_t>(tensors.size()));
+  AppendLE<std::uint32_t>(end, static_cast<std::uint32_t>(directory.size()));
+  AppendLE<std::uint32_t>(end, static_cast<std::uint32_t>(offset));
+  AppendLE<std::uint16_t>(end, 0);
+
+  file.write(directory.data(), static_cast<std::streamsize>(directory.size()));
+  file.write(end.data(), static_cast<std::streamsize>(end.size()));
+  if (!file)
+  {
+    throw std::runtime_error("ファイルに書き込むことができませんでした: " + filename);
+  }
+}
+
+// 要素型ごとの明示的インスタンス化
+#define NAGATO_INSTANTIATE_NPY(T)                                                                          \
+  template BasicTensor<T> LoadNpy(const std::string &, NpyLoadMode);                                        \
+  template void SaveNpy(const std::string &, const BasicTensor<T> &);                                      \
+  template std::map<std::string, BasicTensor<T> > LoadNpz(const std::string &, NpyLoadMode);               \
+  template void SaveNpz(const std::string &, const std::map<std::string, BasicTensor<T> > &);
+
+NAGATO_INSTANTIATE_NPY(float)
+NAGATO_INSTANTIATE_NPY(double)
+NAGATO_INSTANTIATE_NPY(std::int32_t)
+NAGATO_INSTANTIATE_NPY(std::uint8_t)
+NAGATO_INSTANTIATE_NPY(Bool)
+NAGATO_INSTANTIATE_NPY(Half)
+
+#undef NAGATO_INSTANTIATE_NPY
+
+} // namespace nagato
@@ -0,0 +1,79 @@
+//
+// Created by toru on 2026/10/17.
+//
+
+#ifndef NPY_HPP
+#define NPY_HPP
+
+#include "tensor.hpp"
+#include <map>
+#include <string>
+
+namespace nagato
+{
+
+/**
+ * @brief .npy / .npz ファイルの読み込み方法
+ */
+enum class NpyLoadMode
+{
+  /**
+   * @brief ファイルの内容をテンソルのデータ領域へコピーする
+   */
+  Copy,
+
+  /**
+   * @brief ファイルをメモリに割り当て, コピーせずにテンソルのデータ領域として使う
+   * @note 要素型とバイト順がテンソルと一致し, データの位置が要素型の境界に揃っている場合だけ割り当てる.
+   *       条件を満たさない場合は Copy と同じく変換してコピーする.
+   *       割り当てはプライベートなので, テンソルへの書き込みはファイルに反映されない (書き込んだページだけ複製される).
+   *       ファイルはテンソルのデータ領域を共有するすべてのテンソルが破棄されるまで割り当てたままになる
+   */
+  MemoryMap,
+};
+
+/**
+ * @brief NumPy の .npy ファイルを読み込む
+ * @note バージョン 1.0 - 3.0 の形式に対応する. 要素型は bool, 符号付き・符号なし整数 (1, 2, 4, 8 バイト),
+ *       float16 / float32 / float64 で, テンソルの要素型と異なる場合は変換する. バイト順が異なる場合は入れ替え,
+ *       fortran_order のファイルは行優先に並べ替える. 0 次元の配列は形状 {1} のテンソルになる
+ * @param filename ファイル名
+ * @param mode 読み込み方法
+ * @return テンソル
+ */
+template<typename T>
+BasicTensor<T> LoadNpy(const std::string &filename, NpyLoadMode mode = NpyLoadMode::Copy);
+
+/**
+ * @brief テンソルを NumPy の .npy ファイル (バージョン 1.0) に書き込む
+ * @note ヘッダは numpy と同じく 64 バイト境界まで空白で埋めるため, 書き込んだファイルは MemoryMap で読み込める.
+ *       Half は float16 として書き込む. NumPy には bfloat16 の型がないため BFloat16 のテンソルは扱わない
+ * @param filename ファイル名
+ * @param tensor テンソル
+ */
+template<typename T>
+void SaveNpy(const std::string &filename, const BasicTensor<T> &tensor);
+
+/**
+ * @brief NumPy の .npz ファイル (np.savez で作成した無圧縮の zip) を読み込む
+ * @note 各要素は LoadNpy と同じ規則で読み込む. ZIP64 に対応する. 圧縮された要素 (np.savez_compressed) は読み込めない
+ * @param filename ファイル名
+ * @param mode 読み込み方法
+ * @return 配列名 (拡張子 .npy を除いた名前) からテンソルへの対応
+ */
+template<typename T>
+std::map<std::string, BasicTensor<T> > LoadNpz(const std::string &filename, NpyLoadMode mode = NpyLoadMode::Copy);
+
+/**
+ * @brief テンソルを NumPy の .npz ファイル (無圧縮の zip) に書き込む
+ * @note np.load で読み込める. 各配列のデータは 64 バイト境界に揃えて格納するため, MemoryMap で読み込める.
+ *       1 つの配列は 4 GiB 未満である必要がある
+ * @param filename ファイル名
+ * @param tensors 配列名からテンソルへの対応
+ */
+template<typename T>
+void SaveNpz(const std::string &filename, const std::map<std::string, BasicTensor<T> > &tensors);
+
+} // namespace nagato
+
+#endif // NPY_HPP
@@ -0,0 +1,458 @@
+//
+// Created by toru on 2026/10/17.
+//
+
+#include "quantize.hpp"
+#include "network.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#if defined(__AVX512VNNI__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace nagato
+{
+namespace
+{
+// 重みのパネルの列数. AVX-512 のレジスタ 4 本分 (16 列 x 4)
+constexpr std::size_t kPanel = 64;
+
+// 内積の方向に連続させる要素数. vpdpbusd が 1 回に積和する要素数
+constexpr std::size_t kGroup = 4;
+
+// マイクロカーネルの行数. アキュムレータ 6 x 4 本と重み 4 本がレジスタに収まる
+constexpr std::size_t kRows = 6;
+
+#if !defined(__AVX512VNNI__) && defined(__AVX2__)
+/**
+ * @brief AVX2 で R 行 x kPanel 列の積を計算する
+ * @note 入力と重みを int16 に広げて vpmaddwd で 2 要素ずつ積和するため, vpmaddubsw と違って
+ *       int16 の飽和が起きず, 累積した値は VNNI やスカラーの計算と一致する. 8 列ずつ計算し,
+ *       列ごとに 2 つ残る部分和は最後に vphaddd でまとめる
+ */
+template<std::size_t R>
+void Int8Rows(const std::uint8_t *a, std::size_t lda, const std::int8_t *b, std::size_t groups, std::int32_t *c)
+{
+  for (std::size_t col = 0; col < kPanel; col += 8)
+  {
+    __m256i acc[R][2];
+#pragma GCC unroll 4
+    for (std::size_t i = 0; i < R; ++i)
+    {
+      acc[i][0] = _mm256_setzero_si256();
+      acc[i][1] = _mm256_setzero_si256();
+    }
+    for (std::size_t k = 0; k < groups; ++k)
+    {
+      const std::int8_t *panel = b + k * kPanel * kGroup + col * kGroup;
+      const __m256i b0 = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(panel)));
+      const __m256i b1 = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(panel + 16)));
+#pragma GCC unroll 4
+      for (std::size_t i = 0; i < R; ++i)
+      {
+        std::int32_t group;
+        std::memcpy(&group, a + i * lda + k * kGroup, sizeof(group));
+        const __m256i av = _mm256_broadcastq_epi64(_mm_cvtepu8_epi16(_mm_cvtsi32_si128(group)));
+        acc[i][0] = _mm256_add_epi32(acc[i][0], _mm256_madd_epi16(av, b0));
+        acc[i][1] = _mm256_add_epi32(acc[i][1], _mm256_madd_epi16(av, b1));
+      }
+    }
+#pragma GCC unroll 4
+    for (std::size_t i = 0; i < R; ++i)
+    {
+      const __m256i sum = _mm256_permute4x64_epi64(_mm256_hadd_epi32(acc[i][0], acc[i][1]), 0xd8);
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(c + i * kPanel + col), sum);
+    }
+  }
+}
+#endif
+
+/**
+ * @brief uint8 の入力 MR 行と int8 の重みのパネルの積を int32 で累積する
+ * @param a 入力の先頭ポインタ
+ * @param lda 入力の行のストライド
+ * @param b 重みのパネル. 4 要素ごとのグループ k に対して 64 列 x 4 要素が連続している
+ * @param groups グループの数
+ * @param c 出力 (MR, kPanel)
+ */
+template<std::size_t MR>
+void Int8Kernel(const std::uint8_t *a, std::size_t lda, const std::int8_t *b, std::size_t groups, std::int32_t *c)
+{
+#if defined(__AVX512VNNI__)
+  // アキュムレータがすべてレジスタに載るように, ループはすべて展開する
+  __m512i acc[MR][4];
+#pragma GCC unroll 8
+  for (std::size_t i = 0; i < MR; ++i)
+  {
+#pragma GCC unroll 4
+    for (std::size_t v = 0; v < 4; ++v)
+    {
+      acc[i][v] = _mm512_setzero_si512();
+    }
+  }
+  for (std::size_t k = 0; k < groups; ++k)
+  {
+    const std::int8_t *panel = b + k * kPanel * kGroup;
+    __m512i bv[4];
+#pragma GCC unroll 4
+    for (std::size_t v = 0; v < 4; ++v)
+    {
+      bv[v] = _mm512_loadu_si512(panel + v * 64);
+    }
+#pragma GCC unroll 8
+    for (std::size_t i = 0; i < MR; ++i)
+    {
+      std::int32_t group;
+      std::memcpy(&group, a + i * lda + k * kGroup, sizeof(group));
+      const __m512i av = _mm512_set1_epi32(group);
+#pragma GCC unroll 4
+      for (std::size_t v = 0; v < 4; ++v)
+      {
+        acc[i][v] = _mm512_dpbusd_epi32(acc[i][v], av, bv[v]);
+      }
+    }
+  }
+#pragma GCC unroll 8
+  for (std::size_t i = 0; i < MR; ++i)
+  {
+#pragma GCC unroll 4
+    for (std::size_t v = 0; v < 4; ++v)
+    {
+      _mm512_storeu_si512(c + i * kPanel + v * 16, acc[i][v]);
+    }
+  }
+#elif defined(__AVX2__)
+  // アキュムレータがレジスタからあふれないように, 3 行ずつ計算する
+  constexpr std::size_t R = MR < 3 ? MR : 3;
+  Int8Rows<R>(a, lda, b, groups, c);
+  if constexpr (MR > R)
+  {
+    Int8Kernel<MR - R>(a + R * lda, lda, b, groups, c + R * kPanel);
+  }
+#else
+  std::fill(c, c + MR * kPanel, 0);
+  for (std::size_t k = 0; k < groups; ++k)
+  {
+    const std::int8_t *panel = b + k * kPanel * kGroup;
+    for (std::size_t i = 0; i < MR; ++i)
+    {
+      const std::uint8_t *group = a + i * lda + k * kGroup;
+      std::int32_t *row = c + i * kPanel;
+      for (std::size_t j = 0; j < kPanel; ++j)
+      {
+        const std::int8_t *w = panel + j * kGroup;
+        row[j] += group[0] * w[0] + group[1] * w[1] + group[2] * w[2] + group[3] * w[3];
+      }
+    }
+  }
+#endif
+}
+
+/**
+ * @brief 端数の行も含めて rows (kRows 以下) 行のタイルを計算する
+ */
+void Int8Tile(std::size_t rows,
+              const std::uint8_t *a,
+              std::size_t lda,
+              const std::int8_t *b,
+              std::size_t groups,
+              std::int32_t *c)
+{
+  switch (rows)
+  {
+    case 6: return Int8Kernel<6>(a, lda, b, groups, c);
+    case 5: return Int8Kernel<5>(a, lda, b, groups, c);
+    case 4: return Int8Kernel<4>(a, lda, b, groups, c);
+    case 3: return Int8Kernel<3>(a, lda, b, groups, c);
+    case 2: return Int8Kernel<2>(a, lda, b, groups, c);
+    default: return Int8Kernel<1>(a, lda, b, groups, c);
+  }
+}
+
+/**
+ * @brief テンソルの最小値と最大値で範囲を広げる
+ */
+template<typename T>
+void UpdateRange(const BasicTensor<T> &x, float &min, float &max)
+{
+  const BasicTensor<T> dense = x.Contiguous();
+  const auto [lo, hi] = std::minmax_element(dense.data(), dense.data() + dense.size());
+  if (lo != dense.data() + dense.size())
+  {
+    min = std::min(min, static_cast<float>(*lo));
+    max = std::max(max, static_cast<float>(*hi));
+  }
+}
+} // namespace
+
+QuantizationParams QuantizationParams::FromRange(float min, float max)
+{
+  min = std::min(min, 0.0f);
+  max = std::max(max, 0.0f);
+  QuantizationParams params;
+  if (!(max > min))
+  {
+    return params;
+  }
+  params.scale = (max - min) / 255.0f;
+  params.zero_point = static_cast<std::int32_t>(std::clamp(std::nearbyint(-min / params.scale), 0.0f, 255.0f));
+  return params;
+}
+
+template<typename T>
+void Quantize(const T *x, std::size_t n, QuantizationParams params, std::uint8_t *q)
+{
+  const float inverse = 1.0f / params.scale;
+  const auto zero_point = static_cast<float>(params.zero_point);
+#ifdef NAGATO_OPENMP
+  #pragma omp parallel for if (n > 65536)
+#endif
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    const float v = std::nearbyint(static_cast<float>(x[i]) * inverse) + zero_point;
+    q[i] = static_cast<std::uint8_t>(std::clamp(v, 0.0f, 255.0f));
+  }
+}
+
+template<typename T>
+QuantizedAffine::QuantizedAffine(const BasicTensor<T> &W,
+                                 const BasicTensor<T> &b,
+                                 QuantizationParams input,
+                                 bool relu)
+  : input(input), relu(relu)
+{
+  if (W.shape().size() != 2 || b.size() != W.shape()[1])
+  {
+    throw std::invalid_argument("QuantizedAffine: W は (K, M), b は要素数 M にしてください");
+  }
+  K = W.shape()[0];
+  M = W.shape()[1];
+  const BasicTensor<T> weight = W.Contiguous();
+  const BasicTensor<T> b_dense = b.Contiguous();
+  const T *w = weight.data();
+
+  const std::size_t groups = padded_input_size() / kGroup;
+  const std::size_t panels = (M + kPanel - 1) / kPanel;
+  packed.assign(panels * groups * kPanel * kGroup, 0);
+  scale.resize(M);
+  offset.resize(M);
+  bias.resize(M);
+
+  for (std::size_t j = 0; j < M; ++j)
+  {
+    float max = 0;
+    for (std::size_t k = 0; k < K; ++k)
+    {
+      max = std::max(max, std::fabs(static_cast<float>(w[k * M + j])));
+    }
+    const float weight_scale = max > 0 ? max / 127.0f : 1.0f;
+
+    std::int8_t *panel = packed.data() + (j / kPanel) * groups * kPanel * kGroup + (j % kPanel) * kGroup;
+    std::int32_t sum = 0;
+    for (std::size_t k = 0; k < K; ++k)
+    {
+      const float v = std::nearbyint(static_cast<float>(w[k * M + j]) / weight_scale);
+      const auto q = static_cast<std::int8_t>(std::clamp(v, -127.0f, 127.0f));
+      panel[(k / kGroup) * kPanel * kGroup + k % kGroup] = q;
+      sum += q;
+    }
+    scale[j] = input.scale * weight_scale;
+    offset[j] = input.zero_point * sum;
+    bias[j] = static_cast<float>(b_dense.data()[j]);
+  }
+}
+
+template<typename Store>
+void QuantizedAffine::run(const std::uint8_t *x, std::size_t rows, Store store) const
+{
+  const std::size_t lda = padded_input_size();
+  const std::size_t groups = lda / kGroup;
+  const std::size_t panels = (M + kPanel - 1) / kPanel;
+  const std::size_t row_blocks = (rows + kRows - 1) / kRows;
+  const std::size_t tiles = panels * row_blocks;
+
+  // 同じ重みのパネルを続けて使うように, パネルごとにすべての行のタイルを計算する
+#ifdef NAGATO_OPENMP
+  #pragma omp parallel for if (rows * M * K > 1000000)
+#endif
+  for (std::size_t t = 0; t < tiles; ++t)
+  {
+    const std::size_t p = t / row_blocks;
+    const std::size_t r = t % row_blocks;
+    const std::size_t n = std::min(kRows, rows - r * kRows);
+    alignas(64) std::int32_t acc[kRows * kPanel];
+    Int8Tile(n, x + r * kRows * lda, lda, packed.data() + p * groups * kPanel * kGroup, groups, acc);
+
+    // ゼロ点の補正, スケール, バイアス, ReLU をまとめて適用してから書き込む
+    const std::size_t col = p * kPanel;
+    const std::size_t cols = std::min(kPanel, M - col);
+    const std::int32_t *column_offset = offset.data() + col;
+    const float *column_scale = scale.data() + col;
+    const float *column_bias = bias.data() + col;
+    alignas(64) float tile[kRows * kPanel];
+    for (std::size_t i = 0; i < n; ++i)
+    {
+      for (std::size_t j = 0; j < cols; ++j)
+      {
+        const float v = static_cast<float>(acc[i * kPanel + j] - column_offset[j]) * column_scale[j] + column_bias[j];
+        tile[i * kPanel + j] = relu ? std::max(v, 0.0f) : v;
+      }
+    }
+    store(r * kRows, n, col, cols, tile);
+  }
+}
+
+void QuantizedAffine::forward(const std::uint8_t *x, std::size_t rows, float *y) const
+{
+  const std::size_t ldy = M;
+  run(x, rows, [y, ldy](std::size_t row, std::size_t n, std::size_t col, std::size_t cols, const float *tile)
+  {
+    for (std::size_t i = 0; i < n; ++i)
+    {
+      std::copy(tile + i * kPanel, tile + i * kPanel + cols, y + (row + i) * ldy + col);
+    }
+  });
+}
+
+void QuantizedAffine::forward(const std::uint8_t *x,
+                              std::size_t rows,
+                              QuantizationParams output,
+                              std::uint8_t *y,
+                              std::size_t ldy) const
+{
+  const float inverse = 1.0f / output.scale;
+  const auto zero_point = static_cast<float>(output.zero_point);
+  run(x, rows, [=](std::size_t row, std::size_t n, std::size_t col, std::size_t cols, const float *tile)
+  {
+    for (std::size_t i = 0; i < n; ++i)
+    {
+      std::uint8_t *dst = y + (row + i) * ldy + col;
+      for (std::size_t j = 0; j < cols; ++j)
+      {
+        const float v = std::nearbyint(tile[i * kPanel + j] * inverse) + zero_point;
+        dst[j] = static_cast<std::uint8_t>(std::clamp(v, 0.0f, 255.0f));
+      }
+    }
+  });
+}
+
+std::size_t QuantizedAffine::input_size() const
+{
+  return K;
+}
+
+std::size_t QuantizedAffine::output_size() const
+{
+  return M;
+}
+
+std::size_t QuantizedAffine::padded_input_size() const
+{
+  return (K + kGroup - 1) / kGroup * kGroup;
+}
+
+QuantizationParams QuantizedAffine::input_params() const
+{
+  return input;
+}
+
+template<typename T>
+BasicQuantizedTwoLayerNet<T>::BasicQuantizedTwoLayerNet(BasicTwoLayerNet<T> &net, const std::vector<Tensor> &calibration)
+{
+  if (calibration.empty())
+  {
+    throw std::invalid_argument("QuantizedTwoLayerNet: 校正用のバッチが必要です");
+  }
+
+  // predict と同じ順にレイヤーへ通し, 各 Affine レイヤーの入力の範囲を記録する
+  float input_min = std::numeric_limits<float>::infinity();
+  float input_max = -std::numeric_limits<float>::infinity();
+  float hidden_min = input_min;
+  float hidden_max = input_max;
+  for (const Tensor &batch : calibration)
+  {
+    Tensor h = batch;
+    for (auto &layer : net.layers)
+    {
+      if (layer.first == "Affine1")
+      {
+        UpdateRange(h, input_min, input_max);
+      }
+      else if (layer.first == "Affine2")
+      {
+        UpdateRange(h, hidden_min, hidden_max);
+      }
+      h = layer.second->forward(h);
+    }
+  }
+
+  // ReLU は Affine1 の出力に融合する
+  hidden = QuantizationParams::FromRange(hidden_min, hidden_max);
+  affine1 = QuantizedAffine(*net.params[0].second,
+                            *net.params[1].second,
+                            QuantizationParams::FromRange(input_min, input_max),
+                            true);
+  affine2 = QuantizedAffine(*net.params[2].second, *net.params[3].second, hidden, false);
+}
+
+template<typename T>
+BasicTensor<T> BasicQuantizedTwoLayerNet<T>::predict(const Tensor &x) const
+{
+  if (x.shape().size() != 2 || x.shape()[1] != affine1.input_size())
+  {
+    throw std::invalid_argument("QuantizedTwoLayerNet: 入力は (N, input_size) にしてください");
+  }
+  const std::size_t rows = x.shape()[0];
+  const std::size_t K = affine1.input_size();
+  const std::size_t lda = affine1.padded_input_size();
+  const Tensor source = x.Contiguous();
+
+  std::vector<std::uint8_t> input(rows * lda);
+  if (lda == K)
+  {
+    Quantize(source.data(), rows * K, affine1.input_params(), input.data());
+  }
+  else
+  {
+    for (std::size_t i = 0; i < rows; ++i)
+    {
+      Quantize(source.data() + i * K, K, affine1.input_params(), input.data() + i * lda);
+    }
+  }
+
+  std::vector<std::uint8_t> h(rows * affine2.padded_input_size());
+  affine1.forward(input.data(), rows, hidden, h.data(), affine2.padded_input_size());
+
+  Tensorf y({rows, affine2.output_size()});
+  affine2.forward(h.data(), rows, y.data());
+  return Tensor(std::move(y));
+}
+
+template<typename T>
+T BasicQuantizedTwoLayerNet<T>::accuracy(const Tensor &x, const Tensor &t) const
+{
+  const Tensori result = predict(x).Argmax();
+  const Tensori ans = t.Argmax();
+  const Tensorb equal = result == ans;
+  return Tensor::Sum(equal.template AsType<T>())(0) / static_cast<T>(x.shape()[0]);
+}
+
+// 要素型ごとの明示的インスタンス化
+#define NAGATO_INSTANTIATE_QUANTIZE(T)                                                                 \
+  template void Quantize(const T *, std::size_t, QuantizationParams, std::uint8_t *);                  \
+  template QuantizedAffine::QuantizedAffine(const BasicTensor<T> &,                                    \
+                                            const BasicTensor<T> &,                                    \
+                                            QuantizationParams,                                        \
+                                            bool);                                                     \
+  template class BasicQuantizedTwoLayerNet<T>;
+
+NAGATO_INSTANTIATE_QUANTIZE(float)
+NAGATO_INSTANTIATE_QUANTIZE(double)
+
+#undef NAGATO_INSTANTIATE_QUANTIZE
+
+} // namespace nagato
@@ -0,0 +1,191 @@
+//
+// Created by toru on 2026/10/17.
+//
+
+#ifndef QUANTIZE_HPP
+#define QUANTIZE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "tensor.hpp"
+
+namespace nagato
+{
+
+// network.hpp は nagatolib.hpp を経由してこのヘッダーを読み込むため, 前方宣言で済ませる
+template<typename T>
+class BasicTwoLayerNet;
+
+/**
+ * @brief uint8 への非対称量子化のパラメータ
+ * @note 実数 x を q = round(x / scale) + zero_point (0 - 255 に飽和) で表し, x = (q - zero_point) * scale で戻す
+ */
+struct QuantizationParams
+{
+  float scale = 1.0f;
+  std::int32_t zero_point = 0;
+
+  /**
+   * @brief [min, max] を 0 - 255 に割り当てるパラメータを求める
+   * @note 0 を誤差なく表せるように範囲を 0 を含むまで広げ, zero_point を整数に丸める.
+   *       min >= 0 の場合 (ReLU の出力など) は zero_point が 0 になり, 256 段階をすべて正の値に使う
+   * @param min 最小値
+   * @param max 最大値
+   * @return 量子化のパラメータ
+   */
+  static QuantizationParams FromRange(float min, float max);
+};
+
+/**
+ * @brief 配列を uint8 に量子化する
+ * @note NAGATO_OPENMP が有効な場合は要素数が多いときに並列に変換する
+ * @param x 入力の先頭ポインタ
+ * @param n 要素数
+ * @param params 量子化のパラメータ
+ * @param q 出力の先頭ポインタ
+ */
+template<typename T>
+void Quantize(const T *x, std::size_t n, QuantizationParams params, std::uint8_t *q);
+
+/**
+ * @brief 重みを int8 に量子化した推論専用の Affine レイヤー
+ * @note 重み W (K, M) は出力チャネル (列) ごとに max|W| / 127 のスケールで対称に量子化し,
+ *       uint8 の入力と int8 の重みの積を int32 に累積する. 重みは 64 列ごとのパネルに, 内積の 4 要素を
+ *       連続させて詰めておき, AVX-512 VNNI を使える場合は vpdpbusd で 4 要素の積和を 1 命令で計算する.
+ *       AVX2 では int16 に広げて vpmaddwd で, それ以外はスカラーのループで同じ整数演算を行うため,
+ *       累積した値はどの実装でも一致する (vpmaddubsw は int16 に飽和して値が変わるため使わない).
+ *       入力のゼロ点は重みの列の合計で補正し, スケールを掛けてバイアスを加える処理と ReLU,
+ *       次のレイヤーの入力への量子化は累積した 6 x 64 のタイルごとにまとめて行う (融合した再量子化).
+ *       NAGATO_OPENMP が有効な場合はタイルごとに並列に計算する
+ */
+class QuantizedAffine
+{
+  public:
+    QuantizedAffine() = default;
+
+    /**
+     * @param W 重み (K, M)
+     * @param b バイアス (要素数 M)
+     * @param input 入力の量子化パラメータ
+     * @param relu 出力に ReLU を適用するかどうか
+     */
+    template<typename T>
+    QuantizedAffine(const BasicTensor<T> &W, const BasicTensor<T> &b, QuantizationParams input, bool relu = false);
+
+    /**
+     * @brief 量子化した入力から出力を計算する
+     * @param x 量子化した入力 (rows, K). 行のストライドは padded_input_size() で, 端数の列の値は使わない
+     * @param rows 行数
+     * @param y 出力 (rows, M). 行方向に連続している
+     */
+    void forward(const std::uint8_t *x, std::size_t rows, float *y) const;
+
+    /**
+     * @brief 量子化した入力から出力を計算し, output で量子化して書き込む
+     * @note 次の QuantizedAffine の入力をそのまま作るために使う
+     * @param x 量子化した入力 (rows, K). 行のストライドは padded_input_size()
+     * @param rows 行数
+     * @param output 出力の量子化パラメータ
+     * @param y 出力 (rows, M)
+     * @param ldy 出力の行のストライド. M 以上
+     */
+    void forward(const std::uint8_t *x,
+                 std::size_t rows,
+                 QuantizationParams output,
+                 std::uint8_t *y,
+                 std::size_t ldy) const;
+
+    /**
+     * @brief 入力の要素数 K
+     */
+    std::size_t input_size() const;
+
+    /**
+     * @brief 出力の要素数 M
+     */
+    std::size_t output_size() const;
+
+    /**
+     * @brief 量子化した入力の行のストライド. K を 4 の倍数に切り上げた値
+     */
+    std::size_t padded_input_size() const;
+
+    /**
+     * @brief 入力の量子化パラメータ
+     */
+    QuantizationParams input_params() const;
+
+  private:
+    /**
+     * @brief タイルごとに積を計算し, バイアスと ReLU を適用した浮動小数点数のタイルを store に渡す
+     * @param store (先頭の行, 行数, 先頭の列, 列数, 行のストライドが 64 のタイル) を受け取る関数
+     */
+    template<typename Store>
+    void run(const std::uint8_t *x, std::size_t rows, Store store) const;
+
+    std::size_t K = 0;
+    std::size_t M = 0;
+    QuantizationParams input;
+    bool relu = false;
+
+    /// パネルに詰めた int8 の重み
+    std::vector<std::int8_t> packed;
+
+    /// 列ごとの入力のスケールと重みのスケールの積
+    std::vector<float> scale;
+
+    /// 列ごとの入力のゼロ点と量子化した重みの列の合計の積
+    std::vector<std::int32_t> offset;
+
+    std::vector<float> bias;
+};
+
+/**
+ * @brief 学習済みの 2 層ニューラルネットワークを int8 に量子化した推論専用のネットワーク
+ * @note Affine1 の出力は ReLU と次のレイヤーの入力への量子化を融合して uint8 のまま Affine2 に渡し,
+ *       最後の Affine2 の出力だけを浮動小数点数に戻す
+ * @tparam T 要素型 (float, double)
+ */
+template<typename T>
+class BasicQuantizedTwoLayerNet
+{
+  public:
+    using Tensor = BasicTensor<T>;
+
+    /**
+     * @brief 学習済みのネットワークを量子化する
+     * @note 各校正バッチを net.predict と同じ順にレイヤーへ通し, 各 Affine レイヤーの入力の最小値と最大値から
+     *       活性の量子化パラメータを決める. 校正には学習データの一部など実際の入力に近いバッチを使う
+     * @param net 学習済みのネットワーク. 校正のためにレイヤーの順伝播を呼び出す
+     * @param calibration 校正に使う入力のバッチ (N, input_size)
+     */
+    BasicQuantizedTwoLayerNet(BasicTwoLayerNet<T> &net, const std::vector<Tensor> &calibration);
+
+    /**
+     * @param x 入力 (N, input_size)
+     * @return 出力 (N, output_size). Softmax は適用しない
+     */
+    Tensor predict(const Tensor &x) const;
+
+    /**
+     * @brief 認識精度を計算する
+     * @param x 入力
+     * @param t 教師データ (one-hot)
+     * @return 正解の割合
+     */
+    T accuracy(const Tensor &x, const Tensor &t) const;
+
+  private:
+    QuantizedAffine affine1;
+    QuantizedAffine affine2;
+    QuantizationParams hidden;
+};
+
+using QuantizedTwoLayerNet = BasicQuantizedTwoLayerNet<double>;
+using QuantizedTwoLayerNetf = BasicQuantizedTwoLayerNet<float>;
+
+} // namespace nagato
+
+#endif // QUANTIZE_HPP
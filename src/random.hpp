@@ -5,8 +5,15 @@
 #ifndef NAGATOLIB_SRC_RANDOM_H_
 #define NAGATOLIB_SRC_RANDOM_H_
 
+#include <array>
+#include <cstdint>
+#include <limits>
 #include <random>
+#include <span>
+#include <type_traits>
+#include <vector>
 #include "assert.hpp"
+#include "vector_math.hpp"
 
 namespace nagato
 {
@@ -23,6 +30,28 @@ class Random
   {}
   ~Random() = default;
 
+  /**
+   * 1 つのシードから互いに独立した count 個の乱数列を作る
+   * 各スレッドに 1 つずつ渡して, 1 つのエンジンを共有せずに並列に乱数を生成するために使う.
+   * i 番目の乱数列のエンジンは std::seed_seq{seed, i} で初期化する
+   * @param seed シード
+   * @param count 乱数列の数
+   * @return 乱数列
+   */
+  static std::vector<Random> streams(std::uint64_t seed, std::size_t count)
+  {
+    std::vector<Random> result(count);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      std::seed_seq sequence{static_cast<std::uint32_t>(seed),
+                             static_cast<std::uint32_t>(seed >> 32),
+                             static_cast<std::uint32_t>(i),
+                             static_cast<std::uint32_t>(static_cast<std::uint64_t>(i) >> 32)};
+      result[i].engine_.seed(sequence);
+    }
+    return result;
+  }
+
   template<class Return, class From, class To>
   Return uniform_int_distribution(From from, To to) noexcept
   {
@@ -50,10 +79,95 @@ class Random
     return distribution(engine_);
   }
 
+  /**
+   * 1 つの分布のオブジェクトで配列を埋める
+   * 要素ごとに分布を作り直さないため, std::normal_distribution が 2 つずつ作る値も捨てずに使う
+   * @param out 出力
+   * @param distribution 分布
+   */
+  template<class T, class Distribution>
+  void fill(std::span<T> out, Distribution distribution)
+  {
+    for (auto &x : out)
+    {
+      x = static_cast<T>(distribution(engine_));
+    }
+  }
+
+  /**
+   * 配列を [from, to) の一様乱数で埋める
+   * float と double はエンジンから 64 ビットの鍵を 1 つだけ取り出し, VectorRandomUniform (Philox4x32-10) で
+   * SIMD と並列に生成する. それ以外の型は std::uniform_real_distribution で 1 つずつ生成する
+   * @param out 出力
+   * @param from 下限
+   * @param to 上限
+   */
+  template<class T, class From, class To>
+  void fill_uniform_real(std::span<T> out, From from, To to)
+  {
+    STATIC_ASSERT_IS_FLOATING_POINT(T);
+    if constexpr (std::is_same_v<T, float> || std::is_same_v<T, double>)
+    {
+      VectorRandomUniform(draw_key(), static_cast<T>(from), static_cast<T>(to), out.data(), out.size());
+    }
+    else
+    {
+      fill(out, std::uniform_real_distribution<T>(from, to));
+    }
+  }
+
+  /**
+   * 配列を [from, to] の一様な整数の乱数で埋める
+   * @param out 出力
+   * @param from 下限
+   * @param to 上限
+   */
+  template<class T, class From, class To>
+  void fill_uniform_int(std::span<T> out, From from, To to)
+  {
+    STATIC_ASSERT_IS_INTEGER(T);
+    fill(out, std::uniform_int_distribution<T>(from, to));
+  }
+
+  /**
+   * 配列を正規分布 N(mu, sigma^2) の乱数で埋める
+   * float と double は VectorRandomNormal (Philox4x32-10 と Box-Muller 法) で生成する
+   * @param out 出力
+   * @param mu 平均
+   * @param sigma 標準偏差
+   */
+  template<class T, class Mu, class Sigma>
+  void fill_normal(std::span<T> out, Mu mu, Sigma sigma)
+  {
+    STATIC_ASSERT_IS_FLOATING_POINT(T);
+    if constexpr (std::is_same_v<T, float> || std::is_same_v<T, double>)
+    {
+      VectorRandomNormal(draw_key(), static_cast<T>(mu), static_cast<T>(sigma), out.data(), out.size());
+    }
+    else
+    {
+      fill(out, std::normal_distribution<T>(mu, sigma));
+    }
+  }
+
  private:
+  /**
+   * エンジンから Philox4x32-10 の鍵にする 64 ビットの値を取り出す
+   */
+  std::uint64_t draw_key()
+  {
+    const std::uint64_t hi = engine_();
+    return (hi << 32) ^ engine_();
+  }
+
   Engine engine_;
 };
 
+/**
+ * 乗算合同法の乱数生成器 x_{n+1} = a * x_n mod (2^w - 1) (a = 48271, w は UINT のビット数)
+ * a * x_n は 2 倍の幅の整数で計算する. 状態の更新が乗算だけなので, n 個先の状態を
+ * a^n mod (2^w - 1) を掛けて O(log n) で求められる
+ */
 template<typename UINT = std::uint64_t>
 class LinearCongruential
 {
@@ -61,13 +175,51 @@ class LinearCongruential
   static_assert(std::is_unsigned<UINT>(),
                 "UINT is signed type!");
 
-  using ld = long double;
+  using wide_type = std::conditional_t<(sizeof(UINT) < sizeof(std::uint64_t)), std::uint64_t, unsigned __int128>;
  public:
+  using result_type = UINT;
+
+  /**
+   * @param seed シード. 状態 0 は乗算で 0 のまま変わらないため, 2^w - 1 で割り切れるシード (0 と 2^w - 1) は
+   *             0 でない固定の状態から始める
+   */
   constexpr LinearCongruential(UINT seed = 1) noexcept
-    : seed_(seed), x_(seed)
+    : x_(initial_state(seed)), seed_(seed)
   {
   }
 
+  /**
+   * 1 つのシードから重ならない count 個の乱数列を作る
+   * i 番目の乱数列は seed の乱数列を i * stride 個進めた位置から始まるため, それぞれ stride 個までは
+   * 他の乱数列と重ならない
+   * @param seed シード
+   * @param count 乱数列の数
+   * @param stride 乱数列の間隔
+   * @return 乱数列
+   */
+  static std::vector<LinearCongruential> streams(UINT seed, std::size_t count, unsigned long long stride)
+  {
+    std::vector<LinearCongruential> result;
+    result.reserve(count);
+    LinearCongruential generator(seed);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      result.emplace_back(generator.x_);
+      generator.discard(stride);
+    }
+    return result;
+  }
+
+  static constexpr UINT min() noexcept
+  {
+    return 1;
+  }
+
+  static constexpr UINT max() noexcept
+  {
+    return mod_ - 1;
+  }
+
   constexpr UINT seed() const noexcept
   {
     return seed_;
@@ -75,30 +227,194 @@ class LinearCongruential
 
   constexpr UINT next() noexcept
   {
-    return x_ = (coefficient_ * x_) % mod_;
+    return x_ = multiply(coefficient_, x_);
+  }
+
+  constexpr UINT operator()() noexcept
+  {
+    return next();
+  }
+
+  /**
+   * 状態を n 個進める. 繰り返し二乗法で a^n を求めるため O(log n)
+   * @param n 進める数
+   */
+  constexpr void discard(unsigned long long n) noexcept
+  {
+    x_ = multiply(power(coefficient_, n), x_);
   }
 
+  /**
+   * [from, to) の一様な整数の乱数を生成する
+   * 状態 x (< 2^w) と幅 to - from の積の上位 w ビットを使うため, 除算をしない
+   */
   template<typename Int, typename From, typename To>
   constexpr Int uniform_int(From from, To to) noexcept
   {
     STATIC_ASSERT_IS_INTEGER(Int);
-    ld diff = static_cast<From>(to) - from;
-    return from + diff * next() / mod_;
+    return to_int<Int>(next(), from, to);
   }
 
+  /**
+   * [from, to) の一様乱数を生成する
+   * 状態の上位のビットを Real の仮数部の桁数だけ使って [0, 1) の値を作る
+   */
   template<typename Real, typename From, typename To>
   constexpr Real uniform_real(From from, To to) noexcept
   {
     STATIC_ASSERT_IS_FLOATING_POINT(Real);
-    From diff = static_cast<From>(to) - from;
-    return from + diff * (next() / mod_);
+    return to_real<Real>(next(), from, to);
+  }
+
+  /**
+   * 配列を uniform_int と同じ値で埋める
+   * next() を繰り返し呼んだ場合と同じ乱数列になり, 埋めた後の状態も同じになる
+   * @param out 出力
+   * @param from 下限
+   * @param to 上限
+   */
+  template<typename Int, typename From, typename To>
+  constexpr void fill_uniform_int(std::span<Int> out, From from, To to) noexcept
+  {
+    STATIC_ASSERT_IS_INTEGER(Int);
+    fill_states(out, [from, to](UINT x) { return to_int<Int>(x, from, to); });
+  }
+
+  /**
+   * 配列を uniform_real と同じ値で埋める
+   * @param out 出力
+   * @param from 下限
+   * @param to 上限
+   */
+  template<typename Real, typename From, typename To>
+  constexpr void fill_uniform_real(std::span<Real> out, From from, To to) noexcept
+  {
+    STATIC_ASSERT_IS_FLOATING_POINT(Real);
+    fill_states(out, [from, to](UINT x) { return to_real<Real>(x, from, to); });
   }
 
  private:
+  static constexpr UINT initial_state(UINT seed) noexcept
+  {
+    const UINT x = seed % mod_;
+    return x != 0 ? x : static_cast<UINT>(0x9e3779b97f4a7c15ull);
+  }
+
+  /**
+   * a * b mod (2^w - 1). 2^w = 1 (mod 2^w - 1) なので, 積の上位と下位の w ビットを足してから剰余を取る
+   */
+  static constexpr UINT multiply(UINT a, UINT b) noexcept
+  {
+    constexpr int kBits = std::numeric_limits<UINT>::digits;
+    const wide_type product = static_cast<wide_type>(a) * b;
+    wide_type r = (product & mod_) + (product >> kBits);
+    r = (r & mod_) + (r >> kBits);
+    return static_cast<UINT>(r >= mod_ ? r - mod_ : r);
+  }
+
+  static constexpr UINT power(UINT a, unsigned long long n) noexcept
+  {
+    UINT result = 1;
+    while (n > 0)
+    {
+      if (n & 1)
+      {
+        result = multiply(result, a);
+      }
+      a = multiply(a, a);
+      n >>= 1;
+    }
+    return result;
+  }
+
+  template<typename Int, typename From, typename To>
+  static constexpr Int to_int(UINT x, From from, To to) noexcept
+  {
+    constexpr int kBits = std::numeric_limits<UINT>::digits;
+    const auto range = static_cast<unsigned __int128>(static_cast<std::int64_t>(to) - static_cast<std::int64_t>(from));
+    return static_cast<Int>(static_cast<std::int64_t>(from) + static_cast<std::int64_t>((range * x) >> kBits));
+  }
+
+  template<typename Real, typename From, typename To>
+  static constexpr Real to_real(UINT x, From from, To to) noexcept
+  {
+    constexpr int kBits = std::numeric_limits<UINT>::digits;
+    constexpr int kShift = kBits > std::numeric_limits<Real>::digits ? kBits - std::numeric_limits<Real>::digits : 0;
+    constexpr Real kScale = Real(1) / (static_cast<Real>(UINT(1) << (kBits - kShift - 1)) * 2);
+    const Real unit = static_cast<Real>(x >> kShift) * kScale;
+    return static_cast<Real>(from) + (static_cast<Real>(to) - static_cast<Real>(from)) * unit;
+  }
+
+  template<typename T, typename Transform>
+  constexpr void fill_states(std::span<T> out, Transform transform) noexcept
+  {
+    for (T &y : out)
+    {
+      y = transform(next());
+    }
+  }
+
+
+  static constexpr UINT coefficient_ = 48271;
+  static constexpr UINT mod_ = std::numeric_limits<UINT>::max();
+
   UINT x_;
-  const UINT coefficient_ = 48271;
-  const UINT mod_ = std::numeric_limits<UINT>::max();
-  const UINT seed_;
+  UINT seed_;
+};
+
+/**
+ * カウンターベースの乱数生成器 Philox4x32-10
+ * (Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3", SC 2011)
+ * 128 ビットのカウンタと 64 ビットの鍵から 128 ビットの乱数を計算する.
+ * 状態を持たず任意の位置の乱数を直接計算できるため, 分割して並列に計算しても結果が変わらない
+ */
+class Philox4x32
+{
+ public:
+  using counter_type = std::array<std::uint32_t, 4>;
+  using key_type = std::array<std::uint32_t, 2>;
+
+  static constexpr std::uint32_t kMultiplier0 = 0xD2511F53;
+  static constexpr std::uint32_t kMultiplier1 = 0xCD9E8D57;
+  static constexpr std::uint32_t kWeyl0 = 0x9E3779B9;
+  static constexpr std::uint32_t kWeyl1 = 0xBB67AE85;
+  static constexpr int kRounds = 10;
+
+  /**
+   * カウンタと鍵から乱数を計算する
+   * @param counter カウンタ
+   * @param key 鍵
+   * @return 4 つの 32 ビットの乱数
+   */
+  static constexpr counter_type generate(counter_type counter, key_type key) noexcept
+  {
+    for (int round = 0; round < kRounds; ++round)
+    {
+      const std::uint64_t p0 = static_cast<std::uint64_t>(kMultiplier0) * counter[0];
+      const std::uint64_t p1 = static_cast<std::uint64_t>(kMultiplier1) * counter[2];
+      counter = {
+        static_cast<std::uint32_t>(p1 >> 32) ^ counter[1] ^ key[0],
+        static_cast<std::uint32_t>(p1),
+        static_cast<std::uint32_t>(p0 >> 32) ^ counter[3] ^ key[1],
+        static_cast<std::uint32_t>(p0)
+      };
+      key[0] += kWeyl0;
+      key[1] += kWeyl1;
+    }
+    return counter;
+  }
+
+  /**
+   * シードのストリームの block 番目の乱数を計算する
+   * @param seed シード. 鍵として使う
+   * @param block ブロックの番号. カウンタの下位 64 ビットとして使う
+   * @return 4 つの 32 ビットの乱数
+   */
+  static constexpr counter_type generate(std::uint64_t seed, std::uint64_t block) noexcept
+  {
+    return generate(counter_type{static_cast<std::uint32_t>(block), static_cast<std::uint32_t>(block >> 32), 0, 0},
+                    key_type{static_cast<std::uint32_t>(seed), static_cast<std::uint32_t>(seed >> 32)});
+  }
 };
 
 }
@@ -0,0 +1,411 @@
+//
+// Created by toru on 2026/10/17.
+//
+
+#ifndef SMALL_VECTOR_HPP
+#define SMALL_VECTOR_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace nagato
+{
+
+/**
+ * @brief 要素数が N 以下の間はヒープを使わずに内部の配列へ格納する可変長配列
+ * @note テンソルの形状やストライドのように要素数がほとんど小さい配列に使用する.
+ *       N を超えた場合はヒープに確保した領域へ移る. std::vector との相互変換と比較ができる
+ * @tparam T 要素型 (トリビアルにコピーできる型)
+ * @tparam N 内部の配列の要素数
+ */
+template<typename T, std::size_t N>
+class SmallVector
+{
+    static_assert(std::is_trivially_copyable_v<T>, "SmallVector requires a trivially copyable type");
+
+  public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = T &;
+    using const_reference = const T &;
+    using pointer = T *;
+    using const_pointer = const T *;
+    using iterator = T *;
+    using const_iterator = const T *;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+    SmallVector() noexcept
+    {
+    }
+
+    explicit SmallVector(size_type count, const T &value = T())
+    {
+      assign(count, value);
+    }
+
+    SmallVector(std::initializer_list<T> values)
+    {
+      assign(values.begin(), values.end());
+    }
+
+    template<typename InputIt>
+      requires (!std::is_integral_v<InputIt>)
+    SmallVector(InputIt first, InputIt last)
+    {
+      assign(first, last);
+    }
+
+    SmallVector(const std::vector<T> &values)
+    {
+      assign(values.begin(), values.end());
+    }
+
+    SmallVector(const SmallVector &other)
+    {
+      assign(other.begin(), other.end());
+    }
+
+    SmallVector(SmallVector &&other) noexcept
+    {
+      move_from(other);
+    }
+
+    ~SmallVector() = default;
+
+    SmallVector &operator=(const SmallVector &other)
+    {
+      if (this != &other)
+      {
+        assign(other.begin(), other.end());
+      }
+      return *this;
+    }
+
+    SmallVector &operator=(SmallVector &&other) noexcept
+    {
+      if (this != &other)
+      {
+        heap_.reset();
+        capacity_ = N;
+        move_from(other);
+      }
+      return *this;
+    }
+
+    SmallVector &operator=(std::initializer_list<T> values)
+    {
+      assign(values.begin(), values.end());
+      return *this;
+    }
+
+    /**
+     * @brief std::vector に変換する
+     */
+    operator std::vector<T>() const
+    {
+      return std::vector<T>(begin(), end());
+    }
+
+    void assign(size_type count, const T &value)
+    {
+      clear();
+      resize(count, value);
+    }
+
+    template<typename InputIt>
+      requires (!std::is_integral_v<InputIt>)
+    void assign(InputIt first, InputIt last)
+    {
+      clear();
+      if constexpr (std::is_base_of_v<std::forward_iterator_tag,
+                                      typename std::iterator_traits<InputIt>::iterator_category>)
+      {
+        reserve(static_cast<size_type>(std::distance(first, last)));
+      }
+      for (; first != last; ++first)
+      {
+        push_back(*first);
+      }
+    }
+
+    size_type size() const noexcept
+    {
+      return size_;
+    }
+
+    bool empty() const noexcept
+    {
+      return size_ == 0;
+    }
+
+    size_type capacity() const noexcept
+    {
+      return capacity_;
+    }
+
+    T *data() noexcept
+    {
+      return heap_ ? heap_.get() : inline_;
+    }
+
+    const T *data() const noexcept
+    {
+      return heap_ ? heap_.get() : inline_;
+    }
+
+    iterator begin() noexcept
+    {
+      return data();
+    }
+
+    iterator end() noexcept
+    {
+      return data() + size_;
+    }
+
+    const_iterator begin() const noexcept
+    {
+      return data();
+    }
+
+    const_iterator end() const noexcept
+    {
+      return data() + size_;
+    }
+
+    const_iterator cbegin() const noexcept
+    {
+      return begin();
+    }
+
+    const_iterator cend() const noexcept
+    {
+      return end();
+    }
+
+    reverse_iterator rbegin() noexcept
+    {
+      return reverse_iterator(end());
+    }
+
+    reverse_iterator rend() noexcept
+    {
+      return reverse_iterator(begin());
+    }
+
+    const_reverse_iterator rbegin() const noexcept
+    {
+      return const_reverse_iterator(end());
+    }
+
+    const_reverse_iterator rend() const noexcept
+    {
+      return const_reverse_iterator(begin());
+    }
+
+    T &operator[](size_type i) noexcept
+    {
+      return data()[i];
+    }
+
+    const T &operator[](size_type i) const noexcept
+    {
+      return data()[i];
+    }
+
+    T &at(size_type i)
+    {
+      if (i >= size_)
+      {
+        throw std::out_of_range("SmallVector index is out of range");
+      }
+      return data()[i];
+    }
+
+    const T &at(size_type i) const
+    {
+      if (i >= size_)
+      {
+        throw std::out_of_range("SmallVector index is out of range");
+      }
+      return data()[i];
+    }
+
+    T &front() noexcept
+    {
+      return data()[0];
+    }
+
+    const T &front() const noexcept
+    {
+      return data()[0];
+    }
+
+    T &back() noexcept
+    {
+      return data()[size_ - 1];
+    }
+
+    const T &back() const noexcept
+    {
+      return data()[size_ - 1];
+    }
+
+    void reserve(size_type capacity)
+    {
+      if (capacity <= capacity_)
+      {
+        return;
+      }
+      auto heap = std::make_unique_for_overwrite<T[]>(capacity);
+      std::copy(begin(), end(), heap.get());
+      heap_ = std::move(heap);
+      capacity_ = capacity;
+    }
+
+    void clear() noexcept
+    {
+      size_ = 0;
+    }
+
+    void resize(size_type count, const T &value = T())
+    {
+      reserve(count);
+      if (count > size_)
+      {
+        std::fill(data() + size_, data() + count, value);
+      }
+      size_ = count;
+    }
+
+    void push_back(const T &value)
+    {
+      const T copy = value;
+      grow(size_ + 1);
+      data()[size_++] = copy;
+    }
+
+    template<typename... Args>
+    T &emplace_back(Args &&...args)
+    {
+      push_back(T(std::forward<Args>(args)...));
+      return back();
+    }
+
+    void pop_back() noexcept
+    {
+      --size_;
+    }
+
+    iterator insert(const_iterator pos, const T &value)
+    {
+      return insert(pos, size_type(1), value);
+    }
+
+    iterator insert(const_iterator pos, size_type count, const T &value)
+    {
+      const size_type index = static_cast<size_type>(pos - begin());
+      const T copy = value;
+      grow(size_ + count);
+      std::copy_backward(begin() + index, end(), end() + count);
+      std::fill(begin() + index, begin() + index + count, copy);
+      size_ += count;
+      return begin() + index;
+    }
+
+    template<typename InputIt>
+      requires (!std::is_integral_v<InputIt>)
+    iterator insert(const_iterator pos, InputIt first, InputIt last)
+    {
+      // 自身の要素を挿入する場合に備えて一度コピーする
+      const SmallVector values(first, last);
+      const size_type index = static_cast<size_type>(pos - begin());
+      const size_type count = values.size();
+      grow(size_ + count);
+      std::copy_backward(begin() + index, end(), end() + count);
+      std::copy(values.begin(), values.end(), begin() + index);
+      size_ += count;
+      return begin() + index;
+    }
+
+    iterator insert(const_iterator pos, std::initializer_list<T> values)
+    {
+      return insert(pos, values.begin(), values.end());
+    }
+
+    iterator erase(const_iterator pos)
+    {
+      return erase(pos, pos + 1);
+    }
+
+    iterator erase(const_iterator first, const_iterator last)
+    {
+      const size_type index = static_cast<size_type>(first - begin());
+      const size_type count = static_cast<size_type>(last - first);
+      std::copy(begin() + index + count, end(), begin() + index);
+      size_ -= count;
+      return begin() + index;
+    }
+
+    friend bool operator==(const SmallVector &a, const SmallVector &b)
+    {
+      return std::equal(a.begin(), a.end(), b.begin(), b.end());
+    }
+
+    friend bool operator==(const SmallVector &a, const std::vector<T> &b)
+    {
+      return std::equal(a.begin(), a.end(), b.begin(), b.end());
+    }
+
+  private:
+    /**
+     * @brief 要素数 count を格納できるように容量を 2 倍ずつ増やす
+     */
+    void grow(size_type count)
+    {
+      if (count > capacity_)
+      {
+        reserve(std::max(count, capacity_ * 2));
+      }
+    }
+
+    void move_from(SmallVector &other) noexcept
+    {
+      if (other.heap_)
+      {
+        heap_ = std::move(other.heap_);
+        capacity_ = other.capacity_;
+      }
+      else
+      {
+        std::copy(other.inline_, other.inline_ + other.size_, inline_);
+      }
+      size_ = other.size_;
+      other.size_ = 0;
+      other.capacity_ = N;
+    }
+
+    /// 要素数が N 以下の場合の格納先
+    T inline_[N];
+
+    /// 要素数が N を超えた場合の格納先
+    std::unique_ptr<T[]> heap_;
+
+    size_type size_ = 0;
+    size_type capacity_ = N;
+};
+
+/// テンソルの形状とストライドの型. 8 次元まではヒープを使わない
+using Shape = SmallVector<std::size_t, 8>;
+
+} // namespace nagato
+
+#endif // SMALL_VECTOR_HPP
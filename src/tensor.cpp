@@ -3,28 +3,323 @@
 //
 
 #include "tensor.hpp"
+#include "gemm.hpp"
+#include "vector_math.hpp"
+#include "mapped_file.hpp"
+#include <charconv>
+#include <cstring>
 #include <iostream>
 #include <numeric>
 #include <random>
-#include <fstream>
-#include <sstream>
 #include <stdexcept>
 #include <algorithm>
 #include <initializer_list>
+#include <limits>
+#include <tuple>
 #include <type_traits>
 
 namespace nagato
 {
-Tensor::Tensor()
+namespace
+{
+/**
+ * @brief 形状から要素数を計算する
+ */
+std::size_t ElementCount(const Shape &shape)
+{
+  return std::accumulate(shape.begin(), shape.end(), std::size_t(1), std::multiplies<std::size_t>());
+}
+
+/**
+ * @brief シードを指定しない乱数のために 64 ビットのシードを作る
+ */
+std::uint64_t RandomSeed()
+{
+  std::random_device rd;
+  return (static_cast<std::uint64_t>(rd()) << 32) | rd();
+}
+
+/**
+ * @brief 行優先で連続したテンソルのストライドを計算する
+ */
+Shape ContiguousStrides(const Shape &shape)
+{
+  Shape strides(shape.size(), 1);
+  for (std::size_t i = shape.size(); i > 1; --i)
+  {
+    strides[i - 2] = strides[i - 1] * shape[i - 1];
+  }
+  return strides;
+}
+
+/**
+ * @brief データ領域を作成する. 参照カウントの管理領域も含めて TensorAllocator から確保する
+ */
+template<typename Storage, typename... Args>
+std::shared_ptr<Storage> MakeStorage(Args &&...args)
+{
+  return std::allocate_shared<Storage>(TensorAllocator<Storage>(), std::forward<Args>(args)...);
+}
+
+/**
+ * @brief コピーのために軸をまとめる
+ * @note 長さ 1 の軸を除き, コピー元でも連続している隣り合う軸を 1 つにする. コピー先は常に連続しているため,
+ *       まとめた後も要素の順序は変わらない. すべての軸の長さが 1 の場合は長さ 1 の軸を 1 つ残す
+ */
+void MergeCopyAxes(const Shape &shape, const Shape &strides, Shape &merged_shape, Shape &merged_strides)
+{
+  merged_shape.clear();
+  merged_strides.clear();
+  for (std::size_t d = 0; d < shape.size(); ++d)
+  {
+    if (shape[d] == 1)
+    {
+      continue;
+    }
+    if (!merged_shape.empty() && merged_strides.back() == strides[d] * shape[d])
+    {
+      merged_shape.back() *= shape[d];
+      merged_strides.back() = strides[d];
+    }
+    else
+    {
+      merged_shape.push_back(shape[d]);
+      merged_strides.push_back(strides[d]);
+    }
+  }
+  if (merged_shape.empty())
+  {
+    merged_shape.push_back(1);
+    merged_strides.push_back(1);
+  }
+}
+
+/**
+ * @brief 外側の軸の通し番号からコピー元の位置を計算する
+ * @param shape 形状
+ * @param strides ストライド
+ * @param axes 通し番号に含める軸 (外側から順)
+ * @param count axes の要素数
+ * @param index 通し番号
+ * @return コピー元の位置
+ */
+std::size_t StridedOffset(const Shape &shape,
+                          const Shape &strides,
+                          const std::size_t *axes,
+                          std::size_t count,
+                          std::size_t index)
+{
+  std::size_t offset = 0;
+  for (std::size_t k = count; k > 0; --k)
+  {
+    const std::size_t d = axes[k - 1];
+    offset += (index % shape[d]) * strides[d];
+    index /= shape[d];
+  }
+  return offset;
+}
+
+/**
+ * @brief 最後の軸を 1 行として行ごとにコピーする
+ * @note 行をおよそ kBlockElements 要素ずつのブロックに分け, ブロックの先頭で位置を計算した後は
+ *       インデックスを繰り上げながら進める. NAGATO_OPENMP が有効な場合はブロックごとに並列に計算する
+ */
+template<typename T>
+void CopyRows(const Shape &shape, const T *src, const Shape &strides, T *dst)
+{
+  const std::size_t ndim = shape.size();
+  const std::size_t inner = shape[ndim - 1];
+  const std::size_t inner_stride = strides[ndim - 1];
+  const std::size_t rows = ElementCount(shape) / inner;
+
+  Shape outer_axes(ndim - 1);
+  std::iota(outer_axes.begin(), outer_axes.end(), std::size_t(0));
+
+  constexpr std::size_t kBlockElements = 16384;
+  const std::size_t rows_per_block = std::max<std::size_t>(1, kBlockElements / inner);
+  const std::size_t blocks = (rows + rows_per_block - 1) / rows_per_block;
+
+#ifdef NAGATO_OPENMP
+  #pragma omp parallel for if (rows * inner > 65536)
+#endif
+  for (std::size_t block = 0; block < blocks; ++block)
+  {
+    const std::size_t row_begin = block * rows_per_block;
+    const std::size_t row_end = std::min(rows, row_begin + rows_per_block);
+
+    Shape index(ndim, 0);
+    std::size_t rest = row_begin;
+    for (std::size_t d = ndim - 1; d > 0; --d)
+    {
+      index[d - 1] = rest % shape[d - 1];
+      rest /= shape[d - 1];
+    }
+    std::size_t src_offset = StridedOffset(shape, strides, outer_axes.data(), ndim - 1, row_begin);
+
+    for (std::size_t r = row_begin; r < row_end; ++r)
+    {
+      const T *row = src + src_offset;
+      T *out = dst + r * inner;
+      if (inner_stride == 1)
+      {
+        std::copy(row, row + inner, out);
+      }
+      else
+      {
+        for (std::size_t i = 0; i < inner; ++i)
+        {
+          out[i] = row[i * inner_stride];
+        }
+      }
+
+      // 次の行の先頭に進める
+      for (std::size_t d = ndim - 1; d > 0; --d)
+      {
+        src_offset += strides[d - 1];
+        if (++index[d - 1] < shape[d - 1])
+        {
+          break;
+        }
+        src_offset -= strides[d - 1] * shape[d - 1];
+        index[d - 1] = 0;
+      }
+    }
+  }
+}
+
+/**
+ * @brief コピー元で連続している軸 unit_axis と最後の軸を入れ替えるコピーをタイルごとに行う
+ * @note 2 つの軸を kTile x kTile のタイルに分け, タイルの中ではコピー元を連続した順に読み, コピー先には
+ *       kTile 要素ずつ連続して書き込む. どちらの側のキャッシュラインもタイルの中で使い切るため,
+ *       軸の入れ替えでもキャッシュミスがほぼコピー元とコピー先の 1 回ずつになる.
+ *       NAGATO_OPENMP が有効な場合は (他の軸, タイルの行) ごとに並列に計算する
+ */
+template<typename T>
+void CopyTransposed(const Shape &shape, const T *src, const Shape &strides, std::size_t unit_axis, T *dst)
+{
+  constexpr std::size_t kTile = 32;
+  const std::size_t ndim = shape.size();
+  const Shape dst_strides = ContiguousStrides(shape);
+
+  // 行列 (rows x cols) の転置として扱う. rows はコピー元で連続, cols はコピー先で連続
+  const std::size_t rows = shape[unit_axis];
+  const std::size_t cols = shape[ndim - 1];
+  const std::size_t src_col_stride = strides[ndim - 1];
+  const std::size_t dst_row_stride = dst_strides[unit_axis];
+
+  Shape other_axes;
+  for (std::size_t d = 0; d + 1 < ndim; ++d)
+  {
+    if (d != unit_axis)
+    {
+      other_axes.push_back(d);
+    }
+  }
+  const std::size_t matrices = ElementCount(shape) / (rows * cols);
+  const std::size_t row_tiles = (rows + kTile - 1) / kTile;
+
+#ifdef NAGATO_OPENMP
+  #pragma omp parallel for if (matrices * rows * cols > 65536)
+#endif
+  for (std::size_t task = 0; task < matrices * row_tiles; ++task)
+  {
+    const std::size_t matrix = task / row_tiles;
+    const std::size_t i0 = (task % row_tiles) * kTile;
+    const std::size_t i1 = std::min(rows, i0 + kTile);
+    const T *s = src + StridedOffset(shape, strides, other_axes.data(), other_axes.size(), matrix);
+    T *d = dst + StridedOffset(shape, dst_strides, other_axes.data(), other_axes.size(), matrix);
+
+    for (std::size_t j0 = 0; j0 < cols; j0 += kTile)
+    {
+      const std::size_t j1 = std::min(cols, j0 + kTile);
+      for (std::size_t i = i0; i < i1; ++i)
+      {
+        const T *column = s + i;
+        T *out = d + i * dst_row_stride;
+        for (std::size_t j = j0; j < j1; ++j)
+        {
+          out[j] = column[j * src_col_stride];
+        }
+      }
+    }
+  }
+}
+
+/**
+ * @brief 任意のストライドを持つ要素を行優先の順に連続した領域へコピーする
+ * @note まず長さ 1 の軸を除いて連続した軸をまとめる. 最後の軸がコピー元でも連続していれば行ごとにコピーし,
+ *       そうでなくコピー元で連続した軸が他にあれば (転置など) その軸と最後の軸をタイルごとに入れ替える.
+ *       どちらでもなければ最後の軸を飛び飛びに読みながら行ごとにコピーする
+ * @param shape 形状
+ * @param src コピー元の先頭要素
+ * @param strides コピー元のストライド
+ * @param dst コピー先. 要素数分の連続した領域
+ */
+template<typename T>
+void CopyStrided(const Shape &shape,
+                 const T *src,
+                 const Shape &strides,
+                 T *dst)
+{
+  if (shape.empty())
+  {
+    dst[0] = src[0];
+    return;
+  }
+  if (ElementCount(shape) == 0)
+  {
+    return;
+  }
+
+  Shape merged_shape;
+  Shape merged_strides;
+  MergeCopyAxes(shape, strides, merged_shape, merged_strides);
+
+  const std::size_t ndim = merged_shape.size();
+  if (merged_strides[ndim - 1] != 1)
+  {
+    for (std::size_t d = ndim - 1; d > 0; --d)
+    {
+      if (merged_strides[d - 1] == 1)
+      {
+        CopyTransposed(merged_shape, src, merged_strides, d - 1, dst);
+        return;
+      }
+    }
+  }
+  CopyRows(merged_shape, src, merged_strides, dst);
+}
+} // namespace
+
+template<typename T>
+BasicTensor<T>::BasicTensor()
   : shape_(),
     strides_(),
-    storage_()
+    storage_(MakeStorage<storage_type>())
 {
 }
 
-Tensor::Tensor(const shape_type &shape)
+template<typename T>
+BasicTensor<T>::BasicTensor(const shape_type &shape, std::shared_ptr<storage_type> storage)
   : shape_(shape),
-    strides_(shape.size(), 1)
+    strides_(ContiguousStrides(shape)),
+    storage_(std::move(storage))
+{
+  if (!has_shape())
+  {
+    throw std::invalid_argument("shape is not set");
+  }
+  if (storage_ == nullptr || storage_->size() != ElementCount(shape))
+  {
+    throw std::invalid_argument("storage size does not match the shape");
+  }
+}
+
+template<typename T>
+BasicTensor<T>::BasicTensor(const shape_type &shape)
+  : shape_(shape),
+    strides_(shape.size(), 1),
+    storage_(MakeStorage<storage_type>())
 {
   if (!has_shape())
   {
@@ -34,239 +329,269 @@ Tensor::Tensor(const shape_type &shape)
   this->set_shape(shape);
 }
 
-bool Tensor::has_shape() const
+template<typename T>
+bool BasicTensor<T>::has_shape() const
 {
   return !shape_.empty();
 }
 
-void Tensor::set_shape(const shape_type &shape)
+template<typename T>
+void BasicTensor<T>::set_shape(const shape_type &shape)
 {
   shape_ = shape;
-  strides_.resize(shape.size(), 1);
-
-  for (std::size_t i = shape.size() - 1; i > 0; --i)
-  {
-    strides_[i - 1] = strides_[i] * shape[i];
-  }
-
-  // 確保するストレージサイズを計算する
-  std::size_t storage_size = 1;
-  for (std::size_t i = 0; i < shape.size(); ++i)
-  {
-    storage_size *= shape[i];
-  }
+  strides_ = ContiguousStrides(shape);
+  offset_ = 0;
 
   // データ領域を確保
-  storage_.resize(storage_size, 0);
+  storage_->resize(ElementCount(shape), 0);
 }
 
-const Tensor::shape_type &Tensor::shape() const
+template<typename T>
+const typename BasicTensor<T>::shape_type &BasicTensor<T>::shape() const
 {
   return shape_;
 }
 
-const Tensor::strides_type &Tensor::strides() const
+template<typename T>
+const typename BasicTensor<T>::strides_type &BasicTensor<T>::strides() const
 {
   return strides_;
 }
 
-const Tensor::storage_type &Tensor::storage() const
+template<typename T>
+const typename BasicTensor<T>::storage_type &BasicTensor<T>::storage() const
 {
-  return storage_;
+  // const の参照から詰め直すと, 同じビューを並列に読み出すときに storage_ の書き換えが競合する
+  if (!is_dense())
+  {
+    throw std::logic_error("storage() const requires a dense tensor. use Contiguous() and data() for views");
+  }
+  return *storage_;
 }
 
-Tensor::storage_type &Tensor::storage()
+template<typename T>
+typename BasicTensor<T>::storage_type &BasicTensor<T>::storage()
 {
-  return storage_;
+  detach();
+  return *storage_;
 }
 
-Tensor Tensor::Fill(const shape_type &shape, const value_type &value)
+template<typename T>
+const typename BasicTensor<T>::value_type *BasicTensor<T>::data() const
 {
-  Tensor tensor(shape);
-#ifdef NAGATO_OPENMP
-  #pragma omp parallel for
-#endif
-  for (std::size_t i = 0; i < tensor.storage().size(); ++i)
-  {
-    tensor.storage()[i] = value;
-  }
-  return tensor;
+  return storage_->data() + offset_;
 }
 
-Tensor Tensor::Zeros(const shape_type &shape)
+template<typename T>
+typename BasicTensor<T>::value_type *BasicTensor<T>::data()
 {
-  return Fill(shape, 0);
+  detach();
+  return storage_->data();
 }
 
-Tensor Tensor::Ones(const shape_type &shape)
+template<typename T>
+std::size_t BasicTensor<T>::size() const
 {
-  return Fill(shape, 1);
+  return shape_.empty() ? storage_->size() : ElementCount(shape_);
 }
 
-Tensor Tensor::Eye(const shape_type &shape)
+template<typename T>
+std::size_t BasicTensor<T>::offset() const
 {
-  Tensor tensor(shape);
-  std::fill(tensor.storage().begin(), tensor.storage().end(), 0);
-#ifdef NAGATO_OPENMP
-  #pragma omp parallel for
-#endif
-  for (std::size_t i = 0; i < shape[0]; ++i)
-  {
-    tensor(i, i) = 1;
-  }
-  return tensor;
+  return offset_;
 }
 
-void Tensor::IsSameShape(const Tensor &a, const Tensor &b)
+template<typename T>
+bool BasicTensor<T>::IsContiguous() const
 {
-  // ２つのテンソルの形状が等しいことをチェック
-  if (a.shape() != b.shape())
-  {
-    for (std::size_t i = 0; i < a.shape().size(); ++i)
-    {
-      std::cerr << "a.shape()[i]: " << a.shape()[i] << ", b.shape()[i]: " << b.shape()[i] <<
-        std::endl;
-    }
-    throw std::invalid_argument("tensor must have the same shape");
-  }
-  else
+  // 長さ 1 の軸のストライドは要素の並びに影響しないため無視する
+  std::size_t expected = 1;
+  for (std::size_t i = shape_.size(); i > 0; --i)
   {
-    // すべての次元が等しいことをチェック
-    for (std::size_t i = 0; i < a.shape().size(); ++i)
+    if (shape_[i - 1] != 1 && strides_[i - 1] != expected)
     {
-      if (a.shape()[i] != b.shape()[i])
-      {
-        throw std::invalid_argument("tensor must have the same shape");
-      }
+      return false;
     }
+    expected *= shape_[i - 1];
   }
+  return true;
 }
 
-Tensor operator+(const Tensor &a, const Tensor &b)
-{
-  return ApplyBroadcastBinaryOp(a, b, [](const Tensor::value_type x, const Tensor::value_type y) { return x + y; });
-}
-
-Tensor operator+(const Tensor &a, const Tensor::value_type &b)
+template<typename T>
+BasicTensor<T> BasicTensor<T>::Contiguous() const
 {
-  Tensor result(a.shape());
-#ifdef NAGATO_OPENMP
-  #pragma omp parallel for
-#endif
-  for (std::size_t i = 0; i < a.storage().size(); ++i)
+  if (IsContiguous())
   {
-    result.storage()[i] = a.storage()[i] + b;
+    return *this;
   }
+
+  BasicTensor result;
+  result.shape_ = shape_;
+  result.strides_ = ContiguousStrides(shape_);
+  *result.storage_ = pack();
   return result;
 }
 
-Tensor operator+(const Tensor::value_type &a, const Tensor &b)
+template<typename T>
+typename BasicTensor<T>::storage_type BasicTensor<T>::pack() const
 {
-  Tensor result(b.shape());
-#ifdef NAGATO_OPENMP
-  #pragma omp parallel for
-#endif
-  for (std::size_t i = 0; i < b.storage().size(); ++i)
+  const std::size_t count = size();
+  if (IsContiguous())
   {
-    result.storage()[i] = a + b.storage()[i];
+    return storage_type(storage_->begin() + offset_, storage_->begin() + offset_ + count);
   }
+
+  storage_type result(count);
+  CopyStrided(shape_, storage_->data() + offset_, strides_, result.data());
   return result;
 }
 
-Tensor operator-(const Tensor &a, const Tensor &b)
+template<typename T>
+bool BasicTensor<T>::is_dense() const
 {
-  return ApplyBroadcastBinaryOp(a, b, [](const Tensor::value_type x, const Tensor::value_type y) { return x - y; });
+  return offset_ == 0 && storage_->size() == size() && IsContiguous();
 }
 
-Tensor operator-(const Tensor &a, const Tensor::value_type &b)
+template<typename T>
+void BasicTensor<T>::densify()
 {
-  Tensor result(a.shape());
-#ifdef NAGATO_OPENMP
-  #pragma omp parallel for
-#endif
-  for (std::size_t i = 0; i < a.storage().size(); ++i)
+  storage_ = MakeStorage<storage_type>(pack());
+  strides_ = ContiguousStrides(shape_);
+  offset_ = 0;
+}
+
+template<typename T>
+void BasicTensor<T>::detach()
+{
+  if (!is_dense() || storage_.use_count() > 1)
   {
-    result.storage()[i] = a.storage()[i] - b;
+    densify();
   }
-  return result;
 }
 
-Tensor operator-(const Tensor::value_type &a, const Tensor &b)
+template<typename T>
+BasicTensor<T> BasicTensor<T>::Fill(const shape_type &shape, const value_type &value)
 {
-  Tensor result(b.shape());
+  BasicTensor tensor(shape);
+  T *data = tensor.data();
+  const std::size_t size = tensor.size();
 #ifdef NAGATO_OPENMP
-  #pragma omp parallel for
+  #pragma omp parallel for if (size > 65536)
 #endif
-  for (std::size_t i = 0; i < b.storage().size(); ++i)
+  for (std::size_t i = 0; i < size; ++i)
   {
-    result.storage()[i] = a - b.storage()[i];
+    data[i] = value;
   }
-  return result;
+  return tensor;
 }
 
-Tensor operator*(const Tensor &a, const Tensor &b)
+template<typename T>
+BasicTensor<T> BasicTensor<T>::Zeros(const shape_type &shape)
 {
-  return ApplyBroadcastBinaryOp(a, b, [](const Tensor::value_type x, const Tensor::value_type y) { return x * y; });
+  return Fill(shape, 0);
 }
 
-Tensor operator*(const Tensor &a, const Tensor::value_type &b)
+template<typename T>
+BasicTensor<T> BasicTensor<T>::Ones(const shape_type &shape)
 {
-  Tensor result(a.shape());
-#ifdef NAGATO_OPENMP
-  #pragma omp parallel for
-#endif
-  for (std::size_t i = 0; i < a.storage().size(); ++i)
-  {
-    result.storage()[i] = a.storage()[i] * b;
-  }
-  return result;
+  return Fill(shape, 1);
 }
 
-Tensor operator*(const Tensor::value_type &a, const Tensor &b)
+template<typename T>
+BasicTensor<T> BasicTensor<T>::Eye(const shape_type &shape)
 {
-  Tensor result(b.shape());
+  BasicTensor tensor(shape);
+  std::fill(tensor.storage().begin(), tensor.storage().end(), 0);
 #ifdef NAGATO_OPENMP
   #pragma omp parallel for
 #endif
-  for (std::size_t i = 0; i < b.storage().size(); ++i)
+  for (std::size_t i = 0; i < shape[0]; ++i)
   {
-    result.storage()[i] = a * b.storage()[i];
+    tensor(i, i) = 1;
   }
-  return result;
-}
-
-Tensor operator/(const Tensor &a, const Tensor &b)
-{
-  return ApplyBroadcastBinaryOp(a, b, [](const Tensor::value_type x, const Tensor::value_type y) { return x / (y + 1e-7); });
+  return tensor;
 }
 
-Tensor operator/(const Tensor &a, const Tensor::value_type &b)
+template<typename T>
+void BasicTensor<T>::IsSameShape(const BasicTensor &a, const BasicTensor &b)
 {
-  Tensor result(a.shape());
-#ifdef NAGATO_OPENMP
-  #pragma omp parallel for
-#endif
-  for (std::size_t i = 0; i < a.storage().size(); ++i)
+  // ２つのテンソルの形状が等しいことをチェック
+  if (a.shape() != b.shape())
   {
-    result.storage()[i] = a.storage()[i] / (b + 1e-7);
+    for (std::size_t i = 0; i < a.shape().size(); ++i)
+    {
+      std::cerr << "a.shape()[i]: " << a.shape()[i] << ", b.shape()[i]: " << b.shape()[i] <<
+        std::endl;
+    }
+    throw std::invalid_argument("tensor must have the same shape");
+  }
+  else
+  {
+    // すべての次元が等しいことをチェック
+    for (std::size_t i = 0; i < a.shape().size(); ++i)
+    {
+      if (a.shape()[i] != b.shape()[i])
+      {
+        throw std::invalid_argument("tensor must have the same shape");
+      }
+    }
   }
-  return result;
 }
 
-Tensor operator/(const Tensor::value_type &a, const Tensor &b)
+namespace
 {
-  Tensor result(b.shape());
-#ifdef NAGATO_OPENMP
-  #pragma omp parallel for
-#endif
-  for (std::size_t i = 0; i < b.storage().size(); ++i)
+/**
+ * @brief 行列同士の積 C = A * B を計算する. A, B は任意のストライドを持つことができ, C は連続している
+ * @note 浮動小数点数は GEMM エンジンを使用し, 整数型は compute_t で累積してから変換する.
+ *       16 ビットの浮動小数点数は GEMM エンジンで float に累積してから丸める
+ */
+template<typename T>
+void MatmulKernel(std::size_t M,
+                  std::size_t N,
+                  std::size_t K,
+                  const T *A,
+                  std::size_t rs_a,
+                  std::size_t cs_a,
+                  const T *B,
+                  std::size_t rs_b,
+                  std::size_t cs_b,
+                  T *C)
+{
+  if constexpr (std::is_floating_point_v<T>)
   {
-    result.storage()[i] = a / (b.storage()[i] + 1e-7);
+    Gemm(M, N, K, A, rs_a, cs_a, B, rs_b, cs_b, C, N);
+  }
+  else if constexpr (is_reduced_precision_v<T>)
+  {
+    std::vector<float> product(M * N);
+    Gemm(M, N, K, A, rs_a, cs_a, B, rs_b, cs_b, product.data(), N);
+    VectorConvert(product.data(), C, M * N);
+  }
+  else
+  {
+    std::vector<compute_t<T>> row(N);
+    for (std::size_t i = 0; i < M; ++i)
+    {
+      std::fill(row.begin(), row.end(), compute_t<T>(0));
+      for (std::size_t k = 0; k < K; ++k)
+      {
+        const auto a = static_cast<compute_t<T>>(A[i * rs_a + k * cs_a]);
+        for (std::size_t j = 0; j < N; ++j)
+        {
+          row[j] += a * static_cast<compute_t<T>>(B[k * rs_b + j * cs_b]);
+        }
+      }
+      for (std::size_t j = 0; j < N; ++j)
+      {
+        C[i * N + j] = static_cast<T>(row[j]);
+      }
+    }
   }
-  return result;
 }
+} // namespace
 
-Tensor Tensor::Reshape(const shape_type &new_shape) const
+template<typename T>
+BasicTensor<T> BasicTensor<T>::Reshape(const shape_type &new_shape) const
 {
   // 新しく生成される、その要素数が現在の要素すると等しいかチェック
   std::size_t new_size = std::accumulate(new_shape.begin(),
@@ -274,17 +599,20 @@ Tensor Tensor::Reshape(const shape_type &new_shape) const
                                          1,
                                          std::multiplies<std::size_t>());
 
-  if (new_size != storage_.size())
+  if (new_size != size())
   {
     throw std::invalid_argument("new shape is not valid");
   }
 
-  Tensor result(new_shape);
-  std::copy(storage_.begin(), storage_.end(), result.storage().begin());
+  // 連続していない場合のみ詰め直し, それ以外はデータ領域を共有する
+  BasicTensor result = Contiguous();
+  result.shape_ = new_shape;
+  result.strides_ = ContiguousStrides(new_shape);
   return result;
 }
 
-Tensor Tensor::Dot(const Tensor &a, const Tensor &b)
+template<typename T>
+BasicTensor<T> BasicTensor<T>::Dot(const BasicTensor &a, const BasicTensor &b)
 {
   // 入力データの形状が等しいことをチェック
   if (a.shape() != b.shape())
@@ -314,30 +642,31 @@ Tensor Tensor::Dot(const Tensor &a, const Tensor &b)
   // ともに１次元のテンソルの場合
   if (a.shape().size() == 1)
   {
-    Tensor result({1});
-#ifdef NAGATO_OPENMP
-    #pragma omp parallel for
-#endif
+    BasicTensor result({1});
+    compute_t<T> sum = 0;
     for (std::size_t i = 0; i < a.shape()[0]; ++i)
     {
-      result(0) += a(i) * b(i);
+      sum += static_cast<compute_t<T>>(a(i)) * static_cast<compute_t<T>>(b(i));
     }
+    result(0) = static_cast<value_type>(sum);
     return result;
   }
 
   // ともに２次元のテンソルの場合
   if (a.shape().size() == 2)
   {
-    Tensor result({a.shape()[0]});
+    BasicTensor result({a.shape()[0]});
 #ifdef NAGATO_OPENMP
     #pragma omp parallel for
 #endif
     for (std::size_t i = 0; i < a.shape()[0]; ++i)
     {
+      compute_t<T> sum = 0;
       for (std::size_t j = 0; j < a.shape()[1]; ++j)
       {
-        result(i) += a(i, j) * b(i, j);
+        sum += static_cast<compute_t<T>>(a(i, j)) * static_cast<compute_t<T>>(b(i, j));
       }
+      result(i) = static_cast<value_type>(sum);
     }
     return result;
   }
@@ -345,7 +674,8 @@ Tensor Tensor::Dot(const Tensor &a, const Tensor &b)
   throw std::invalid_argument("input tensor must be a vector");
 }
 
-Tensor Tensor::Matmul(const Tensor &a, const Tensor &b)
+template<typename T>
+BasicTensor<T> BasicTensor<T>::Matmul(const BasicTensor &a, const BasicTensor &b)
 {
   // 行列と行列の積
   if (a.shape().size() == 2 && b.shape().size() == 2)
@@ -367,22 +697,17 @@ Tensor Tensor::Matmul(const Tensor &a, const Tensor &b)
     }
     // 出力データの形状を計算
     shape_type result_shape = {a.shape()[0], b.shape()[1]};
-    Tensor result(result_shape);
+    BasicTensor result(result_shape);
 
     // 行列積を計算する
-#ifdef NAGATO_OPENMP
-    #pragma omp parallel for
-#endif
-    for (std::size_t i = 0; i < a.shape()[0]; ++i)
-    {
-      for (std::size_t j = 0; j < b.shape()[1]; ++j)
-      {
-        for (std::size_t k = 0; k < b.shape()[0]; ++k)
-        {
-          result(i, j) += a(i, k) * b(k, j);
-        }
-      }
-    }
+    const std::size_t M = a.shape()[0];
+    const std::size_t K = a.shape()[1];
+    const std::size_t N = b.shape()[1];
+    // 転置などのビューはストライドをそのまま渡すため, コピーは発生しない
+    MatmulKernel(M, N, K,
+                 a.data(), a.strides()[0], a.strides()[1],
+                 b.data(), b.strides()[0], b.strides()[1],
+                 result.data());
     return result;
   }
 
@@ -409,24 +734,19 @@ Tensor Tensor::Matmul(const Tensor &a, const Tensor &b)
 
     // 出力データの形状を計算
     shape_type result_shape = {a.shape()[0], a.shape()[1], b.shape()[2]};
-    Tensor result(result_shape);
-
-    // 行列積を計算する
-#ifdef NAGATO_OPENMP
-    #pragma omp parallel for
-#endif
-    for (std::size_t i = 0; i < result_shape[0]; ++i) // バッチサイズ
+    BasicTensor result(result_shape);
+
+    // バッチごとに行列積を計算する
+    const std::size_t batch = result_shape[0];
+    const std::size_t M = result_shape[1];
+    const std::size_t K = a.shape()[2];
+    const std::size_t N = result_shape[2];
+    for (std::size_t i = 0; i < batch; ++i)
     {
-      for (std::size_t j = 0; j < result_shape[1]; ++j)
-      {
-        for (std::size_t k = 0; k < result_shape[2]; ++k)
-        {
-          for (std::size_t l = 0; l < b.shape()[1]; ++l)
-          {
-            result(i, j, k) += a(i, j, l) * b(i, l, k);
-          }
-        }
-      }
+      MatmulKernel(M, N, K,
+                   a.data() + i * a.strides()[0], a.strides()[1], a.strides()[2],
+                   b.data() + i * b.strides()[0], b.strides()[1], b.strides()[2],
+                   result.data() + i * M * N);
     }
     return result;
   }
@@ -434,254 +754,767 @@ Tensor Tensor::Matmul(const Tensor &a, const Tensor &b)
   throw std::invalid_argument("input tensor must be matrix");
 }
 
-Tensor Tensor::Sum(const Tensor &a)
+template<typename T>
+  requires is_reduced_precision_v<T>
+BasicTensor<float> MixedMatmul(const BasicTensor<T> &a, const BasicTensor<T> &b)
 {
-  // 結果のテンソルを作成
-  shape_type shape = a.shape();
-  std::size_t shape_size = a.shape().size();
-  shape.pop_back();
-  if (shape_size == 1)
+  const auto &as = a.shape();
+  const auto &bs = b.shape();
+  if (as.size() == 2 && bs.size() == 2)
   {
-    shape = {1};
+    if (as[1] != bs[0])
+    {
+      throw std::invalid_argument("input tensor must have the same shape");
+    }
+    BasicTensor<float> result({as[0], bs[1]});
+    Gemm(as[0], bs[1], as[1],
+         a.data(), a.strides()[0], a.strides()[1],
+         b.data(), b.strides()[0], b.strides()[1],
+         result.data(), bs[1]);
+    return result;
   }
-  Tensor result(shape);
 
-  if (shape_size == 1)
+  if (as.size() == 3 && bs.size() == 3)
   {
-    for (std::size_t i = 0; i < a.shape()[0]; ++i)
+    if (as[0] != bs[0])
     {
-      result(0) += a(i);
+      throw std::invalid_argument("batch size must be the same");
+    }
+    if (as[2] != bs[1])
+    {
+      throw std::invalid_argument("input tensor must have the same shape");
     }
+    BasicTensor<float> result({as[0], as[1], bs[2]});
+    for (std::size_t i = 0; i < as[0]; ++i)
+    {
+      Gemm(as[1], bs[2], as[2],
+           a.data() + i * a.strides()[0], a.strides()[1], a.strides()[2],
+           b.data() + i * b.strides()[0], b.strides()[1], b.strides()[2],
+           result.data() + i * as[1] * bs[2], bs[2]);
+    }
+    return result;
+  }
+
+  throw std::invalid_argument("input tensor must be matrix");
+}
+
+namespace
+{
+/**
+ * @brief 総和
+ */
+template<typename T>
+struct SumReducer
+{
+  using acc_type = compute_t<T>;
+
+  static acc_type identity()
+  {
+    return acc_type(0);
   }
-  else if (shape_size == 2)
+
+  static acc_type combine(const acc_type a, const acc_type b)
   {
-    for (std::size_t i = 0; i < a.shape()[0]; ++i)
+    return a + b;
+  }
+
+  static T finalize(const acc_type a, std::size_t)
+  {
+    return static_cast<T>(a);
+  }
+};
+
+/**
+ * @brief 平均
+ */
+template<typename T>
+struct MeanReducer : SumReducer<T>
+{
+  using acc_type = typename SumReducer<T>::acc_type;
+
+  static T finalize(const acc_type a, std::size_t count)
+  {
+    return static_cast<T>(a / static_cast<acc_type>(count));
+  }
+};
+
+/**
+ * @brief 総乗
+ */
+template<typename T>
+struct ProdReducer
+{
+  using acc_type = compute_t<T>;
+
+  static acc_type identity()
+  {
+    return acc_type(1);
+  }
+
+  static acc_type combine(const acc_type a, const acc_type b)
+  {
+    return a * b;
+  }
+
+  static T finalize(const acc_type a, std::size_t)
+  {
+    return static_cast<T>(a);
+  }
+};
+
+/**
+ * @brief 最大値
+ */
+template<typename T>
+struct MaxReducer
+{
+  using acc_type = compute_t<T>;
+
+  static acc_type identity()
+  {
+    return -std::numeric_limits<acc_type>::infinity();
+  }
+
+  static acc_type combine(const acc_type a, const acc_type b)
+  {
+    return a < b ? b : a;
+  }
+
+  static T finalize(const acc_type a, std::size_t)
+  {
+    return static_cast<T>(a);
+  }
+};
+
+/**
+ * @brief 最小値
+ */
+template<typename T>
+struct MinReducer
+{
+  using acc_type = compute_t<T>;
+
+  static acc_type identity()
+  {
+    return std::numeric_limits<acc_type>::infinity();
+  }
+
+  static acc_type combine(const acc_type a, const acc_type b)
+  {
+    return b < a ? b : a;
+  }
+
+  static T finalize(const acc_type a, std::size_t)
+  {
+    return static_cast<T>(a);
+  }
+};
+
+/**
+ * @brief 連続した要素を縮約する
+ * @note 独立した複数の累積変数に振り分けることで, 加算の依存関係を切って SIMD 命令で計算できるようにする
+ */
+template<typename Reducer, typename T>
+typename Reducer::acc_type ReduceContiguous(const T *x, std::size_t n)
+{
+  using acc_type = typename Reducer::acc_type;
+  constexpr std::size_t kLanes = 16;
+  acc_type acc[kLanes];
+  std::fill(acc, acc + kLanes, Reducer::identity());
+
+  std::size_t i = 0;
+  for (; i + kLanes <= n; i += kLanes)
+  {
+    for (std::size_t k = 0; k < kLanes; ++k)
     {
-      for (std::size_t j = 0; j < a.shape()[1]; ++j)
-      {
-        result(i) += a(i, j);
-      }
+      acc[k] = Reducer::combine(acc[k], static_cast<acc_type>(x[i + k]));
     }
   }
-  else if (shape_size == 3)
+  for (; i < n; ++i)
   {
-    for (std::size_t i = 0; i < a.shape()[0]; ++i)
+    acc[0] = Reducer::combine(acc[0], static_cast<acc_type>(x[i]));
+  }
+
+  for (std::size_t width = kLanes / 2; width > 0; width /= 2)
+  {
+    for (std::size_t k = 0; k < width; ++k)
     {
-      for (std::size_t j = 0; j < a.shape()[1]; ++j)
+      acc[k] = Reducer::combine(acc[k], acc[k + width]);
+    }
+  }
+  return acc[0];
+}
+
+/**
+ * @brief 縮約する軸を指定して形状を整理したもの
+ * @note 連続したテンソルの隣り合う軸のうち, 縮約するかどうかが同じものを 1 つにまとめる.
+ *       まとめた後の軸は縮約する軸と残す軸が交互に並び, 最後の軸のストライドは 1 になる
+ */
+struct ReductionLayout
+{
+  /// まとめた後の各軸の要素数
+  Shape sizes;
+
+  /// まとめた後の各軸のストライド
+  Shape strides;
+
+  /// まとめた後の各軸を縮約するかどうか
+  SmallVector<bool, 8> reduced;
+
+  /// 縮約する要素数 (出力 1 要素あたり)
+  std::size_t count = 1;
+
+  /// 出力の要素数
+  std::size_t outputs = 1;
+};
+
+/**
+ * @brief 縮約する軸を検証し, 出力の形状と軸をまとめた形状を求める
+ * @param shape 入力の形状
+ * @param axes 縮約する軸. 空の場合はすべての軸
+ * @param keepdims 真の場合は縮約した軸を長さ 1 として残す
+ * @param result_shape 出力の形状. 軸がすべてなくなる場合は {1}
+ * @return 軸をまとめた形状
+ */
+ReductionLayout MakeReductionLayout(const Shape &shape,
+                                    const std::vector<std::size_t> &axes,
+                                    bool keepdims,
+                                    Shape &result_shape)
+{
+  SmallVector<bool, 8> is_reduced(shape.size(), axes.empty());
+  for (const auto axis : axes)
+  {
+    if (axis >= shape.size())
+    {
+      throw std::invalid_argument("axis is out of range");
+    }
+    if (is_reduced[axis])
+    {
+      throw std::invalid_argument("duplicate axis in reduction");
+    }
+    is_reduced[axis] = true;
+  }
+
+  ReductionLayout layout;
+  result_shape.clear();
+  for (std::size_t d = 0; d < shape.size(); ++d)
+  {
+    if (is_reduced[d])
+    {
+      layout.count *= shape[d];
+      if (keepdims)
       {
-        for (std::size_t k = 0; k < a.shape()[2]; ++k)
-        {
-          result(i, j) += a(i, j, k);
-        }
+        result_shape.push_back(1);
       }
     }
+    else
+    {
+      layout.outputs *= shape[d];
+      result_shape.push_back(shape[d]);
+    }
+
+    // 長さ 1 の軸はどちらにも影響しないため除く
+    if (shape[d] == 1)
+    {
+      continue;
+    }
+    if (!layout.sizes.empty() && layout.reduced.back() == is_reduced[d])
+    {
+      layout.sizes.back() *= shape[d];
+    }
+    else
+    {
+      layout.sizes.push_back(shape[d]);
+      layout.reduced.push_back(is_reduced[d]);
+    }
   }
-  else
+  if (result_shape.empty())
   {
-    throw std::invalid_argument("tensor must be less than 4 dimensional");
+    result_shape.push_back(1);
+  }
+  if (layout.sizes.empty())
+  {
+    layout.sizes.push_back(1);
+    layout.reduced.push_back(true);
   }
 
-  return result;
+  layout.strides.assign(layout.sizes.size(), 1);
+  for (std::size_t d = layout.sizes.size() - 1; d > 0; --d)
+  {
+    layout.strides[d - 1] = layout.strides[d] * layout.sizes[d];
+  }
+  return layout;
 }
 
-Tensor Tensor::Sum(const Tensor &a, const std::size_t &axis)
+/**
+ * @brief 線形のインデックスを, 指定した種類 (縮約する軸か残す軸か) の軸に沿ったオフセットに変換する
+ * @param layout 軸をまとめた形状
+ * @param reduced 縮約する軸を対象にする場合は真
+ * @param end 対象にする軸の終端 (この軸より前の軸だけを使う)
+ * @param index 線形のインデックス
+ * @return 入力の先頭からのオフセット
+ */
+std::size_t ReductionOffset(const ReductionLayout &layout, bool reduced, std::size_t end, std::size_t index)
 {
-  // 4次元以上のテンソルはサポートしない
-  if (a.shape().size() >= 4)
+  std::size_t offset = 0;
+  for (std::size_t d = end; d-- > 0;)
   {
-    throw std::invalid_argument("4次元以上のテンソルはSumでサポートされていません");
+    if (layout.reduced[d] != reduced)
+    {
+      continue;
+    }
+    offset += (index % layout.sizes[d]) * layout.strides[d];
+    index /= layout.sizes[d];
   }
+  return offset;
+}
 
-  // 指定した軸が範囲内にあることを確認する
-  if (axis >= a.shape().size())
+/**
+ * @brief 連続したデータを指定した軸について縮約する
+ * @note 最後の軸を縮約する場合は, 出力の要素ごとに連続した区間を複数の累積変数で縮約する.
+ *       最後の軸を残す場合は, 出力の行を累積変数の配列とし, 縮約する軸に沿って入力の行を要素ごとに畳み込む.
+ *       どちらもメモリを連続した順に読む. NAGATO_OPENMP が有効な場合は出力 (またはすべての軸を
+ *       縮約する場合は入力の区間) ごとに並列に計算する
+ * @param src 入力. 行優先で連続している
+ * @param layout 軸をまとめた形状
+ * @param dst 出力
+ */
+template<typename Reducer, typename T>
+void Reduce(const T *src, const ReductionLayout &layout, T *dst)
+{
+  using acc_type = typename Reducer::acc_type;
+  const std::size_t rank = layout.sizes.size();
+  const std::size_t inner = layout.sizes[rank - 1];
+#ifdef NAGATO_OPENMP
+  const std::size_t total = layout.count * layout.outputs;
+#endif
+
+  if (layout.reduced[rank - 1])
   {
-    throw std::invalid_argument("axis is out of range");
+    const std::size_t segments = layout.count / inner;
+
+    // すべての軸を縮約する場合は入力を区間に分けて並列に縮約し, 最後に結果をまとめる
+    if (rank == 1)
+    {
+      constexpr std::size_t kChunk = 65536;
+      const std::size_t chunks = (inner + kChunk - 1) / kChunk;
+      std::vector<acc_type> partial(chunks);
+#ifdef NAGATO_OPENMP
+      #pragma omp parallel for if (chunks > 1)
+#endif
+      for (std::size_t c = 0; c < chunks; ++c)
+      {
+        const std::size_t begin = c * kChunk;
+        partial[c] = ReduceContiguous<Reducer>(src + begin, std::min(kChunk, inner - begin));
+      }
+      acc_type acc = Reducer::identity();
+      for (const auto value : partial)
+      {
+        acc = Reducer::combine(acc, value);
+      }
+      dst[0] = Reducer::finalize(acc, layout.count);
+      return;
+    }
+
+#ifdef NAGATO_OPENMP
+    #pragma omp parallel for if (total > 65536)
+#endif
+    for (std::size_t o = 0; o < layout.outputs; ++o)
+    {
+      const std::size_t base = ReductionOffset(layout, false, rank, o);
+      acc_type acc = Reducer::identity();
+      for (std::size_t s = 0; s < segments; ++s)
+      {
+        const T *segment = src + base + ReductionOffset(layout, true, rank - 1, s);
+        acc = Reducer::combine(acc, ReduceContiguous<Reducer>(segment, inner));
+      }
+      dst[o] = Reducer::finalize(acc, layout.count);
+    }
+    return;
   }
 
-  const auto &a_shape = a.shape();
-  // 指定した軸を除いた新しいshapeを作成する
-  std::vector<std::size_t> new_shape;
-  for (std::size_t i = 0; i < a_shape.size(); ++i)
+  // 最後の軸を残す場合. 出力の行を列方向のブロックに分けて並列化する
+  constexpr std::size_t kBlock = 1024;
+  const std::size_t rows = layout.outputs / inner;
+  const std::size_t column_blocks = (inner + kBlock - 1) / kBlock;
+#ifdef NAGATO_OPENMP
+  #pragma omp parallel for if (total > 65536)
+#endif
+  for (std::size_t block = 0; block < rows * column_blocks; ++block)
   {
-    if (i == axis)
+    const std::size_t row = block / column_blocks;
+    const std::size_t column_begin = (block % column_blocks) * kBlock;
+    const std::size_t width = std::min(kBlock, inner - column_begin);
+    const std::size_t base = ReductionOffset(layout, false, rank - 1, row) + column_begin;
+
+    acc_type acc[kBlock];
+    std::fill(acc, acc + width, Reducer::identity());
+    for (std::size_t r = 0; r < layout.count; ++r)
     {
-      continue;
+      const T *x = src + base + ReductionOffset(layout, true, rank, r);
+      for (std::size_t j = 0; j < width; ++j)
+      {
+        acc[j] = Reducer::combine(acc[j], static_cast<acc_type>(x[j]));
+      }
+    }
+
+    T *out = dst + row * inner + column_begin;
+    for (std::size_t j = 0; j < width; ++j)
+    {
+      out[j] = Reducer::finalize(acc[j], layout.count);
     }
-    new_shape.push_back(a_shape[i]);
   }
-  // new_shapeが空の場合はスカラーとみなし、shapeを{1}とする
-  if (new_shape.empty())
+}
+
+/**
+ * @brief 縮約を行ってテンソルを作成する
+ */
+template<typename Reducer, typename T>
+BasicTensor<T> ReduceTensor(const BasicTensor<T> &a, const std::vector<std::size_t> &axes, bool keepdims)
+{
+  Shape result_shape;
+  const ReductionLayout layout = MakeReductionLayout(a.shape(), axes, keepdims, result_shape);
+  if (layout.count == 0 && !std::is_same_v<Reducer, SumReducer<T>> && !std::is_same_v<Reducer, ProdReducer<T>>)
   {
-    new_shape.push_back(1);
+    throw std::invalid_argument("zero-size reduction has no identity");
   }
 
-  // 結果のテンソルをゼロ初期化で作成する
-  Tensor result = Tensor::Zeros(new_shape);
+  BasicTensor<T> result(result_shape);
+  const BasicTensor<T> source = a.Contiguous();
+  Reduce<Reducer>(source.data(), layout, result.data());
+  return result;
+}
 
-  // 軸に沿って総和を求めるため、前後のブロックサイズを計算する
-  std::size_t pre = 1;
-  for (std::size_t i = 0; i < axis; ++i)
+/**
+ * @brief 1 つの軸に沿って最大値 (または最小値) のインデックスを求める
+ * @param a テンソル
+ * @param axis 軸
+ * @param keepdims 真の場合は縮約した軸を長さ 1 として残す
+ * @param greater 最大値を求める場合は真
+ * @return インデックス. 同じ値が複数ある場合は最初のインデックス
+ */
+template<typename T>
+BasicTensor<index_type> ArgReduce(const BasicTensor<T> &a, std::size_t axis, bool keepdims, bool greater)
+{
+  const auto &shape = a.shape();
+  Shape result_shape;
+  const ReductionLayout layout = MakeReductionLayout(shape, {axis}, keepdims, result_shape);
+  const std::size_t length = layout.count;
+  if (length == 0)
+  {
+    throw std::invalid_argument("zero-size reduction has no identity");
+  }
+  if (length - 1 > static_cast<std::size_t>(std::numeric_limits<index_type>::max()))
   {
-    pre *= a_shape[i];
+    throw std::invalid_argument("axis is too long for the index type");
   }
-  std::size_t d = a_shape[axis];
+
   std::size_t post = 1;
-  for (std::size_t i = axis + 1; i < a_shape.size(); ++i)
+  for (std::size_t d = axis + 1; d < shape.size(); ++d)
   {
-    post *= a_shape[i];
+    post *= shape[d];
   }
+  const std::size_t pre = layout.outputs / post;
 
-  // テンソル内部はrow-majorと仮定し、
-  // 元のテンソルを(pre, d, post)とみなしてd方向に沿って総和を計算する
+  BasicTensor<index_type> result(result_shape);
+  const BasicTensor<T> source = a.Contiguous();
+  const T *src = source.data();
+  index_type *dst = result.data();
+  const auto better = [greater](const T x, const T best)
+  {
+    return greater ? best < x : x < best;
+  };
+
+  if (post == 1)
+  {
+    // 軸が最後の場合は行ごとに SIMD で最大値 (最小値) を求めてから, その値の最初の位置を探す
 #ifdef NAGATO_OPENMP
-    #pragma omp parallel for
+    #pragma omp parallel for if (pre * length > 65536)
+#endif
+    for (std::size_t i = 0; i < pre; ++i)
+    {
+      const T *row = src + i * length;
+      const auto target = greater ? ReduceContiguous<MaxReducer<T>>(row, length)
+                                  : ReduceContiguous<MinReducer<T>>(row, length);
+      std::size_t best = 0;
+      while (best + 1 < length && static_cast<compute_t<T>>(row[best]) != target)
+      {
+        ++best;
+      }
+      dst[i] = static_cast<index_type>(best);
+    }
+    return result;
+  }
+
+  // 軸が途中の場合は残す軸の行を単位に, 最良の値とインデックスを要素ごとに更新する
+#ifdef NAGATO_OPENMP
+  #pragma omp parallel for if (pre * length * post > 65536)
 #endif
   for (std::size_t i = 0; i < pre; ++i)
   {
-    for (std::size_t j = 0; j < post; ++j)
+    const T *block = src + i * length * post;
+    std::vector<T> best(block, block + post);
+    std::vector<std::size_t> index(post, 0);
+    for (std::size_t k = 1; k < length; ++k)
     {
-      Tensor::value_type sum = 0;
-      for (std::size_t k = 0; k < d; ++k)
+      const T *row = block + k * post;
+      for (std::size_t j = 0; j < post; ++j)
       {
-        std::size_t index = i * (d * post) + k * post + j;
-        sum += a.storage()[index];
+        if (better(row[j], best[j]))
+        {
+          best[j] = row[j];
+          index[j] = k;
+        }
       }
-      std::size_t result_index = i * post + j;
-      result.storage()[result_index] = sum;
+    }
+    for (std::size_t j = 0; j < post; ++j)
+    {
+      dst[i * post + j] = static_cast<index_type>(index[j]);
     }
   }
-
   return result;
 }
+} // namespace
 
-Tensor Tensor::Sigmoid(const Tensor &a)
+template<typename T>
+BasicTensor<T> BasicTensor<T>::Sum(const BasicTensor &a)
 {
-  Tensor result(a.shape());
-#ifdef NAGATO_OPENMP
-  #pragma omp parallel for
-#endif
-  for (std::size_t i = 0; i < result.storage().size(); ++i)
+  return ReduceTensor<SumReducer<T>>(a, {a.shape().size() - 1}, false);
+}
+
+template<typename T>
+BasicTensor<T> BasicTensor<T>::Sum(const BasicTensor &a, const std::vector<std::size_t> &axes, bool keepdims)
+{
+  return ReduceTensor<SumReducer<T>>(a, axes, keepdims);
+}
+
+template<typename T>
+BasicTensor<T> BasicTensor<T>::Mean(const BasicTensor &a, const std::vector<std::size_t> &axes, bool keepdims)
+{
+  return ReduceTensor<MeanReducer<T>>(a, axes, keepdims);
+}
+
+template<typename T>
+BasicTensor<T> BasicTensor<T>::Max(const BasicTensor &a, const std::vector<std::size_t> &axes, bool keepdims)
+{
+  return ReduceTensor<MaxReducer<T>>(a, axes, keepdims);
+}
+
+template<typename T>
+BasicTensor<T> BasicTensor<T>::Min(const BasicTensor &a, const std::vector<std::size_t> &axes, bool keepdims)
+{
+  return ReduceTensor<MinReducer<T>>(a, axes, keepdims);
+}
+
+template<typename T>
+BasicTensor<T> BasicTensor<T>::Prod(const BasicTensor &a, const std::vector<std::size_t> &axes, bool keepdims)
+{
+  return ReduceTensor<ProdReducer<T>>(a, axes, keepdims);
+}
+
+template<typename T>
+BasicTensor<variance_type<T>> BasicTensor<T>::Var(const BasicTensor &a,
+                                                  const std::vector<std::size_t> &axes,
+                                                  bool keepdims,
+                                                  std::size_t ddof)
+{
+  if constexpr (!std::is_same_v<variance_type<T>, T>)
   {
-    result.storage()[i] = 1.f / (1 + std::exp(-a.storage()[i]) + 1e-7);
+    // 整数のまま平均と係数を計算すると切り捨てられるため, 浮動小数点数に変換してから求める
+    return BasicTensor<variance_type<T>>::Var(a.template AsType<variance_type<T>>(), axes, keepdims, ddof);
+  }
+  else
+  {
+    Shape result_shape;
+    const std::size_t count = MakeReductionLayout(a.shape(), axes, keepdims, result_shape).count;
+    if (count <= ddof)
+    {
+      throw std::invalid_argument("degrees of freedom must be less than the number of elements");
+    }
+
+    // 平均を引いてから二乗和を求める (2 パスで計算し, 桁落ちを抑える)
+    BasicTensor centered = a - Mean(a, axes, true);
+    centered *= centered;
+    BasicTensor result = ReduceTensor<SumReducer<T>>(centered, axes, keepdims);
+    result *= static_cast<compute_t<T>>(1) / static_cast<compute_t<T>>(count - ddof);
+    return result;
   }
-  return result;
 }
 
-Tensor Tensor::ReLU(const Tensor &a)
+template<typename T>
+BasicTensor<index_type> BasicTensor<T>::Argmax(const BasicTensor &a, std::size_t axis, bool keepdims)
 {
-  Tensor result(a.shape());
+  return ArgReduce(a, axis, keepdims, true);
+}
+
+template<typename T>
+BasicTensor<index_type> BasicTensor<T>::Argmin(const BasicTensor &a, std::size_t axis, bool keepdims)
+{
+  return ArgReduce(a, axis, keepdims, false);
+}
+
+namespace
+{
+/**
+ * @brief 連続した配列の要素ごとに指数関数を計算する. 浮動小数点数はベクトル化したカーネルで計算する
+ */
+template<typename T>
+void ExpArray(const T *x, T *y, std::size_t n)
+{
+  if constexpr (std::is_floating_point_v<T>)
+  {
+    VectorExp(x, y, n);
+  }
+  else
+  {
 #ifdef NAGATO_OPENMP
-  #pragma omp parallel for
+    #pragma omp parallel for if (n > 65536)
 #endif
-  for (std::size_t i = 0; i < a.shape()[0]; ++i)
-  {
-    result(i) = std::max(static_cast<value_type>(0.f), a(i));
+    for (std::size_t i = 0; i < n; ++i)
+    {
+      y[i] = static_cast<T>(std::exp(static_cast<compute_t<T>>(x[i])));
+    }
   }
-  return result;
 }
 
-Tensor Tensor::Exp(const Tensor &a)
+/**
+ * @brief 連続した配列の要素ごとにシグモイド関数を計算する. 浮動小数点数はベクトル化したカーネルで計算する
+ */
+template<typename T>
+void SigmoidArray(const T *x, T *y, std::size_t n)
 {
-  Tensor result(a.shape());
+  if constexpr (std::is_floating_point_v<T>)
+  {
+    VectorSigmoid(x, y, n);
+  }
+  else
+  {
 #ifdef NAGATO_OPENMP
-  #pragma omp parallel for
+    #pragma omp parallel for if (n > 65536)
 #endif
-  for (std::size_t i = 0; i < a.storage().size(); ++i)
+    for (std::size_t i = 0; i < n; ++i)
+    {
+      const auto v = static_cast<compute_t<T>>(x[i]);
+      y[i] = static_cast<T>(1 / (1 + std::exp(-v)));
+    }
+  }
+}
+
+/**
+ * @brief 連続した 1 行の Softmax を計算する
+ * @note 最大値を引いてから exp を計算し, 合計の逆数を掛ける. x と y は同じでもよい
+ */
+template<typename T>
+void SoftmaxRow(const T *x, T *y, std::size_t n)
+{
+  if constexpr (std::is_floating_point_v<T>)
   {
-    result.storage()[i] = std::exp(a.storage()[i]);
+    const T inverse = static_cast<T>(1) / VectorExpSum(x, VectorMax(x, n), y, n);
+    for (std::size_t j = 0; j < n; ++j)
+    {
+      y[j] *= inverse;
+    }
   }
+  else
+  {
+    const auto max = static_cast<compute_t<T>>(ReduceContiguous<MaxReducer<T>>(x, n));
+    compute_t<T> sum = 0;
+    for (std::size_t j = 0; j < n; ++j)
+    {
+      sum += std::exp(static_cast<compute_t<T>>(x[j]) - max);
+    }
+    for (std::size_t j = 0; j < n; ++j)
+    {
+      y[j] = static_cast<T>(std::exp(static_cast<compute_t<T>>(x[j]) - max) / sum);
+    }
+  }
+}
+} // namespace
+
+template<typename T>
+BasicTensor<T> BasicTensor<T>::Sigmoid(const BasicTensor &a)
+{
+  const BasicTensor source = a.Contiguous();
+  BasicTensor result(a.shape());
+  SigmoidArray(source.data(), result.data(), result.size());
   return result;
 }
 
-Tensor Tensor::Log(const Tensor &a)
+template<typename T>
+BasicTensor<T> BasicTensor<T>::ReLU(const BasicTensor &a)
 {
-  Tensor result(a.shape());
+  const BasicTensor source = a.Contiguous();
+  const value_type *x = source.data();
+  BasicTensor result(a.shape());
+  value_type *y = result.data();
+  const std::size_t n = result.size();
 #ifdef NAGATO_OPENMP
   #pragma omp parallel for
 #endif
-  for (std::size_t i = 0; i < a.storage().size(); ++i)
+  for (std::size_t i = 0; i < n; ++i)
   {
-    result.storage()[i] = std::log(a.storage()[i] + 1e-7);
+    y[i] = x[i] > value_type(0) ? x[i] : value_type(0);
   }
   return result;
 }
 
-Tensor Tensor::Softmax(const Tensor &a)
+template<typename T>
+BasicTensor<T> &BasicTensor<T>::Sigmoid_()
 {
-  const std::size_t shape_size = a.shape().size();
+  value_type *x = data();
+  SigmoidArray(x, x, size());
+  return *this;
+}
 
-  // 入力が 3 次元かつ第2次元が1の場合に対応する
-  if (shape_size == 3) {
-    if (a.shape()[1] != 1) {
-      throw std::invalid_argument("3次元のテンソルは、第2次元が1である必要があります");
-    }
-    // (N, 1, D) -> (N, D) に変換してソフトマックス計算
-    shape_type new_shape = { a.shape()[0], a.shape()[2] };
-    Tensor a_reshaped = a.Reshape(new_shape);
-    Tensor softmax_2d = Softmax(a_reshaped);
-    // 結果を (N, 1, D) に戻す
-    shape_type final_shape = { a.shape()[0], 1, a.shape()[2] };
-    return softmax_2d.Reshape(final_shape);
+template<typename T>
+BasicTensor<T> &BasicTensor<T>::ReLU_()
+{
+  value_type *x = data();
+  const std::size_t n = size();
+#ifdef NAGATO_OPENMP
+  #pragma omp parallel for if (n > 65536)
+#endif
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    x[i] = x[i] > value_type(0) ? x[i] : value_type(0);
   }
+  return *this;
+}
+
+template<typename T>
+BasicTensor<T> &BasicTensor<T>::Exp_()
+{
+  value_type *x = data();
+  ExpArray(x, x, size());
+  return *this;
+}
 
-  if (shape_size == 1)
+template<typename T>
+BasicTensor<T> BasicTensor<T>::Softmax(const BasicTensor &a)
+{
+  if (a.shape().empty())
   {
-    // 1次元の場合、入力全体の最大値を引いてから exp を計算
-    Tensor::value_type max_val = *std::max_element(a.storage().begin(), a.storage().end());
-    Tensor shifted(a.shape());
-    for (std::size_t i = 0; i < a.storage().size(); ++i)
-    {
-      shifted.storage()[i] = a.storage()[i] - max_val;
-    }
-    Tensor exp_a = Exp(shifted);
-    Tensor::value_type sum = std::accumulate(exp_a.storage().begin(), exp_a.storage().end(), 0.0f);
-    Tensor result(a.shape());
-    for (std::size_t i = 0; i < result.storage().size(); ++i)
-    {
-      result.storage()[i] = exp_a.storage()[i] / sum;
-    }
-    return result;
+    throw std::invalid_argument("Softmax requires at least one dimension");
   }
 
-  if (shape_size == 2)
-  {
-    const auto &a_shape = a.shape();
-    Tensor result(a_shape);
+  const BasicTensor source = a.Contiguous();
+  BasicTensor result(a.shape());
+  const std::size_t cols = a.shape().back();
+  const std::size_t rows = cols == 0 ? 0 : result.size() / cols;
+  const value_type *x = source.data();
+  value_type *y = result.data();
 #ifdef NAGATO_OPENMP
-    #pragma omp parallel for
+  #pragma omp parallel for if (rows * cols > 65536)
 #endif
-    for (std::size_t i = 0; i < a_shape[0]; ++i)
-    {
-      // 各行の最大値を計算
-      Tensor::value_type row_max = a(i, 0);
-      for (std::size_t j = 1; j < a_shape[1]; ++j)
-      {
-        if (a(i, j) > row_max)
-        {
-          row_max = a(i, j);
-        }
-      }
-      // 最大値を引いて exp を計算
-      Tensor::value_type row_sum = 0;
-      for (std::size_t j = 0; j < a_shape[1]; ++j)
-      {
-        Tensor::value_type shifted = a(i, j) - row_max;
-        Tensor::value_type exp_val = std::exp(shifted);
-        result(i, j) = exp_val;
-        row_sum += exp_val;
-      }
-      for (std::size_t j = 0; j < a_shape[1]; ++j)
-      {
-        result(i, j) /= row_sum;
-      }
-    }
-    return result;
+  for (std::size_t i = 0; i < rows; ++i)
+  {
+    SoftmaxRow(x + i * cols, y + i * cols, cols);
   }
-
-  throw std::invalid_argument("テンソルは 3 次元以上には対応していません");
+  return result;
 }
 
-void Tensor::Print(const Tensor &a)
+template<typename T>
+void BasicTensor<T>::Print(const BasicTensor &a)
 {
   if (a.shape().size() == 1)
   {
@@ -724,7 +1557,8 @@ void Tensor::Print(const Tensor &a)
   std::cout << std::endl;
 }
 
-void Tensor::PrintShape(const Tensor &a)
+template<typename T>
+void BasicTensor<T>::PrintShape(const BasicTensor &a)
 {
   for (unsigned long i : a.shape())
   {
@@ -733,55 +1567,60 @@ void Tensor::PrintShape(const Tensor &a)
   std::cout << std::endl;
 }
 
-Tensor Tensor::Random(const shape_type &shape)
+template<typename T>
+BasicTensor<T> BasicTensor<T>::Random(const shape_type &shape)
 {
-  Tensor result(shape);
-  std::random_device rd;
-  std::mt19937 gen(rd());
-  std::uniform_real_distribution<value_type> dis(-1.0, 1.0);
-  for (std::size_t i = 0; i < result.storage().size(); ++i)
+  return Random(shape, RandomSeed());
+}
+
+template<typename T>
+BasicTensor<T> BasicTensor<T>::Random(const shape_type &shape, std::uint64_t seed)
+{
+  using C = compute_t<T>;
+  if constexpr (!std::is_same_v<T, C>)
   {
-    result.storage()[i] = dis(gen);
+    return BasicTensor<C>::Random(shape, seed).template AsType<T>();
+  }
+  else
+  {
+    BasicTensor result(shape);
+    VectorRandomUniform(seed, C(-1), C(1), result.data(), result.size());
+    return result;
   }
-  return result;
 }
 
-Tensor Tensor::RandomNormal(const shape_type &shape)
+template<typename T>
+BasicTensor<T> BasicTensor<T>::RandomNormal(const shape_type &shape)
 {
-  Tensor result(shape);
-  std::random_device rd;
-  std::mt19937 gen(rd());
-  std::normal_distribution<value_type> dis(0.0, 1.0);
-  std::transform(
-    result.storage().begin(),
-    result.storage().end(),
-    result.storage().begin(),
-    [&dis, &gen](const value_type &x) { return dis(gen); }
-  );
-  return result;
+  return RandomNormal(shape, RandomSeed());
 }
 
-Tensor Tensor::operator-() const
+template<typename T>
+BasicTensor<T> BasicTensor<T>::RandomNormal(const shape_type &shape, std::uint64_t seed)
 {
-  Tensor result(shape_);
-#ifdef NAGATO_OPENMP
-  #pragma omp parallel for
-#endif
-  for (std::size_t i = 0; i < storage_.size(); ++i)
+  using C = compute_t<T>;
+  if constexpr (!std::is_same_v<T, C>)
   {
-    result.storage()[i] = -storage_[i];
+    return BasicTensor<C>::RandomNormal(shape, seed).template AsType<T>();
+  }
+  else
+  {
+    BasicTensor result(shape);
+    VectorRandomNormal(seed, C(0), C(1), result.data(), result.size());
+    return result;
   }
-  return result;
 }
 
-Tensor Tensor::FromArray(const std::initializer_list<value_type> &array)
+template<typename T>
+BasicTensor<T> BasicTensor<T>::FromArray(const std::initializer_list<value_type> &array)
 {
-  Tensor result({array.size()});
+  BasicTensor result({array.size()});
   std::copy(array.begin(), array.end(), result.storage().begin());
   return result;
 }
 
-Tensor Tensor::FromArray(const std::initializer_list<std::initializer_list<value_type>> &array)
+template<typename T>
+BasicTensor<T> BasicTensor<T>::FromArray(const std::initializer_list<std::initializer_list<value_type>> &array)
 {
     if (array.size() == 0) {
         throw std::invalid_argument("array must not be empty");
@@ -790,7 +1629,7 @@ Tensor Tensor::FromArray(const std::initializer_list<std::initializer_list<value
     // 最初の行から列数を取得
     const std::size_t num_rows = array.size();
     const std::size_t num_cols = array.begin()->size();
-    Tensor result({num_rows, num_cols});
+    BasicTensor result({num_rows, num_cols});
 
     // 各行のサイズが同じであることをチェックする
     for (const auto &row : array) {
@@ -809,7 +1648,8 @@ Tensor Tensor::FromArray(const std::initializer_list<std::initializer_list<value
     return result;
 }
 
-Tensor Tensor::FromArray(const std::initializer_list<std::initializer_list<std::initializer_list<value_type>>> &array)
+template<typename T>
+BasicTensor<T> BasicTensor<T>::FromArray(const std::initializer_list<std::initializer_list<std::initializer_list<value_type>>> &array)
 {
     // 3次元テンソルの場合、まず各次元のサイズを取得する
     if (array.size() == 0) {
@@ -827,7 +1667,7 @@ Tensor Tensor::FromArray(const std::initializer_list<std::initializer_list<std::
         throw std::invalid_argument("Empty subsubarray passed to FromArray");
     }
 
-    Tensor result({dim0, dim1, dim2});
+    BasicTensor result({dim0, dim1, dim2});
 
     // 各平面（plane）の行サイズ・各行の列数がすべて一様であることをチェック
     for (const auto &plane : array)
@@ -859,7 +1699,8 @@ Tensor Tensor::FromArray(const std::initializer_list<std::initializer_list<std::
     return result;
 }
 
-Tensor Tensor::FromArray(const std::initializer_list<std::initializer_list<std::initializer_list<std::initializer_list<value_type>>>> &array)
+template<typename T>
+BasicTensor<T> BasicTensor<T>::FromArray(const std::initializer_list<std::initializer_list<std::initializer_list<std::initializer_list<value_type>>>> &array)
 {
     // 4次元テンソルの場合、各次元のサイズをイテレータから取得する
     if (array.size() == 0) {
@@ -904,7 +1745,7 @@ Tensor Tensor::FromArray(const std::initializer_list<std::initializer_list<std::
 
     // テンソルの形状を決定し、ストレージを確保する
     shape_type shape = {dim0, dim1, dim2, dim3};
-    Tensor result(shape);
+    BasicTensor result(shape);
     std::size_t total = dim0 * dim1 * dim2 * dim3;
     result.storage().resize(total);
 
@@ -926,20 +1767,26 @@ Tensor Tensor::FromArray(const std::initializer_list<std::initializer_list<std::
     return result;
 }
 
-Tensor Tensor::Transform(const Tensor &a, const std::function<value_type(value_type)> &func)
+template<typename T>
+BasicTensor<T> BasicTensor<T>::Transform(const BasicTensor &a, const std::function<value_type(value_type)> &func)
 {
-  Tensor result(a.shape());
+  const BasicTensor source = a.Contiguous();
+  const value_type *x = source.data();
+  BasicTensor result(a.shape());
+  value_type *y = result.data();
+  const std::size_t n = result.size();
 #ifdef NAGATO_OPENMP
   #pragma omp parallel for
 #endif
-  for (std::size_t i = 0; i < a.storage().size(); ++i)
+  for (std::size_t i = 0; i < n; ++i)
   {
-    result.storage()[i] = func(a.storage()[i]);
+    y[i] = func(x[i]);
   }
   return result;
 }
 
-Tensor Tensor::Transpose(const Tensor &a)
+template<typename T>
+BasicTensor<T> BasicTensor<T>::Transpose(const BasicTensor &a)
 {
   // 2, 3 以外の軸数に時は転置しない
   if (a.shape().size() != 2 && a.shape().size() != 3)
@@ -947,288 +1794,445 @@ Tensor Tensor::Transpose(const Tensor &a)
     throw std::invalid_argument("tensor must be 2 or 3 dimensional");
   }
 
-  if (a.shape().size() == 2)
+  // 最後の 2 軸の形状とストライドを入れ替えたビューを作成する
+  const std::size_t n = a.shape().size();
+  BasicTensor result = a;
+  std::swap(result.shape_[n - 2], result.shape_[n - 1]);
+  std::swap(result.strides_[n - 2], result.strides_[n - 1]);
+  return result;
+}
+
+template<typename T>
+BasicTensor<T> BasicTensor<T>::Slice(const std::size_t &axis) const
+{
+  // 指定した軸が範囲内にあることを確認する
+  if (axis < 0 || shape_[0] <= axis)
   {
-    // 転置後の形状を計算
-    shape_type shape = {a.shape()[1], a.shape()[0]};
+    throw std::invalid_argument("axis is out of range");
+  }
 
-    // 転置後のテンソルを作成
-    Tensor result(shape);
+  // 先頭の軸を取り除いたビューを作成する
+  BasicTensor result = *this;
+  result.shape_.erase(result.shape_.begin());
+  result.strides_.erase(result.strides_.begin());
+  result.offset_ += axis * strides_[0];
 
-#ifdef NAGATO_OPENMP
-    #pragma omp parallel for
-#endif
-    for (std::size_t i = 0; i < a.shape()[0]; ++i)
-    {
-      for (std::size_t j = 0; j < a.shape()[1]; ++j)
-      {
-        result(j, i) = a(i, j);
-      }
-    }
-
-    return result;
-  }
-  else if (a.shape().size() == 3)
+  // 1次元のテンソルから取り出した場合は要素数 1 のテンソルとする
+  if (result.shape_.empty())
   {
-    // 転置後の形状を計算
-    shape_type shape = {a.shape()[0], a.shape()[2], a.shape()[1]};
+    result.shape_ = {1};
+    result.strides_ = {1};
+  }
 
-    // 転置後のテンソルを作成
-    Tensor result(shape);
+  return result;
+}
 
-#ifdef NAGATO_OPENMP
-    #pragma omp parallel for
-#endif
-    for (std::size_t i = 0; i < a.shape()[0]; ++i)
-    {
-      for (std::size_t j = 0; j < a.shape()[1]; ++j)
-      {
-        for (std::size_t k = 0; k < a.shape()[2]; ++k)
-        {
-          result(i, k, j) = a(i, j, k);
-        }
-      }
-    }
+template<typename T>
+BasicTensor<T> BasicTensor<T>::Slice(const std::size_t &start, const std::size_t &end) const
+{
+  // 指定した範囲が範囲内にあることを確認する
+  if (start < 0 || end >= shape_[0])
+  {
+    throw std::invalid_argument("start and end must be within the range of the tensor");
+  }
 
-    return result;
+  // end が start より大きいことを確認する
+  if (end <= start)
+  {
+    throw std::invalid_argument("end must be greater than start");
   }
 
-  throw std::invalid_argument("tensor must be 2 or 3 dimensional");
+  // 先頭の軸の範囲を絞ったビューを作成する
+  BasicTensor result = *this;
+  result.shape_[0] = end - start + 1;
+  result.offset_ += start * strides_[0];
+
+  return result;
 }
 
-Tensor Tensor::Slice(const std::size_t &axis) const
+template<typename T>
+BasicTensor<index_type> BasicTensor<T>::Argmax() const
 {
-  // 指定した軸が範囲内にあることを確認する
-  if (axis < 0 || shape_[0] <= axis)
+  return Argmax(*this, shape_.size() - 1, false);
+}
+
+template<typename T>
+bool BasicTensor<T>::Equal(const BasicTensor &a, const BasicTensor &b)
+{
+  if (a.shape() != b.shape())
   {
-    throw std::invalid_argument("axis is out of range");
+    return false;
   }
 
-  // 分割したテンソルのshape を計算する
-  shape_type shape(shape_.begin() + 1, shape_.end());
+  const BasicTensor x = a.Contiguous();
+  const BasicTensor y = b.Contiguous();
+  return std::equal(x.data(), x.data() + x.size(), y.data());
+}
 
-  // 分割したテンソルを作成する
-  Tensor result(shape);
+template<typename T>
+BasicTensor<Bool> operator==(const BasicTensor<T> &a, const BasicTensor<T> &b)
+{
+  // 入力形状が同じであることを確認する
+  if (a.shape() != b.shape())
+  {
+    throw std::invalid_argument("tensor shapes must be the same");
+  }
 
-  // 分割したテンソルを作成する
-  const std::size_t start_index = axis * strides_[0];
-  const std::size_t end_index = start_index + strides_[0];
+  BasicTensor<Bool> result(a.shape());
+  const BasicTensor<T> x = a.Contiguous();
+  const BasicTensor<T> y = b.Contiguous();
+  const T *a_data = x.data();
+  const T *b_data = y.data();
+  Bool *result_data = result.data();
+  const std::size_t n = result.size();
+#ifdef NAGATO_OPENMP
+  #pragma omp parallel for
+#endif
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    result_data[i] = a_data[i] == b_data[i];
+  }
+  return result;
+}
 
-  std::copy(
-    storage_.begin() + start_index,
-    storage_.begin() + end_index,
-    result.storage().begin()
-  );
+namespace
+{
+/// CSV を並列に変換するブロックの目安のバイト数
+constexpr std::size_t kCSVChunkBytes = std::size_t(1) << 20;
 
-  return result;
+/**
+ * @brief 前後の空白を除いた範囲を返す
+ */
+std::pair<const char *, const char *> TrimCSVCell(const char *begin, const char *end)
+{
+  while (begin < end && (*begin == ' ' || *begin == '\t'))
+  {
+    ++begin;
+  }
+  while (end > begin && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r'))
+  {
+    --end;
+  }
+  if (end - begin >= 2 && *begin == '"' && end[-1] == '"')
+  {
+    ++begin;
+    --end;
+  }
+  return {begin, end};
 }
 
-Tensor Tensor::Slice(const std::size_t &start, const std::size_t &end) const
+/**
+ * @brief [begin, end) を行に分け, 空でない行ごとに fn(行頭, 行末) を呼ぶ
+ * @note 行末の \r と空白は行に含めない
+ */
+template<typename F>
+void ForEachCSVLine(const char *begin, const char *end, F &&fn)
 {
-  // 指定した範囲が範囲内にあることを確認する
-  if (start < 0 || end > shape_[0])
+  while (begin < end)
   {
-    throw std::invalid_argument("start and end must be within the range of the tensor");
+    const char *newline = static_cast<const char *>(std::memchr(begin, '\n', static_cast<std::size_t>(end - begin)));
+    const char *line_end = newline != nullptr ? newline : end;
+    const char *trimmed = line_end;
+    while (trimmed > begin && (trimmed[-1] == '\r' || trimmed[-1] == ' ' || trimmed[-1] == '\t'))
+    {
+      --trimmed;
+    }
+    if (trimmed > begin)
+    {
+      fn(begin, trimmed);
+    }
+    begin = newline != nullptr ? newline + 1 : end;
   }
+}
 
-  // end が start より大きいことを確認する
-  if (end <= start)
+/**
+ * @brief 1 つの値を変換する
+ * @return 変換できたかどうか
+ */
+template<typename T>
+bool ParseCSVValue(const char *begin, const char *end, T &value)
+{
+  std::tie(begin, end) = TrimCSVCell(begin, end);
+  if (begin < end && *begin == '+')
   {
-    throw std::invalid_argument("end must be greater than start");
+    ++begin;
+  }
+  if constexpr (std::is_floating_point_v<T>)
+  {
+    const auto [ptr, ec] = std::from_chars(begin, end, value);
+    return ec == std::errc() && ptr == end && begin < end;
+  }
+  else
+  {
+    // 整数として変換できない場合は小数として変換する
+    std::int64_t integer = 0;
+    const auto [ptr, ec] = std::from_chars(begin, end, integer);
+    if (ec == std::errc() && ptr == end && begin < end)
+    {
+      value = static_cast<T>(integer);
+      return true;
+    }
+    double real = 0;
+    const auto [real_ptr, real_ec] = std::from_chars(begin, end, real);
+    if (real_ec != std::errc() || real_ptr != end || begin == end)
+    {
+      return false;
+    }
+    value = static_cast<T>(real);
+    return true;
+  }
+}
+
+/**
+ * @brief 1 行を変換して出力先の行に書き込む
+ * @param begin 行頭
+ * @param end 行末
+ * @param delimiter 区切り文字
+ * @param column_map ファイルの列ごとの出力先の列. 読み込まない列は -1
+ * @param row 出力先の行の先頭
+ * @return エラーの内容. 成功した場合は nullptr
+ */
+template<typename T>
+const char *ParseCSVLine(const char *begin, const char *end, char delimiter,
+                         const std::vector<std::ptrdiff_t> &column_map, T *row)
+{
+  std::size_t column = 0;
+  while (true)
+  {
+    if (column >= column_map.size())
+    {
+      return "CSV内の行で列数が一致しません";
+    }
+    const std::ptrdiff_t out = column_map[column];
+
+    // 18 桁までの整数だけの値は区切り文字を探しながら 1 回の走査で変換する.
+    // 画素値のような短い整数の列では値ごとの from_chars の呼び出しが支配的になるため
+    const char *p = begin;
+    const bool negative = p < end && *p == '-';
+    if (p < end && (*p == '-' || *p == '+'))
+    {
+      ++p;
+    }
+    const char *digits = p;
+    std::uint64_t integer = 0;
+    while (p < end && static_cast<unsigned>(*p - '0') < 10 && p - digits < 18)
+    {
+      integer = integer * 10 + static_cast<unsigned>(*p - '0');
+      ++p;
+    }
+    const char *cell_end;
+    if (p > digits && (p == end || *p == delimiter) && !(negative && integer == 0))
+    {
+      cell_end = p;
+      if (out >= 0)
+      {
+        const auto value = static_cast<std::int64_t>(integer);
+        row[out] = static_cast<T>(negative ? -value : value);
+      }
+    }
+    else
+    {
+      cell_end = static_cast<const char *>(std::memchr(p, delimiter, static_cast<std::size_t>(end - p)));
+      if (cell_end == nullptr)
+      {
+        cell_end = end;
+      }
+      if (out >= 0 && !ParseCSVValue(begin, cell_end, row[out]))
+      {
+        return "CSVの値を数値に変換できません";
+      }
+    }
+    ++column;
+    if (cell_end == end)
+    {
+      break;
+    }
+    begin = cell_end + 1;
   }
-
-  // 分割したテンソルのshape を計算する
-  shape_type shape(this->shape_);
-  const std::size_t size = end - start + 1;
-  shape[0] = size;
-
-  // 分割したテンソルを作成する
-  Tensor result(shape);
-
-  // 分割したテンソルを作成する
-  const std::size_t start_index = start * strides_[0];
-  const std::size_t end_index = start_index + size * strides_[0];
-  std::copy(
-    storage_.begin() + start_index,
-    storage_.begin() + end_index,
-    result.storage().begin());
-
-  return result;
+  return column == column_map.size() ? nullptr : "CSV内の行で列数が一致しません";
 }
 
-Tensor Tensor::Argmax() const
+/**
+ * @brief 1 行を区切り文字で分ける
+ */
+std::vector<std::string> SplitCSVLine(const char *begin, const char *end, char delimiter)
 {
-  // 1次元のテンソルの場合
-  if (shape_.size() == 1)
-  {
-    Tensor result({1});
-    result(0) = std::distance(
-      storage_.begin(),
-      std::max_element(storage_.begin(), storage_.end()));
-    return result;
-  }
-
-  // 2次元のテンソルの場合
-  if (shape_.size() == 2)
+  std::vector<std::string> cells;
+  while (true)
   {
-    Tensor result({shape_[0]});
-    for (std::size_t i = 0; i < shape_[0]; ++i)
+    const char *cell_end = std::find(begin, end, delimiter);
+    const auto [b, e] = TrimCSVCell(begin, cell_end);
+    cells.emplace_back(b, e);
+    if (cell_end == end)
     {
-      Tensor slice = this->Slice(i);
-      result(i) = slice.Argmax()(0);
+      return cells;
     }
-    return result;
+    begin = cell_end + 1;
   }
-
-  throw std::invalid_argument("tensor must be 1 or 2 dimensional");
 }
+} // namespace
 
-bool Tensor::Equal(const Tensor &a, const Tensor &b)
+template<typename T>
+BasicTensor<T> BasicTensor<T>::FromCSV(const std::string &filename, const CSVOptions &options)
 {
-  if (a.shape() != b.shape())
+  const MappedFile file(filename, true);
+  const char *begin = reinterpret_cast<const char *>(file.data());
+  const char *const end = begin + file.size();
+  const char delimiter = options.delimiter;
+
+  // UTF-8 の BOM を読み飛ばす
+  if (file.size() >= 3 && std::memcmp(begin, "\xEF\xBB\xBF", 3) == 0)
   {
-    return false;
+    begin += 3;
   }
 
-  for (std::size_t i = 0; i < a.storage().size(); ++i)
+  // 先頭の空でない行を取り出す
+  const auto first_line = [&](const char *from) -> std::pair<const char *, const char *>
   {
-    if (a.storage()[i] != b.storage()[i])
+    std::pair<const char *, const char *> line{end, end};
+    const char *next = from;
+    while (next < end && line.first == end)
     {
-      return false;
+      const char *newline = static_cast<const char *>(std::memchr(next, '\n', static_cast<std::size_t>(end - next)));
+      const char *line_end = newline != nullptr ? newline : end;
+      ForEachCSVLine(next, line_end, [&](const char *b, const char *e) { line = {b, e}; });
+      next = newline != nullptr ? newline + 1 : end;
     }
-  }
-  return true;
-}
+    return line;
+  };
 
-Tensor operator==(const Tensor &a, const Tensor &b)
-{
-  // 入力形状が同じであることを確認する
-  if (a.shape() != b.shape())
+  std::vector<std::string> names;
+  if (options.header)
   {
-    throw std::invalid_argument("tensor shapes must be the same");
+    const auto [b, e] = first_line(begin);
+    names = SplitCSVLine(b, e, delimiter);
+    const char *newline = static_cast<const char *>(std::memchr(e, '\n', static_cast<std::size_t>(end - e)));
+    begin = newline != nullptr ? newline + 1 : end;
   }
-
-  Tensor result = Tensor::Zeros(a.shape());
-#ifdef NAGATO_OPENMP
-  #pragma omp parallel for
-#endif
-  for (std::size_t i = 0; i < a.storage().size(); ++i)
+  else if (!options.column_names.empty())
   {
-    if (a(i) == b(i))
-    {
-      result.storage()[i] = 1.0;
-    }
+    throw std::invalid_argument("列名で列を選ぶには header を指定してください");
   }
-  return result;
-}
 
-Tensor Tensor::FromCSV(const std::string &filename)
-{
-    std::ifstream file(filename);
-    if (!file.is_open())
-    {
-        throw std::runtime_error("ファイルを開くことができませんでした: " + filename);
-    }
+  const auto [data_begin, data_end] = first_line(begin);
+  if (data_begin == end)
+  {
+    throw std::invalid_argument("CSVファイルが空です");
+  }
+  const std::size_t source_columns = options.header
+                                       ? names.size()
+                                       : static_cast<std::size_t>(std::count(data_begin, data_end, delimiter)) + 1;
 
-    std::string line;
-    std::vector<std::vector<value_type>> data;
-    while (std::getline(file, line))
+  // 読み込む列を選び, ファイルの列から出力先の列への対応を作る
+  std::vector<std::size_t> selected = options.columns;
+  if (!options.column_names.empty())
+  {
+    if (!selected.empty())
     {
-        std::vector<value_type> row;
-        std::stringstream ss(line);
-        std::string cell;
-        while (std::getline(ss, cell, ','))
-        {
-            row.push_back(std::stof(cell));
-        }
-        data.push_back(row);
+      throw std::invalid_argument("columns と column_names は同時に指定できません");
     }
-
-    if (data.empty())
+    for (const auto &name : options.column_names)
     {
-        throw std::invalid_argument("CSVファイルが空です");
+      const auto it = std::find(names.begin(), names.end(), name);
+      if (it == names.end())
+      {
+        throw std::invalid_argument("CSVに列がありません: " + name);
+      }
+      selected.push_back(static_cast<std::size_t>(it - names.begin()));
     }
-
-    // 行数と列数を取得
-    std::size_t rows = data.size();
-    std::size_t cols = data[0].size();
-    for (const auto &row : data)
+  }
+  if (selected.empty())
+  {
+    selected.resize(source_columns);
+    std::iota(selected.begin(), selected.end(), std::size_t(0));
+  }
+  std::vector<std::ptrdiff_t> column_map(source_columns, -1);
+  for (std::size_t i = 0; i < selected.size(); ++i)
+  {
+    if (selected[i] >= source_columns)
     {
-        if (row.size() != cols)
-        {
-            throw std::invalid_argument("CSV内の行で列数が一致しません");
-        }
+      throw std::invalid_argument("CSVの列の番号が範囲外です: " + std::to_string(selected[i]));
     }
-
-    // 2次元のテンソルとして初期化（形状: {rows, cols}）
-    Tensor result({rows, cols});
-
-    // 2重ループで vector 内の値をテンソルのストレージへコピーする
-    for (std::size_t i = 0; i < rows; ++i)
+    if (column_map[selected[i]] >= 0)
     {
-        for (std::size_t j = 0; j < cols; ++j)
-        {
-            result(i, j) = data[i][j];
-        }
+      throw std::invalid_argument("CSVの列が重複しています: " + std::to_string(selected[i]));
     }
-    return result;
-}
+    column_map[selected[i]] = static_cast<std::ptrdiff_t>(i);
+  }
+  const std::size_t cols = selected.size();
 
-Tensor Tensor::Mean(const Tensor &a)
-{
-  // ベクトルの場合
-  if (a.shape().size() == 1)
+  // 改行の直後で区切ったブロックに分ける
+  std::vector<const char *> bounds{begin};
+  while (bounds.back() < end)
   {
-    Tensor result({1});
-    // 分母が0の場合は例外を送出
-    if (a.shape()[0] == 0)
+    const char *next = bounds.back() + std::min(kCSVChunkBytes, static_cast<std::size_t>(end - bounds.back()));
+    if (next < end)
     {
-      throw std::invalid_argument("denominator is 0");
+      const char *newline = static_cast<const char *>(std::memchr(next, '\n', static_cast<std::size_t>(end - next)));
+      next = newline != nullptr ? newline + 1 : end;
     }
-    result(0) = std::accumulate(a.storage().begin(), a.storage().end(), 0.0f) / a.shape()[0];
-    return result;
+    bounds.push_back(next);
   }
+  const std::size_t chunks = bounds.size() - 1;
 
-  // 行列の場合
-  if (a.shape().size() == 2)
+  // ブロックごとの行数を数えて, 各ブロックの書き込み先の行を決める
+  std::vector<std::size_t> row_offsets(chunks + 1, 0);
+#ifdef NAGATO_OPENMP
+  #pragma omp parallel for if (chunks > 1)
+#endif
+  for (std::size_t c = 0; c < chunks; ++c)
   {
-    Tensor result({a.shape()[0]});
+    std::size_t rows = 0;
+    ForEachCSVLine(bounds[c], bounds[c + 1], [&](const char *, const char *) { ++rows; });
+    row_offsets[c + 1] = rows;
+  }
+  std::partial_sum(row_offsets.begin(), row_offsets.end(), row_offsets.begin());
+  const std::size_t rows = row_offsets.back();
+
+  BasicTensor result({rows, cols});
+  T *const dst = result.data();
+  std::vector<const char *> errors(chunks, nullptr);
+  std::vector<std::size_t> error_rows(chunks, 0);
 #ifdef NAGATO_OPENMP
-    #pragma omp parallel for
+  #pragma omp parallel for schedule(dynamic) if (chunks > 1)
 #endif
-    for (std::size_t i = 0; i < a.shape()[0]; ++i)
+  for (std::size_t c = 0; c < chunks; ++c)
+  {
+    std::size_t row = row_offsets[c];
+    ForEachCSVLine(bounds[c], bounds[c + 1], [&](const char *b, const char *e)
     {
-      // 行をベクトルとして取り出して計算する
-      Tensor slice = a.Slice(i);
-      result(i) = Tensor::Mean(slice)(0);
-    }
-    return result;
+      if (errors[c] != nullptr)
+      {
+        return;
+      }
+      errors[c] = ParseCSVLine(b, e, delimiter, column_map, dst + row * cols);
+      error_rows[c] = row;
+      ++row;
+    });
   }
-  
-  // 3次元の場合: すべての要素の平均（グローバル平均）を求める
-  if (a.shape().size() == 3)
+  for (std::size_t c = 0; c < chunks; ++c)
   {
-    Tensor result({1});
-    // テンソル全体のストレージを使って全要素の和を求める
-    Tensor::value_type total = std::accumulate(a.storage().begin(), a.storage().end(), 0.0f);
-    result(0) = total / a.storage().size();
-    return result;
+    if (errors[c] != nullptr)
+    {
+      throw std::invalid_argument(std::string(errors[c]) + " (データの " + std::to_string(error_rows[c] + 1) + " 行目)");
+    }
   }
-
-  throw std::invalid_argument("tensor must be 1, 2 or 3 dimensional");
+  return result;
 }
 
-Tensor Tensor::Abs(const Tensor &a)
+template<typename T>
+BasicTensor<T> BasicTensor<T>::Mean(const BasicTensor &a)
 {
-  Tensor result(a.shape());
-  std::transform(a.storage().begin(),
-                 a.storage().end(),
-                 result.storage().begin(),
-                 [](Tensor::value_type x) { return std::abs(x); });
-  return result;
+  // ベクトルと行列は最後の軸, 3 次元以上はすべての要素の平均 (グローバル平均) を求める
+  if (a.shape().size() <= 2)
+  {
+    return ReduceTensor<MeanReducer<T>>(a, {a.shape().size() - 1}, false);
+  }
+  return ReduceTensor<MeanReducer<T>>(a, {}, false);
 }
 
-int Tensor::IsBroadcastable(const Tensor &a, const Tensor &b)
+template<typename T>
+int BasicTensor<T>::IsBroadcastable(const BasicTensor &a, const BasicTensor &b)
 {
   // それぞれのテンソルの shape（次元数を格納した vector）を取得
   const auto &shapeA = a.shape();
@@ -1255,192 +2259,515 @@ int Tensor::IsBroadcastable(const Tensor &a, const Tensor &b)
   return true;
 }
 
-template<typename BinaryOp>
-Tensor ApplyBroadcastBinaryOp(const Tensor &a, const Tensor &b, BinaryOp op)
+namespace
 {
-  // まず、2つのテンソルがブロードキャスト可能かチェックする
-  if (!Tensor::IsBroadcastable(a, b))
+/**
+ * @brief 各入力を (outer, 残り) とみなし, outer ごとのブロックを (outer, 残りの合計) の dst の行の中に並べてコピーする
+ * @note 隣り合うタスクが dst の連続した位置に書き込むよう, タスクは outer を外側, 入力を内側の順に並べる.
+ *       連続していないビューだけ先に詰める
+ */
+template<typename T>
+void ConcatBlocks(const std::vector<BasicTensor<T> > &tensors, std::size_t outer, T *dst)
+{
+  const std::size_t n = tensors.size();
+  std::vector<BasicTensor<T> > packed;
+  std::vector<const T *> sources(n);
+  std::vector<std::size_t> row_sizes(n);
+  std::vector<std::size_t> offsets(n + 1, 0);
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    if (tensors[i].IsContiguous())
+    {
+      sources[i] = tensors[i].data();
+    }
+    else
+    {
+      packed.push_back(tensors[i].Contiguous());
+      sources[i] = packed.back().data();
+    }
+    row_sizes[i] = outer == 0 ? 0 : tensors[i].size() / outer;
+    offsets[i + 1] = offsets[i] + row_sizes[i];
+  }
+  const std::size_t width = offsets[n];
+
+#ifdef NAGATO_OPENMP
+  #pragma omp parallel for if (outer * width > 65536)
+#endif
+  for (std::size_t task = 0; task < outer * n; ++task)
   {
-    throw std::invalid_argument("Tensors are not broadcastable");
+    const std::size_t o = task / n;
+    const std::size_t i = task % n;
+    std::copy_n(sources[i] + o * row_sizes[i], row_sizes[i], dst + o * width + offsets[i]);
   }
+}
 
-  // もし形状が完全に一致していれば、単純な要素ごとのループで処理する
-  if (a.shape() == b.shape())
+/**
+ * @brief Concat の結果の形状を求める
+ * @param outer 軸 axis より前の軸をまとめた長さ
+ */
+Shape ConcatShape(const std::vector<Shape> &shapes, std::size_t axis, std::size_t &outer)
+{
+  if (shapes.empty())
+  {
+    throw std::invalid_argument("BasicTensor vector is empty");
+  }
+  const Shape &first = shapes[0];
+  if (axis >= first.size())
   {
-    Tensor result(a.shape());
-    const auto &a_storage = a.storage();
-    const auto &b_storage = b.storage();
-    auto &result_storage = result.storage();
-    for (std::size_t i = 0; i < a_storage.size(); ++i)
+    throw std::invalid_argument("axis is out of range");
+  }
+  Shape shape = first;
+  shape[axis] = 0;
+  for (const auto &s : shapes)
+  {
+    bool same = s.size() == first.size();
+    for (std::size_t d = 0; same && d < s.size(); ++d)
     {
-      result_storage[i] = op(a_storage[i], b_storage[i]);
+      same = d == axis || s[d] == first[d];
     }
-    return result;
+    if (!same)
+    {
+      throw std::invalid_argument("all tensors must have the same shape except along the axis");
+    }
+    shape[axis] += s[axis];
   }
+  outer = std::accumulate(first.begin(), first.begin() + axis, std::size_t(1), std::multiplies<std::size_t>());
+  return shape;
+}
 
-  // 形状が一致しない場合、ブロードキャスト処理を行う
+/**
+ * @brief Stack の結果の形状を求める
+ * @param outer 新しい軸より前の軸をまとめた長さ
+ */
+Shape StackShape(const std::vector<Shape> &shapes, std::size_t axis, std::size_t &outer)
+{
+  if (shapes.empty())
+  {
+    throw std::invalid_argument("BasicTensor vector is empty");
+  }
+  const Shape &first = shapes[0];
+  if (axis > first.size())
+  {
+    throw std::invalid_argument("axis is out of range");
+  }
+  for (const auto &s : shapes)
+  {
+    if (s != first)
+    {
+      throw std::invalid_argument("all tensors must have the same shape");
+    }
+  }
+  Shape shape = first;
+  shape.insert(shape.begin() + axis, shapes.size());
+  outer = std::accumulate(first.begin(), first.begin() + axis, std::size_t(1), std::multiplies<std::size_t>());
+  return shape;
+}
 
-  // 元のshapeを取得
-  const auto &shapeA = a.shape();
-  const auto &shapeB = b.shape();
-  std::size_t rankA = shapeA.size();
-  std::size_t rankB = shapeB.size();
-  std::size_t maxRank = std::max(rankA, rankB);
+/**
+ * @brief テンソル群の形状を取り出す
+ */
+template<typename T>
+std::vector<Shape> ShapesOf(const std::vector<BasicTensor<T> > &tensors)
+{
+  std::vector<Shape> shapes;
+  shapes.reserve(tensors.size());
+  for (const auto &tensor : tensors)
+  {
+    shapes.push_back(tensor.shape());
+  }
+  return shapes;
+}
+} // namespace
+
+template<typename T>
+BasicTensor<T> BasicTensor<T>::Concat(const std::vector<BasicTensor> &tensors)
+{
+  return Stack(tensors, 0);
+}
 
-  // 先頭側に1を補完してパディングしたshapeを作成
-  std::vector<std::size_t> paddedA(maxRank, 1);
-  std::vector<std::size_t> paddedB(maxRank, 1);
-  for (std::size_t i = 0; i < rankA; ++i)
+template<typename T>
+BasicTensor<T> BasicTensor<T>::Concat(const std::vector<BasicTensor> &tensors, std::size_t axis)
+{
+  std::size_t outer = 0;
+  BasicTensor result(ConcatShape(ShapesOf(tensors), axis, outer));
+  ConcatBlocks(tensors, outer, result.data());
+  return result;
+}
+
+template<typename T>
+void BasicTensor<T>::Concat(const std::vector<BasicTensor> &tensors, std::size_t axis, BasicTensor &out)
+{
+  std::size_t outer = 0;
+  const shape_type shape = ConcatShape(ShapesOf(tensors), axis, outer);
+  if (out.shape() != shape)
   {
-    paddedA[maxRank - rankA + i] = shapeA[i];
+    out = BasicTensor(shape);
   }
-  for (std::size_t i = 0; i < rankB; ++i)
+  ConcatBlocks(tensors, outer, out.data());
+}
+
+template<typename T>
+BasicTensor<T> BasicTensor<T>::Stack(const std::vector<BasicTensor> &tensors, std::size_t axis)
+{
+  // 長さ 1 の軸 axis を持つテンソルの連結として扱う
+  std::size_t outer = 0;
+  BasicTensor result(StackShape(ShapesOf(tensors), axis, outer));
+  ConcatBlocks(tensors, outer, result.data());
+  return result;
+}
+
+template<typename T>
+void BasicTensor<T>::Stack(const std::vector<BasicTensor> &tensors, std::size_t axis, BasicTensor &out)
+{
+  std::size_t outer = 0;
+  const shape_type shape = StackShape(ShapesOf(tensors), axis, outer);
+  if (out.shape() != shape)
   {
-    paddedB[maxRank - rankB + i] = shapeB[i];
+    out = BasicTensor(shape);
   }
+  ConcatBlocks(tensors, outer, out.data());
+}
 
-  // 各軸ごとに拡張後のサイズは、paddedA と paddedB の大きい方となる
-  std::vector<std::size_t> broadcastShape(maxRank);
-  for (std::size_t i = 0; i < maxRank; ++i)
+namespace
+{
+/// ScatterAdd で 1 つのタスクが受け持つ inner 方向の要素数
+constexpr std::size_t kScatterBlock = 1024;
+
+/**
+ * @brief 軸 axis より前の軸をまとめた長さ, 軸の長さ, 後の軸をまとめた長さ
+ */
+struct AxisSplit
+{
+  std::size_t outer = 1;
+  std::size_t dim = 1;
+  std::size_t inner = 1;
+};
+
+/**
+ * @brief 形状を軸 axis で (outer, dim, inner) に分ける
+ */
+AxisSplit SplitAtAxis(const Shape &shape, std::size_t axis)
+{
+  if (axis >= shape.size())
+  {
+    throw std::invalid_argument("axis is out of range");
+  }
+  AxisSplit split;
+  for (std::size_t d = 0; d < shape.size(); ++d)
   {
-    broadcastShape[i] = std::max(paddedA[i], paddedB[i]);
+    if (d < axis)
+    {
+      split.outer *= shape[d];
+    }
+    else if (d > axis)
+    {
+      split.inner *= shape[d];
+    }
   }
-  Tensor result(broadcastShape);
+  split.dim = shape[axis];
+  return split;
+}
 
-  // 拡張後の総要素数を計算
-  std::size_t total = 1;
-  for (auto dim : broadcastShape)
+/**
+ * @brief 2 つの形状が軸 axis 以外で一致するか確認する
+ */
+void CheckSameExceptAxis(const Shape &a, const Shape &b, std::size_t axis)
+{
+  bool same = a.size() == b.size();
+  for (std::size_t d = 0; same && d < a.size(); ++d)
   {
-    total *= dim;
+    same = d == axis || a[d] == b[d];
   }
+  if (!same)
+  {
+    throw std::invalid_argument("shapes must match except along the axis");
+  }
+}
 
-  // 補完後のshapeからストライドを計算するラムダ（row-major順）
-  auto computeStrides = [](const std::vector<std::size_t> &shape) -> std::vector<std::size_t>
+/**
+ * @brief 位置がすべて軸の長さ未満か確認する
+ */
+void CheckIndices(const std::size_t *indices, std::size_t count, std::size_t dim)
+{
+  for (std::size_t k = 0; k < count; ++k)
   {
-    std::vector<std::size_t> strides(shape.size());
-    if (!shape.empty())
+    if (indices[k] >= dim)
     {
-      strides[shape.size() - 1] = 1;
-      for (int i = static_cast<int>(shape.size()) - 2; i >= 0; --i)
-      {
-        strides[i] = strides[i + 1] * shape[i + 1];
-      }
+      throw std::out_of_range("index " + std::to_string(indices[k]) + " is out of range for axis of length " +
+                              std::to_string(dim));
     }
-    return strides;
-  };
+  }
+}
 
-  std::vector<std::size_t> stridesA = computeStrides(paddedA);
-  std::vector<std::size_t> stridesB = computeStrides(paddedB);
+/**
+ * @brief 位置がすべて 0 以上で軸の長さ未満か確認する
+ */
+void CheckIndices(const std::int32_t *indices, std::size_t count, std::size_t dim)
+{
+  for (std::size_t k = 0; k < count; ++k)
+  {
+    if (indices[k] < 0 || static_cast<std::size_t>(indices[k]) >= dim)
+    {
+      throw std::out_of_range("index " + std::to_string(indices[k]) + " is out of range for axis of length " +
+                              std::to_string(dim));
+    }
+  }
+}
 
-  // flat index を multi-index に変換するラムダ
-  auto flatToMultiIndex = [&](std::size_t flatIndex,
-                              const std::vector<std::size_t> &shape) -> std::vector<std::size_t>
+/**
+ * @brief dst[j] += src[j] (Bool は論理和)
+ */
+template<typename T>
+void AccumulateRow(T *dst, const T *src, std::size_t n)
+{
+  for (std::size_t j = 0; j < n; ++j)
   {
-    std::vector<std::size_t> indices(shape.size(), 0);
-    for (int i = static_cast<int>(shape.size()) - 1; i >= 0; --i)
+    if constexpr (std::is_same_v<T, Bool>)
     {
-      indices[i] = flatIndex % shape[i];
-      flatIndex /= shape[i];
+      dst[j] = Bool(dst[j] || src[j]);
     }
-    return indices;
-  };
+    else
+    {
+      dst[j] += src[j];
+    }
+  }
+}
 
-  // 各要素に対して、ブロードキャストに従ったインデックス変換を行い、opを適用する
+/**
+ * @brief (outer, dim, inner) の src から軸の位置 indices の行を (outer, count, inner) の dst へコピーする
+ * @note outer が 1 の場合 (最初の軸に沿って取り出す場合) は行ごとに, それ以外は outer ごとに並列にコピーする
+ */
+template<typename T>
+void IndexSelectKernel(const T *src, const AxisSplit &split, const std::size_t *indices, std::size_t count, T *dst)
+{
+  const std::size_t inner = split.inner;
+  if (split.outer == 1)
+  {
 #ifdef NAGATO_OPENMP
-  #pragma omp parallel for
+    #pragma omp parallel for if (count * inner > 65536)
 #endif
-  for (std::size_t idx = 0; idx < total; ++idx)
+    for (std::size_t k = 0; k < count; ++k)
+    {
+      std::copy_n(src + indices[k] * inner, inner, dst + k * inner);
+    }
+    return;
+  }
+
+#ifdef NAGATO_OPENMP
+  #pragma omp parallel for if (split.outer * count * inner > 65536)
+#endif
+  for (std::size_t o = 0; o < split.outer; ++o)
   {
-    std::vector<std::size_t> multiIndex = flatToMultiIndex(idx, broadcastShape);
-    std::size_t indexA = 0;
-    std::size_t indexB = 0;
-    for (std::size_t i = 0; i < maxRank; ++i)
+    const T *src_o = src + o * split.dim * inner;
+    T *dst_o = dst + o * count * inner;
+    if (inner == 1)
+    {
+      for (std::size_t k = 0; k < count; ++k)
+      {
+        dst_o[k] = src_o[indices[k]];
+      }
+    }
+    else
     {
-      // 対象の次元が1の場合、常に0番目の要素を参照する
-      std::size_t idxA = (paddedA[i] == 1 ? 0 : multiIndex[i]);
-      std::size_t idxB = (paddedB[i] == 1 ? 0 : multiIndex[i]);
-      indexA += idxA * stridesA[i];
-      indexB += idxB * stridesB[i];
+      for (std::size_t k = 0; k < count; ++k)
+      {
+        std::copy_n(src_o + indices[k] * inner, inner, dst_o + k * inner);
+      }
     }
-    result.storage()[idx] = op(a.storage()[indexA], b.storage()[indexB]);
   }
+}
+} // namespace
+
+template<typename T>
+BasicTensor<T> BasicTensor<T>::IndexSelect(const BasicTensor &a,
+                                           std::size_t axis,
+                                           const std::vector<std::size_t> &indices)
+{
+  BasicTensor result;
+  IndexSelect(a, axis, indices, result);
   return result;
 }
 
-Tensor Tensor::Concat(const std::vector<Tensor> &tensors)
+template<typename T>
+void BasicTensor<T>::IndexSelect(const BasicTensor &a,
+                                 std::size_t axis,
+                                 const std::vector<std::size_t> &indices,
+                                 BasicTensor &out)
 {
-  if (tensors.empty())
+  const AxisSplit split = SplitAtAxis(a.shape(), axis);
+  CheckIndices(indices.data(), indices.size(), split.dim);
+
+  // out が a と同じオブジェクトの場合に備えて, out を作り直す前に入力のデータ領域を確保しておく
+  const BasicTensor source = a.Contiguous();
+  shape_type shape = a.shape();
+  shape[axis] = indices.size();
+  if (out.shape() != shape)
+  {
+    out = BasicTensor(shape);
+  }
+  if (out.size() == 0)
   {
-    throw std::invalid_argument("Tensor vector is empty");
+    return;
   }
+  IndexSelectKernel(source.data(), split, indices.data(), indices.size(), out.data());
+}
 
-  // すべてのテンソルの形状が同一であることをチェック
-  const auto &firstShape = tensors[0].shape();
-  for (const auto &tensor : tensors)
+template<typename T>
+BasicTensor<T> BasicTensor<T>::Gather(const BasicTensor &a, std::size_t axis, const BasicTensor<std::int32_t> &index)
+{
+  const AxisSplit split = SplitAtAxis(a.shape(), axis);
+  CheckSameExceptAxis(a.shape(), index.shape(), axis);
+  const BasicTensor<std::int32_t> idx = index.Contiguous();
+  CheckIndices(idx.data(), idx.size(), split.dim);
+
+  BasicTensor result(index.shape());
+  const BasicTensor source = a.Contiguous();
+  const value_type *src = source.data();
+  const std::int32_t *ids = idx.data();
+  value_type *dst = result.data();
+  const std::size_t count = index.shape()[axis];
+  const std::size_t inner = split.inner;
+#ifdef NAGATO_OPENMP
+  #pragma omp parallel for if (result.size() > 65536)
+#endif
+  for (std::size_t o = 0; o < split.outer; ++o)
   {
-    if (tensor.shape() != firstShape)
+    const value_type *src_o = src + o * split.dim * inner;
+    for (std::size_t k = 0; k < count; ++k)
     {
-      throw std::invalid_argument("all tensors must have the same shape");
+      const std::size_t row = (o * count + k) * inner;
+      for (std::size_t i = 0; i < inner; ++i)
+      {
+        dst[row + i] = src_o[static_cast<std::size_t>(ids[row + i]) * inner + i];
+      }
     }
   }
+  return result;
+}
 
-  // 新しいテンソルの形状を構築する
-  // 先頭にテンソル数、続いて各テンソルの元の形状を追加する
-  shape_type new_shape = {tensors.size()};
-  new_shape.insert(new_shape.end(), firstShape.begin(), firstShape.end());
-
-  // 結果テンソルを作成 (new_shape に基づいてストレージサイズも自動的に確保される)
-  Tensor result(new_shape);
+template<typename T>
+void BasicTensor<T>::ScatterAdd(BasicTensor &out,
+                                std::size_t axis,
+                                const std::vector<std::size_t> &indices,
+                                const BasicTensor &src)
+{
+  const AxisSplit split = SplitAtAxis(out.shape(), axis);
+  CheckSameExceptAxis(out.shape(), src.shape(), axis);
+  if (src.shape()[axis] != indices.size())
+  {
+    throw std::invalid_argument("src must have indices.size() elements along the axis");
+  }
+  CheckIndices(indices.data(), indices.size(), split.dim);
+  if (out.size() == 0 || src.size() == 0)
+  {
+    return;
+  }
 
+  // 同じ位置が重なっても競合しないよう, 軸以外の位置 (outer, inner のブロック) ごとに分ける
+  const BasicTensor source = src.Contiguous();
+  const value_type *s = source.data();
+  value_type *d = out.data();
+  const std::size_t count = indices.size();
+  const std::size_t inner = split.inner;
+  const std::size_t blocks = (inner + kScatterBlock - 1) / kScatterBlock;
 #ifdef NAGATO_OPENMP
-  // 各テンソルのコピー開始位置を事前に計算する
-  std::vector<std::size_t> offsets(tensors.size());
-  std::size_t current_offset = 0;
-  for (std::size_t i = 0; i < tensors.size(); ++i)
+  #pragma omp parallel for if (src.size() > 65536)
+#endif
+  for (std::size_t task = 0; task < split.outer * blocks; ++task)
   {
-    offsets[i] = current_offset;
-    current_offset += tensors[i].storage().size();
+    const std::size_t o = task / blocks;
+    const std::size_t begin = (task % blocks) * kScatterBlock;
+    const std::size_t n = std::min(kScatterBlock, inner - begin);
+    for (std::size_t k = 0; k < count; ++k)
+    {
+      AccumulateRow(d + (o * split.dim + indices[k]) * inner + begin, s + (o * count + k) * inner + begin, n);
+    }
   }
+}
 
-  // 並列に各テンソルのストレージをコピーする
-  #pragma omp parallel for
-  for (std::size_t i = 0; i < tensors.size(); ++i)
+template<typename T>
+void BasicTensor<T>::ScatterAdd(BasicTensor &out,
+                                std::size_t axis,
+                                const BasicTensor<std::int32_t> &index,
+                                const BasicTensor &src)
+{
+  const AxisSplit split = SplitAtAxis(out.shape(), axis);
+  CheckSameExceptAxis(out.shape(), index.shape(), axis);
+  if (index.shape() != src.shape())
   {
-    const auto &storage = tensors[i].storage();
-    std::copy(storage.begin(), storage.end(), result.storage().begin() + offsets[i]);
+    throw std::invalid_argument("index and src must have the same shape");
   }
-#else
-  // 並列化しない場合はシリアルにコピー
-  std::size_t offset = 0;
-  for (const auto &tensor : tensors)
+  const BasicTensor<std::int32_t> idx = index.Contiguous();
+  CheckIndices(idx.data(), idx.size(), split.dim);
+  if (out.size() == 0 || src.size() == 0)
   {
-    const auto &storage = tensor.storage();
-    std::copy(storage.begin(), storage.end(), result.storage().begin() + offset);
-    offset += storage.size();
+    return;
   }
-#endif
 
-  return result;
+  const BasicTensor source = src.Contiguous();
+  const value_type *s = source.data();
+  const std::int32_t *ids = idx.data();
+  value_type *d = out.data();
+  const std::size_t count = index.shape()[axis];
+  const std::size_t inner = split.inner;
+  const std::size_t blocks = (inner + kScatterBlock - 1) / kScatterBlock;
+#ifdef NAGATO_OPENMP
+  #pragma omp parallel for if (src.size() > 65536)
+#endif
+  for (std::size_t task = 0; task < split.outer * blocks; ++task)
+  {
+    const std::size_t o = task / blocks;
+    const std::size_t begin = (task % blocks) * kScatterBlock;
+    const std::size_t end = std::min(begin + kScatterBlock, inner);
+    value_type *d_o = d + o * split.dim * inner;
+    for (std::size_t k = 0; k < count; ++k)
+    {
+      const std::size_t row = (o * count + k) * inner;
+      for (std::size_t i = begin; i < end; ++i)
+      {
+        AccumulateRow(d_o + static_cast<std::size_t>(ids[row + i]) * inner + i, s + row + i, 1);
+      }
+    }
+  }
 }
 
-Tensor::value_type Tensor::Max(const Tensor &a)
+template<typename T>
+typename BasicTensor<T>::value_type BasicTensor<T>::Max(const BasicTensor &a)
 {
-  return *std::max_element(a.storage().begin(), a.storage().end());
+  return ReduceTensor<MaxReducer<T>>(a, {}, false)(0);
 }
 
-Tensor::value_type Tensor::Min(const Tensor &a)
+template<typename T>
+typename BasicTensor<T>::value_type BasicTensor<T>::Min(const BasicTensor &a)
 {
-  return *std::min_element(a.storage().begin(), a.storage().end());
+  return ReduceTensor<MinReducer<T>>(a, {}, false)(0);
 }
 
-bool Tensor::IsNan(const Tensor &a)
-{
-  return std::any_of(a.storage().begin(),
-                     a.storage().end(),
-                     [](const value_type &x) { return std::isnan(x); });
+template<typename T>
+bool BasicTensor<T>::IsNan(const BasicTensor &a)
+{
+  const BasicTensor source = a.Contiguous();
+  return std::any_of(source.data(),
+                     source.data() + source.size(),
+                     [](const value_type &x)
+                     {
+                       if constexpr (std::is_floating_point_v<T>)
+                       {
+                         return std::isnan(x);
+                       }
+                       else if constexpr (is_reduced_precision_v<T>)
+                       {
+                         return std::isnan(static_cast<float>(x));
+                       }
+                       else
+                       {
+                         return false;
+                       }
+                     });
 }
 
-Tensor Tensor::Tile(const Tensor &a, std::size_t batch_size)
+template<typename T>
+BasicTensor<T> BasicTensor<T>::Tile(const BasicTensor &a, std::size_t batch_size)
 {
   // a が2次元のテンソルであることを確認
   if (a.shape().size() != 2)
@@ -1450,25 +2777,29 @@ Tensor Tensor::Tile(const Tensor &a, std::size_t batch_size)
 
   // 元のテンソルの shape を (n, m) とした場合、出力の shape は {batch_size, n, m} となる
   shape_type new_shape = {batch_size, a.shape()[0], a.shape()[1]};
-  Tensor result(new_shape);
-  std::size_t a_size = a.storage().size();
+  BasicTensor result(new_shape);
+  const BasicTensor source = a.Contiguous();
+  const value_type *src = source.data();
+  value_type *dst = result.data();
+  const std::size_t a_size = source.size();
 
 #ifdef NAGATO_OPENMP
   #pragma omp parallel for
 #endif
   for (std::size_t i = 0; i < batch_size; ++i)
   {
-    std::copy(a.storage().begin(), a.storage().end(), result.storage().begin() + i * a_size);
+    std::copy_n(src, a_size, dst + i * a_size);
   }
   return result;
 }
 
-Tensor Tensor::Pad(const Tensor &a, const std::vector<std::pair<std::size_t, std::size_t>> &pad)
+template<typename T>
+BasicTensor<T> BasicTensor<T>::Pad(const BasicTensor &a, const std::vector<std::pair<std::size_t, std::size_t>> &pad)
 {
-  // Tensor の形状とパディングの形状をチェックする
+  // BasicTensor の形状とパディングの形状をチェックする
   if (a.shape().size() != pad.size())
   {
-    throw std::invalid_argument("Tensor の形状とパディングの形状が一致しません");
+    throw std::invalid_argument("BasicTensor の形状とパディングの形状が一致しません");
   }
   
   // パディング後の形状を計算する
@@ -1479,7 +2810,7 @@ Tensor Tensor::Pad(const Tensor &a, const std::vector<std::pair<std::size_t, std
   }
   
   // パディング後のデータを格納するテンソルを作成する
-  Tensor result(new_shape);
+  BasicTensor result(new_shape);
   
   // 以下の処理で、入力テンソルの全要素を対応する位置にコピーする
   // ※各次元において、元のインデックスに pad.first の値を足した位置にコピーする
@@ -1488,12 +2819,15 @@ Tensor Tensor::Pad(const Tensor &a, const std::vector<std::pair<std::size_t, std
   const auto &a_shape = a.shape();
   const std::size_t ndim = a_shape.size();
   // 元のテンソルの全要素数
-  const std::size_t total = a.storage().size();
+  const std::size_t total = a.size();
+  const BasicTensor source = a.Contiguous();
+  const value_type *src = source.data();
+  value_type *dst = result.data();
   
   // 元のテンソルと結果テンソル（パディング後）のストライドを計算する
   // ※ストライド：各次元のインデックスが1増加する際の一次元配列上のオフセット
-  std::vector<std::size_t> a_strides(ndim);
-  std::vector<std::size_t> result_strides(ndim);
+  Shape a_strides(ndim);
+  Shape result_strides(ndim);
   a_strides[ndim - 1] = 1;
   result_strides[ndim - 1] = 1;
   for (int i = ndim - 2; i >= 0; --i)
@@ -1514,13 +2848,14 @@ Tensor Tensor::Pad(const Tensor &a, const std::vector<std::pair<std::size_t, std
       tmp %= a_strides[d];
       res_idx += (pos + pad[d].first) * result_strides[d];
     }
-    result.storage()[res_idx] = a.storage()[idx];
+    dst[res_idx] = src[idx];
   }
   
   return result;
 }
 
-Tensor Tensor::Transpose(const Tensor &a, const std::vector<std::size_t> &axes)
+template<typename T>
+BasicTensor<T> BasicTensor<T>::Transpose(const BasicTensor &a, const std::vector<std::size_t> &axes)
 {
     const std::size_t ndim = a.shape().size();
     if (axes.size() != ndim) {
@@ -1539,49 +2874,33 @@ Tensor Tensor::Transpose(const Tensor &a, const std::vector<std::size_t> &axes)
         seen[ax] = true;
     }
     
-    // 新しい形状を決定する: new_shape[d] = a.shape()[axes[d]]
-    Tensor::shape_type new_shape;
-    for (std::size_t i = 0; i < ndim; i++) {
-        new_shape.push_back(a.shape()[axes[i]]);
-    }
-    
-    // 新たな形状でTensorを作成（連続領域が確保され、ストライドも計算される）
-    Tensor result(new_shape);
-    
-    // 全要素数
-    const std::size_t total = a.storage().size();
-    
-    // 元テンソルのストライドと結果用テンソルのストライドを取得
-    const auto &a_strides = a.strides();
-    const auto &r_strides = result.strides();
-    
-    // flatインデックスを用いて、元の多次元インデックスを求め、軸の並び替えをする
-    for (std::size_t i = 0; i < total; i++) {
-        // 元のテンソルの各軸のインデックスを計算
-        std::vector<std::size_t> orig_idx(ndim, 0);
-        std::size_t t = i;
-        for (std::size_t d = 0; d < ndim; d++) {
-            orig_idx[d] = t / a_strides[d];
-            t %= a_strides[d];
-        }
-        
-        // 転置後の多次元インデックス new_idx[d] = orig_idx[axes[d]]
-        std::vector<std::size_t> new_idx(ndim, 0);
-        for (std::size_t d = 0; d < ndim; d++) {
-            new_idx[d] = orig_idx[axes[d]];
-        }
-        
-        // 転置後のテンソルのflatインデックスを計算
-        std::size_t new_flat_index = 0;
-        for (std::size_t d = 0; d < ndim; d++) {
-            new_flat_index += new_idx[d] * r_strides[d];
-        }
-        
-        // 元のテンソルの値を転置先にコピー
-        result.storage()[new_flat_index] = a.storage()[i];
+    // 形状とストライドを axes の順に並べ替えたビューを作成する
+    // new_shape[d] = a.shape()[axes[d]], new_strides[d] = a.strides()[axes[d]]
+    BasicTensor result = a;
+    for (std::size_t d = 0; d < ndim; d++) {
+        result.shape_[d] = a.shape_[axes[d]];
+        result.strides_[d] = a.strides_[axes[d]];
     }
-    
+
     return result;
 }
 
+// 要素型ごとの明示的インスタンス化
+#define NAGATO_INSTANTIATE_TENSOR(T)                                                                   \
+  template class BasicTensor<T>;                                                                       \
+  template BasicTensor<Bool> operator==(const BasicTensor<T> &, const BasicTensor<T> &);
+
+NAGATO_INSTANTIATE_TENSOR(float)
+NAGATO_INSTANTIATE_TENSOR(double)
+NAGATO_INSTANTIATE_TENSOR(std::int32_t)
+NAGATO_INSTANTIATE_TENSOR(std::uint8_t)
+NAGATO_INSTANTIATE_TENSOR(Bool)
+NAGATO_INSTANTIATE_TENSOR(Half)
+NAGATO_INSTANTIATE_TENSOR(BFloat16)
+
+#undef NAGATO_INSTANTIATE_TENSOR
+
+template BasicTensor<float> MixedMatmul(const BasicTensor<Half> &, const BasicTensor<Half> &);
+template BasicTensor<float> MixedMatmul(const BasicTensor<BFloat16> &, const BasicTensor<BFloat16> &);
+
 } // namespace nagato
@@ -11,6 +11,16 @@
 #include <vector>
 #include <algorithm>
 #include <iostream>
+#include <memory>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "dtype.hpp"
+#include "small_vector.hpp"
+#include "tensor_allocator.hpp"
+#include "tensor_expression.hpp"
 
 // #define NAGATO_OPENMP
 
@@ -18,19 +28,207 @@
 
 namespace nagato{
 
+/**
+ * @brief CSV ファイルの読み込み設定
+ * @note 要素型は読み込むテンソルの要素型 (BasicTensor<T>::FromCSV の T) で決まる
+ */
+struct CSVOptions
+{
+  /**
+   * @brief 区切り文字
+   */
+  char delimiter = ',';
+
+  /**
+   * @brief 先頭行を列名の行として扱うかどうか
+   */
+  bool header = false;
+
+  /**
+   * @brief 読み込む列の番号 (0 始まり). この順にテンソルの列になる. 空の場合はすべての列を読み込む
+   */
+  std::vector<std::size_t> columns;
+
+  /**
+   * @brief 読み込む列の名前. header が true の場合だけ指定でき, columns とは同時に指定できない
+   */
+  std::vector<std::string> column_names;
+};
+
+/**
+ * @brief 要素型 T のテンソルの分散の要素型
+ * @note 浮動小数点数はそのままの型, 整数と真偽値は compute_t (double) にする
+ */
+template<typename T>
+using variance_type = std::conditional_t<std::is_floating_point_v<T> || is_reduced_precision_v<T>, T, compute_t<T>>;
+
+/**
+ * @brief Argmax/Argmin が返すインデックスの要素型
+ * @note 要素型に関わらず整数で返し, uint8 や Half, Bool でもインデックスが丸められないようにする
+ */
+using index_type = std::int32_t;
+
 /**
  * numpy の ndarray に相当するクラス
+ * @note データ領域は参照カウントで共有される. Slice, Reshape, Transpose はコピーせずに
+ *       オフセットとストライドだけを持つビューを返す. 書き込み時に共有されている場合は
+ *       その時点で複製する (コピーオンライト) ため, 値のセマンティクスは従来と変わらない.
+ *       データ領域は TensorAllocator で確保し, 既定では解放した領域を再利用する TensorMemoryPool から確保する
+ * @tparam T 要素型 (float, double, int32, uint8, Bool)
  */
-class Tensor {
+template<typename T>
+class BasicTensor {
 public:
- using value_type = double;
- using shape_type = std::vector<std::size_t>;
- using strides_type = std::vector<std::size_t>;
- using storage_type = std::vector<value_type>;
+ using value_type = T;
+ using shape_type = Shape;
+ using strides_type = Shape;
+ using storage_type = std::vector<value_type, TensorAllocator<value_type>>;
+
+  BasicTensor();
+
+  BasicTensor(const shape_type &shape);
+
+  /**
+   * @brief 作成済みのデータ領域を共有して作成する
+   * @note ファイルから読み込んだデータなどをコピーせずにテンソルにするために使う
+   * @param shape 形状
+   * @param storage データ領域. 要素数は形状の要素数と一致する必要がある
+   */
+  BasicTensor(const shape_type &shape, std::shared_ptr<storage_type> storage);
 
-  Tensor();
+  /**
+   * @brief 要素型の異なるテンソルから変換して作成する
+   * @param other 変換元のテンソル
+   */
+  template<typename U>
+  explicit BasicTensor(const BasicTensor<U> &other);
 
-  Tensor(const shape_type &shape);
+  /**
+   * @brief 遅延評価される式を評価して作成する
+   * @note 式全体を 1 回のループでまとめて計算する
+   * @param expression 式 (a + b, Exp(a) など)
+   */
+  template<typename E>
+    requires is_tensor_expression_v<E>
+  BasicTensor(const E &expression);
+
+  /**
+   * @brief 遅延評価される式を評価して代入する
+   * @note 形状が同じでデータ領域を単独で所有している場合は, 確保済みの領域にそのまま書き込む
+   * @param expression 式
+   * @return 自身
+   */
+  template<typename E>
+    requires is_tensor_expression_v<E>
+  BasicTensor &operator=(const E &expression);
+
+  /**
+   * @brief テンソル (または式) を要素ごとに加算する
+   * @note 右辺は自身の形状にブロードキャストする. 結果は確保済みの領域にそのまま書き込む
+   * @param rhs テンソルまたは式
+   * @return 自身
+   */
+  template<typename E>
+    requires TensorOperand<E>
+  BasicTensor &operator+=(const E &rhs)
+  {
+    return compound_assign(TensorAddOp{}, rhs);
+  }
+
+  /**
+   * @brief テンソル (または式) を要素ごとに減算する
+   * @note 右辺は自身の形状にブロードキャストする. 結果は確保済みの領域にそのまま書き込む
+   * @param rhs テンソルまたは式
+   * @return 自身
+   */
+  template<typename E>
+    requires TensorOperand<E>
+  BasicTensor &operator-=(const E &rhs)
+  {
+    return compound_assign(TensorSubtractOp{}, rhs);
+  }
+
+  /**
+   * @brief テンソル (または式) を要素ごとに乗算する
+   * @note 右辺は自身の形状にブロードキャストする. 結果は確保済みの領域にそのまま書き込む
+   * @param rhs テンソルまたは式
+   * @return 自身
+   */
+  template<typename E>
+    requires TensorOperand<E>
+  BasicTensor &operator*=(const E &rhs)
+  {
+    return compound_assign(TensorMultiplyOp{}, rhs);
+  }
+
+  /**
+   * @brief テンソル (または式) で要素ごとに除算する
+   * @note 右辺は自身の形状にブロードキャストする. 結果は確保済みの領域にそのまま書き込む
+   * @param rhs テンソルまたは式
+   * @return 自身
+   */
+  template<typename E>
+    requires TensorOperand<E>
+  BasicTensor &operator/=(const E &rhs)
+  {
+    return compound_assign(TensorDivideOp{}, rhs);
+  }
+
+  /**
+   * @brief スカラーを全要素に加算する
+   * @param value スカラー
+   * @return 自身
+   */
+  template<typename S>
+    requires TensorScalar<S>
+  BasicTensor &operator+=(const S &value)
+  {
+    return compound_assign(TensorAddOp{}, MakeScalarExpression<BasicTensor>(value));
+  }
+
+  /**
+   * @brief スカラーを全要素から減算する
+   * @param value スカラー
+   * @return 自身
+   */
+  template<typename S>
+    requires TensorScalar<S>
+  BasicTensor &operator-=(const S &value)
+  {
+    return compound_assign(TensorSubtractOp{}, MakeScalarExpression<BasicTensor>(value));
+  }
+
+  /**
+   * @brief スカラーを全要素に乗算する
+   * @param value スカラー
+   * @return 自身
+   */
+  template<typename S>
+    requires TensorScalar<S>
+  BasicTensor &operator*=(const S &value)
+  {
+    return compound_assign(TensorMultiplyOp{}, MakeScalarExpression<BasicTensor>(value));
+  }
+
+  /**
+   * @brief スカラーで全要素を除算する
+   * @param value スカラー
+   * @return 自身
+   */
+  template<typename S>
+    requires TensorScalar<S>
+  BasicTensor &operator/=(const S &value)
+  {
+    return compound_assign(TensorDivideOp{}, MakeScalarExpression<BasicTensor>(value));
+  }
+
+  /**
+   * @brief 要素型を変換したテンソルを作成する
+   * @tparam U 変換後の要素型
+   * @return 変換したテンソル
+   */
+  template<typename U>
+  BasicTensor<U> AsType() const;
 
   /**
    * @brief テンソルの形状を取得する
@@ -46,16 +244,57 @@ public:
 
   /**
    * @brief テンソルのデータを取得する
+   * @note データ領域を書き換えないので, 密でないビューの場合は例外を送出する. ビューは Contiguous() と data() で読み出す
    * @return データ
    */
   const storage_type &storage() const;
 
   /**
    * @brief テンソルのデータを取得する (非 const 版)
+   * @note データ領域が共有されている場合, またはビューの場合は複製してから返す
    * @return データ
    */
   storage_type &storage();
 
+  /**
+   * @brief 先頭要素へのポインタを取得する
+   * @note 連続していないビューでは要素が飛び飛びになる. 連続したデータが必要な場合は Contiguous() を使う
+   * @return 先頭要素へのポインタ
+   */
+  const value_type *data() const;
+
+  /**
+   * @brief 先頭要素へのポインタを取得する (非 const 版)
+   * @note データ領域が共有されている場合, またはビューの場合は複製してから返す
+   * @return 先頭要素へのポインタ
+   */
+  value_type *data();
+
+  /**
+   * @brief 要素数を取得する
+   * @return 要素数
+   */
+  std::size_t size() const;
+
+  /**
+   * @brief データ領域の先頭からのオフセットを取得する
+   * @return オフセット
+   */
+  std::size_t offset() const;
+
+  /**
+   * @brief 要素が行優先で連続して並んでいるかどうか
+   * @return 連続している場合は真
+   */
+  bool IsContiguous() const;
+
+  /**
+   * @brief 要素が連続して並んだテンソルを返す
+   * @note すでに連続している場合はデータ領域を共有し, コピーしない
+   * @return 連続したテンソル
+   */
+  BasicTensor Contiguous() const;
+
   /**
    * @brief テンソルへの要素アクセス (const 版)
    * @param indices インデックス
@@ -68,7 +307,7 @@ public:
       throw std::invalid_argument("index size must be equal to shape size");
     }
 
-    return storage_[index_of({static_cast<std::size_t>(indices)...})];
+    return (*storage_)[index_of({static_cast<std::size_t>(indices)...})];
   }
 
   /**
@@ -78,43 +317,48 @@ public:
    */
   template <typename... Indices>
   value_type &operator()(Indices... indices) {
-    return const_cast<value_type &>(const_cast<const Tensor &>(*this)(indices...));
+    detach();
+    return const_cast<value_type &>(const_cast<const BasicTensor &>(*this)(indices...));
   }
   
   /**
    * @brief テンソルの形状を変更する. 要素数は変更しない
+   * @note 連続している場合はデータ領域を共有するビューを返す
    * @param new_shape 新しい形状
    * @return 新しいテンソル
    */
-  Tensor Reshape(const shape_type &new_shape) const;
+  BasicTensor Reshape(const shape_type &new_shape) const;
 
   /**
    * @brief テンソルの指定した次元を取り出す.
+   * @note データ領域を共有するビューを返す
    * @param axis 取り出す次元
    * @return 取り出したテンソル
    */
-  Tensor Slice(const std::size_t &axis) const;
+  BasicTensor Slice(const std::size_t &axis) const;
 
   /**
    * @brief 指定した範囲のデータを取り出す
+   * @note データ領域を共有するビューを返す
    * @param start 開始インデックス
    * @param end 終了インデックス. 終了インデックスのデータを含む
    * @return 取り出したテンソル
    */
-  Tensor Slice(const std::size_t &start, const std::size_t &end) const;
+  BasicTensor Slice(const std::size_t &start, const std::size_t &end) const;
 
   /**
    * @brief テンソルの最大値のインデックスを返す
-   * @return 最大値のインデックス
+   * @note 最後の軸に沿って求める. Argmax(*this, shape().size() - 1) と同じ
+   * @return 最大値のインデックス (index_type)
    */
-  Tensor Argmax() const;
+  BasicTensor<index_type> Argmax() const;
 
   /**
    * @brief ゼロテンソルを作成する
    * @param shape 形状
    * @return ゼロテンソル
    */
-  static Tensor Zeros(const shape_type &shape);
+  static BasicTensor Zeros(const shape_type &shape);
 
   /**
    * @brief テンソルを埋める
@@ -122,21 +366,21 @@ public:
    * @param value 値
    * @return 埋めたテンソル
    */
-  static Tensor Fill(const shape_type &shape, const value_type &value);
+  static BasicTensor Fill(const shape_type &shape, const value_type &value);
 
   /**
    * @brief 1のテンソルを作成する
    * @param shape 形状
    * @return 1のテンソル
    */
-  static Tensor Ones(const shape_type &shape);
+  static BasicTensor Ones(const shape_type &shape);
 
   /**
    * @brief 単位行列を作成する
    * @param shape 形状
    * @return 単位行列
    */
-  static Tensor Eye(const shape_type &shape);
+  static BasicTensor Eye(const shape_type &shape);
 
   /**
    * @brief テンソルの内積を計算する
@@ -145,79 +389,205 @@ public:
    * @param b テンソル
    * @return 内積
    */
-  static Tensor Dot(const Tensor &a, const Tensor &b);
+  static BasicTensor Dot(const BasicTensor &a, const BasicTensor &b);
 
   /**
    * @brief 行列の積を計算する. 行列とベクトルの積も計算する.
    * @note ブロードキャストは行わない. 2次元の場合は行列同士の積, 3次元はバッチ行列同士の積を計算する. 
+   *       16 ビットの浮動小数点数は float で累積してから丸める
    * @param a テンソル
    * @param b テンソル
    * @return 行列の積
    */
-  static Tensor Matmul(const Tensor &a, const Tensor &b);
+  static BasicTensor Matmul(const BasicTensor &a, const BasicTensor &b);
 
   /**
-   * @brief テンソルの総和を求める. shape_ の最後の要素を軸として総和を求める. 4次元以上のテンソルはサポートしない
+   * @brief テンソルの総和を求める. shape_ の最後の要素を軸として総和を求める
    * @param a テンソル
    * @return 総和
    */
-  static Tensor Sum(const Tensor &a);
+  static BasicTensor Sum(const BasicTensor &a);
 
   /**
-   * @brief テンソルの総和を求める. shape_ の指定した軸を軸として総和を求める. 4次元以上のテンソルはサポートしない
+   * @brief テンソルの総和を求める. shape_ の指定した軸を軸として総和を求める
+   * @note 整数型のテンプレートにすることで, Sum(a, {}) が軸 0 ではなくすべての軸の総和になるようにしている
    * @param a テンソル
    * @param axis 軸
    * @return 総和
    */
-  static Tensor Sum(const Tensor &a, const std::size_t &axis);
+  template<typename I>
+    requires std::is_integral_v<I>
+  static BasicTensor Sum(const BasicTensor &a, const I &axis)
+  {
+    return Sum(a, std::vector<std::size_t>{static_cast<std::size_t>(axis)});
+  }
+
+  /**
+   * @brief 複数の軸に沿って総和を求める
+   * @note 次元数に制限はない. 縮約はメモリ上連続した順に行い, 複数の累積変数による SIMD 計算と
+   *       NAGATO_OPENMP による並列化を行う. 以下の縮約関数も同じ方法で計算する
+   * @param a テンソル
+   * @param axes 軸. 空の場合はすべての軸
+   * @param keepdims 真の場合は縮約した軸を長さ 1 として残す. 偽の場合に軸がなくなる場合の形状は {1}
+   * @return 総和
+   */
+  static BasicTensor Sum(const BasicTensor &a, const std::vector<std::size_t> &axes, bool keepdims = false);
+
+  /**
+   * @brief 複数の軸に沿って平均を求める
+   * @param a テンソル
+   * @param axes 軸. 空の場合はすべての軸
+   * @param keepdims 真の場合は縮約した軸を長さ 1 として残す
+   * @return 平均
+   */
+  static BasicTensor Mean(const BasicTensor &a, const std::vector<std::size_t> &axes, bool keepdims = false);
+
+  /**
+   * @brief 複数の軸に沿って最大値を求める
+   * @param a テンソル
+   * @param axes 軸. 空の場合はすべての軸
+   * @param keepdims 真の場合は縮約した軸を長さ 1 として残す
+   * @return 最大値
+   */
+  static BasicTensor Max(const BasicTensor &a, const std::vector<std::size_t> &axes, bool keepdims = false);
+
+  /**
+   * @brief 複数の軸に沿って最小値を求める
+   * @param a テンソル
+   * @param axes 軸. 空の場合はすべての軸
+   * @param keepdims 真の場合は縮約した軸を長さ 1 として残す
+   * @return 最小値
+   */
+  static BasicTensor Min(const BasicTensor &a, const std::vector<std::size_t> &axes, bool keepdims = false);
+
+  /**
+   * @brief 複数の軸に沿って総乗を求める
+   * @param a テンソル
+   * @param axes 軸. 空の場合はすべての軸
+   * @param keepdims 真の場合は縮約した軸を長さ 1 として残す
+   * @return 総乗
+   */
+  static BasicTensor Prod(const BasicTensor &a, const std::vector<std::size_t> &axes = {}, bool keepdims = false);
+
+  /**
+   * @brief 複数の軸に沿って分散を求める
+   * @note 平均を求めてから偏差の二乗和を求める (2 パス).
+   *       整数と真偽値のテンソルは compute_t (double) に変換してから計算し, その型で返す
+   * @param a テンソル
+   * @param axes 軸. 空の場合はすべての軸
+   * @param keepdims 真の場合は縮約した軸を長さ 1 として残す
+   * @param ddof 自由度の補正. 要素数から ddof を引いた値で割る (不偏分散の場合は 1)
+   * @return 分散
+   */
+  static BasicTensor<variance_type<T>> Var(const BasicTensor &a,
+                         const std::vector<std::size_t> &axes = {},
+                         bool keepdims = false,
+                         std::size_t ddof = 0);
+
+  /**
+   * @brief 指定した軸に沿って最大値のインデックスを求める
+   * @note 同じ値が複数ある場合は最初のインデックスを返す
+   * @param a テンソル
+   * @param axis 軸
+   * @param keepdims 真の場合は縮約した軸を長さ 1 として残す
+   * @return インデックス (index_type)
+   */
+  static BasicTensor<index_type> Argmax(const BasicTensor &a, std::size_t axis, bool keepdims = false);
+
+  /**
+   * @brief 指定した軸に沿って最小値のインデックスを求める
+   * @note 同じ値が複数ある場合は最初のインデックスを返す
+   * @param a テンソル
+   * @param axis 軸
+   * @param keepdims 真の場合は縮約した軸を長さ 1 として残す
+   * @return インデックス (index_type)
+   */
+  static BasicTensor<index_type> Argmin(const BasicTensor &a, std::size_t axis, bool keepdims = false);
 
   /**
    * @brief シグモイド関数を計算する
+   * @note 浮動小数点数はベクトル化したカーネル (VectorSigmoid) で計算する
    * @param a テンソル
    * @return シグモイド関数
    */
-  static Tensor Sigmoid(const Tensor &a);
+  static BasicTensor Sigmoid(const BasicTensor &a);
 
   /**
    * @brief ReLU関数を計算する
    * @param a テンソル
    * @return ReLU関数
    */
-  static Tensor ReLU(const Tensor &a);
+  static BasicTensor ReLU(const BasicTensor &a);
+
+  /**
+   * @brief シグモイド関数をその場で計算する
+   * @note 新しい領域を確保せず自身の要素を書き換える
+   * @return 自身
+   */
+  BasicTensor &Sigmoid_();
+
+  /**
+   * @brief ReLU関数をその場で計算する
+   * @note 新しい領域を確保せず自身の要素を書き換える
+   * @return 自身
+   */
+  BasicTensor &ReLU_();
+
+  /**
+   * @brief 指数関数をその場で計算する
+   * @note 新しい領域を確保せず自身の要素を書き換える
+   * @return 自身
+   */
+  BasicTensor &Exp_();
 
   /**
    * @brief 指数関数を計算する
-   * @param a テンソル
+   * @note 遅延評価される式を返す. 四則演算と組み合わせた式は代入時にまとめて計算する.
+   *       式の最も外側が Exp の場合 (Exp(a - b) など) は内側を評価してからベクトル化したカーネルで計算する
+   * @param a テンソルまたは式
    * @return 指数関数
    */
-  static Tensor Exp(const Tensor &a);
+  template<typename E>
+    requires TensorOperand<E>
+  static auto Exp(E &&a)
+  {
+    return MakeUnaryExpression(TensorExpOp{}, std::forward<E>(a));
+  }
 
   /**
    * @brief 対数関数を計算する. 0 に近い値は 1e-7 に修正して計算する
-   * @param a テンソル
+   * @note 遅延評価される式を返す. 四則演算と組み合わせた式は代入時にまとめて計算する.
+   *       式の最も外側が Log の場合は内側を評価してからベクトル化したカーネルで計算する
+   * @param a テンソルまたは式
    * @return 対数関数
    */
-  static Tensor Log(const Tensor &a);
+  template<typename E>
+    requires TensorOperand<E>
+  static auto Log(E &&a)
+  {
+    return MakeUnaryExpression(TensorLogOp{}, std::forward<E>(a));
+  }
 
   /**
    * @brief Softmax関数を計算する
-   * @note テンソルはベクトルとして扱う, 2次元テンソルの場合は行ごとにSoftmaxを計算する. ブロードキャストは行わない. 3次元以上のテンソルはサポートしない
+   * @note 最後の軸に沿って計算する (2次元テンソルの場合は行ごと). 浮動小数点数の exp は
+   *       ベクトル化したカーネル (VectorExp) で計算し, 精度は SetMathPrecision で切り替える
    * @param a テンソル
    * @return Softmax関数
    */
-  static Tensor Softmax(const Tensor &a);
+  static BasicTensor Softmax(const BasicTensor &a);
 
   /**
    * @brief テンソルを表示する
    * @param a テンソル
    */
-  static void Print(const Tensor &a);
+  static void Print(const BasicTensor &a);
 
   /**
    * @brief テンソルの形状を表示する
    * @param a テンソル
    */
-  static void PrintShape(const Tensor &a);
+  static void PrintShape(const BasicTensor &a);
 
   /**
    * @brief ２つのテンソルの形状が等しいかどうかをチェックする
@@ -225,7 +595,7 @@ public:
    * @param a テンソル
    * @param b テンソル
    */
-  static void IsSameShape(const Tensor &a, const Tensor &b);
+  static void IsSameShape(const BasicTensor &a, const BasicTensor &b);
 
   /**
    * @brief ブロードキャスト可能かどうかをチェックする
@@ -233,21 +603,42 @@ public:
    * @param b テンソル
    * @return ブロードキャスト可能な軸を返す. ブロードキャスト不可能な場合は-1を返す
    */
-  static int IsBroadcastable(const Tensor &a, const Tensor &b);
+  static int IsBroadcastable(const BasicTensor &a, const BasicTensor &b);
 
   /**
-   * @brief 乱数を生成する
+   * @brief [-1, 1) の一様乱数を生成する
+   * @note シードは std::random_device から毎回作る
    * @param shape 形状
    * @return 乱数
    */
-  static Tensor Random(const shape_type &shape);
+  static BasicTensor Random(const shape_type &shape);
 
   /**
-   * @brief 正規分布に従って乱数を生成する
+   * @brief シードを指定して [-1, 1) の一様乱数を生成する
+   * @note VectorRandomUniform (Philox4x32-10) で計算するため, 同じシードと形状からはスレッド数によらず同じ値ができる.
+   *       float と double 以外の要素型は compute_t で生成して変換する
    * @param shape 形状
+   * @param seed シード
    * @return 乱数
    */
-  static Tensor RandomNormal(const shape_type &shape);
+  static BasicTensor Random(const shape_type &shape, std::uint64_t seed);
+
+  /**
+   * @brief 標準正規分布に従って乱数を生成する
+   * @note シードは std::random_device から毎回作る
+   * @param shape 形状
+   * @return 乱数
+   */
+  static BasicTensor RandomNormal(const shape_type &shape);
+
+  /**
+   * @brief シードを指定して標準正規分布に従って乱数を生成する
+   * @note VectorRandomNormal (Philox4x32-10 と Box-Muller 法) で計算する
+   * @param shape 形状
+   * @param seed シード
+   * @return 乱数
+   */
+  static BasicTensor RandomNormal(const shape_type &shape, std::uint64_t seed);
 
   /**
    * @brief 配列からテンソルを作成する
@@ -255,28 +646,28 @@ public:
    * @param array 配列
    * @return テンソル
    */
-  static Tensor FromArray(const std::initializer_list<value_type> &array);
+  static BasicTensor FromArray(const std::initializer_list<value_type> &array);
 
   /**
    * @brief 配列からテンソルを作成する. 2次元テンソルとして作成する
    * @param array 配列
    * @return テンソル
    */
-  static Tensor FromArray(const std::initializer_list<std::initializer_list<value_type>> &array);
+  static BasicTensor FromArray(const std::initializer_list<std::initializer_list<value_type>> &array);
 
   /**
    * @brief 配列からテンソルを作成する. 3次元テンソルとして作成する
    * @param array 配列
    * @return テンソル
    */
-  static Tensor FromArray(const std::initializer_list<std::initializer_list<std::initializer_list<value_type>>> &array);
+  static BasicTensor FromArray(const std::initializer_list<std::initializer_list<std::initializer_list<value_type>>> &array);
 
   /**
    * @brief 配列からテンソルを作成する. 4次元テンソルとして作成する
    * @param array 配列
    * @return テンソル
    */
-  static Tensor FromArray(const std::initializer_list<std::initializer_list<std::initializer_list<std::initializer_list<value_type>>>> &array);
+  static BasicTensor FromArray(const std::initializer_list<std::initializer_list<std::initializer_list<std::initializer_list<value_type>>>> &array);
 
   /**
    * @brief テンソルの要素ごとに関数を適用する
@@ -284,7 +675,7 @@ public:
    * @param func 関数
    * @return 適用したテンソル
    */
-  static Tensor Transform(const Tensor &a, const std::function<value_type(value_type)> &func);
+  static BasicTensor Transform(const BasicTensor &a, const std::function<value_type(value_type)> &func);
 
   /**
    * @brief テンソルの転置を行う.
@@ -293,125 +684,213 @@ public:
    *  - 2次元テンソル : 転置する
    *  - 3次元テンソル : バッチ軸はそのままで, それ以外の軸を転置する
    *  - 4次元テンソル以降 : 転置せず例外を送出する
+   * ストライドを入れ替えたビューを返すためコピーは発生しない
    * @param a テンソル
    * @return 転置したテンソル
    */
-  static Tensor Transpose(const Tensor &a);
+  static BasicTensor Transpose(const BasicTensor &a);
 
   /**
    * @brief テンソルの軸を入れ替える
+   * @note ストライドを入れ替えたビューを返すためコピーは発生しない
    * @param a テンソル
    * @param axes 軸
    * @return 軸を入れ替えたテンソル
    */
-  static Tensor Transpose(const Tensor &a, const std::vector<std::size_t> &axes);
-
-  /**
-   * @brief 単項演算子のオーバーロード
-   * @note テンソルの要素ごとに演算を行う
-   */
-  Tensor operator-() const;
+  static BasicTensor Transpose(const BasicTensor &a, const std::vector<std::size_t> &axes);
 
   /**
    * @brief ２つのテンソルの値が等しいことを確認する
    * @param a テンソル
    * @param b テンソル
    */
-  static bool Equal(const Tensor &a, const Tensor &b);
+  static bool Equal(const BasicTensor &a, const BasicTensor &b);
 
   /**
    * @brief テンソルをCSVファイルから読み込む
+   * @note ファイルをメモリに割り当て, 改行の位置で分けたブロックごとに std::from_chars で
+   *       結果のテンソルへ直接変換する. NAGATO_OPENMP が有効な場合はブロックごとに並列に変換する.
+   *       空行と行末の \r は無視する. 値の前後の空白と引用符は取り除くが, 引用符の中の区切り文字には対応しない.
+   *       整数型のテンソルに小数を読み込む場合は小数点以下を切り捨てる
    * @param filename ファイル名
-   * @return テンソル
+   * @param options 読み込み設定
+   * @return 形状 {行数, 列数} のテンソル
    */
-  static Tensor FromCSV(const std::string &filename);
+  static BasicTensor FromCSV(const std::string &filename, const CSVOptions &options = CSVOptions());
 
   /**
    * @brief テンソルの平均を求める
+   * @note 1, 2 次元のテンソルは最後の軸に沿って, 3 次元以上のテンソルはすべての要素の平均を求める
    * @param a テンソル
    * @return 平均
    */
-  static Tensor Mean(const Tensor &a);
+  static BasicTensor Mean(const BasicTensor &a);
 
   /**
    * @brief テンソルの絶対値を求める
-   * @param a テンソル
+   * @note 遅延評価される式を返す. 四則演算と組み合わせた式は代入時にまとめて計算する
+   * @param a テンソルまたは式
    * @return 絶対値
    */
-  static Tensor Abs(const Tensor &a);
+  template<typename E>
+    requires TensorOperand<E>
+  static auto Abs(E &&a)
+  {
+    return MakeUnaryExpression(TensorAbsOp{}, std::forward<E>(a));
+  }
 
   /**
    * @brief 複数のテンソルを組み合わせて一つのテンソルにする (単一引数の場合はそのまま返す)
    * @param first テンソル
    * @return 組み合わせたテンソル
    */
-  static Tensor Concat(const Tensor &first)
+  static BasicTensor Concat(const BasicTensor &first)
   {
     return first;
   }
 
   /**
    * @brief 複数のテンソルを組み合わせて一つのテンソルにする
+   * @note Stack({first, rest...}, 0) と同じ
    * @param first 最初のテンソル
    * @param rest 残りのテンソル群
    * @return 組み合わせたテンソル
    */
   template <typename... Tensors>
-  static Tensor Concat(const Tensor &first, const Tensors &...rest)
+  static BasicTensor Concat(const BasicTensor &first, const Tensors &...rest)
   {
-    // すべてのテンソルの形状が同一であることをチェック
-    ((void)((rest.shape() == first.shape())
-            ? 0
-            : throw std::invalid_argument("all tensors must have the same shape")), ...);
-    
-    // 引数の数をテンソルの個数として登録し, その後に元の形状を登録する
-    shape_type new_shape = {1 + sizeof...(Tensors)};
-    new_shape.insert(new_shape.end(), first.shape().begin(), first.shape().end());
-
-    // 結果のテンソルを生成 (new_shape に基づいてストレージサイズも確保される)
-    Tensor result(new_shape);
-    std::size_t offset = 0;
-    
-    // 最初のテンソルのストレージをコピー
-    std::copy(first.storage().begin(), first.storage().end(),
-              result.storage().begin() + offset);
-    offset += first.storage().size();
-    
-    // 残りのテンソル群をコピー (fold expression により展開)
-    ((std::copy(rest.storage().begin(), rest.storage().end(),
-                result.storage().begin() + offset),
-      offset += rest.storage().size()), ...);
-    
-    return result;
+    return Stack({first, rest...}, 0);
   }
 
   /**
    * @brief 複数のテンソルを組み合わせて一つのテンソルにする
+   * @note Stack(tensors, 0) と同じ
    * @param tensors テンソル群
    * @return 組み合わせたテンソル
    */
-  static Tensor Concat(const std::vector<Tensor> &tensors);
+  static BasicTensor Concat(const std::vector<BasicTensor> &tensors);
+
+  /**
+   * @brief 既存の軸 axis に沿ってテンソルを連結する (numpy の concatenate)
+   * @note 軸 axis の長さは異なってもよく, それ以外の長さはすべて一致する必要がある.
+   *       結果を (軸より前の軸をまとめた outer, 残り) とみなし, 各入力の outer ごとの連続したブロックを
+   *       memcpy で結果の行の中の位置へコピーする. 連続していないビューは先に詰める.
+   *       NAGATO_OPENMP が有効な場合は (入力, outer) ごとに並列にコピーする
+   * @param tensors テンソル群
+   * @param axis 連結する軸
+   * @return 連結したテンソル
+   */
+  static BasicTensor Concat(const std::vector<BasicTensor> &tensors, std::size_t axis);
+
+  /**
+   * @brief 既存の軸 axis に沿ってテンソルを連結し, out に書き込む
+   * @note out の形状が結果と同じ場合は領域を確保せずにそのまま書き込む
+   * @param tensors テンソル群
+   * @param axis 連結する軸
+   * @param out 出力先. 形状が異なる場合は確保し直す
+   */
+  static void Concat(const std::vector<BasicTensor> &tensors, std::size_t axis, BasicTensor &out);
+
+  /**
+   * @brief 同じ形状のテンソルを新しい軸 axis に沿って積み重ねる (numpy の stack)
+   * @param tensors テンソル群. すべて同じ形状
+   * @param axis 新しい軸の位置. 0 以上 ndim 以下
+   * @return 軸 axis の長さが tensors.size() のテンソル
+   */
+  static BasicTensor Stack(const std::vector<BasicTensor> &tensors, std::size_t axis = 0);
+
+  /**
+   * @brief 同じ形状のテンソルを新しい軸 axis に沿って積み重ね, out に書き込む
+   * @note out の形状が結果と同じ場合は領域を確保せずにそのまま書き込む
+   * @param tensors テンソル群. すべて同じ形状
+   * @param axis 新しい軸の位置
+   * @param out 出力先. 形状が異なる場合は確保し直す
+   */
+  static void Stack(const std::vector<BasicTensor> &tensors, std::size_t axis, BasicTensor &out);
+
+  /**
+   * @brief 軸 axis に沿って indices の位置を取り出したテンソルを返す (numpy の take, PyTorch の index_select)
+   * @note 軸より前をまとめた outer, 軸より後をまとめた inner とみなし, 連続した inner 個の要素を 1 行として
+   *       memcpy で結果へコピーする. 同じ位置を複数回指定してもよい.
+   *       NAGATO_OPENMP が有効な場合は行ごとに並列にコピーする
+   * @param a テンソル
+   * @param axis 軸
+   * @param indices 取り出す位置
+   * @return 軸 axis の長さが indices.size() のテンソル
+   * @throws std::out_of_range 位置が軸の長さ以上の場合
+   */
+  static BasicTensor IndexSelect(const BasicTensor &a, std::size_t axis, const std::vector<std::size_t> &indices);
+
+  /**
+   * @brief 軸 axis に沿って indices の位置を取り出し, out に書き込む
+   * @note out の形状が結果と同じ場合は領域を確保せずにそのまま書き込むため, バッファを使い回せる
+   * @param a テンソル
+   * @param axis 軸
+   * @param indices 取り出す位置
+   * @param out 出力先. 形状が異なる場合は確保し直す
+   */
+  static void IndexSelect(const BasicTensor &a,
+                          std::size_t axis,
+                          const std::vector<std::size_t> &indices,
+                          BasicTensor &out);
+
+  /**
+   * @brief 要素ごとに軸 axis の位置を index で指定して取り出す (PyTorch の gather, numpy の take_along_axis)
+   * @note 3 次元の場合 axis = 1 なら out[i][j][k] = a[i][index[i][j][k]][k]
+   * @param a テンソル
+   * @param axis 軸
+   * @param index 位置. 軸 axis 以外の長さは a と同じ
+   * @return index と同じ形状のテンソル
+   * @throws std::out_of_range 位置が負または軸の長さ以上の場合
+   */
+  static BasicTensor Gather(const BasicTensor &a, std::size_t axis, const BasicTensor<std::int32_t> &index);
+
+  /**
+   * @brief IndexSelect の逆方向. src の行を out の軸 axis の indices の位置へ足し込む
+   * @note 同じ位置を複数回指定した場合はすべて足し込むため, IndexSelect の勾配の計算に使える.
+   *       NAGATO_OPENMP が有効な場合は軸以外の位置 (outer と inner の列のブロック) ごとに並列に足し込む
+   * @param out 足し込む先
+   * @param axis 軸
+   * @param indices 足し込む位置
+   * @param src 足し込む値. 軸 axis の長さが indices.size() で, それ以外は out と同じ形状
+   */
+  static void ScatterAdd(BasicTensor &out,
+                         std::size_t axis,
+                         const std::vector<std::size_t> &indices,
+                         const BasicTensor &src);
+
+  /**
+   * @brief Gather の逆方向. src の要素を out の index で指定した位置へ足し込む (PyTorch の scatter_add_)
+   * @param out 足し込む先
+   * @param axis 軸
+   * @param index 位置. src と同じ形状で, 軸 axis 以外の長さは out と同じ
+   * @param src 足し込む値
+   */
+  static void ScatterAdd(BasicTensor &out,
+                         std::size_t axis,
+                         const BasicTensor<std::int32_t> &index,
+                         const BasicTensor &src);
 
   /**
    * @brief テンソルの最大値を求める
    * @param a テンソル
    * @return 最大値
    */
-  static Tensor::value_type Max(const Tensor &a);
+  static value_type Max(const BasicTensor &a);
 
   /**
    * @brief テンソルの最小値を求める
    * @param a テンソル
    * @return 最小値
    */
-  static Tensor::value_type Min(const Tensor &a);
+  static value_type Min(const BasicTensor &a);
 
   /**
    * @brief テンソルに nan が含まれているかどうかをチェックする
    * @param a テンソル
    * @return nan が含まれているかどうか
    */
-  static bool IsNan(const Tensor &a);
+  static bool IsNan(const BasicTensor &a);
   
   /**
    * @brief テンソルを繰り返し展開する
@@ -419,7 +898,7 @@ public:
    * @param batch_size 繰り返し回数
    * @return 展開したテンソル
    */
-  static Tensor Tile(const Tensor &a, std::size_t batch_size);
+  static BasicTensor Tile(const BasicTensor &a, std::size_t batch_size);
 
  /**
   * @brief テンソルをパディングする
@@ -428,7 +907,7 @@ public:
   * @param pad パディング
   * @return パディングしたテンソル
   */
-  static Tensor Pad(const Tensor &a, const std::vector<std::pair<std::size_t, std::size_t>> &pad);
+  static BasicTensor Pad(const BasicTensor &a, const std::vector<std::pair<std::size_t, std::size_t>> &pad);
 private:
 
   /**
@@ -444,6 +923,37 @@ private:
    */
   void set_shape(const shape_type &shape);
 
+  /**
+   * @brief オフセットとストライドに従って要素を行優先の順に詰めたデータを作成する
+   * @return 詰めたデータ
+   */
+  storage_type pack() const;
+
+  /**
+   * @brief データ領域がこのテンソルだけのもので, かつ先頭から連続しているかどうか
+   * @return 連続している場合は真
+   */
+  bool is_dense() const;
+
+  /**
+   * @brief データ領域を連続した状態に詰め直す
+   */
+  void densify();
+
+  /**
+   * @brief 書き込みの前にデータ領域を単独で所有する状態にする (コピーオンライト)
+   */
+  void detach();
+
+  /**
+   * @brief 右辺を自身の形状にブロードキャストして二項演算を適用し, 結果を自身に書き込む
+   * @param op 二項演算
+   * @param rhs テンソルまたは式
+   * @return 自身
+   */
+  template<typename Op, typename E>
+  BasicTensor &compound_assign(Op op, const E &rhs);
+
   /**
    * @brief インデックスをストライドに応じて乗算して加算していく
    * @param indices インデックス
@@ -462,7 +972,7 @@ private:
 
       index += idx * strides_[i++];
     }
-    return index;
+    return offset_ + index;
   }
 
   /// テンソルの形状
@@ -471,123 +981,147 @@ private:
   /// テンソルのストライド
   strides_type strides_;
 
-  /// テンソルのデータ
-  storage_type storage_;
-};
-
-/**
- * @brief ブロードキャスト可能な二項演算を適用する
- * @param a テンソル
- * @param b テンソル
- * @param op 二項演算
- * @return 適用したテンソル
- */
-template <typename BinaryOp>
-Tensor ApplyBroadcastBinaryOp(const Tensor &a, const Tensor &b, BinaryOp op);
+  /// テンソルのデータ. 複数のテンソル (ビュー) で共有される
+  std::shared_ptr<storage_type> storage_;
 
-/**
- * @brief テンソルの加算
- * @param a テンソル
- * @param b テンソル
- * @return 加算結果
- */
-Tensor operator+(const Tensor &a, const Tensor &b);
-
-/**
- * @brief テンソルの加算
- * @param a テンソル
- * @param b スカラー
- * @return 加算結果
- */
-Tensor operator+(const Tensor &a, const Tensor::value_type &b);
-/**
- * @brief テンソルの加算
- * @param a テンソル
- * @param b スカラー
- * @return 加算結果
- */
-Tensor operator+(const Tensor::value_type &a, const Tensor &b);
+  /// データ領域の先頭から最初の要素までのオフセット
+  std::size_t offset_ = 0;
+};
 
-/**
- * @brief テンソルの減算
- * @param a テンソル
- * @param b テンソル
- * @return 減算結果
- */
-Tensor operator-(const Tensor &a, const Tensor &b);
+/// 倍精度浮動小数点数のテンソル
+using Tensor = BasicTensor<double>;
+
+/// 単精度浮動小数点数のテンソル
+using Tensorf = BasicTensor<float>;
+
+/// 32bit 整数のテンソル
+using Tensori = BasicTensor<std::int32_t>;
+
+/// 8bit 符号なし整数のテンソル
+using Tensoru8 = BasicTensor<std::uint8_t>;
+
+/// 真偽値のテンソル
+using Tensorb = BasicTensor<Bool>;
+
+/// 半精度浮動小数点数のテンソル
+using Tensorh = BasicTensor<Half>;
+
+/// bfloat16 のテンソル
+using Tensorbf16 = BasicTensor<BFloat16>;
+
+template<typename T>
+template<typename U>
+BasicTensor<T>::BasicTensor(const BasicTensor<U> &other)
+  : BasicTensor(other.template AsType<T>())
+{
+}
+
+template<typename T>
+template<typename E>
+  requires is_tensor_expression_v<E>
+BasicTensor<T>::BasicTensor(const E &expression)
+  : BasicTensor(expression.shape())
+{
+  EvaluateExpression(expression, data());
+}
+
+template<typename T>
+template<typename E>
+  requires is_tensor_expression_v<E>
+BasicTensor<T> &BasicTensor<T>::operator=(const E &expression)
+{
+  // 式が自身を参照していても形状が同じなら同じ位置の要素しか読まないため, そのまま上書きできる.
+  // データ領域が共有されている場合はビューから読まれる可能性があるため新しい領域に評価する
+  if (shape_ != expression.shape() || !is_dense() || storage_.use_count() > 1)
+  {
+    return *this = BasicTensor(expression);
+  }
+  EvaluateExpression(expression, storage_->data());
+  return *this;
+}
+
+template<typename T>
+template<typename Op, typename E>
+BasicTensor<T> &BasicTensor<T>::compound_assign(Op op, const E &rhs)
+{
+  if (BroadcastShape(shape_, rhs.shape()) != shape_)
+  {
+    throw std::invalid_argument("right-hand side must be broadcastable to the shape of the tensor");
+  }
 
-/**
- * @brief テンソルの減算
- * @param a テンソル
- * @param b スカラー
- * @return 減算結果
- */
-Tensor operator-(const Tensor &a, const Tensor::value_type &b);
+  // 右辺が自身のビューを含む場合も, 先に複製しておけば右辺は元の領域を読む
+  detach();
+  EvaluateExpression(MakeBinaryExpression(op, std::as_const(*this), rhs), storage_->data());
+  return *this;
+}
+
+template<typename T>
+template<typename U>
+BasicTensor<U> BasicTensor<T>::AsType() const
+{
+  BasicTensor<U> result(shape_);
+  const BasicTensor source = Contiguous();
+  const T *src = source.data();
+  U *dst = result.data();
+  const std::size_t size = source.size();
+  // float と 16 ビットの浮動小数点数の変換は SIMD の変換カーネルを使う
+  if constexpr (requires { VectorConvert(src, dst, size); })
+  {
+    VectorConvert(src, dst, size);
+    return result;
+  }
+#ifdef NAGATO_OPENMP
+  #pragma omp parallel for if (size > 65536)
+#endif
+  for (std::size_t i = 0; i < size; ++i)
+  {
+    if constexpr (std::is_same_v<T, Bool> || std::is_same_v<U, Bool>)
+    {
+      dst[i] = static_cast<U>(static_cast<compute_t<T>>(src[i]));
+    }
+    else
+    {
+      dst[i] = static_cast<U>(src[i]);
+    }
+  }
+  return result;
+}
 
 /**
- * @brief テンソルの減算
- * @param a テンソル
- * @param b スカラー
- * @return 減算結果
- */
-Tensor operator-(const Tensor::value_type &a, const Tensor &b);
-/**
- * @brief テンソルの乗算
+ * @brief ブロードキャスト可能な二項演算を適用する
  * @param a テンソル
  * @param b テンソル
- * @return 乗算結果
- */
-Tensor operator*(const Tensor &a, const Tensor &b);
-
-/**
- * @brief テンソルの乗算
- * @param a テンソル
- * @param b スカラー
- * @return 乗算結果
- */
-Tensor operator*(const Tensor &a, const Tensor::value_type &b);
-
-/**
- * @brief テンソルの乗算
- * @param a テンソル
- * @param b スカラー
- * @return 乗算結果
+ * @param op 二項演算. 戻り値の型が結果のテンソルの要素型になる
+ * @return 適用したテンソル
  */
-Tensor operator*(const Tensor::value_type &a, const Tensor &b);
+template <typename T, typename BinaryOp>
+auto ApplyBroadcastBinaryOp(const BasicTensor<T> &a, const BasicTensor<T> &b, BinaryOp op)
+  -> BasicTensor<std::invoke_result_t<BinaryOp, T, T>>
+{
+  return BasicTensor<std::invoke_result_t<BinaryOp, T, T>>(MakeBinaryExpression(op, a, b));
+}
 
 /**
- * @brief テンソルの除算
- * @note 0 で除算した場合, 0 になる
+ * @brief テンソルの等号演算子. 等しい場合は真, 等しくない場合は偽となる
  * @param a テンソル
  * @param b テンソル
- * @return 除算結果
+ * @return 等号演算結果 (1 要素 1 バイトのマスク)
  */
-Tensor operator/(const Tensor &a, const Tensor &b);
-
-/**
- * @brief テンソルの除算
- * @param a テンソル
- * @param b スカラー
- * @return 除算結果
- */
-Tensor operator/(const Tensor &a, const Tensor::value_type &b);  
-
-/**
- * @brief テンソルの除算
- * @param a テンソル
- * @param b スカラー
- * @return 除算結果
- */
-Tensor operator/(const Tensor::value_type &a, const Tensor &b);
-
+template<typename T>
+BasicTensor<Bool> operator==(const BasicTensor<T> &a, const BasicTensor<T> &b);
 
 /**
- * @brief テンソルの等号演算子. 等しい場合は1.0, 等しくない場合は0.0を返す
+ * @brief 16 ビットの浮動小数点数のテンソル同士の行列積を float で累積し, 丸めずに float のテンソルとして返す
+ * @note 混合精度の学習で, 低精度で保持した入力と重みから fp32 の出力や勾配を得るために使う.
+ *       形状の規則は Matmul と同じ (2次元は行列同士, 3次元はバッチ行列同士の積).
+ *       パッキングするときに float へ変換するため, 入力を float のテンソルに変換してから掛けるより読み込む量が少ない
  * @param a テンソル
  * @param b テンソル
- * @return 等号演算結果
+ * @return 行列の積
  */
-Tensor operator==(const Tensor &a, const Tensor &b);
+template<typename T>
+  requires is_reduced_precision_v<T>
+BasicTensor<float> MixedMatmul(const BasicTensor<T> &a, const BasicTensor<T> &b);
 
 
 }  // namespace nagato
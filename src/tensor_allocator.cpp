@@ -0,0 +1,252 @@
+//
+// Created by toru on 2026/10/17.
+//
+
+#include "tensor_allocator.hpp"
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <new>
+
+namespace nagato
+{
+namespace
+{
+/// 最小のサイズクラス (64 バイト) のビット数
+constexpr std::size_t kMinClassBits = 6;
+
+/// キャッシュする最大のサイズクラスのビット数. これより大きい領域は直接確保・解放する
+constexpr std::size_t kMaxClassBits = 40;
+
+/// 2 のべき乗の区間を分割する数
+constexpr std::size_t kSubClasses = 4;
+
+/// サイズクラスの数
+constexpr std::size_t kClassCount = (kMaxClassBits - kMinClassBits) * kSubClasses + 1;
+
+/// 確保する領域の境界
+constexpr std::size_t kPoolAlignment = 64;
+
+/**
+ * @brief 要求サイズのサイズクラスを求める
+ * @note 2^m < bytes <= 2^(m+1) のとき, 2^m + k * 2^(m-2) (k = 1..4) に切り上げる
+ */
+std::size_t SizeClass(std::size_t bytes)
+{
+  if (bytes <= (std::size_t(1) << kMinClassBits))
+  {
+    return 0;
+  }
+  const std::size_t m = std::bit_width(bytes - 1) - 1;
+  const std::size_t step = std::size_t(1) << (m - 2);
+  const std::size_t sub = (bytes - (std::size_t(1) << m) + step - 1) / step;
+  return (m - kMinClassBits) * kSubClasses + sub;
+}
+
+/**
+ * @brief サイズクラスのバイト数を求める
+ */
+std::size_t ClassSize(std::size_t index)
+{
+  if (index == 0)
+  {
+    return std::size_t(1) << kMinClassBits;
+  }
+  const std::size_t m = (index - 1) / kSubClasses + kMinClassBits;
+  const std::size_t sub = (index - 1) % kSubClasses + 1;
+  return (std::size_t(1) << m) + sub * (std::size_t(1) << (m - 2));
+}
+
+/**
+ * @brief 全スレッドで共有する統計と設定
+ */
+struct PoolCounters
+{
+  std::atomic<std::size_t> allocations{0};
+  std::atomic<std::size_t> cache_hits{0};
+  std::atomic<std::size_t> system_allocations{0};
+  std::atomic<std::size_t> system_frees{0};
+  std::atomic<std::size_t> bytes_in_use{0};
+  std::atomic<std::size_t> bytes_cached{0};
+  std::atomic<std::size_t> capacity{std::size_t(1) << 30};
+};
+
+PoolCounters &Counters()
+{
+  // スレッドの終了処理や静的なテンソルの破棄から参照されるため破棄しない
+  static auto *counters = new PoolCounters;
+  return *counters;
+}
+
+void *SystemAllocate(std::size_t bytes, std::size_t alignment)
+{
+  Counters().system_allocations.fetch_add(1, std::memory_order_relaxed);
+  return ::operator new(bytes, std::align_val_t(alignment));
+}
+
+void SystemFree(void *p, std::size_t alignment)
+{
+  Counters().system_frees.fetch_add(1, std::memory_order_relaxed);
+  ::operator delete(p, std::align_val_t(alignment));
+}
+
+/// スレッドのキャッシュが破棄された後かどうか
+thread_local bool thread_cache_destroyed = false;
+
+/**
+ * @brief スレッドごとのフリーリスト
+ */
+struct ThreadCache
+{
+  std::array<std::vector<void *>, kClassCount> free_lists;
+
+  /// このスレッドがキャッシュしているバイト数
+  std::size_t bytes = 0;
+
+  void Release()
+  {
+    for (std::size_t i = 0; i < kClassCount; ++i)
+    {
+      for (void *p : free_lists[i])
+      {
+        SystemFree(p, kPoolAlignment);
+      }
+      free_lists[i].clear();
+      free_lists[i].shrink_to_fit();
+    }
+    Counters().bytes_cached.fetch_sub(bytes, std::memory_order_relaxed);
+    bytes = 0;
+  }
+
+  ~ThreadCache()
+  {
+    Release();
+    thread_cache_destroyed = true;
+  }
+};
+
+/**
+ * @brief 呼び出したスレッドのキャッシュを取得する
+ * @return キャッシュ. スレッドの終了処理中で破棄済みの場合は nullptr
+ */
+ThreadCache *GetThreadCache()
+{
+  if (thread_cache_destroyed)
+  {
+    return nullptr;
+  }
+  thread_local ThreadCache cache;
+  return &cache;
+}
+
+/// 新しく作成するテンソルが使用するメモリリソース
+std::atomic<std::pmr::memory_resource *> current_resource{nullptr};
+} // namespace
+
+TensorMemoryPool &TensorMemoryPool::Instance()
+{
+  // 静的なテンソルが破棄されるまで使用するため破棄しない
+  static auto *pool = new TensorMemoryPool;
+  return *pool;
+}
+
+void *TensorMemoryPool::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+  auto &counters = Counters();
+  counters.allocations.fetch_add(1, std::memory_order_relaxed);
+
+  const std::size_t index = SizeClass(bytes);
+  if (alignment > kPoolAlignment || index >= kClassCount)
+  {
+    counters.bytes_in_use.fetch_add(bytes, std::memory_order_relaxed);
+    return SystemAllocate(bytes, std::max(alignment, kPoolAlignment));
+  }
+
+  const std::size_t size = ClassSize(index);
+  counters.bytes_in_use.fetch_add(size, std::memory_order_relaxed);
+  if (ThreadCache *cache = GetThreadCache(); cache && !cache->free_lists[index].empty())
+  {
+    void *p = cache->free_lists[index].back();
+    cache->free_lists[index].pop_back();
+    cache->bytes -= size;
+    counters.bytes_cached.fetch_sub(size, std::memory_order_relaxed);
+    counters.cache_hits.fetch_add(1, std::memory_order_relaxed);
+    return p;
+  }
+  return SystemAllocate(size, kPoolAlignment);
+}
+
+void TensorMemoryPool::do_deallocate(void *p, std::size_t bytes, std::size_t alignment)
+{
+  auto &counters = Counters();
+  const std::size_t index = SizeClass(bytes);
+  if (alignment > kPoolAlignment || index >= kClassCount)
+  {
+    counters.bytes_in_use.fetch_sub(bytes, std::memory_order_relaxed);
+    SystemFree(p, std::max(alignment, kPoolAlignment));
+    return;
+  }
+
+  const std::size_t size = ClassSize(index);
+  counters.bytes_in_use.fetch_sub(size, std::memory_order_relaxed);
+  ThreadCache *cache = GetThreadCache();
+  if (!cache || cache->bytes + size > counters.capacity.load(std::memory_order_relaxed))
+  {
+    SystemFree(p, kPoolAlignment);
+    return;
+  }
+  cache->free_lists[index].push_back(p);
+  cache->bytes += size;
+  counters.bytes_cached.fetch_add(size, std::memory_order_relaxed);
+}
+
+bool TensorMemoryPool::do_is_equal(const std::pmr::memory_resource &other) const noexcept
+{
+  return this == &other;
+}
+
+void TensorMemoryPool::Trim()
+{
+  if (ThreadCache *cache = GetThreadCache())
+  {
+    cache->Release();
+  }
+}
+
+TensorMemoryStats TensorMemoryPool::Stats() const
+{
+  const auto &counters = Counters();
+  TensorMemoryStats stats;
+  stats.allocations = counters.allocations.load(std::memory_order_relaxed);
+  stats.cache_hits = counters.cache_hits.load(std::memory_order_relaxed);
+  stats.system_allocations = counters.system_allocations.load(std::memory_order_relaxed);
+  stats.system_frees = counters.system_frees.load(std::memory_order_relaxed);
+  stats.bytes_in_use = counters.bytes_in_use.load(std::memory_order_relaxed);
+  stats.bytes_cached = counters.bytes_cached.load(std::memory_order_relaxed);
+  return stats;
+}
+
+void TensorMemoryPool::SetCapacity(std::size_t bytes)
+{
+  Counters().capacity.store(bytes, std::memory_order_relaxed);
+}
+
+std::size_t TensorMemoryPool::Capacity() const
+{
+  return Counters().capacity.load(std::memory_order_relaxed);
+}
+
+std::pmr::memory_resource *GetTensorMemoryResource()
+{
+  std::pmr::memory_resource *resource = current_resource.load(std::memory_order_acquire);
+  return resource ? resource : &TensorMemoryPool::Instance();
+}
+
+std::pmr::memory_resource *SetTensorMemoryResource(std::pmr::memory_resource *resource)
+{
+  std::pmr::memory_resource *previous = current_resource.exchange(resource, std::memory_order_acq_rel);
+  return previous ? previous : &TensorMemoryPool::Instance();
+}
+
+} // namespace nagato
@@ -0,0 +1,199 @@
+//
+// Created by toru on 2026/10/17.
+//
+
+#ifndef TENSOR_ALLOCATOR_HPP
+#define TENSOR_ALLOCATOR_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <memory_resource>
+#include <utility>
+#include <vector>
+
+namespace nagato
+{
+
+/**
+ * @brief テンソルのデータ領域の確保状況
+ */
+struct TensorMemoryStats
+{
+  /// データ領域の確保要求の回数
+  std::size_t allocations = 0;
+
+  /// キャッシュから再利用した回数
+  std::size_t cache_hits = 0;
+
+  /// システム (operator new) から確保した回数
+  std::size_t system_allocations = 0;
+
+  /// システムへ返却した回数
+  std::size_t system_frees = 0;
+
+  /// テンソルが使用中のバイト数 (サイズクラスに切り上げた値)
+  std::size_t bytes_in_use = 0;
+
+  /// キャッシュに保持しているバイト数
+  std::size_t bytes_cached = 0;
+};
+
+/**
+ * @brief テンソルのデータ領域をサイズクラスごとにキャッシュするメモリリソース
+ * @note 要求サイズを 2 のべき乗を 4 分割したサイズクラスに切り上げ, 解放された領域はスレッドごとの
+ *       フリーリストに保持して同じサイズクラスの次の確保で再利用する. フリーリストはスレッドローカルのため
+ *       確保・解放でロックを取らない. 学習のように同じ形状の確保と解放を繰り返す場合, 2 回目以降の反復では
+ *       システムの確保・解放が発生しない.
+ *       領域は 64 バイト境界に揃えて確保する
+ */
+class TensorMemoryPool : public std::pmr::memory_resource
+{
+  public:
+    /**
+     * @brief プロセス全体で共有するインスタンスを取得する
+     * @return インスタンス
+     */
+    static TensorMemoryPool &Instance();
+
+    /**
+     * @brief 呼び出したスレッドのキャッシュを解放し, システムへ返却する
+     */
+    void Trim();
+
+    /**
+     * @brief 確保状況を取得する
+     * @return 確保状況
+     */
+    TensorMemoryStats Stats() const;
+
+    /**
+     * @brief スレッドごとにキャッシュする最大バイト数を設定する
+     * @note 上限を超える分の解放はキャッシュせずにシステムへ返却する. 既定値は 1 GiB
+     * @param bytes 最大バイト数
+     */
+    void SetCapacity(std::size_t bytes);
+
+    /**
+     * @brief スレッドごとにキャッシュする最大バイト数を取得する
+     * @return 最大バイト数
+     */
+    std::size_t Capacity() const;
+
+  private:
+    TensorMemoryPool() = default;
+
+    void *do_allocate(std::size_t bytes, std::size_t alignment) override;
+
+    void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override;
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override;
+};
+
+/**
+ * @brief 新しく作成するテンソルが使用するメモリリソースを取得する
+ * @return メモリリソース. 既定では TensorMemoryPool
+ */
+std::pmr::memory_resource *GetTensorMemoryResource();
+
+/**
+ * @brief 新しく作成するテンソルが使用するメモリリソースを設定する
+ * @note 設定前に作成したテンソルは確保したリソースへ返却するため, 途中で切り替えても安全である.
+ *       キャッシュを無効にする場合は std::pmr::new_delete_resource() を設定する
+ * @param resource メモリリソース. nullptr の場合は TensorMemoryPool に戻す
+ * @return 設定前のメモリリソース
+ */
+std::pmr::memory_resource *SetTensorMemoryResource(std::pmr::memory_resource *resource);
+
+/**
+ * @brief テンソルのデータ領域を確保するアロケータ
+ * @note 作成時点の GetTensorMemoryResource() を保持し, そのリソースから確保・解放する
+ * @tparam T 要素型
+ */
+template<typename T>
+class TensorAllocator
+{
+  public:
+    using value_type = T;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    TensorAllocator() noexcept : resource_(GetTensorMemoryResource())
+    {
+    }
+
+    explicit TensorAllocator(std::pmr::memory_resource *resource) noexcept : resource_(resource)
+    {
+    }
+
+    template<typename U>
+    TensorAllocator(const TensorAllocator<U> &other) noexcept : resource_(other.resource())
+    {
+    }
+
+    T *allocate(std::size_t n)
+    {
+      return static_cast<T *>(resource_->allocate(n * sizeof(T), kAlignment));
+    }
+
+    void deallocate(T *p, std::size_t n) noexcept
+    {
+      resource_->deallocate(p, n * sizeof(T), kAlignment);
+    }
+
+    /**
+     * @brief 要素を構築する
+     * @note 引数がない場合は値初期化ではなく既定初期化とし, 数値型の要素を 0 で埋めない.
+     *       確保した直後にすべての要素を書き込む場合の無駄な書き込みを省き,
+     *       ファイルを割り当てた領域の内容を保ったまま配列にできるようにする. 0 が必要な場合は値を明示する
+     */
+    template<typename U, typename... Args>
+    void construct(U *p, Args &&...args)
+    {
+      if constexpr (sizeof...(Args) == 0)
+      {
+        ::new (static_cast<void *>(p)) U;
+      }
+      else
+      {
+        ::new (static_cast<void *>(p)) U(std::forward<Args>(args)...);
+      }
+    }
+
+    /**
+     * @brief コンテナのコピーは現在のリソースから確保する
+     */
+    TensorAllocator select_on_container_copy_construction() const noexcept
+    {
+      return TensorAllocator();
+    }
+
+    std::pmr::memory_resource *resource() const noexcept
+    {
+      return resource_;
+    }
+
+    template<typename U>
+    bool operator==(const TensorAllocator<U> &other) const noexcept
+    {
+      return *resource_ == *other.resource();
+    }
+
+  private:
+    /// SIMD のロードがキャッシュラインをまたがないように揃える
+    static constexpr std::size_t kAlignment = alignof(std::max_align_t) > 64 ? alignof(std::max_align_t) : 64;
+
+    std::pmr::memory_resource *resource_;
+};
+
+/**
+ * @brief アロケータの異なる配列と要素を比較する (テンソルのデータと std::vector の比較用)
+ */
+template<typename T>
+bool operator==(const std::vector<T, TensorAllocator<T> > &a, const std::vector<T> &b)
+{
+  return std::equal(a.begin(), a.end(), b.begin(), b.end());
+}
+
+} // namespace nagato
+
+#endif // TENSOR_ALLOCATOR_HPP
@@ -0,0 +1,866 @@
+//
+// Created by toru on 2026/10/17.
+//
+
+#ifndef TENSOR_EXPRESSION_HPP
+#define TENSOR_EXPRESSION_HPP
+
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "dtype.hpp"
+#include "small_vector.hpp"
+#include "vector_math.hpp"
+
+namespace nagato
+{
+
+template<typename T>
+class BasicTensor;
+
+/**
+ * @brief 型がテンソル (BasicTensor) かどうか
+ */
+template<typename T>
+struct is_basic_tensor : std::false_type
+{
+};
+
+template<typename T>
+struct is_basic_tensor<BasicTensor<T> > : std::true_type
+{
+};
+
+template<typename T>
+inline constexpr bool is_basic_tensor_v = is_basic_tensor<std::remove_cvref_t<T> >::value;
+
+/**
+ * @brief 型が遅延評価される式 (TensorUnaryExpression など) かどうか
+ */
+template<typename E>
+struct is_tensor_expression : std::false_type
+{
+};
+
+template<typename E>
+inline constexpr bool is_tensor_expression_v = is_tensor_expression<std::remove_cvref_t<E> >::value;
+
+/**
+ * @brief テンソルの演算子の被演算子になれる型 (テンソルまたは式)
+ */
+template<typename E>
+concept TensorOperand = is_basic_tensor_v<E> || is_tensor_expression_v<E>;
+
+/**
+ * @brief テンソルの演算子の被演算子になれるスカラー型
+ */
+template<typename S>
+concept TensorScalar = std::is_arithmetic_v<std::remove_cvref_t<S> > ||
+                       std::is_same_v<std::remove_cvref_t<S>, Bool> ||
+                       is_reduced_precision_v<std::remove_cvref_t<S> >;
+
+/**
+ * @brief 式の中で被演算子を保持する型
+ * @note 左辺値のテンソルは参照で保持し, 右辺値のテンソルと式は値で保持する.
+ *       そのため a + b のような式を auto で受け取った場合, a と b はその式より長く生存している必要がある
+ */
+template<typename E>
+using expression_closure_t = std::conditional_t<
+  std::is_lvalue_reference_v<E> && is_basic_tensor_v<E>,
+  const std::remove_cvref_t<E> &,
+  std::remove_cvref_t<E> >;
+
+/**
+ * @brief ブロードキャスト後の形状を計算する
+ * @note スカラーの形状は空として扱い, 相手の形状をそのまま返す
+ * @param a 形状
+ * @param b 形状
+ * @return ブロードキャスト後の形状. ブロードキャストできない場合は例外を送出する
+ */
+inline Shape BroadcastShape(const Shape &a, const Shape &b)
+{
+  const std::size_t rank = std::max(a.size(), b.size());
+  Shape result(rank, 1);
+  for (std::size_t i = 0; i < rank; ++i)
+  {
+    const std::size_t dim_a = i < a.size() ? a[a.size() - 1 - i] : 1;
+    const std::size_t dim_b = i < b.size() ? b[b.size() - 1 - i] : 1;
+    if (dim_a != dim_b && dim_a != 1 && dim_b != 1)
+    {
+      throw std::invalid_argument("Tensors are not broadcastable");
+    }
+    result[rank - 1 - i] = dim_a == 1 ? dim_b : dim_a;
+  }
+  return result;
+}
+
+/**
+ * @brief テンソルの要素を読み出す評価器
+ * @note 出力の形状に合わせてブロードキャストする軸のストライドを 0 にしたストライドを持つ.
+ *       行 (最後の軸) ごとに seek で先頭位置を合わせてから at で読み出す
+ */
+template<typename T>
+struct TensorLeafEvaluator
+{
+  using value_type = T;
+
+  const T *base = nullptr;
+  const T *row = nullptr;
+  Shape strides;
+  std::size_t inner_stride = 0;
+  value_type broadcast_value{};
+  bool flat = false;
+
+  bool is_flat() const
+  {
+    return flat;
+  }
+
+  value_type flat_at(std::size_t i) const
+  {
+    return base[i];
+  }
+
+  bool is_mergeable(std::size_t outer, std::size_t inner, std::size_t inner_dim) const
+  {
+    return strides[outer] == strides[inner] * inner_dim;
+  }
+
+  void collapse(const Shape &axes)
+  {
+    Shape collapsed(axes.size());
+    for (std::size_t i = 0; i < axes.size(); ++i)
+    {
+      collapsed[i] = strides[axes[i]];
+    }
+    strides = std::move(collapsed);
+    inner_stride = strides.back();
+  }
+
+  bool is_unit_inner() const
+  {
+    return inner_stride <= 1;
+  }
+
+  void seek(const std::size_t *index, std::size_t outer_rank)
+  {
+    std::size_t offset = 0;
+    for (std::size_t d = 0; d < outer_rank; ++d)
+    {
+      offset += index[d] * strides[d];
+    }
+    row = base + offset;
+    if (inner_stride == 0)
+    {
+      broadcast_value = *row;
+    }
+  }
+
+  /**
+   * @brief 行の j 番目の要素を読み出す
+   * @tparam Unit 真の場合は最後の軸のストライドが 0 か 1 であることを前提にし, 連続したロードで読み出す
+   */
+  template<bool Unit>
+  value_type at(std::size_t j) const
+  {
+    if constexpr (Unit)
+    {
+      return inner_stride == 0 ? broadcast_value : row[j];
+    }
+    else
+    {
+      return row[j * inner_stride];
+    }
+  }
+};
+
+/**
+ * @brief テンソルの評価器を作成する
+ * @param tensor テンソル
+ * @param shape 出力の形状
+ * @return 評価器
+ */
+template<typename T>
+TensorLeafEvaluator<T> MakeEvaluator(const BasicTensor<T> &tensor, const Shape &shape)
+{
+  TensorLeafEvaluator<T> evaluator;
+  evaluator.base = tensor.data();
+  evaluator.row = evaluator.base;
+  evaluator.flat = tensor.shape() == shape && tensor.IsContiguous();
+
+  // 先頭側に補完した軸と長さ 1 の軸はストライドを 0 にしてブロードキャストする
+  const auto &tensor_shape = tensor.shape();
+  const auto &tensor_strides = tensor.strides();
+  const std::size_t pad = shape.size() - tensor_shape.size();
+  evaluator.strides.assign(shape.size(), 0);
+  for (std::size_t i = 0; i < tensor_shape.size(); ++i)
+  {
+    evaluator.strides[pad + i] = tensor_shape[i] == 1 ? 0 : tensor_strides[i];
+  }
+  evaluator.inner_stride = evaluator.strides.back();
+  return evaluator;
+}
+
+/**
+ * @brief スカラーを表す式
+ */
+template<typename T>
+class TensorScalarExpression
+{
+  public:
+    using value_type = T;
+
+    explicit TensorScalarExpression(const T &value) : value_(value)
+    {
+    }
+
+    const Shape &shape() const
+    {
+      static const Shape empty;
+      return empty;
+    }
+
+    struct Evaluator
+    {
+      using value_type = T;
+      T value;
+
+      bool is_flat() const
+      {
+        return true;
+      }
+
+      value_type flat_at(std::size_t) const
+      {
+        return value;
+      }
+
+      bool is_mergeable(std::size_t, std::size_t, std::size_t) const
+      {
+        return true;
+      }
+
+      void collapse(const Shape &)
+      {
+      }
+
+      bool is_unit_inner() const
+      {
+        return true;
+      }
+
+      void seek(const std::size_t *, std::size_t)
+      {
+      }
+
+      template<bool Unit>
+      value_type at(std::size_t) const
+      {
+        return value;
+      }
+    };
+
+    Evaluator evaluator(const Shape &) const
+    {
+      return Evaluator{value_};
+    }
+
+  private:
+    T value_;
+};
+
+/**
+ * @brief 単項演算の式
+ * @tparam Op 要素ごとの演算. 被演算子の要素型を受け取り, 戻り値の型が式の要素型になる
+ * @tparam E 被演算子の型
+ */
+template<typename Op, typename E>
+class TensorUnaryExpression
+{
+  public:
+    using operand_value_type = typename std::remove_cvref_t<E>::value_type;
+    using value_type = std::invoke_result_t<Op, operand_value_type>;
+
+    TensorUnaryExpression(Op op, E &&operand)
+      : op_(op),
+        operand_(std::forward<E>(operand))
+    {
+    }
+
+    const Shape &shape() const
+    {
+      return operand_.shape();
+    }
+
+    const std::remove_cvref_t<E> &operand() const
+    {
+      return operand_;
+    }
+
+    template<typename Inner>
+    struct Evaluator
+    {
+      using value_type = typename TensorUnaryExpression::value_type;
+      using operand_value_type = typename TensorUnaryExpression::operand_value_type;
+      Op op;
+      Inner inner;
+
+      bool is_flat() const
+      {
+        return inner.is_flat();
+      }
+
+      value_type flat_at(std::size_t i) const
+      {
+        return op(static_cast<operand_value_type>(inner.flat_at(i)));
+      }
+
+      bool is_mergeable(std::size_t outer, std::size_t inner_axis, std::size_t inner_dim) const
+      {
+        return inner.is_mergeable(outer, inner_axis, inner_dim);
+      }
+
+      void collapse(const Shape &axes)
+      {
+        inner.collapse(axes);
+      }
+
+      bool is_unit_inner() const
+      {
+        return inner.is_unit_inner();
+      }
+
+      void seek(const std::size_t *index, std::size_t outer_rank)
+      {
+        inner.seek(index, outer_rank);
+      }
+
+      template<bool Unit>
+      value_type at(std::size_t j) const
+      {
+        return op(static_cast<operand_value_type>(inner.template at<Unit>(j)));
+      }
+    };
+
+    auto evaluator(const Shape &shape) const
+    {
+      using Inner = decltype(MakeEvaluator(operand_, shape));
+      return Evaluator<Inner>{op_, MakeEvaluator(operand_, shape)};
+    }
+
+  private:
+    Op op_;
+    expression_closure_t<E> operand_;
+};
+
+/**
+ * @brief 二項演算の式. 被演算子はブロードキャストされる
+ * @tparam Op 要素ごとの演算. 昇格した要素型を 2 つ受け取り, 戻り値の型が式の要素型になる
+ * @tparam L 左辺の型
+ * @tparam R 右辺の型
+ */
+template<typename Op, typename L, typename R>
+class TensorBinaryExpression
+{
+  public:
+    using operand_value_type = promote_t<typename std::remove_cvref_t<L>::value_type,
+                                         typename std::remove_cvref_t<R>::value_type>;
+    using value_type = std::invoke_result_t<Op, operand_value_type, operand_value_type>;
+
+    TensorBinaryExpression(Op op, L &&lhs, R &&rhs)
+      : op_(op),
+        lhs_(std::forward<L>(lhs)),
+        rhs_(std::forward<R>(rhs)),
+        shape_(BroadcastShape(lhs_.shape(), rhs_.shape()))
+    {
+    }
+
+    const Shape &shape() const
+    {
+      return shape_;
+    }
+
+    template<typename Left, typename Right>
+    struct Evaluator
+    {
+      using value_type = typename TensorBinaryExpression::value_type;
+      using operand_value_type = typename TensorBinaryExpression::operand_value_type;
+      Op op;
+      Left left;
+      Right right;
+
+      bool is_flat() const
+      {
+        return left.is_flat() && right.is_flat();
+      }
+
+      value_type flat_at(std::size_t i) const
+      {
+        return op(static_cast<operand_value_type>(left.flat_at(i)), static_cast<operand_value_type>(right.flat_at(i)));
+      }
+
+      bool is_mergeable(std::size_t outer, std::size_t inner, std::size_t inner_dim) const
+      {
+        return left.is_mergeable(outer, inner, inner_dim) && right.is_mergeable(outer, inner, inner_dim);
+      }
+
+      void collapse(const Shape &axes)
+      {
+        left.collapse(axes);
+        right.collapse(axes);
+      }
+
+      bool is_unit_inner() const
+      {
+        return left.is_unit_inner() && right.is_unit_inner();
+      }
+
+      void seek(const std::size_t *index, std::size_t outer_rank)
+      {
+        left.seek(index, outer_rank);
+        right.seek(index, outer_rank);
+      }
+
+      template<bool Unit>
+      value_type at(std::size_t j) const
+      {
+        return op(static_cast<operand_value_type>(left.template at<Unit>(j)),
+                  static_cast<operand_value_type>(right.template at<Unit>(j)));
+      }
+    };
+
+    auto evaluator(const Shape &shape) const
+    {
+      using Left = decltype(MakeEvaluator(lhs_, shape));
+      using Right = decltype(MakeEvaluator(rhs_, shape));
+      return Evaluator<Left, Right>{op_, MakeEvaluator(lhs_, shape), MakeEvaluator(rhs_, shape)};
+    }
+
+  private:
+    Op op_;
+    expression_closure_t<L> lhs_;
+    expression_closure_t<R> rhs_;
+    Shape shape_;
+};
+
+template<typename T>
+struct is_tensor_expression<TensorScalarExpression<T> > : std::true_type
+{
+};
+
+template<typename Op, typename E>
+struct is_tensor_expression<TensorUnaryExpression<Op, E> > : std::true_type
+{
+};
+
+template<typename Op, typename L, typename R>
+struct is_tensor_expression<TensorBinaryExpression<Op, L, R> > : std::true_type
+{
+};
+
+/**
+ * @brief 式の評価器を作成する
+ * @param expression 式
+ * @param shape 出力の形状
+ * @return 評価器
+ */
+template<typename E>
+  requires is_tensor_expression_v<E>
+auto MakeEvaluator(const E &expression, const Shape &shape)
+{
+  return expression.evaluator(shape);
+}
+
+/**
+ * @brief ブロードキャストを含む式を行ごとに評価する
+ * @tparam Unit 真の場合はすべての被演算子の最後の軸のストライドが 0 か 1 である
+ * @param evaluator 軸をまとめた後の評価器
+ * @param shape 軸をまとめた後の形状
+ * @param dst 出力先
+ */
+template<bool Unit, typename T, typename Evaluator>
+void EvaluateRows(const Evaluator &evaluator, const Shape &shape, T *dst)
+{
+  const std::size_t rank = shape.size();
+  const std::size_t inner = shape[rank - 1];
+  std::size_t rows = 1;
+  for (std::size_t d = 0; d + 1 < rank; ++d)
+  {
+    rows *= shape[d];
+  }
+
+  // 出力をおよそ kBlockElements 要素ずつのブロックに分けて並列化する.
+  // 行が短い場合は複数の行を, 長い場合は行を分割したものを 1 ブロックとする
+  constexpr std::size_t kBlockElements = 4096;
+  const std::size_t rows_per_block = std::max<std::size_t>(1, kBlockElements / inner);
+  const std::size_t chunks_per_row = (inner + kBlockElements - 1) / kBlockElements;
+  const std::size_t chunk = chunks_per_row > 1 ? kBlockElements : inner;
+  const std::size_t blocks = chunks_per_row > 1
+                               ? rows * chunks_per_row
+                               : (rows + rows_per_block - 1) / rows_per_block;
+
+#ifdef NAGATO_OPENMP
+  #pragma omp parallel for if (rows * inner > 65536)
+#endif
+  for (std::size_t block = 0; block < blocks; ++block)
+  {
+    // 評価器は行の位置を持つためブロックごとに複製する
+    auto local = evaluator;
+    const std::size_t row_begin = chunks_per_row > 1 ? block / chunks_per_row : block * rows_per_block;
+    const std::size_t row_end = chunks_per_row > 1 ? row_begin + 1 : std::min(rows, row_begin + rows_per_block);
+    const std::size_t column_begin = chunks_per_row > 1 ? (block % chunks_per_row) * chunk : 0;
+    const std::size_t column_end = std::min(inner, column_begin + chunk);
+
+    // 先頭の行番号を外側の軸のインデックスに変換し, 以降は 1 行ずつ繰り上げる
+    Shape index(rank, 0);
+    std::size_t rest = row_begin;
+    for (std::size_t d = rank - 1; d > 0; --d)
+    {
+      index[d - 1] = rest % shape[d - 1];
+      rest /= shape[d - 1];
+    }
+
+    for (std::size_t r = row_begin; r < row_end; ++r)
+    {
+      local.seek(index.data(), rank - 1);
+      T *out = dst + r * inner;
+      for (std::size_t j = column_begin; j < column_end; ++j)
+      {
+        out[j] = static_cast<T>(local.template at<Unit>(j));
+      }
+
+      for (std::size_t d = rank - 1; d > 0; --d)
+      {
+        if (++index[d - 1] < shape[d - 1])
+        {
+          break;
+        }
+        index[d - 1] = 0;
+      }
+    }
+  }
+}
+
+/**
+ * @brief 式を評価して出力先に書き込む
+ * @note 被演算子がすべて出力と同じ形状で連続している場合は 1 重のループで計算する (ベクトル化しやすい).
+ *       それ以外は長さ 1 の軸を除き, すべての被演算子でメモリ上連続している隣り合う軸を 1 つにまとめてから,
+ *       最後の軸を内側のループとして行ごとに計算する. 内側の軸のストライドが 0 (列方向のブロードキャスト) か
+ *       1 (行方向のブロードキャストや連続した行) の被演算子だけであれば連続したロードで計算する.
+ *       NAGATO_OPENMP が有効な場合はどちらも並列に計算する
+ * @param expression 式
+ * @param dst 出力先. 式の形状と同じ要素数の連続した領域
+ */
+template<typename T, typename E>
+void EvaluateExpression(const E &expression, T *dst)
+{
+  const auto &shape = expression.shape();
+  std::size_t size = 1;
+  for (const auto dim : shape)
+  {
+    size *= dim;
+  }
+  if (size == 0 || shape.empty())
+  {
+    return;
+  }
+
+  auto evaluator = MakeEvaluator(expression, shape);
+
+  if (evaluator.is_flat())
+  {
+#ifdef NAGATO_OPENMP
+    #pragma omp parallel for if (size > 65536)
+#endif
+    for (std::size_t i = 0; i < size; ++i)
+    {
+      dst[i] = static_cast<T>(evaluator.flat_at(i));
+    }
+    return;
+  }
+
+  // 長さ 1 の軸を除き, まとめられる軸を 1 つにする. axes には各まとまりの最後の軸を記録する
+  Shape collapsed_shape;
+  Shape axes;
+  for (std::size_t d = 0; d < shape.size(); ++d)
+  {
+    if (shape[d] == 1)
+    {
+      continue;
+    }
+    if (!axes.empty() && evaluator.is_mergeable(axes.back(), d, shape[d]))
+    {
+      collapsed_shape.back() *= shape[d];
+      axes.back() = d;
+    }
+    else
+    {
+      collapsed_shape.push_back(shape[d]);
+      axes.push_back(d);
+    }
+  }
+  if (axes.empty())
+  {
+    collapsed_shape.push_back(1);
+    axes.push_back(shape.size() - 1);
+  }
+  evaluator.collapse(axes);
+
+  if (evaluator.is_unit_inner())
+  {
+    EvaluateRows<true>(evaluator, collapsed_shape, dst);
+  }
+  else
+  {
+    EvaluateRows<false>(evaluator, collapsed_shape, dst);
+  }
+}
+
+/**
+ * @brief 最も外側が配列ごとの計算 (Op::Apply) を持つ単項演算の式を評価する
+ * @note 被演算子を出力先に評価してから Op::Apply でまとめて計算する.
+ *       被演算子が出力と同じ形状の連続したテンソルの場合は直接 Op::Apply に渡す
+ * @param expression 式
+ * @param dst 出力先. 式の形状と同じ要素数の連続した領域
+ */
+template<typename T, typename Op, typename E>
+  requires std::is_same_v<typename TensorUnaryExpression<Op, E>::operand_value_type, T> &&
+           requires(const T *x, T *y, std::size_t n) { Op::Apply(x, y, n); }
+void EvaluateExpression(const TensorUnaryExpression<Op, E> &expression, T *dst)
+{
+  const auto &shape = expression.shape();
+  std::size_t size = 1;
+  for (const auto dim : shape)
+  {
+    size *= dim;
+  }
+  if (size == 0 || shape.empty())
+  {
+    return;
+  }
+
+  const auto &operand = expression.operand();
+
+  if constexpr (is_basic_tensor_v<E>)
+  {
+    if (operand.IsContiguous())
+    {
+      Op::Apply(operand.data(), dst, size);
+      return;
+    }
+  }
+  EvaluateExpression(operand, dst);
+  Op::Apply(dst, dst, size);
+}
+
+/**
+ * @brief 加算
+ */
+struct TensorAddOp
+{
+  template<typename V>
+  V operator()(const V x, const V y) const
+  {
+    return static_cast<V>(x + y);
+  }
+};
+
+/**
+ * @brief 減算
+ */
+struct TensorSubtractOp
+{
+  template<typename V>
+  V operator()(const V x, const V y) const
+  {
+    return static_cast<V>(x - y);
+  }
+};
+
+/**
+ * @brief 乗算
+ */
+struct TensorMultiplyOp
+{
+  template<typename V>
+  V operator()(const V x, const V y) const
+  {
+    return static_cast<V>(x * y);
+  }
+};
+
+/**
+ * @brief 除算
+ * @note 浮動小数点数 (Half, BFloat16 を含む) の場合は分母に 1e-7 を加えて計算する. 整数の場合, 0 で除算すると 0 になる
+ */
+struct TensorDivideOp
+{
+  template<typename V>
+  V operator()(const V x, const V y) const
+  {
+    if constexpr (std::is_floating_point_v<V> || is_reduced_precision_v<V>)
+    {
+      return static_cast<V>(x / (y + static_cast<V>(1e-7)));
+    }
+    else
+    {
+      return y == V(0) ? V(0) : static_cast<V>(x / y);
+    }
+  }
+};
+
+/**
+ * @brief 符号反転
+ */
+struct TensorNegateOp
+{
+  template<typename V>
+  V operator()(const V x) const
+  {
+    return static_cast<V>(-x);
+  }
+};
+
+/**
+ * @brief 指数関数. compute_t で計算する
+ * @note Apply は連続した配列をベクトル化したカーネルでまとめて計算する
+ */
+struct TensorExpOp
+{
+  template<typename V>
+  V operator()(const V x) const
+  {
+    return static_cast<V>(std::exp(static_cast<compute_t<V> >(x)));
+  }
+
+  template<typename V>
+    requires std::is_floating_point_v<V>
+  static void Apply(const V *x, V *y, std::size_t n)
+  {
+    VectorExp(x, y, n);
+  }
+};
+
+/**
+ * @brief 対数関数. 0 に近い値は 1e-7 を加えて計算する
+ * @note Apply は連続した配列をベクトル化したカーネルでまとめて計算する
+ */
+struct TensorLogOp
+{
+  template<typename V>
+  V operator()(const V x) const
+  {
+    return static_cast<V>(std::log(static_cast<compute_t<V> >(x) + 1e-7));
+  }
+
+  template<typename V>
+    requires std::is_floating_point_v<V>
+  static void Apply(const V *x, V *y, std::size_t n)
+  {
+    for (std::size_t i = 0; i < n; ++i)
+    {
+      y[i] = x[i] + static_cast<V>(1e-7);
+    }
+    VectorLog(y, y, n);
+  }
+};
+
+/**
+ * @brief 絶対値
+ */
+struct TensorAbsOp
+{
+  template<typename V>
+  V operator()(const V x) const
+  {
+    if constexpr (std::is_signed_v<V>)
+    {
+      return static_cast<V>(std::abs(x));
+    }
+    else
+    {
+      return x;
+    }
+  }
+};
+
+/**
+ * @brief 単項演算の式を作成する
+ */
+template<typename Op, typename E>
+  requires TensorOperand<E>
+auto MakeUnaryExpression(Op op, E &&operand)
+{
+  return TensorUnaryExpression<Op, E>(op, std::forward<E>(operand));
+}
+
+/**
+ * @brief 二項演算の式を作成する
+ */
+template<typename Op, typename L, typename R>
+  requires (TensorOperand<L> && TensorOperand<R>)
+auto MakeBinaryExpression(Op op, L &&lhs, R &&rhs)
+{
+  return TensorBinaryExpression<Op, L, R>(op, std::forward<L>(lhs), std::forward<R>(rhs));
+}
+
+/**
+ * @brief 式の要素型のスカラー式を作成する
+ */
+template<typename E, typename S>
+auto MakeScalarExpression(const S &value)
+{
+  using V = typename std::remove_cvref_t<E>::value_type;
+  return TensorScalarExpression<V>(static_cast<V>(value));
+}
+
+/**
+ * @brief テンソル (または式) 同士, テンソルとスカラーの四則演算.
+ * 結果は遅延評価される式となり, BasicTensor に代入した時点で 1 回のループでまとめて計算する.
+ * 要素型の異なるテンソル同士は promote_t の規則で昇格した型で計算し, スカラーはテンソルの要素型に変換する
+ */
+#define NAGATO_TENSOR_EXPRESSION_OPERATOR(OP, OPERATION)                                     \
+  template<typename L, typename R>                                                            \
+    requires (TensorOperand<L> && TensorOperand<R>)                                           \
+  auto operator OP(L &&a, R &&b)                                                              \
+  {                                                                                           \
+    return MakeBinaryExpression(OPERATION{}, std::forward<L>(a), std::forward<R>(b));         \
+  }                                                                                           \
+                                                                                              \
+  template<typename L, typename S>                                                            \
+    requires (TensorOperand<L> && TensorScalar<S>)                                            \
+  auto operator OP(L &&a, const S &b)                                                         \
+  {                                                                                           \
+    return MakeBinaryExpression(OPERATION{}, std::forward<L>(a), MakeScalarExpression<L>(b)); \
+  }                                                                                           \
+                                                                                              \
+  template<typename S, typename R>                                                            \
+    requires (TensorScalar<S> && TensorOperand<R>)                                            \
+  auto operator OP(const S &a, R &&b)                                                         \
+  {                                                                                           \
+    return MakeBinaryExpression(OPERATION{}, MakeScalarExpression<R>(a), std::forward<R>(b)); \
+  }
+
+NAGATO_TENSOR_EXPRESSION_OPERATOR(+, TensorAddOp)
+NAGATO_TENSOR_EXPRESSION_OPERATOR(-, TensorSubtractOp)
+NAGATO_TENSOR_EXPRESSION_OPERATOR(*, TensorMultiplyOp)
+NAGATO_TENSOR_EXPRESSION_OPERATOR(/, TensorDivideOp)
+
+#undef NAGATO_TENSOR_EXPRESSION_OPERATOR
+
+/**
+ * @brief 単項マイナス. 遅延評価される式を返す
+ */
+template<typename E>
+  requires TensorOperand<E>
+auto operator-(E &&a)
+{
+  return MakeUnaryExpression(TensorNegateOp{}, std::forward<E>(a));
+}
+
+} // namespace nagato
+
+#endif // TENSOR_EXPRESSION_HPP
@@ -51,7 +51,11 @@ void ThreadPool::Loop(std::function<void(size)> &&f,
 }
 
 void ThreadPool::Finish() noexcept {
-	is_work_ = false;
+	// ロックせずに書き換えると, 条件を確認した直後のスレッドが通知を取りこぼして join が終わらなくなる
+	{
+		unique_lock lock(mutex_);
+		is_work_ = false;
+	}
 	int joinable = 0;
 	condition_variable_.notify_all();
 
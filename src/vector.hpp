@@ -11,6 +11,8 @@
 #include <array>
 #include <limits>
 #include <cmath>
+#include <ostream>
+#include <vector>
 
 #include "math.hpp"
 #include "type_traits.hpp"
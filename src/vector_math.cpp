@@ -0,0 +1,855 @@
+//
+// Created by toru on 2026/10/17.
+//
+
+#include "vector_math.hpp"
+#include "random.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace nagato
+{
+namespace
+{
+// コンパイル時に利用できる SIMD レジスタのバイト数
+#if defined(__AVX512F__)
+constexpr std::size_t kSimdBytes = 64;
+#elif defined(__AVX__)
+constexpr std::size_t kSimdBytes = 32;
+#else
+constexpr std::size_t kSimdBytes = 16;
+#endif
+
+// この要素数ごとに分けて並列化する
+constexpr std::size_t kChunkElements = 4096;
+
+std::atomic<MathPrecision> current_precision{MathPrecision::Precise};
+
+/**
+ * @brief 要素型ごとのベクトル型と定数
+ * @note exp の多項式は [-log(2)/2, log(2)/2] での近似, log の多項式は
+ *       R(z) = log((1 + s) / (1 - s)) / s - 2 を z = s^2 の多項式 z * P(z) で近似したときの P の係数 (昇順).
+ *       Precise の係数は Cephes (float の exp), fdlibm / musl (log) のもの,
+ *       Fast の係数はチェビシェフ点での補間で求めた
+ */
+template<typename T>
+struct MathTraits;
+
+template<>
+struct MathTraits<float>
+{
+  typedef float vector_type __attribute__((vector_size(kSimdBytes)));
+  typedef std::int32_t int_vector __attribute__((vector_size(kSimdBytes)));
+  using int_type = std::int32_t;
+
+  static constexpr std::size_t kLanes = kSimdBytes / sizeof(float);
+  static constexpr int kMantissaBits = 23;
+  static constexpr int_type kExponentBias = 127;
+  static constexpr int_type kMantissaMask = 0x007fffff;
+
+  // 整数への丸めに使う 1.5 * 2^23. この値を加えると小数部が丸められる
+  static constexpr float kRoundMagic = 0x1.8p23f;
+
+  // exp(kExpMin) は 0 に, exp(kExpMax) は inf に丸められる
+  static constexpr float kExpMin = -104.0f;
+  static constexpr float kExpMax = 89.0f;
+
+  // log(2) を上位と下位に分けた値. 上位は n * kLn2Hi が丸めなしで計算できる桁数にする
+  static constexpr float kExpLn2Hi = 0.693359375f;
+  static constexpr float kExpLn2Lo = -2.12194440e-4f;
+  static constexpr float kLogLn2Hi = 6.9313812256e-01f;
+  static constexpr float kLogLn2Lo = 9.0580006145e-06f;
+
+  static constexpr float kExpPrecise[] = {
+    1.0f, 1.0f, 5.0000001201e-1f, 1.6666665459e-1f, 4.1665795894e-2f, 8.3334519073e-3f, 1.3981999507e-3f,
+    1.9875691500e-4f
+  };
+  static constexpr float kExpFast[] = {
+    1.0000000754548972f, 1.00000001077157f, 0.49998869378303396f, 0.16666505260408124f, 0.04191750724961526f,
+    0.008369148490856347f
+  };
+  static constexpr float kLogPrecise[] = {0xaaaaaa.0p-24f, 0xccce13.0p-25f, 0x91e9ee.0p-25f, 0xf89e26.0p-26f};
+  static constexpr float kLogFast[] = {0.6666349945494474f, 0.40858269361438715f};
+
+  // sqrt(2) / 2 のビット表現. 仮数部をこの値以上 sqrt(2) 未満に正規化する
+  static constexpr int_type kSqrtHalfBits = 0x3f3504f3;
+  static constexpr int_type kOneBits = 0x3f800000;
+
+  // 非正規化数は 2^kSubnormalShift 倍して正規化数にしてから計算する
+  static constexpr int_type kSubnormalShift = 25;
+  static constexpr float kSubnormalScale = 0x1p25f;
+
+  // [-pi/4, pi/4] での sin(r) = r + r * z * S(z), cos(r) = 1 - z / 2 + z^2 * C(z) (z = r^2) の係数 (Cephes)
+  static constexpr float kSin[] = {-1.6666654611e-1f, 8.3321608736e-3f, -1.9515295891e-4f};
+  static constexpr float kCos[] = {4.166664568298827e-2f, -1.388731625493765e-3f, 2.443315711809948e-5f};
+
+  // 乱数の 32 ビットの語. 要素数は vector_type と同じにする
+  typedef std::uint32_t word_vector __attribute__((vector_size(kSimdBytes)));
+  typedef std::uint64_t pair_vector __attribute__((vector_size(kSimdBytes)));
+};
+
+template<>
+struct MathTraits<double>
+{
+  typedef double vector_type __attribute__((vector_size(kSimdBytes)));
+  typedef std::int64_t int_vector __attribute__((vector_size(kSimdBytes)));
+  using int_type = std::int64_t;
+
+  static constexpr std::size_t kLanes = kSimdBytes / sizeof(double);
+  static constexpr int kMantissaBits = 52;
+  static constexpr int_type kExponentBias = 1023;
+  static constexpr int_type kMantissaMask = 0x000fffffffffffff;
+
+  static constexpr double kRoundMagic = 0x1.8p52;
+
+  static constexpr double kExpMin = -746.0;
+  static constexpr double kExpMax = 710.0;
+
+  static constexpr double kExpLn2Hi = 6.93147180369123816490e-01;
+  static constexpr double kExpLn2Lo = 1.90821492927058770002e-10;
+  static constexpr double kLogLn2Hi = 6.93147180369123816490e-01;
+  static constexpr double kLogLn2Lo = 1.90821492927058770002e-10;
+
+  static constexpr double kExpPrecise[] = {
+    1.0, 1.0, 0.5000000000000019, 0.1666666666666668, 0.0416666666664881, 0.008333333333319601,
+    0.0013888888952314775, 0.00019841269890047113, 2.4801485482328494e-05, 2.755724091857897e-06,
+    2.763263963904103e-07, 2.5110037605963777e-08
+  };
+  static constexpr double kExpFast[] = {
+    1.0, 0.9999999999797852, 0.49999999999797934, 0.16666666891045775, 0.041666666890957, 0.008333266097949614,
+    0.0013888821677630362, 0.00019915866926782682, 2.487616402262597e-05
+  };
+  static constexpr double kLogPrecise[] = {
+    6.666666666666735130e-01, 3.999999999940941908e-01, 2.857142874366239149e-01, 2.222219843214978396e-01,
+    1.818357216161805012e-01, 1.531383769920937332e-01, 1.479819860511658591e-01
+  };
+  static constexpr double kLogFast[] = {
+    0.6666666666737509, 0.3999999879733759, 0.2857175453591449, 0.22191400830308503, 0.19362653714202005
+  };
+
+  static constexpr int_type kSqrtHalfBits = 0x3fe6a09e667f3bcd;
+  static constexpr int_type kOneBits = 0x3ff0000000000000;
+
+  static constexpr int_type kSubnormalShift = 54;
+  static constexpr double kSubnormalScale = 0x1p54;
+
+  // fdlibm の __kernel_sin / __kernel_cos の係数
+  static constexpr double kSin[] = {
+    -1.66666666666666324348e-01, 8.33333333332248946124e-03, -1.98412698298579493134e-04, 2.75573137070700676789e-06,
+    -2.50507602534068634195e-08, 1.58969099521155010221e-10
+  };
+  static constexpr double kCos[] = {
+    4.16666666666666019037e-02, -1.38888888888741095749e-03, 2.48015872894767294178e-05, -2.75573143513906633035e-07,
+    2.08757232129817482790e-09, -1.13596475577881948265e-11
+  };
+
+  typedef std::uint32_t word_vector __attribute__((vector_size(kSimdBytes / 2)));
+  typedef std::uint64_t pair_vector __attribute__((vector_size(kSimdBytes / 2)));
+};
+
+/**
+ * @brief 昇順の係数の多項式をホーナー法で計算する. 再帰で展開して係数ごとに 1 回の積和にする
+ */
+template<std::size_t I = 0, typename V, typename T, std::size_t N>
+[[gnu::always_inline]] inline V Polynomial(const V r, const T (&c)[N])
+{
+  if constexpr (I + 1 == N)
+  {
+    return V{} + c[I];
+  }
+  else
+  {
+    return Polynomial<I + 1>(r, c) * r + c[I];
+  }
+}
+
+/**
+ * @brief 整数 k (|k| < 2^22) を浮動小数点数に変換する
+ * @note 1.5 * 2^m のビット表現に k を加えると値が 1.5 * 2^m + k になることを利用する
+ *       (AVX2 には 64 ビット整数から double への変換命令がないため)
+ */
+template<typename T>
+[[gnu::always_inline]] inline typename MathTraits<T>::vector_type ToFloating(const typename MathTraits<T>::int_vector k)
+{
+  using Traits = MathTraits<T>;
+  using V = typename Traits::vector_type;
+  using IV = typename Traits::int_vector;
+  const IV magic = (IV)(V{} + Traits::kRoundMagic);
+  return (V)(k + magic) - Traits::kRoundMagic;
+}
+
+/**
+ * @brief 2^k を計算する. k は正規化数の指数の範囲にあること
+ */
+template<typename T>
+[[gnu::always_inline]] inline typename MathTraits<T>::vector_type Pow2(const typename MathTraits<T>::int_vector k)
+{
+  using Traits = MathTraits<T>;
+  using V = typename Traits::vector_type;
+  return (V)((k + Traits::kExponentBias) << Traits::kMantissaBits);
+}
+
+template<typename T, bool Fast>
+[[gnu::always_inline]] inline typename MathTraits<T>::vector_type ExpKernel(const typename MathTraits<T>::vector_type x)
+{
+  using Traits = MathTraits<T>;
+  using V = typename Traits::vector_type;
+  using IV = typename Traits::int_vector;
+
+  V clamped = x < Traits::kExpMin ? V{} + Traits::kExpMin : x;
+  clamped = clamped > Traits::kExpMax ? V{} + Traits::kExpMax : clamped;
+
+  // x = n * log(2) + r (|r| <= log(2) / 2)
+  const V t = clamped * static_cast<T>(1.44269504088896340736) + Traits::kRoundMagic;
+  const V n = t - Traits::kRoundMagic;
+  V r = clamped - n * Traits::kExpLn2Hi;
+  r = r - n * Traits::kExpLn2Lo;
+
+  const V p = Fast ? Polynomial(r, Traits::kExpFast) : Polynomial(r, Traits::kExpPrecise);
+
+  // 2^n を 2 回に分けて掛け, オーバーフローと非正規化数への段階的アンダーフローを正しく扱う
+  const IV k = (IV)t - (IV)(V{} + Traits::kRoundMagic);
+  const IV k1 = k >> 1;
+  const IV k2 = k - k1;
+  const V y = p * Pow2<T>(k1) * Pow2<T>(k2);
+  return x != x ? x : y;
+}
+
+template<typename T, bool Fast>
+[[gnu::always_inline]] inline typename MathTraits<T>::vector_type LogKernel(const typename MathTraits<T>::vector_type x)
+{
+  using Traits = MathTraits<T>;
+  using V = typename Traits::vector_type;
+  using IV = typename Traits::int_vector;
+  constexpr T kInfinity = std::numeric_limits<T>::infinity();
+
+  // 非正規化数は正規化数にしてから分解する
+  const auto subnormal = x < std::numeric_limits<T>::min();
+  const V scaled = subnormal ? x * Traits::kSubnormalScale : x;
+
+  // x = 2^k * m (sqrt(2)/2 <= m < sqrt(2))
+  IV bits = (IV)scaled + (Traits::kOneBits - Traits::kSqrtHalfBits);
+  const IV k = (bits >> Traits::kMantissaBits) - Traits::kExponentBias -
+               (subnormal ? IV{} + Traits::kSubnormalShift : IV{});
+  bits = (bits & Traits::kMantissaMask) + Traits::kSqrtHalfBits;
+  const V f = (V)bits - static_cast<T>(1);
+
+  // log(m) = log((1 + s) / (1 - s)) = 2s + s * R(z), s = f / (2 + f), z = s^2
+  const V s = f / (f + static_cast<T>(2));
+  const V z = s * s;
+  const V R = z * (Fast ? Polynomial(z, Traits::kLogFast) : Polynomial(z, Traits::kLogPrecise));
+  const V hfsq = static_cast<T>(0.5) * f * f;
+  const V dk = ToFloating<T>(k);
+  V y = s * (hfsq + R) + dk * Traits::kLogLn2Lo - hfsq + f + dk * Traits::kLogLn2Hi;
+
+  y = x == 0 ? V{} - kInfinity : y;
+  y = x < 0 ? V{} + std::numeric_limits<T>::quiet_NaN() : y;
+  y = x == kInfinity ? x : y;
+  return x != x ? x : y;
+}
+
+template<typename T, bool Fast>
+[[gnu::always_inline]] inline typename MathTraits<T>::vector_type SigmoidKernel(const typename MathTraits<T>::vector_type x)
+{
+  const auto e = ExpKernel<T, Fast>(-x);
+  return static_cast<T>(1) / (e + static_cast<T>(1));
+}
+
+/**
+ * @brief 配列の要素ごとにカーネルを適用する
+ * @note 端数の要素は 0 で埋めたベクトルに読み込んで同じカーネルで計算する
+ */
+template<typename T, typename Kernel>
+void ApplyKernel(const T *x, T *y, std::size_t n, Kernel kernel)
+{
+  using Traits = MathTraits<T>;
+  using V = typename Traits::vector_type;
+  constexpr std::size_t kLanes = Traits::kLanes;
+  const std::size_t chunks = (n + kChunkElements - 1) / kChunkElements;
+
+#ifdef NAGATO_OPENMP
+  #pragma omp parallel for if (n > 65536)
+#endif
+  for (std::size_t c = 0; c < chunks; ++c)
+  {
+    const std::size_t begin = c * kChunkElements;
+    const std::size_t end = std::min(n, begin + kChunkElements);
+    std::size_t i = begin;
+    for (; i + kLanes <= end; i += kLanes)
+    {
+      V v;
+      std::memcpy(&v, x + i, sizeof(V));
+      v = kernel(v);
+      std::memcpy(y + i, &v, sizeof(V));
+    }
+    if (i < end)
+    {
+      V v{};
+      std::memcpy(&v, x + i, (end - i) * sizeof(T));
+      v = kernel(v);
+      std::memcpy(y + i, &v, (end - i) * sizeof(T));
+    }
+  }
+}
+
+bool IsFast()
+{
+  return current_precision.load(std::memory_order_relaxed) == MathPrecision::Fast;
+}
+
+/**
+ * @brief 配列を kChunkElements ごとに分け, 各チャンク [begin, end) を convert で変換する
+ */
+template<typename Convert>
+void ConvertChunks(std::size_t n, Convert convert)
+{
+  const std::size_t chunks = (n + kChunkElements - 1) / kChunkElements;
+
+#ifdef NAGATO_OPENMP
+  #pragma omp parallel for if (n > 65536)
+#endif
+  for (std::size_t c = 0; c < chunks; ++c)
+  {
+    const std::size_t begin = c * kChunkElements;
+    convert(begin, std::min(n, begin + kChunkElements));
+  }
+}
+
+/**
+ * @brief sin(2 * pi * u) と cos(2 * pi * u) を計算する (0 <= u < 1)
+ * @note 4u を最も近い整数 q と |r| <= 1/2 に分けると 2 * pi * u = q * pi / 2 + r * pi / 2 になるので,
+ *       [-pi/4, pi/4] の多項式で計算して q に応じて入れ替えと符号の反転をする
+ */
+template<typename T>
+[[gnu::always_inline]] inline void SinCos2PiKernel(const typename MathTraits<T>::vector_type u,
+                                                   typename MathTraits<T>::vector_type &sin,
+                                                   typename MathTraits<T>::vector_type &cos)
+{
+  using Traits = MathTraits<T>;
+  using V = typename Traits::vector_type;
+  using IV = typename Traits::int_vector;
+
+  const V t = u * static_cast<T>(4) + Traits::kRoundMagic;
+  const V q = t - Traits::kRoundMagic;
+  const V r = (u * static_cast<T>(4) - q) * static_cast<T>(1.57079632679489661923);
+  const IV k = (IV)t - (IV)(V{} + Traits::kRoundMagic);
+
+  const V z = r * r;
+  const V s = r + r * z * Polynomial(z, Traits::kSin);
+  const V c = static_cast<T>(1) - static_cast<T>(0.5) * z + z * z * Polynomial(z, Traits::kCos);
+
+  const auto odd = (k & 1) != 0;
+  const V sin_r = odd ? c : s;
+  const V cos_r = odd ? s : c;
+  sin = (k & 2) != 0 ? -sin_r : sin_r;
+  cos = ((k + 1) & 2) != 0 ? -cos_r : cos_r;
+}
+
+/**
+ * @brief ベクトルの要素ごとに平方根を計算する
+ */
+template<typename V>
+[[gnu::always_inline]] inline V SqrtKernel(V x)
+{
+#if defined(__AVX512F__)
+  // マスクなしの AVX-512 命令は未初期化の値を渡すため GCC が -Wuninitialized を出す. 全レーンのマスクでゼロ埋めの版を使う
+  if constexpr (sizeof(V) == 64)
+  {
+    if constexpr (sizeof(x[0]) == 4)
+    {
+      return (V)_mm512_maskz_sqrt_ps(0xffff, (__m512)x);
+    }
+    else
+    {
+      return (V)_mm512_maskz_sqrt_pd(0xff, (__m512d)x);
+    }
+  }
+#endif
+#if defined(__AVX__)
+  if constexpr (sizeof(V) == 32)
+  {
+    if constexpr (sizeof(x[0]) == 4)
+    {
+      return (V)_mm256_sqrt_ps((__m256)x);
+    }
+    else
+    {
+      return (V)_mm256_sqrt_pd((__m256d)x);
+    }
+  }
+#endif
+  if constexpr (sizeof(V) == 16)
+  {
+    if constexpr (sizeof(x[0]) == 4)
+    {
+      return (V)_mm_sqrt_ps((__m128)x);
+    }
+    else
+    {
+      return (V)_mm_sqrt_pd((__m128d)x);
+    }
+  }
+  for (std::size_t i = 0; i < sizeof(V) / sizeof(x[0]); ++i)
+  {
+    x[i] = std::sqrt(x[i]);
+  }
+  return x;
+}
+
+/**
+ * @brief 32 ビットの語のベクトルとスカラーの積の上位と下位の 32 ビットを計算する
+ * @note 64 ビットの要素として偶数番目と奇数番目の語を別々に掛け (vpmuludq), 結果を元の位置に戻す
+ */
+template<typename T>
+[[gnu::always_inline]] inline void MulHiLo(const typename MathTraits<T>::word_vector x,
+                                           const std::uint32_t m,
+                                           typename MathTraits<T>::word_vector &hi,
+                                           typename MathTraits<T>::word_vector &lo)
+{
+  using W = typename MathTraits<T>::word_vector;
+  using PairVector = typename MathTraits<T>::pair_vector;
+  constexpr std::uint64_t kLow = 0xffffffff;
+  // 64 ビットの要素の下位 32 ビット同士の積. 汎用のベクトルの式では上位が 0 であることを使わずに
+  // 64 ビットの乗算 (vpmullq) になるため, 命令を直接使う
+  const auto multiply = [](const PairVector a, const PairVector b) -> PairVector
+  {
+#if defined(__AVX512F__)
+    // SqrtKernel と同じく, 未初期化の値を渡さない全レーンのマスクの版を使う
+    if constexpr (sizeof(PairVector) == 64)
+    {
+      return (PairVector)_mm512_maskz_mul_epu32(0xff, (__m512i)a, (__m512i)b);
+    }
+#endif
+#if defined(__AVX2__)
+    if constexpr (sizeof(PairVector) == 32)
+    {
+      return (PairVector)_mm256_mul_epu32((__m256i)a, (__m256i)b);
+    }
+#endif
+#if defined(__SSE2__)
+    if constexpr (sizeof(PairVector) == 16)
+    {
+      return (PairVector)_mm_mul_epu32((__m128i)a, (__m128i)b);
+    }
+#endif
+    return (a & kLow) * (b & kLow);
+  };
+  const PairVector pairs = (PairVector)x;
+  const PairVector even = multiply(pairs, PairVector{} + m);
+  const PairVector odd = multiply(pairs >> 32, PairVector{} + m);
+  hi = (W)((even >> 32) | (odd & ~kLow));
+  lo = (W)((even & kLow) | (odd << 32));
+}
+
+/**
+ * @brief Philox4x32-10 をベクトルのレーンごとに計算する. 各レーンが 1 つのブロック (カウンタ) に対応する
+ */
+template<typename T>
+[[gnu::always_inline]] inline void PhiloxKernel(typename MathTraits<T>::word_vector (&x)[4],
+                                                std::uint32_t key0,
+                                                std::uint32_t key1)
+{
+  for (int round = 0; round < Philox4x32::kRounds; ++round)
+  {
+    typename MathTraits<T>::word_vector hi0, lo0, hi1, lo1;
+    MulHiLo<T>(x[0], Philox4x32::kMultiplier0, hi0, lo0);
+    MulHiLo<T>(x[2], Philox4x32::kMultiplier1, hi1, lo1);
+    x[0] = hi1 ^ x[1] ^ key0;
+    x[1] = lo1;
+    x[2] = hi0 ^ x[3] ^ key1;
+    x[3] = lo0;
+    key0 += Philox4x32::kWeyl0;
+    key1 += Philox4x32::kWeyl1;
+  }
+}
+
+/**
+ * @brief 乱数の語から [0, 1) の一様乱数を作る
+ * @note 仮数部に乱数のビットを入れた [1, 2) の値から 1 を引く. float は hi の上位 23 ビット,
+ *       double は hi の 32 ビットと lo の上位 20 ビットを使う
+ */
+template<typename T>
+[[gnu::always_inline]] inline typename MathTraits<T>::vector_type UnitKernel(const typename MathTraits<T>::word_vector hi,
+                                                                            const typename MathTraits<T>::word_vector lo)
+{
+  using Traits = MathTraits<T>;
+  using V = typename Traits::vector_type;
+  using IV = typename Traits::int_vector;
+  if constexpr (std::is_same_v<T, float>)
+  {
+    return (V)((hi >> 9) | 0x3f800000) - 1.0f;
+  }
+  else
+  {
+    const IV bits = (__builtin_convertvector(hi, IV) << 20) | __builtin_convertvector(lo >> 12, IV);
+    return (V)(bits | 0x3ff0000000000000) - 1.0;
+  }
+}
+
+// 乱数の値の並びを SIMD 幅によらず同じにするため, この数のブロックをまとめて 1 つのグループとして計算する
+constexpr std::size_t kRandomBlocks = 16;
+
+/**
+ * @brief グループ group の乱数を out に書き込む
+ * @note 1 つのブロック (128 ビット) から float は 4 個, double は 2 個の値を作り, グループの中では
+ *       j 番目の値を out[j * kRandomBlocks + (ブロックの番号 % kRandomBlocks)] に置く.
+ *       一様乱数は float ではブロックの j 番目の語を, double では 2j, 2j + 1 番目の語を使う.
+ *       正規乱数は Box-Muller 法で 2 つの一様乱数 u1, u2 から sqrt(-2 log(1 - u1)) * (cos, sin)(2 * pi * u2)
+ *       の 2 つの値を作る
+ */
+template<typename T, bool Normal>
+void RandomGroupKernel(std::uint64_t seed, std::uint64_t group, T scale, T shift, T *out)
+{
+  using Traits = MathTraits<T>;
+  using V = typename Traits::vector_type;
+  using W = typename Traits::word_vector;
+  constexpr std::size_t kLanes = Traits::kLanes;
+  constexpr std::size_t kValues = 16 / sizeof(T);
+  static_assert(kRandomBlocks % kLanes == 0);
+
+  W lane;
+  for (std::size_t i = 0; i < kLanes; ++i)
+  {
+    lane[i] = static_cast<std::uint32_t>(i);
+  }
+  const auto key0 = static_cast<std::uint32_t>(seed);
+  const auto key1 = static_cast<std::uint32_t>(seed >> 32);
+
+  for (std::size_t p = 0; p < kRandomBlocks; p += kLanes)
+  {
+    // ベクトルの先頭のブロックの番号は kLanes の倍数なので, 下位 32 ビットはレーンの間で桁上がりしない
+    const std::uint64_t block = group * kRandomBlocks + p;
+    W x[4] = {lane + static_cast<std::uint32_t>(block), W{} + static_cast<std::uint32_t>(block >> 32), W{}, W{}};
+    PhiloxKernel<T>(x, key0, key1);
+
+    V v[kValues];
+    if constexpr (kValues == 4)
+    {
+      for (std::size_t j = 0; j < 4; ++j)
+      {
+        v[j] = UnitKernel<T>(x[j], x[j]);
+      }
+    }
+    else
+    {
+      v[0] = UnitKernel<T>(x[0], x[1]);
+      v[1] = UnitKernel<T>(x[2], x[3]);
+    }
+    if constexpr (Normal)
+    {
+      for (std::size_t j = 0; j < kValues; j += 2)
+      {
+        const V r = SqrtKernel(static_cast<T>(-2) * LogKernel<T, false>(static_cast<T>(1) - v[j]));
+        V sin, cos;
+        SinCos2PiKernel<T>(v[j + 1], sin, cos);
+        v[j] = r * cos;
+        v[j + 1] = r * sin;
+      }
+    }
+    for (std::size_t j = 0; j < kValues; ++j)
+    {
+      const V y = v[j] * scale + shift;
+      std::memcpy(out + j * kRandomBlocks + p, &y, sizeof(V));
+    }
+  }
+}
+
+/**
+ * @brief 配列をグループごとの乱数で埋める. グループの番号は位置で決まるため, 分割して並列に計算しても結果は同じ
+ */
+template<typename T, bool Normal>
+void FillRandom(std::uint64_t seed, T scale, T shift, T *y, std::size_t n)
+{
+  constexpr std::size_t kGroupElements = kRandomBlocks * 16 / sizeof(T);
+  static_assert(kChunkElements % kGroupElements == 0);
+  const std::size_t groups = n / kGroupElements;
+  ConvertChunks(groups * kGroupElements, [=](std::size_t begin, std::size_t end)
+  {
+    for (std::size_t i = begin; i < end; i += kGroupElements)
+    {
+      RandomGroupKernel<T, Normal>(seed, i / kGroupElements, scale, shift, y + i);
+    }
+  });
+  if (groups * kGroupElements < n)
+  {
+    T buffer[kGroupElements];
+    RandomGroupKernel<T, Normal>(seed, groups, scale, shift, buffer);
+    std::memcpy(y + groups * kGroupElements, buffer, (n - groups * kGroupElements) * sizeof(T));
+  }
+}
+
+// 16 ビットの浮動小数点数と float の変換に使うベクトル. 要素数は float のベクトルと同じにする
+typedef std::uint32_t WordVector __attribute__((vector_size(kSimdBytes)));
+typedef std::uint16_t HalfWordVector __attribute__((vector_size(kSimdBytes / 2)));
+constexpr std::size_t kWordLanes = kSimdBytes / sizeof(std::uint32_t);
+
+} // namespace
+
+MathPrecision GetMathPrecision()
+{
+  return current_precision.load(std::memory_order_relaxed);
+}
+
+MathPrecision SetMathPrecision(MathPrecision precision)
+{
+  return current_precision.exchange(precision, std::memory_order_relaxed);
+}
+
+template<typename T>
+void VectorExp(const T *x, T *y, std::size_t n)
+{
+  if (IsFast())
+  {
+    ApplyKernel(x, y, n, [](const auto v) { return ExpKernel<T, true>(v); });
+  }
+  else
+  {
+    ApplyKernel(x, y, n, [](const auto v) { return ExpKernel<T, false>(v); });
+  }
+}
+
+template<typename T>
+void VectorLog(const T *x, T *y, std::size_t n)
+{
+  if (IsFast())
+  {
+    ApplyKernel(x, y, n, [](const auto v) { return LogKernel<T, true>(v); });
+  }
+  else
+  {
+    ApplyKernel(x, y, n, [](const auto v) { return LogKernel<T, false>(v); });
+  }
+}
+
+template<typename T>
+void VectorSigmoid(const T *x, T *y, std::size_t n)
+{
+  if (IsFast())
+  {
+    ApplyKernel(x, y, n, [](const auto v) { return SigmoidKernel<T, true>(v); });
+  }
+  else
+  {
+    ApplyKernel(x, y, n, [](const auto v) { return SigmoidKernel<T, false>(v); });
+  }
+}
+
+template<typename T>
+T VectorMax(const T *x, std::size_t n)
+{
+  using Traits = MathTraits<T>;
+  using V = typename Traits::vector_type;
+  constexpr std::size_t kLanes = Traits::kLanes;
+
+  // 2 本の累積ベクトルで比較の依存関係を切る
+  V max0 = V{} - std::numeric_limits<T>::infinity();
+  V max1 = max0;
+  std::size_t i = 0;
+  for (; i + 2 * kLanes <= n; i += 2 * kLanes)
+  {
+    V v0, v1;
+    std::memcpy(&v0, x + i, sizeof(V));
+    std::memcpy(&v1, x + i + kLanes, sizeof(V));
+    max0 = v0 > max0 ? v0 : max0;
+    max1 = v1 > max1 ? v1 : max1;
+  }
+  max0 = max1 > max0 ? max1 : max0;
+
+  T result = max0[0];
+  for (std::size_t k = 1; k < kLanes; ++k)
+  {
+    result = std::max(result, max0[k]);
+  }
+  for (; i < n; ++i)
+  {
+    result = std::max(result, x[i]);
+  }
+  return result;
+}
+
+template<typename T>
+T VectorExpSum(const T *x, T shift, T *y, std::size_t n)
+{
+  using Traits = MathTraits<T>;
+  using V = typename Traits::vector_type;
+  constexpr std::size_t kLanes = Traits::kLanes;
+
+  V sum{};
+  const auto exp_sum = [&](const auto kernel)
+  {
+    std::size_t i = 0;
+    for (; i + kLanes <= n; i += kLanes)
+    {
+      V v;
+      std::memcpy(&v, x + i, sizeof(V));
+      v = kernel(v - shift);
+      std::memcpy(y + i, &v, sizeof(V));
+      sum += v;
+    }
+    if (i < n)
+    {
+      // 端数の要素以外は合計に含めない
+      V v{};
+      std::memcpy(&v, x + i, (n - i) * sizeof(T));
+      v = kernel(v - shift);
+      std::memcpy(y + i, &v, (n - i) * sizeof(T));
+      for (std::size_t k = 0; k < n - i; ++k)
+      {
+        sum[k] += v[k];
+      }
+    }
+  };
+  if (IsFast())
+  {
+    exp_sum([](const auto v) { return ExpKernel<T, true>(v); });
+  }
+  else
+  {
+    exp_sum([](const auto v) { return ExpKernel<T, false>(v); });
+  }
+
+  T result = 0;
+  for (std::size_t k = 0; k < kLanes; ++k)
+  {
+    result += sum[k];
+  }
+  return result;
+}
+
+void VectorConvert(const float *x, Half *y, std::size_t n)
+{
+  ConvertChunks(n, [x, y](std::size_t begin, std::size_t end)
+  {
+    std::size_t i = begin;
+#if defined(__AVX512F__)
+    for (; i + 16 <= end; i += 16)
+    {
+      // SqrtKernel と同じく, 未初期化の値を渡さない全レーンのマスクの版を使う
+      const __m256i h = _mm512_maskz_cvtps_ph(0xffff, _mm512_loadu_ps(x + i), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(y + i), h);
+    }
+#elif defined(__F16C__)
+    for (; i + 8 <= end; i += 8)
+    {
+      const __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(x + i), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(y + i), h);
+    }
+#endif
+    for (; i < end; ++i)
+    {
+      y[i] = Half::FromBits(FloatToHalfBits(x[i]));
+    }
+  });
+}
+
+void VectorConvert(const Half *x, float *y, std::size_t n)
+{
+  ConvertChunks(n, [x, y](std::size_t begin, std::size_t end)
+  {
+    std::size_t i = begin;
+#if defined(__AVX512F__)
+    for (; i + 16 <= end; i += 16)
+    {
+      const __m256i h = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(x + i));
+      _mm512_storeu_ps(y + i, _mm512_maskz_cvtph_ps(0xffff, h));
+    }
+#elif defined(__F16C__)
+    for (; i + 8 <= end; i += 8)
+    {
+      const __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i *>(x + i));
+      _mm256_storeu_ps(y + i, _mm256_cvtph_ps(h));
+    }
+#endif
+    for (; i < end; ++i)
+    {
+      y[i] = HalfBitsToFloat(x[i].bits);
+    }
+  });
+}
+
+void VectorConvert(const float *x, BFloat16 *y, std::size_t n)
+{
+  ConvertChunks(n, [x, y](std::size_t begin, std::size_t end)
+  {
+    std::size_t i = begin;
+#if defined(__AVX512BF16__)
+    for (; i + 16 <= end; i += 16)
+    {
+      const __m256bh h = _mm512_cvtneps_pbh(_mm512_loadu_ps(x + i));
+      std::memcpy(static_cast<void *>(y + i), &h, sizeof(h));
+    }
+#else
+    for (; i + kWordLanes <= end; i += kWordLanes)
+    {
+      WordVector v;
+      std::memcpy(&v, x + i, sizeof(v));
+      const WordVector abs = v & 0x7fffffff;
+      WordVector r = (v + 0x7fff + ((v >> 16) & 1)) >> 16;
+      r = abs < 0x00800000 ? (v >> 16) & 0x8000 : r;
+      r = abs > 0x7f800000 ? (v >> 16) | 0x0040 : r;
+      const HalfWordVector h = __builtin_convertvector(r, HalfWordVector);
+      std::memcpy(static_cast<void *>(y + i), &h, sizeof(h));
+    }
+#endif
+    for (; i < end; ++i)
+    {
+      y[i] = BFloat16::FromBits(FloatToBFloat16Bits(x[i]));
+    }
+  });
+}
+
+void VectorConvert(const BFloat16 *x, float *y, std::size_t n)
+{
+  ConvertChunks(n, [x, y](std::size_t begin, std::size_t end)
+  {
+    std::size_t i = begin;
+    for (; i + kWordLanes <= end; i += kWordLanes)
+    {
+      HalfWordVector h;
+      std::memcpy(&h, x + i, sizeof(h));
+      const WordVector v = __builtin_convertvector(h, WordVector) << 16;
+      std::memcpy(y + i, &v, sizeof(v));
+    }
+    for (; i < end; ++i)
+    {
+      y[i] = BFloat16BitsToFloat(x[i].bits);
+    }
+  });
+}
+
+template<typename T>
+void VectorRandomUniform(std::uint64_t seed, T low, T high, T *y, std::size_t n)
+{
+  FillRandom<T, false>(seed, high - low, low, y, n);
+}
+
+template<typename T>
+void VectorRandomNormal(std::uint64_t seed, T mean, T stddev, T *y, std::size_t n)
+{
+  FillRandom<T, true>(seed, stddev, mean, y, n);
+}
+
+template void VectorExp<float>(const float *, float *, std::size_t);
+template void VectorExp<double>(const double *, double *, std::size_t);
+template void VectorLog<float>(const float *, float *, std::size_t);
+template void VectorLog<double>(const double *, double *, std::size_t);
+template void VectorSigmoid<float>(const float *, float *, std::size_t);
+template void VectorSigmoid<double>(const double *, double *, std::size_t);
+template float VectorMax<float>(const float *, std::size_t);
+template double VectorMax<double>(const double *, std::size_t);
+template float VectorExpSum<float>(const float *, float, float *, std::size_t);
+template double VectorExpSum<double>(const double *, double, double *, std::size_t);
+template void VectorRandomUniform<float>(std::uint64_t, float, float, float *, std::size_t);
+template void VectorRandomUniform<double>(std::uint64_t, double, double, double *, std::size_t);
+template void VectorRandomNormal<float>(std::uint64_t, float, float, float *, std::size_t);
+template void VectorRandomNormal<double>(std::uint64_t, double, double, double *, std::size_t);
+
+} // namespace nagato
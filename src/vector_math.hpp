@@ -0,0 +1,175 @@
+//
+// Created by toru on 2026/10/17.
+//
+
+#ifndef VECTOR_MATH_HPP
+#define VECTOR_MATH_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include "dtype.hpp"
+
+namespace nagato
+{
+
+/**
+ * @brief 超越関数のカーネルの精度
+ * @note 誤差は正規化数の範囲で 2^21 個の乱数の入力に対して long double の結果と比較して測定した
+ */
+enum class MathPrecision
+{
+  /**
+   * @brief 正確な値との差を数 ULP 以内に抑える (既定)
+   * @note float / double ともに exp は 1.5 ULP (FMA 命令を使える場合は 1 ULP), log は 1 ULP, sigmoid は 3 ULP 未満
+   */
+  Precise,
+
+  /**
+   * @brief 多項式の次数を下げて速度を優先する
+   * @note float の exp は 3.5 ULP, log は 6.5 ULP, sigmoid は 5 ULP 未満.
+   *       double は相対誤差 2^-39 (約 2e-12) 以内
+   */
+  Fast,
+};
+
+/**
+ * @brief 超越関数のカーネルの精度を取得する
+ * @return 精度
+ */
+MathPrecision GetMathPrecision();
+
+/**
+ * @brief 超越関数のカーネルの精度を設定する
+ * @note プロセス全体で共有する. 設定後に呼び出したカーネルから反映される
+ * @param precision 精度
+ * @return 設定前の精度
+ */
+MathPrecision SetMathPrecision(MathPrecision precision);
+
+/**
+ * @brief 配列の要素ごとに指数関数 y = exp(x) を計算する
+ * @note 範囲縮小 x = n * log(2) + r と r の多項式で計算し, 2^n を指数部に加える.
+ *       コンパイル時の SIMD 幅 (AVX2/AVX-512 など) のベクトルで計算し, 端数の要素も同じカーネルで計算する.
+ *       NaN はそのまま返し, オーバーフローは inf になる. 非正規化数の結果も段階的アンダーフローで計算する.
+ *       NAGATO_OPENMP が有効な場合は要素数が多いときに並列に計算する
+ * @param x 入力の先頭ポインタ
+ * @param y 出力の先頭ポインタ. x と同じでもよい
+ * @param n 要素数
+ */
+template<typename T>
+void VectorExp(const T *x, T *y, std::size_t n);
+
+/**
+ * @brief 配列の要素ごとに自然対数 y = log(x) を計算する
+ * @note x = 2^k * m (sqrt(2)/2 <= m < sqrt(2)) に分解し, log(m) を s = (m - 1) / (m + 1) の多項式で計算する.
+ *       log(0) は -inf, 負の値は NaN になる
+ * @param x 入力の先頭ポインタ
+ * @param y 出力の先頭ポインタ. x と同じでもよい
+ * @param n 要素数
+ */
+template<typename T>
+void VectorLog(const T *x, T *y, std::size_t n);
+
+/**
+ * @brief 配列の要素ごとにシグモイド関数 y = 1 / (1 + exp(-x)) を計算する
+ * @param x 入力の先頭ポインタ
+ * @param y 出力の先頭ポインタ. x と同じでもよい
+ * @param n 要素数
+ */
+template<typename T>
+void VectorSigmoid(const T *x, T *y, std::size_t n);
+
+/**
+ * @brief 配列の最大値を求める
+ * @param x 入力の先頭ポインタ
+ * @param n 要素数
+ * @return 最大値. 要素数が 0 の場合は -inf
+ */
+template<typename T>
+T VectorMax(const T *x, std::size_t n);
+
+/**
+ * @brief 配列の要素ごとに y = exp(x - shift) を計算し, その合計を返す
+ * @note Softmax や log-sum-exp の 1 行分を, 入力を 1 回読むだけで計算するために使う.
+ *       shift に最大値を渡すとオーバーフローしない. 並列化はしない (呼び出し側で行ごとに並列化する)
+ * @param x 入力の先頭ポインタ
+ * @param shift 各要素から引く値
+ * @param y 出力の先頭ポインタ. x と同じでもよい
+ * @param n 要素数
+ * @return y の合計
+ */
+template<typename T>
+T VectorExpSum(const T *x, T shift, T *y, std::size_t n);
+
+/**
+ * @brief 配列を [low, high) の一様乱数で埋める
+ * @note カウンターベースの乱数生成器 Philox4x32-10 (Philox4x32) を鍵 seed で使い, 各値は配列の中の位置から決まる
+ *       ブロック (カウンタ) の乱数で作る. ブロックをコンパイル時の SIMD 幅のベクトルでまとめて計算し,
+ *       NAGATO_OPENMP が有効な場合は要素数が多いときに並列に計算するが, 結果は SIMD 幅やスレッド数によらず一致する.
+ *       [0, 1) の値は float では 23 ビット, double では 52 ビットの乱数から作る.
+ *       同じ seed で長さの違う配列を埋めた場合, 短い方は長い方の先頭と一致する
+ * @param seed シード
+ * @param low 下限
+ * @param high 上限
+ * @param y 出力の先頭ポインタ
+ * @param n 要素数
+ */
+template<typename T>
+void VectorRandomUniform(std::uint64_t seed, T low, T high, T *y, std::size_t n);
+
+/**
+ * @brief 配列を正規分布 N(mean, stddev^2) の乱数で埋める
+ * @note VectorRandomUniform と同じ Philox4x32-10 の乱数から Box-Muller 法で 2 つずつ値を作る.
+ *       log, sqrt, sin, cos もベクトルで計算する. 一様乱数のビット数で決まるため,
+ *       値の絶対値は float では約 5.6 stddev, double では約 8.5 stddev 以下になる
+ * @param seed シード
+ * @param mean 平均
+ * @param stddev 標準偏差
+ * @param y 出力の先頭ポインタ
+ * @param n 要素数
+ */
+template<typename T>
+void VectorRandomNormal(std::uint64_t seed, T mean, T stddev, T *y, std::size_t n);
+
+/**
+ * @brief float の配列を半精度 (Half) に変換する
+ * @note F16C / AVX-512 の変換命令を使える場合は SIMD 幅ごとにまとめて変換し, 端数と命令がない場合は
+ *       FloatToHalfBits で 1 要素ずつ変換する. どちらも最近接偶数丸めで結果は一致する.
+ *       NAGATO_OPENMP が有効な場合は要素数が多いときに並列に変換する
+ * @param x 入力の先頭ポインタ
+ * @param y 出力の先頭ポインタ
+ * @param n 要素数
+ */
+void VectorConvert(const float *x, Half *y, std::size_t n);
+
+/**
+ * @brief 半精度 (Half) の配列を float に変換する
+ * @param x 入力の先頭ポインタ
+ * @param y 出力の先頭ポインタ
+ * @param n 要素数
+ */
+void VectorConvert(const Half *x, float *y, std::size_t n);
+
+/**
+ * @brief float の配列を bfloat16 に変換する
+ * @note AVX-512 BF16 の変換命令を使える場合はその命令で, それ以外はコンパイル時の SIMD 幅のベクトルで
+ *       FloatToBFloat16Bits と同じ規則 (最近接偶数丸め, 非正規化数は 0) で変換する
+ * @param x 入力の先頭ポインタ
+ * @param y 出力の先頭ポインタ
+ * @param n 要素数
+ */
+void VectorConvert(const float *x, BFloat16 *y, std::size_t n);
+
+/**
+ * @brief bfloat16 の配列を float に変換する
+ * @note 16 ビット左にシフトするだけなので, コンパイル時の SIMD 幅のベクトルで変換する
+ * @param x 入力の先頭ポインタ
+ * @param y 出力の先頭ポインタ
+ * @param n 要素数
+ */
+void VectorConvert(const BFloat16 *x, float *y, std::size_t n);
+
+} // namespace nagato
+
+#endif // VECTOR_MATH_HPP
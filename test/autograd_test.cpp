@@ -0,0 +1,226 @@
+//
+// Created by toru on 2026/10/17.
+//
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <vector>
+
+#include "nagatolib.hpp"
+using namespace nagato;
+
+namespace
+{
+// 2 層ニューラルネットワークの順伝播をテープに記録する
+Variable TwoLayerLoss(Tape &tape,
+                      const std::vector<Variable> &params,
+                      const Tensor &x,
+                      const Tensor &t)
+{
+  const Variable h = Variable::ReLU(Variable::Matmul(tape.constant(x), params[0]) + params[1]);
+  return Variable::SoftmaxCrossEntropy(Variable::Matmul(h, params[2]) + params[3], t);
+}
+} // namespace
+
+// 手書きの逆伝播と同じ勾配が求まり, そのまま Optimizer で学習できるか確認する
+TEST(AutogradTest, MatchesTwoLayerNetGradient)
+{
+  const Tensor x = Tensor::Random({16, 6}, 1);
+  Tensor t = Tensor::Zeros({16, 3});
+  for (std::size_t i = 0; i < 16; ++i)
+  {
+    t(i, (x(i, 0) > 0 ? 1 : 0) + (x(i, 1) > 0 ? 1 : 0)) = 1;
+  }
+
+  TwoLayerNet net(6, 8, 3, 0.5);
+  const auto expected = net.gradient(x, t);
+
+  Tape tape;
+  std::vector<std::pair<std::string, Variable> > variables;
+  std::vector<Variable> params;
+  for (const auto &[name, param] : net.params)
+  {
+    variables.emplace_back(name, tape.parameter(*param));
+    params.push_back(variables.back().second);
+  }
+  const Variable loss = TwoLayerLoss(tape, params, x, t);
+  EXPECT_NEAR(loss.value()(0), net.loss(x, t)(0), 1e-12);
+  tape.backward(loss);
+
+  const auto grads = tape.gradients(variables);
+  ASSERT_EQ(grads.size(), expected.size());
+  for (std::size_t i = 0; i < grads.size(); ++i)
+  {
+    EXPECT_EQ(grads[i].first, expected[i].first);
+    // 手書きの Affine はバイアスの勾配を (M) で返すが, テープはパラメータと同じ (1, M) で返す
+    EXPECT_EQ(grads[i].second.shape(), net.params[i].second->shape()) << grads[i].first;
+    ASSERT_EQ(grads[i].second.size(), expected[i].second.size()) << grads[i].first;
+    for (std::size_t j = 0; j < grads[i].second.size(); ++j)
+    {
+      EXPECT_NEAR(grads[i].second.Contiguous().data()[j], expected[i].second.Contiguous().data()[j], 1e-12)
+        << grads[i].first << " " << j;
+    }
+  }
+
+  // 反復ごとにテープを記録し直して学習する
+  SGD sgd(0.5);
+  const double first = loss.value()(0);
+  double last = first;
+  for (int i = 0; i < 100; ++i)
+  {
+    tape.clear();
+    variables.clear();
+    params.clear();
+    for (const auto &[name, param] : net.params)
+    {
+      variables.emplace_back(name, tape.parameter(*param));
+      params.push_back(variables.back().second);
+    }
+    const Variable l = TwoLayerLoss(tape, params, x, t);
+    last = l.value()(0);
+    tape.backward(l);
+    // パラメータとデータ領域を共有している記録を破棄してから更新し, 書き込み時の複製を避ける
+    const auto step_grads = tape.gradients(variables);
+    tape.clear();
+    sgd.update(net.params, step_grads);
+  }
+  EXPECT_LT(last, first * 0.5);
+}
+
+// ブロードキャストと要素ごとの演算, 縮約の勾配が中心差分による数値微分と一致するか確認する
+TEST(AutogradTest, MatchesNumericalGradient)
+{
+  const auto f = [](Tape &tape, const std::vector<Variable> &v)
+  {
+    const Variable &a = v[0];
+    const Variable &b = v[1];
+    const Variable &c = v[2];
+    // a は複数の演算で使うため, 勾配を足し合わせる
+    const Variable y = Variable::Sigmoid(a * b + c) / (Variable::Exp(a) + 1.0) - Variable::Log(b * b + 1.0);
+    const Variable z = Variable::Matmul(a, Variable::Transpose(a)).Reshape({9});
+    const Variable w = Variable::Sum(Variable::ReLU(a - 0.1), {1}, true) * (2.0 - c);
+    return Variable::Sum(y) + Variable::Mean(z) * 0.5 - Variable::Mean(-w) / 3.0;
+  };
+
+  std::vector<Tensor> inputs = {
+    Tensor::Random({3, 4}, 2),
+    Tensor::Random({1, 4}, 3),
+    Tensor::Random({1}, 4),
+  };
+
+  Tape tape;
+  std::vector<Variable> v;
+  for (const Tensor &input : inputs)
+  {
+    v.push_back(tape.parameter(input));
+  }
+  tape.backward(f(tape, v));
+
+  const auto evaluate = [&]()
+  {
+    Tape numeric;
+    std::vector<Variable> c;
+    for (const Tensor &input : inputs)
+    {
+      c.push_back(numeric.constant(input));
+    }
+    return f(numeric, c).value()(0);
+  };
+
+  constexpr double h = 1e-5;
+  for (std::size_t k = 0; k < inputs.size(); ++k)
+  {
+    const Tensor &grad = tape.gradient(v[k]);
+    ASSERT_EQ(grad.shape(), inputs[k].shape());
+    const Tensor analytic = grad.Contiguous();
+    for (std::size_t i = 0; i < inputs[k].size(); ++i)
+    {
+      const double original = inputs[k].data()[i];
+      inputs[k].data()[i] = original + h;
+      const double plus = evaluate();
+      inputs[k].data()[i] = original - h;
+      const double minus = evaluate();
+      inputs[k].data()[i] = original;
+      EXPECT_NEAR(analytic.data()[i], (plus - minus) / (2 * h), 1e-6) << k << " " << i;
+    }
+  }
+}
+
+// 逆伝播が終わると途中の活性と勾配が解放され, 定常状態ではシステムの確保が発生しないか確認する
+TEST(AutogradTest, ReleasesActivationsAfterUse)
+{
+  auto &pool = TensorMemoryPool::Instance();
+  const std::size_t width = 128;
+  const std::size_t depth = 8;
+  const Tensorf x = Tensorf::Random({64, width}, 5);
+  const Tensorf t = Tensorf::Fill({64}, 1.0f);
+
+  const std::size_t empty = pool.Stats().bytes_in_use;
+  std::vector<std::pair<std::string, Tensorf> > weights;
+  for (std::size_t i = 0; i < depth; ++i)
+  {
+    weights.emplace_back("W" + std::to_string(i), Tensorf::RandomNormal({width, width}, i) * 0.1f);
+  }
+  const std::size_t weight_bytes = pool.Stats().bytes_in_use - empty;
+
+  Tapef tape;
+  const auto step = [&]()
+  {
+    tape.clear();
+    std::vector<std::pair<std::string, Variablef> > variables;
+    Variablef h = tape.constant(x);
+    for (const auto &[name, W] : weights)
+    {
+      variables.emplace_back(name, tape.parameter(W));
+      h = Variablef::ReLU(Variablef::Matmul(h, variables.back().second)) * 1.5f;
+    }
+    const Variablef loss = Variablef::SoftmaxCrossEntropy(h, t);
+    const std::size_t forward_bytes = pool.Stats().bytes_in_use;
+    tape.backward(loss);
+    for (auto &[name, grad] : tape.gradients(variables))
+    {
+      EXPECT_EQ(grad.shape(), (Shape{width, width})) << name;
+    }
+    return forward_bytes;
+  };
+
+  const std::size_t forward_bytes = step();
+  // 順伝播の後は層ごとに 3 つの活性を保持している
+  EXPECT_GT(forward_bytes - empty, weight_bytes + depth * 2 * 64 * width * sizeof(float));
+  // 逆伝播の後に残るのは重みと同じ大きさの勾配と損失だけである
+  EXPECT_LE(pool.Stats().bytes_in_use - empty, 2 * weight_bytes + 4096);
+
+  step();
+  const auto before = pool.Stats();
+  for (int i = 0; i < 3; ++i)
+  {
+    step();
+  }
+  const auto after = pool.Stats();
+  EXPECT_EQ(after.system_allocations, before.system_allocations);
+}
+
+// テープの使い方の誤りを例外で知らせるか確認する
+TEST(AutogradTest, Errors)
+{
+  Tape tape;
+  Tape other;
+  const Variable a = tape.parameter(Tensor::Ones({2, 2}));
+  const Variable b = other.parameter(Tensor::Ones({2, 2}));
+  EXPECT_THROW(a + b, std::invalid_argument);
+  EXPECT_THROW(Variable::Matmul(a, Variable::Sum(a)), std::invalid_argument);
+  EXPECT_THROW(tape.backward(a), std::invalid_argument);
+
+  const Variable c = tape.constant(Tensor::Ones({2, 2}));
+  const Variable hidden = a * 3.0;
+  const Variable loss = Variable::Sum(hidden * c);
+  tape.backward(loss);
+  EXPECT_THROW(tape.gradient(c), std::invalid_argument);
+  EXPECT_THROW(hidden.value(), std::invalid_argument);
+  EXPECT_EQ(hidden.shape(), (Shape{2, 2}));
+  EXPECT_DOUBLE_EQ(loss.value()(0), 12.0);
+  EXPECT_TRUE(Tensor::Equal(tape.gradient(a), Tensor::Fill({2, 2}, 3.0)));
+  EXPECT_THROW(tape.backward(loss), std::invalid_argument);
+  EXPECT_THROW(tape.gradient(b), std::invalid_argument);
+}
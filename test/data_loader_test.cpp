@@ -0,0 +1,124 @@
+//
+// Created by toru on 2026/10/17.
+//
+
+#include <gtest/gtest.h>
+
+#include <set>
+
+#include "nagatolib.hpp"
+using namespace nagato;
+
+namespace
+{
+// i 番目のサンプルの入力を [i, i + 0.5], 教師データを [-i] にする
+std::pair<Tensorf, Tensorf> MakeSamples(std::size_t n)
+{
+  Tensorf x({n, 2});
+  Tensorf t({n, 1});
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    x(i, 0) = static_cast<float>(i);
+    x(i, 1) = static_cast<float>(i) + 0.5f;
+    t(i, 0) = -static_cast<float>(i);
+  }
+  return {x, t};
+}
+} // namespace
+
+// シャッフルしない場合はサンプルの順にバッチを作り, エポックをまたいで続けるか確認する
+TEST(DataLoaderTest, SequentialBatchesAcrossEpochs)
+{
+  const auto [x, t] = MakeSamples(10);
+  DataLoaderf loader(x, t, 4, false, 2, 1, false);
+  EXPECT_EQ(loader.BatchesPerEpoch(), 3u);
+
+  const std::size_t expected_rows[] = {4, 4, 2, 4, 4, 2};
+  std::size_t sample = 0;
+  for (std::size_t b = 0; b < 6; ++b)
+  {
+    const auto batch = loader.Next();
+    EXPECT_EQ(loader.Epoch(), b / 3);
+    ASSERT_EQ(batch.x.shape(), Shape({expected_rows[b], 2}));
+    ASSERT_EQ(batch.t.shape(), Shape({expected_rows[b], 1}));
+    for (std::size_t i = 0; i < expected_rows[b]; ++i, ++sample)
+    {
+      EXPECT_FLOAT_EQ(batch.x(i, 0), static_cast<float>(sample % 10));
+      EXPECT_FLOAT_EQ(batch.x(i, 1), static_cast<float>(sample % 10) + 0.5f);
+      EXPECT_FLOAT_EQ(batch.t(i, 0), -static_cast<float>(sample % 10));
+    }
+  }
+}
+
+// シャッフルした各エポックがすべてのサンプルを 1 回ずつ含み, 入力と教師データの対応が崩れないか確認する
+TEST(DataLoaderTest, ShuffledEpochsArePermutations)
+{
+  const auto [x, t] = MakeSamples(64);
+  DataLoaderf loader(x, t, 8, true, 3, 2, true, 42);
+  std::vector<float> first_epoch;
+  for (std::size_t epoch = 0; epoch < 3; ++epoch)
+  {
+    std::set<float> seen;
+    std::vector<float> order;
+    for (std::size_t b = 0; b < loader.BatchesPerEpoch(); ++b)
+    {
+      const auto batch = loader.Next();
+      for (std::size_t i = 0; i < 8; ++i)
+      {
+        EXPECT_FLOAT_EQ(batch.t(i, 0), -batch.x(i, 0));
+        seen.insert(batch.x(i, 0));
+        order.push_back(batch.x(i, 0));
+      }
+    }
+    EXPECT_EQ(seen.size(), 64u);
+    if (epoch == 0)
+    {
+      first_epoch = order;
+    }
+    else
+    {
+      EXPECT_NE(order, first_epoch);
+    }
+  }
+}
+
+// 定常状態ではバッファを使い回し, 保持したままのバッチは書き換えられないか確認する
+TEST(DataLoaderTest, ReusesBuffersWithoutClobberingHeldBatches)
+{
+  const auto [x, t] = MakeSamples(100);
+  DataLoaderf loader(x, t, 10, false, 2, 1);
+
+  std::vector<const float *> pointers;
+  for (std::size_t b = 0; b < 9; ++b)
+  {
+    const auto batch = loader.Next();
+    pointers.push_back(batch.x.data());
+  }
+  // prefetch + 1 = 3 個のバッファを巡回する
+  for (std::size_t b = 3; b < pointers.size(); ++b)
+  {
+    EXPECT_EQ(pointers[b], pointers[b - 3]);
+  }
+
+  const auto held = loader.Next();
+  for (std::size_t b = 0; b < 5; ++b)
+  {
+    loader.Next();
+  }
+  for (std::size_t i = 0; i < 10; ++i)
+  {
+    EXPECT_FLOAT_EQ(held.x(i, 0), static_cast<float>(90 + i));
+  }
+
+  // ワーカーを使わない場合も同じバッチを作る
+  DataLoaderf inline_loader(x, t, 10, false, 2, 0);
+  for (std::size_t b = 0; b < 12; ++b)
+  {
+    const auto batch = inline_loader.Next();
+    EXPECT_FLOAT_EQ(batch.x(9, 1), static_cast<float>((b % 10) * 10 + 9) + 0.5f);
+  }
+
+  EXPECT_THROW(DataLoaderf(x, t, 0), std::invalid_argument);
+  EXPECT_THROW(DataLoaderf(x, t, 101), std::invalid_argument);
+  EXPECT_THROW(DataLoaderf(x, t.Slice(0, 49), 10), std::invalid_argument);
+}
@@ -0,0 +1,128 @@
+//
+// Created by toru on 2026/10/17.
+//
+
+#include <gtest/gtest.h>
+#include <random>
+
+#include "nagatolib.hpp"
+using namespace nagato;
+
+/**
+ * @brief 比較用の素朴な行列積. C = A * B (A, B は任意のストライド)
+ */
+std::vector<double> ReferenceGemm(std::size_t M,
+                                  std::size_t N,
+                                  std::size_t K,
+                                  const std::vector<double> &A,
+                                  std::size_t rs_a,
+                                  std::size_t cs_a,
+                                  const std::vector<double> &B,
+                                  std::size_t rs_b,
+                                  std::size_t cs_b)
+{
+  std::vector<double> C(M * N, 0.0);
+  for (std::size_t i = 0; i < M; ++i)
+  {
+    for (std::size_t j = 0; j < N; ++j)
+    {
+      for (std::size_t k = 0; k < K; ++k)
+      {
+        C[i * N + j] += A[i * rs_a + k * cs_a] * B[k * rs_b + j * cs_b];
+      }
+    }
+  }
+  return C;
+}
+
+std::vector<double> RandomVector(std::size_t size, unsigned int seed)
+{
+  std::mt19937 gen(seed);
+  std::uniform_real_distribution<double> dis(-1.0, 1.0);
+  std::vector<double> v(size);
+  for (auto &x : v)
+  {
+    x = dis(gen);
+  }
+  return v;
+}
+
+// ブロックサイズの端数を含むさまざまな形状で素朴な実装と一致するか確認する
+TEST(GemmTest, MatchesReference)
+{
+  const std::vector<std::array<std::size_t, 3>> shapes = {
+    {1, 1, 1}, {3, 5, 7}, {13, 17, 19}, {100, 50, 784}, {64, 64, 300}, {129, 257, 65}
+  };
+
+  for (const auto &[M, N, K] : shapes)
+  {
+    const auto A = RandomVector(M * K, 1);
+    const auto B = RandomVector(K * N, 2);
+    std::vector<double> C(M * N, 123.0);
+    Gemm(M, N, K, A.data(), K, 1, B.data(), N, 1, C.data(), N);
+
+    const auto expected = ReferenceGemm(M, N, K, A, K, 1, B, N, 1);
+    for (std::size_t i = 0; i < M * N; ++i)
+    {
+      ASSERT_NEAR(C[i], expected[i], 1e-9) << M << "x" << N << "x" << K << " index " << i;
+    }
+  }
+}
+
+// 転置した (列方向に連続した) 入力をそのまま扱えるか確認する
+TEST(GemmTest, StridedInput)
+{
+  const std::size_t M = 70, N = 45, K = 90;
+  // A は K x M の行列を転置したもの, B は N x K の行列を転置したもの
+  const auto A = RandomVector(M * K, 3);
+  const auto B = RandomVector(K * N, 4);
+  std::vector<double> C(M * N);
+  Gemm(M, N, K, A.data(), 1, M, B.data(), 1, K, C.data(), N);
+
+  const auto expected = ReferenceGemm(M, N, K, A, 1, M, B, 1, K);
+  for (std::size_t i = 0; i < M * N; ++i)
+  {
+    ASSERT_NEAR(C[i], expected[i], 1e-9);
+  }
+}
+
+// accumulate が真の場合は C に加算されるか確認する
+TEST(GemmTest, Accumulate)
+{
+  const std::size_t M = 40, N = 33, K = 600;
+  const auto A = RandomVector(M * K, 5);
+  const auto B = RandomVector(K * N, 6);
+  std::vector<double> C(M * N, 1.0);
+  Gemm(M, N, K, A.data(), K, 1, B.data(), N, 1, C.data(), N, true);
+
+  const auto expected = ReferenceGemm(M, N, K, A, K, 1, B, N, 1);
+  for (std::size_t i = 0; i < M * N; ++i)
+  {
+    ASSERT_NEAR(C[i], expected[i] + 1.0, 1e-9);
+  }
+}
+
+// Tensor::Matmul が MNIST 相当の形状で正しく計算できるか確認する
+TEST(GemmTest, TensorMatmulBatch)
+{
+  Tensor a = Tensor::Random({3, 20, 784});
+  Tensor b = Tensor::Random({3, 784, 50});
+  Tensor c = Tensor::Matmul(a, b);
+  EXPECT_EQ(c.shape(), (std::vector<std::size_t>{3, 20, 50}));
+
+  for (std::size_t n = 0; n < 3; ++n)
+  {
+    for (std::size_t i = 0; i < 20; ++i)
+    {
+      for (std::size_t j = 0; j < 50; ++j)
+      {
+        double expected = 0;
+        for (std::size_t k = 0; k < 784; ++k)
+        {
+          expected += a(n, i, k) * b(n, k, j);
+        }
+        ASSERT_NEAR(c(n, i, j), expected, 1e-9);
+      }
+    }
+  }
+}
@@ -345,7 +345,7 @@ TEST(MatrixNTest, MatrixMultiplication_12_12)
   MatrixN<float> b = {
     {3, 4},
   };
-  MatrixN<float> c = {
+  MatrixN<float> c = std::initializer_list<std::initializer_list<float>>{
     {11},
   };
 
@@ -0,0 +1,195 @@
+//
+// Created by toru on 2026/10/17.
+//
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+#include "nagatolib.hpp"
+using namespace nagato;
+
+namespace
+{
+std::string TempPath(const std::string &name)
+{
+  return ::testing::TempDir() + "nagato_" + name;
+}
+
+// ファイルにバイト列をそのまま書き込む
+void WriteBytes(const std::string &filename, const std::string &bytes)
+{
+  std::ofstream file(filename, std::ios::binary);
+  file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+}
+
+// .npy のヘッダを手で組み立てる
+std::string NpyBytes(const std::string &dict, const std::string &data)
+{
+  std::string header = dict;
+  while ((10 + header.size() + 1) % 64 != 0)
+  {
+    header.push_back(' ');
+  }
+  header.push_back('\n');
+  std::string bytes("\x93NUMPY\x01\x00", 8);
+  bytes.push_back(static_cast<char>(header.size() & 0xFF));
+  bytes.push_back(static_cast<char>(header.size() >> 8));
+  return bytes + header + data;
+}
+
+template<typename T>
+void ExpectSameTensor(const BasicTensor<T> &expected, const BasicTensor<T> &actual)
+{
+  ASSERT_EQ(expected.shape(), actual.shape());
+  const BasicTensor<T> a = expected.Contiguous();
+  const BasicTensor<T> b = actual.Contiguous();
+  EXPECT_EQ(std::memcmp(a.data(), b.data(), a.size() * sizeof(T)), 0);
+}
+} // namespace
+
+// すべての要素型で書き込んだテンソルを読み込めるか確認する
+TEST(NpyTest, RoundTripsEachType)
+{
+  const std::string path = TempPath("round_trip.npy");
+
+  // 連続していないビューも詰めて書き込む
+  const Tensorf f = Tensorf::Transpose(Tensorf::Random({3, 5}));
+  SaveNpy(path, f);
+  ExpectSameTensor(f, LoadNpy<float>(path));
+
+  const BasicTensor<double> d = BasicTensor<double>::Random({2, 3, 4});
+  SaveNpy(path, d);
+  ExpectSameTensor(d, LoadNpy<double>(path));
+
+  const BasicTensor<std::int32_t> i = BasicTensor<std::int32_t>::FromArray({{-7, 0, 3}, {2147483647, -1, 8}});
+  SaveNpy(path, i);
+  ExpectSameTensor(i, LoadNpy<std::int32_t>(path));
+
+  const BasicTensor<std::uint8_t> u = BasicTensor<std::uint8_t>::FromArray({0, 1, 200, 255});
+  SaveNpy(path, u);
+  ExpectSameTensor(u, LoadNpy<std::uint8_t>(path));
+
+  const Tensorh h = Tensorf::Random({4, 9}).AsType<Half>();
+  SaveNpy(path, h);
+  ExpectSameTensor(h, LoadNpy<Half>(path, NpyLoadMode::MemoryMap));
+  const Tensorf widened = LoadNpy<float>(path);
+  EXPECT_EQ(widened(3, 8), static_cast<float>(h(3, 8)));
+
+  const BasicTensor<Bool> b = BasicTensor<Bool>::FromArray({Bool(true), Bool(false), Bool(true)});
+  SaveNpy(path, b);
+  ExpectSameTensor(b, LoadNpy<Bool>(path, NpyLoadMode::MemoryMap));
+
+  // ヘッダは numpy と同じ形式で, データは 64 バイト境界から始まる
+  std::ifstream file(path, std::ios::binary);
+  std::string bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  EXPECT_EQ(bytes.size(), 128u + 3u);
+  EXPECT_NE(bytes.find("{'descr': '|b1', 'fortran_order': False, 'shape': (3,), }"), std::string::npos);
+  EXPECT_EQ(bytes[127], '\n');
+}
+
+// メモリに割り当てて読み込んだテンソルへの書き込みがファイルに反映されないか確認する
+TEST(NpyTest, MemoryMapIsCopyOnWrite)
+{
+  const std::string path = TempPath("mapped.npy");
+  const Tensorf expected = Tensorf::Random({64, 33});
+  SaveNpy(path, expected);
+
+  Tensorf mapped = LoadNpy<float>(path, NpyLoadMode::MemoryMap);
+  ExpectSameTensor(expected, mapped);
+
+  // ビューはデータ領域を共有したまま, ファイルを割り当てたままにする
+  Tensorf row = mapped.Slice(10);
+  mapped = Tensorf();
+  EXPECT_FLOAT_EQ(row(5), expected(10, 5));
+
+  row(5) = 123.0f;
+  EXPECT_FLOAT_EQ(row(5), 123.0f);
+  ExpectSameTensor(expected, LoadNpy<float>(path));
+}
+
+// .npz に書き込んだ複数のテンソルを読み込めるか確認する
+TEST(NpyTest, NpzRoundTrip)
+{
+  const std::string path = TempPath("arrays.npz");
+  std::map<std::string, Tensorf> tensors;
+  tensors["weight"] = Tensorf::Random({7, 3});
+  tensors["bias"] = Tensorf::Random({3});
+  tensors["w"] = Tensorf::Random({1});
+  SaveNpz(path, tensors);
+
+  for (const auto mode : {NpyLoadMode::Copy, NpyLoadMode::MemoryMap})
+  {
+    const auto loaded = LoadNpz<float>(path, mode);
+    ASSERT_EQ(loaded.size(), tensors.size());
+    for (const auto &[name, tensor] : tensors)
+    {
+      ASSERT_TRUE(loaded.contains(name)) << name;
+      ExpectSameTensor(tensor, loaded.at(name));
+      EXPECT_EQ(reinterpret_cast<std::uintptr_t>(loaded.at(name).data()) % 64, 0u);
+    }
+  }
+
+  // 要素型の異なるテンソルとして読み込むと変換する
+  const auto converted = LoadNpz<double>(path);
+  EXPECT_DOUBLE_EQ(converted.at("weight")(6, 2), static_cast<double>(tensors["weight"](6, 2)));
+}
+
+// バイト順と要素型の異なる列優先の配列を変換して読み込めるか確認する
+TEST(NpyTest, ConvertsByteOrderAndFortranOrder)
+{
+  const std::string path = TempPath("fortran.npy");
+
+  // 2x3 の配列 [[0, 1, 2], [3, 4, 5]] を列優先, ビッグエンディアンの float64 で格納する
+  std::string data;
+  for (const double value : {0.0, 3.0, 1.0, 4.0, 2.0, 5.0})
+  {
+    unsigned char bytes[8];
+    std::memcpy(bytes, &value, 8);
+    if (std::endian::native == std::endian::little)
+    {
+      std::reverse(bytes, bytes + 8);
+    }
+    data.append(reinterpret_cast<const char *>(bytes), 8);
+  }
+  WriteBytes(path, NpyBytes("{'descr': '>f8', 'fortran_order': True, 'shape': (2, 3), }", data));
+
+  for (const auto mode : {NpyLoadMode::Copy, NpyLoadMode::MemoryMap})
+  {
+    const Tensorf f = LoadNpy<float>(path, mode);
+    ASSERT_EQ(f.shape(), Shape({2, 3}));
+    for (std::size_t i = 0; i < 2; ++i)
+    {
+      for (std::size_t j = 0; j < 3; ++j)
+      {
+        EXPECT_FLOAT_EQ(f(i, j), static_cast<float>(i * 3 + j));
+      }
+    }
+  }
+
+  // 0 次元の配列は形状 {1} になる
+  WriteBytes(path, NpyBytes("{'descr': '<i2', 'fortran_order': False, 'shape': (), }", std::string("\xfe\xff", 2)));
+  const BasicTensor<std::int32_t> scalar = LoadNpy<std::int32_t>(path);
+  ASSERT_EQ(scalar.shape(), Shape({1}));
+  EXPECT_EQ(scalar(0), -2);
+}
+
+// 不正なファイルを読み込むと例外を投げるか確認する
+TEST(NpyTest, RejectsInvalidFiles)
+{
+  const std::string path = TempPath("invalid.npy");
+  EXPECT_THROW(LoadNpy<float>(TempPath("missing.npy")), std::runtime_error);
+
+  WriteBytes(path, "not a numpy file");
+  EXPECT_THROW(LoadNpy<float>(path), std::invalid_argument);
+  EXPECT_THROW(LoadNpz<float>(path), std::invalid_argument);
+
+  WriteBytes(path, NpyBytes("{'descr': '<c8', 'fortran_order': False, 'shape': (1,), }", std::string(8, '\0')));
+  EXPECT_THROW(LoadNpy<float>(path), std::invalid_argument);
+
+  WriteBytes(path, NpyBytes("{'descr': '<f4', 'fortran_order': False, 'shape': (4,), }", std::string(8, '\0')));
+  EXPECT_THROW(LoadNpy<float>(path), std::invalid_argument);
+}
@@ -0,0 +1,110 @@
+//
+// Created by toru on 2026/10/17.
+//
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdlib>
+
+#include "nagatolib.hpp"
+using namespace nagato;
+
+// 範囲から求めたパラメータで 0 と両端を表せるか確認する
+TEST(QuantizeTest, ParamsFromRange)
+{
+  const auto params = QuantizationParams::FromRange(-1.0f, 3.0f);
+  EXPECT_FLOAT_EQ(params.scale, 4.0f / 255.0f);
+  EXPECT_EQ(params.zero_point, 64);
+
+  const float x[] = {-1.0f, 0.0f, 3.0f, 10.0f, -10.0f};
+  std::uint8_t q[5];
+  Quantize(x, 5, params, q);
+  EXPECT_EQ(q[0], 0);
+  EXPECT_EQ(q[1], 64);
+  EXPECT_EQ(q[2], 255);
+  EXPECT_EQ(q[3], 255);
+  EXPECT_EQ(q[4], 0);
+
+  // ReLU の出力のように負の値がない場合はゼロ点を 0 にする
+  EXPECT_EQ(QuantizationParams::FromRange(0.5f, 2.0f).zero_point, 0);
+  EXPECT_FLOAT_EQ(QuantizationParams::FromRange(0.0f, 0.0f).scale, 1.0f);
+}
+
+// パネルと行のタイルの端数を含む形状で, 量子化した Affine が浮動小数点数の計算に近いか確認する
+TEST(QuantizeTest, AffineMatchesFloat)
+{
+  const std::size_t rows = 13;
+  const std::size_t K = 37;
+  const std::size_t M = 70;
+  const Tensorf x = Tensorf::Random({rows, K});
+  const Tensorf W = Tensorf::Random({K, M});
+  const Tensorf b = Tensorf::Random({1, M});
+  const Tensorf expected = Tensorf::Matmul(x, W) + b;
+
+  const auto input = QuantizationParams::FromRange(-1.0f, 1.0f);
+  for (const bool relu : {false, true})
+  {
+    const QuantizedAffine affine(W, b, input, relu);
+    ASSERT_EQ(affine.padded_input_size(), 40u);
+
+    std::vector<std::uint8_t> q(rows * affine.padded_input_size());
+    for (std::size_t i = 0; i < rows; ++i)
+    {
+      Quantize(x.data() + i * K, K, input, q.data() + i * affine.padded_input_size());
+    }
+    std::vector<float> y(rows * M);
+    affine.forward(q.data(), rows, y.data());
+
+    const auto output = QuantizationParams::FromRange(-40.0f, 40.0f);
+    std::vector<std::uint8_t> yq(rows * 72, 0);
+    affine.forward(q.data(), rows, output, yq.data(), 72);
+
+    for (std::size_t i = 0; i < rows; ++i)
+    {
+      for (std::size_t j = 0; j < M; ++j)
+      {
+        const float reference = relu ? std::max(expected(i, j), 0.0f) : expected(i, j);
+        EXPECT_NEAR(y[i * M + j], reference, 0.1f) << i << ", " << j;
+        const float dequantized = static_cast<float>(yq[i * 72 + j] - output.zero_point) * output.scale;
+        EXPECT_NEAR(dequantized, y[i * M + j], output.scale) << i << ", " << j;
+      }
+    }
+  }
+
+  EXPECT_THROW(QuantizedAffine(W, Tensorf::Zeros({1, M + 1}), input), std::invalid_argument);
+}
+
+// 学習したネットワークを量子化しても出力と認識精度がほとんど変わらないか確認する
+TEST(QuantizeTest, TwoLayerNetKeepsAccuracy)
+{
+  // 入力 ([-1, 1)) の最初の 2 次元の符号で 4 クラスに分ける
+  const std::size_t n = 256;
+  const Tensorf x = Tensorf::Random({n, 10});
+  Tensorf t = Tensorf::Zeros({n, 4});
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    t(i, (x(i, 0) > 0 ? 1 : 0) + (x(i, 1) > 0 ? 2 : 0)) = 1.0f;
+  }
+
+  TwoLayerNetf net(10, 32, 4);
+  SGDf sgd(0.5);
+  for (int i = 0; i < 500; ++i)
+  {
+    auto grads = net.gradient(x, t);
+    sgd.update(net.params, grads);
+  }
+  const float accuracy = net.accuracy(x, t);
+  ASSERT_GT(accuracy, 0.9f);
+
+  const QuantizedTwoLayerNetf quantized(net, {x.Slice(0, 127), x.Slice(128, 255)});
+  const Tensorf expected = net.predict(x);
+  const Tensorf y = quantized.predict(x);
+  ASSERT_EQ(y.shape(), expected.shape());
+  const float max = Tensorf::Max(Tensorf::Abs(expected), {})(0);
+  EXPECT_LT(Tensorf::Max(Tensorf::Abs(y - expected), {})(0), 0.05f * max);
+  EXPECT_NEAR(quantized.accuracy(x, t), accuracy, 0.03f);
+
+  EXPECT_THROW(quantized.predict(Tensorf::Zeros({2, 9})), std::invalid_argument);
+  EXPECT_THROW(QuantizedTwoLayerNetf(net, {}), std::invalid_argument);
+}
@@ -0,0 +1,166 @@
+//
+// Created by toru on 2026/10/17.
+//
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <vector>
+
+#include "random.hpp"
+using namespace nagato;
+
+// 乗算が 2 倍の幅で正しく計算され, 先に進める処理が 1 つずつ進めた場合と一致するか確認する
+TEST(RandomTest, LinearCongruentialDiscard)
+{
+  LinearCongruential<std::uint32_t> small(1);
+  EXPECT_EQ(small.next(), 48271u);
+  EXPECT_EQ(small.next(), 48271ull * 48271ull % 0xffffffffull);
+
+  LinearCongruential<> stepped(12345);
+  LinearCongruential<> jumped(12345);
+  for (int i = 0; i < 1000; ++i)
+  {
+    stepped.next();
+  }
+  jumped.discard(1000);
+  EXPECT_EQ(jumped.next(), stepped.next());
+
+  // 巨大な数だけ進めても O(log n) で計算できる
+  LinearCongruential<> a(7);
+  LinearCongruential<> b(7);
+  a.discard(1ull << 40);
+  a.discard(1ull << 40);
+  b.discard(1ull << 41);
+  EXPECT_EQ(a.next(), b.next());
+
+  static_assert([]
+  {
+    LinearCongruential<std::uint32_t> x(3);
+    LinearCongruential<std::uint32_t> y(3);
+    x.next();
+    x.next();
+    y.discard(2);
+    return x.next() == y.next();
+  }());
+
+  // 2^w - 1 で割り切れるシードでも状態が 0 に留まらない
+  for (const std::uint32_t seed : {0u, 0xffffffffu})
+  {
+    LinearCongruential<std::uint32_t> zero(seed);
+    EXPECT_EQ(zero.seed(), seed);
+    const std::uint32_t first = zero.next();
+    EXPECT_GE(first, zero.min());
+    EXPECT_NE(zero.next(), first);
+  }
+  const auto streams = LinearCongruential<>::streams(0, 3, 1000);
+  std::vector<std::uint64_t> starts;
+  for (LinearCongruential<> stream : streams)
+  {
+    starts.push_back(stream.next());
+    EXPECT_NE(starts.back(), 0u);
+  }
+  EXPECT_NE(starts[0], starts[1]);
+  EXPECT_NE(starts[1], starts[2]);
+}
+
+// 乱数列が元の乱数列を stride ずつ進めた位置から始まり, まとめて埋めた値が 1 つずつ生成した値と一致するか確認する
+TEST(RandomTest, LinearCongruentialStreamsAndFill)
+{
+  const auto streams = LinearCongruential<>::streams(99, 4, 1000);
+  ASSERT_EQ(streams.size(), 4u);
+  LinearCongruential<> reference(99);
+  for (std::size_t i = 0; i < streams.size(); ++i)
+  {
+    LinearCongruential<> stream = streams[i];
+    LinearCongruential<> expected = reference;
+    EXPECT_EQ(stream.next(), expected.next()) << i;
+    reference.discard(1000);
+  }
+
+  for (const std::size_t n : {std::size_t(0), std::size_t(3), std::size_t(4), std::size_t(1001)})
+  {
+    LinearCongruential<> filled(5);
+    LinearCongruential<> stepped(5);
+    std::vector<double> real(n);
+    std::vector<int> integer(n);
+    filled.fill_uniform_real(std::span<double>(real), -1.0, 1.0);
+    filled.fill_uniform_int(std::span<int>(integer), 0, 100);
+    for (std::size_t i = 0; i < n; ++i)
+    {
+      EXPECT_EQ(real[i], (stepped.uniform_real<double>(-1.0, 1.0))) << i;
+    }
+    for (std::size_t i = 0; i < n; ++i)
+    {
+      EXPECT_EQ(integer[i], (stepped.uniform_int<int>(0, 100))) << i;
+    }
+    EXPECT_EQ(filled.next(), stepped.next()) << n;
+  }
+
+  // 乱数生成器として std の分布にも渡せる
+  LinearCongruential<> engine(3);
+  std::uniform_real_distribution<double> distribution(0.0, 1.0);
+  const double x = distribution(engine);
+  EXPECT_GE(x, 0.0);
+  EXPECT_LT(x, 1.0);
+}
+
+// 配列をまとめて埋める処理と, 1 つのシードから作った乱数列を確認する
+TEST(RandomTest, RandomFillAndStreams)
+{
+  Random<> a(1);
+  Random<> b(1);
+  std::vector<float> x(1000);
+  std::vector<float> y(1000);
+  a.fill_uniform_real(std::span<float>(x), -2.0, 3.0);
+  b.fill_uniform_real(std::span<float>(y), -2.0, 3.0);
+  EXPECT_EQ(x, y);
+  for (const float v : x)
+  {
+    EXPECT_GE(v, -2.0f);
+    EXPECT_LT(v, 3.0f);
+  }
+
+  std::vector<double> normal(1 << 16);
+  a.fill_normal(std::span<double>(normal), 1.0, 2.0);
+  double sum = 0;
+  double square = 0;
+  for (const double v : normal)
+  {
+    sum += v;
+    square += (v - 1.0) * (v - 1.0);
+  }
+  EXPECT_NEAR(sum / normal.size(), 1.0, 0.05);
+  EXPECT_NEAR(std::sqrt(square / normal.size()), 2.0, 0.05);
+
+  std::vector<int> dice(1000);
+  a.fill_uniform_int(std::span<int>(dice), 1, 6);
+  for (const int v : dice)
+  {
+    EXPECT_GE(v, 1);
+    EXPECT_LE(v, 6);
+  }
+
+  // long double は std の分布で生成する
+  std::vector<long double> wide(10);
+  a.fill(std::span<long double>(wide), std::uniform_real_distribution<long double>(0.0L, 1.0L));
+  for (const long double v : wide)
+  {
+    EXPECT_GE(v, 0.0L);
+    EXPECT_LT(v, 1.0L);
+  }
+
+  // 同じシードからは同じ乱数列ができ, 乱数列ごとに値が異なる
+  auto first = Random<>::streams(42, 3);
+  auto second = Random<>::streams(42, 3);
+  ASSERT_EQ(first.size(), 3u);
+  std::vector<double> values;
+  for (std::size_t i = 0; i < first.size(); ++i)
+  {
+    const double v = first[i].uniform_real_distribution<double>(0.0, 1.0);
+    EXPECT_EQ(v, (second[i].uniform_real_distribution<double>(0.0, 1.0)));
+    values.push_back(v);
+  }
+  EXPECT_NE(values[0], values[1]);
+  EXPECT_NE(values[1], values[2]);
+}
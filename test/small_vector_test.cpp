@@ -0,0 +1,97 @@
+//
+// Created by toru on 2026/10/17.
+//
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "nagatolib.hpp"
+using namespace nagato;
+
+namespace
+{
+/// operator new の呼び出し回数
+std::atomic<std::size_t> heap_allocations{0};
+} // namespace
+
+// テスト中のヒープ確保を数えるために置き換える
+void *operator new(std::size_t size)
+{
+  heap_allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void *p = std::malloc(size == 0 ? 1 : size))
+  {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+  std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+  std::free(p);
+}
+
+// 内部の配列に収まる場合と, ヒープへ移る場合の基本的な操作を確認する
+TEST(SmallVectorTest, InlineAndHeapStorage)
+{
+  SmallVector<int, 4> v = {1, 2, 3};
+  const int *inline_data = v.data();
+  const std::size_t before = heap_allocations.load();
+  v.push_back(4);
+  EXPECT_EQ(v.data(), inline_data);
+  EXPECT_EQ(v.capacity(), 4u);
+  EXPECT_EQ(heap_allocations.load(), before);
+
+  // 容量を超えるとヒープへ移り, 値は保たれる
+  v.push_back(5);
+  EXPECT_NE(v.data(), inline_data);
+  EXPECT_EQ(heap_allocations.load(), before + 1);
+  EXPECT_EQ(v, (std::vector<int>{1, 2, 3, 4, 5}));
+
+  v.insert(v.begin() + 1, {7, 8});
+  v.erase(v.begin());
+  EXPECT_EQ(v, (std::vector<int>{7, 8, 2, 3, 4, 5}));
+  v.insert(v.end(), v.begin(), v.begin() + 2);
+  EXPECT_EQ(v, (std::vector<int>{7, 8, 2, 3, 4, 5, 7, 8}));
+
+  // コピーとムーブ
+  SmallVector<int, 4> copy = v;
+  SmallVector<int, 4> moved = std::move(v);
+  EXPECT_EQ(copy, moved);
+  moved.resize(2);
+  copy = moved;
+  EXPECT_EQ(copy, (std::vector<int>{7, 8}));
+
+  // std::vector との相互変換
+  const std::vector<int> converted = copy;
+  EXPECT_EQ(converted, (std::vector<int>{7, 8}));
+  EXPECT_EQ((SmallVector<int, 4>(converted)), copy);
+}
+
+// テンソルの作成と形状の操作でヒープ確保が発生しないか確認する
+TEST(SmallVectorTest, TensorMetadataDoesNotAllocate)
+{
+  // データ領域はプールのキャッシュに載せておく
+  {
+    Tensor warmup_a({4, 6});
+    Tensor warmup_b({4, 6});
+  }
+
+  const std::size_t before = heap_allocations.load();
+  {
+    Tensor a({4, 6});
+    Tensor b = a.Reshape({2, 12});
+    Tensor c = Tensor::Transpose(a);
+    Tensor::IsSameShape(a, a);
+    EXPECT_EQ(Tensor::IsBroadcastable(a, a), Tensor::IsBroadcastable(c, c));
+    EXPECT_EQ(b.shape(), (Shape{2, 12}));
+    EXPECT_EQ(c.strides(), (Shape{1, 6}));
+  }
+  EXPECT_EQ(heap_allocations.load(), before);
+}
@@ -0,0 +1,92 @@
+//
+// Created by toru on 2026/10/17.
+//
+
+#include <gtest/gtest.h>
+
+#include "nagatolib.hpp"
+using namespace nagato;
+
+// 同じサイズクラスの確保はキャッシュから再利用されるか確認する
+TEST(TensorAllocatorTest, ReusesFreedStorage)
+{
+  auto &pool = TensorMemoryPool::Instance();
+  {
+    Tensor warmup_a({100, 50});
+    Tensor warmup_b({100, 50});
+  }
+
+  const auto before = pool.Stats();
+  for (int i = 0; i < 10; ++i)
+  {
+    // 要素数が少し異なっても同じサイズクラスに切り上げられる
+    Tensor a({100, 50});
+    Tensor b({100, 49});
+  }
+  const auto after = pool.Stats();
+  EXPECT_EQ(after.system_allocations, before.system_allocations);
+  EXPECT_GE(after.cache_hits, before.cache_hits + 20);
+  EXPECT_EQ(after.bytes_in_use, before.bytes_in_use);
+
+  // 領域は 64 バイト境界に揃っている
+  const Tensor c({3, 7});
+  EXPECT_EQ(reinterpret_cast<std::uintptr_t>(c.data()) % 64, 0u);
+}
+
+// 学習の反復が定常状態になるとシステムの確保・解放が発生しないか確認する
+TEST(TensorAllocatorTest, SteadyStateTrainingDoesNotAllocate)
+{
+  auto &pool = TensorMemoryPool::Instance();
+  Tensor x = Tensor::Random({32, 20});
+  Tensor t = Tensor::Zeros({32, 5});
+  for (std::size_t i = 0; i < 32; ++i)
+  {
+    t(i, i % 5) = 1;
+  }
+
+  TwoLayerNet net(20, 16, 5, 0.1);
+  Momentum optimizer(0.1, 0.9);
+  const auto step = [&]()
+  {
+    auto grads = net.gradient(x, t);
+    optimizer.update(net.params, grads);
+  };
+
+  step();
+  step();
+  const auto before = pool.Stats();
+  for (int i = 0; i < 5; ++i)
+  {
+    step();
+  }
+  const auto after = pool.Stats();
+  EXPECT_GT(after.allocations, before.allocations);
+  EXPECT_EQ(after.system_allocations, before.system_allocations);
+  EXPECT_EQ(after.system_frees, before.system_frees);
+}
+
+// Trim でキャッシュを解放し, メモリリソースを差し替えられるか確認する
+TEST(TensorAllocatorTest, TrimAndCustomResource)
+{
+  auto &pool = TensorMemoryPool::Instance();
+  {
+    Tensor a({256, 256});
+  }
+  EXPECT_GT(pool.Stats().bytes_cached, 0u);
+  pool.Trim();
+  EXPECT_EQ(pool.Stats().bytes_cached, 0u);
+
+  // 差し替えたリソースから確保したテンソルはプールを経由しない
+  auto *previous = SetTensorMemoryResource(std::pmr::new_delete_resource());
+  EXPECT_EQ(previous, &pool);
+  const auto before = pool.Stats();
+  Tensor b = Tensor::Ones({64, 64});
+  Tensor c = b * 2.0;
+  EXPECT_EQ(pool.Stats().allocations, before.allocations);
+  SetTensorMemoryResource(nullptr);
+  EXPECT_EQ(GetTensorMemoryResource(), &pool);
+
+  // 切り替え後も元のリソースへ返却され, 値も変わらない
+  c += 1.0;
+  EXPECT_EQ(c(63, 63), 3.0);
+}
@@ -1,5 +1,7 @@
 #include <gtest/gtest.h>
 
+#include <fstream>
+
 #include "nagatolib.hpp"
 using namespace nagato;
 
@@ -1494,6 +1496,63 @@ TEST(TensorTransposeTest, Rank4) {
     EXPECT_EQ(transposed.storage(), expected_storage);
 }
 
+// タイルの端数を含む大きさの転置を要素ごとの添字計算と比較する
+TEST(TensorTransposeTest, LargePermutations) {
+    const std::vector<std::size_t> shape = {3, 5, 37, 41};
+    Tensor a(shape);
+    for (std::size_t i = 0; i < a.storage().size(); ++i)
+    {
+        a.storage()[i] = static_cast<Tensor::value_type>(i);
+    }
+
+    const std::vector<std::vector<std::size_t>> permutations = {
+        {0, 1, 3, 2}, {3, 2, 1, 0}, {0, 3, 1, 2}, {2, 0, 3, 1}, {1, 0, 2, 3}};
+    for (const auto &axes : permutations)
+    {
+        const Tensor transposed = Tensor::Transpose(a, axes).Contiguous();
+        ASSERT_TRUE(transposed.IsContiguous());
+
+        const auto &storage = transposed.storage();
+        std::vector<std::size_t> index(4, 0);
+        for (std::size_t i = 0; i < storage.size(); ++i)
+        {
+            // 転置後の添字 index を元のテンソルの線形な位置に変換する
+            std::size_t offset = 0;
+            for (std::size_t d = 0; d < 4; ++d)
+            {
+                std::size_t stride = 1;
+                for (std::size_t e = axes[d] + 1; e < 4; ++e)
+                {
+                    stride *= shape[e];
+                }
+                offset += index[d] * stride;
+            }
+            ASSERT_EQ(storage[i], static_cast<Tensor::value_type>(offset));
+
+            for (std::size_t d = 4; d-- > 0;)
+            {
+                if (++index[d] < shape[axes[d]])
+                {
+                    break;
+                }
+                index[d] = 0;
+            }
+        }
+    }
+
+    // im2col で使う 6 次元の並べ替え. 連続する軸がまとめられて 2 次元の転置になる
+    Tensor col({2, 3, 3, 3, 10, 12});
+    for (std::size_t i = 0; i < col.storage().size(); ++i)
+    {
+        col.storage()[i] = static_cast<Tensor::value_type>(i);
+    }
+    const Tensor permuted = Tensor::Transpose(col, {0, 4, 5, 1, 2, 3}).Contiguous();
+    const std::vector<std::size_t> expected_shape = {2, 10, 12, 3, 3, 3};
+    EXPECT_EQ(permuted.shape(), expected_shape);
+    EXPECT_EQ(permuted(1, 7, 5, 2, 0, 1), col(1, 2, 0, 1, 7, 5));
+    EXPECT_EQ(permuted(0, 9, 11, 0, 2, 2), col(0, 0, 2, 2, 9, 11));
+}
+
 #include "network.hpp"  // im2col 関数が宣言されているヘッダ
 #include "tensor.hpp"
 
@@ -1601,4 +1660,1025 @@ TEST(NetworkIm2ColTest, BatchSize2) {
         27.0f, 28.0f, 31.0f, 32.0f
     };
     EXPECT_EQ(col.storage(), expected_storage);
-}
\ No newline at end of file
+}
+// パディングとストライドがある場合を素朴な実装と比較する
+TEST(NetworkIm2ColTest, PaddingAndStride) {
+    const std::size_t N = 2, C = 3, H = 7, W = 6;
+    const std::size_t filter_h = 3, filter_w = 2, stride = 2, pad = 1;
+    Tensor input({N, C, H, W});
+    for (std::size_t i = 0; i < input.storage().size(); ++i)
+    {
+        input.storage()[i] = static_cast<double>(i) + 1.0;
+    }
+
+    const Tensor col = im2col(input, filter_h, filter_w, stride, pad);
+    const std::size_t out_h = (H + 2 * pad - filter_h) / stride + 1;
+    const std::size_t out_w = (W + 2 * pad - filter_w) / stride + 1;
+    const std::vector<std::size_t> expected_shape = {N * out_h * out_w, C * filter_h * filter_w};
+    ASSERT_EQ(col.shape(), expected_shape);
+
+    for (std::size_t n = 0; n < N; ++n)
+    for (std::size_t i = 0; i < out_h; ++i)
+    for (std::size_t j = 0; j < out_w; ++j)
+    for (std::size_t c = 0; c < C; ++c)
+    for (std::size_t y = 0; y < filter_h; ++y)
+    for (std::size_t x = 0; x < filter_w; ++x)
+    {
+        const auto iy = static_cast<std::ptrdiff_t>(i * stride + y) - static_cast<std::ptrdiff_t>(pad);
+        const auto ix = static_cast<std::ptrdiff_t>(j * stride + x) - static_cast<std::ptrdiff_t>(pad);
+        const bool inside = iy >= 0 && iy < static_cast<std::ptrdiff_t>(H) &&
+                            ix >= 0 && ix < static_cast<std::ptrdiff_t>(W);
+        const double expected = inside ? input(n, c, static_cast<std::size_t>(iy), static_cast<std::size_t>(ix)) : 0.0;
+        ASSERT_EQ(col((n * out_h + i) * out_w + j, (c * filter_h + y) * filter_w + x), expected);
+    }
+
+    EXPECT_THROW(im2col(input, 10, 2, 1, 0), std::invalid_argument);
+    EXPECT_THROW(im2col(input, 3, 2, 0, 0), std::invalid_argument);
+}
+
+// col2im が im2col の随伴 (転置) になっていることを内積で確認する: <im2col(x), y> = <x, col2im(y)>
+TEST(NetworkIm2ColTest, Col2ImIsAdjoint) {
+    const Shape input_shape = {2, 3, 6, 5};
+    const std::size_t filter_h = 3, filter_w = 3, stride = 1, pad = 1;
+    const Tensor x = Tensor::Random(input_shape);
+    const Tensor col = im2col(x, filter_h, filter_w, stride, pad);
+    const Tensor y = Tensor::Random(col.shape());
+
+    const Tensor image = col2im(y, input_shape, filter_h, filter_w, stride, pad);
+    EXPECT_EQ(image.shape(), x.shape());
+    const double lhs = Tensor::Sum(col * y, {})(0);
+    const double rhs = Tensor::Sum(x * image, {})(0);
+    EXPECT_NEAR(lhs, rhs, 1e-9 * std::abs(lhs));
+
+    // 重なりのない場合は元に戻る
+    const Tensor z = Tensor::Random({2, 3, 6, 4});
+    const Tensor restored = col2im(im2col(z, 2, 2, 2, 0), z.shape(), 2, 2, 2, 0);
+    EXPECT_EQ(restored.storage(), z.storage());
+
+    EXPECT_THROW(col2im(y, Shape{2, 3, 6, 6}, filter_h, filter_w, stride, pad), std::invalid_argument);
+}
+
+// 畳み込みレイヤーの順伝播と逆伝播を直接ループで計算した値と比較する
+TEST(ConvolutionLayerTest, MatchesDirectLoops) {
+    const std::size_t N = 2, C = 3, H = 7, W = 6, FN = 4, FH = 3, FW = 2, stride = 2, pad = 1;
+    auto weight = std::make_shared<Tensor>(Tensor::Random({FN, C, FH, FW}));
+    auto bias = std::make_shared<Tensor>(Tensor::Random({FN}));
+    const Tensor x = Tensor::Random({N, C, H, W});
+    Convolution conv(weight, bias, stride, pad);
+
+    const Tensor out = conv.forward(x);
+    const std::size_t out_h = (H + 2 * pad - FH) / stride + 1;
+    const std::size_t out_w = (W + 2 * pad - FW) / stride + 1;
+    const std::vector<std::size_t> expected_shape = {N, FN, out_h, out_w};
+    ASSERT_EQ(out.shape(), expected_shape);
+
+    const Tensor dout = Tensor::Random(out.shape());
+    const Tensor dx = conv.backward(dout);
+    const Tensor dW = conv.get_dW();
+    const Tensor db = conv.get_db();
+    ASSERT_EQ(dx.shape(), x.shape());
+    ASSERT_EQ(dW.shape(), weight->shape());
+
+    Tensor expected_out = Tensor::Zeros(out.shape());
+    Tensor expected_dx = Tensor::Zeros(x.shape());
+    Tensor expected_dW = Tensor::Zeros(weight->shape());
+    Tensor expected_db = Tensor::Zeros({FN});
+    for (std::size_t n = 0; n < N; ++n)
+    for (std::size_t f = 0; f < FN; ++f)
+    for (std::size_t i = 0; i < out_h; ++i)
+    for (std::size_t j = 0; j < out_w; ++j)
+    {
+        double sum = (*bias)(f);
+        expected_db(f) += dout(n, f, i, j);
+        for (std::size_t c = 0; c < C; ++c)
+        for (std::size_t y = 0; y < FH; ++y)
+        for (std::size_t x_ = 0; x_ < FW; ++x_)
+        {
+            const auto iy = static_cast<std::ptrdiff_t>(i * stride + y) - static_cast<std::ptrdiff_t>(pad);
+            const auto ix = static_cast<std::ptrdiff_t>(j * stride + x_) - static_cast<std::ptrdiff_t>(pad);
+            if (iy < 0 || ix < 0 || iy >= static_cast<std::ptrdiff_t>(H) || ix >= static_cast<std::ptrdiff_t>(W))
+            {
+                continue;
+            }
+            const auto yy = static_cast<std::size_t>(iy);
+            const auto xx = static_cast<std::size_t>(ix);
+            sum += (*weight)(f, c, y, x_) * x(n, c, yy, xx);
+            expected_dW(f, c, y, x_) += dout(n, f, i, j) * x(n, c, yy, xx);
+            expected_dx(n, c, yy, xx) += dout(n, f, i, j) * (*weight)(f, c, y, x_);
+        }
+        expected_out(n, f, i, j) = sum;
+    }
+
+    const auto expect_near = [](const Tensor &actual, const Tensor &expected) {
+        ASSERT_EQ(actual.size(), expected.size());
+        for (std::size_t i = 0; i < actual.size(); ++i)
+        {
+            EXPECT_NEAR(actual.storage()[i], expected.storage()[i], 1e-12);
+        }
+    };
+    expect_near(out, expected_out);
+    expect_near(dx, expected_dx);
+    expect_near(dW, expected_dW);
+    expect_near(db, expected_db);
+
+    // 形状の異なる入力でもワークスペースを作り直して計算できる
+    const Tensor small = Tensor::Random({1, C, 4, 4});
+    EXPECT_EQ(conv.forward(small).shape(), (std::vector<std::size_t>{1, FN, 2, 3}));
+    EXPECT_EQ(conv.backward(Tensor::Random({1, FN, 2, 3})).shape(), small.shape());
+
+    EXPECT_THROW(conv.forward(Tensor::Random({1, C + 1, 4, 4})), std::invalid_argument);
+    EXPECT_THROW(Convolution(weight, std::make_shared<Tensor>(Tensor::Random({FN + 1}))), std::invalid_argument);
+}
+
+// プーリングレイヤーの順伝播と逆伝播を窓ごとのループで計算した値と比較する
+TEST(PoolingLayerTest, MatchesDirectLoops) {
+    const std::size_t N = 2, C = 3, H = 7, W = 9, PH = 3, PW = 2, stride = 2, pad = 1;
+    const std::size_t out_h = (H + 2 * pad - PH) / stride + 1;
+    const std::size_t out_w = (W + 2 * pad - PW) / stride + 1;
+    const Tensor x = Tensor::Random({N, C, H, W});
+    const Tensor dout = Tensor::Random({N, C, out_h, out_w});
+
+    MaxPooling max_pool(PH, PW, stride, pad);
+    AvgPooling avg_pool(PH, PW, stride, pad);
+    const Tensor max_out = max_pool.forward(x);
+    const Tensor avg_out = avg_pool.forward(x);
+    const Tensor max_dx = max_pool.backward(dout);
+    const Tensor avg_dx = avg_pool.backward(dout);
+    const std::vector<std::size_t> expected_shape = {N, C, out_h, out_w};
+    ASSERT_EQ(max_out.shape(), expected_shape);
+    ASSERT_EQ(avg_out.shape(), expected_shape);
+    ASSERT_EQ(max_dx.shape(), x.shape());
+
+    Tensor expected_max_dx = Tensor::Zeros(x.shape());
+    Tensor expected_avg_dx = Tensor::Zeros(x.shape());
+    const double scale = 1.0 / static_cast<double>(PH * PW);
+    for (std::size_t n = 0; n < N; ++n)
+    for (std::size_t c = 0; c < C; ++c)
+    for (std::size_t i = 0; i < out_h; ++i)
+    for (std::size_t j = 0; j < out_w; ++j)
+    {
+        double best = -std::numeric_limits<double>::infinity();
+        std::size_t best_y = 0, best_x = 0;
+        double sum = 0.0;
+        for (std::size_t y = 0; y < PH; ++y)
+        for (std::size_t x_ = 0; x_ < PW; ++x_)
+        {
+            const auto iy = static_cast<std::ptrdiff_t>(i * stride + y) - static_cast<std::ptrdiff_t>(pad);
+            const auto ix = static_cast<std::ptrdiff_t>(j * stride + x_) - static_cast<std::ptrdiff_t>(pad);
+            if (iy < 0 || ix < 0 || iy >= static_cast<std::ptrdiff_t>(H) || ix >= static_cast<std::ptrdiff_t>(W))
+            {
+                continue;
+            }
+            const auto yy = static_cast<std::size_t>(iy);
+            const auto xx = static_cast<std::size_t>(ix);
+            sum += x(n, c, yy, xx);
+            expected_avg_dx(n, c, yy, xx) += dout(n, c, i, j) * scale;
+            if (x(n, c, yy, xx) > best)
+            {
+                best = x(n, c, yy, xx);
+                best_y = yy;
+                best_x = xx;
+            }
+        }
+        EXPECT_EQ(max_out(n, c, i, j), best);
+        EXPECT_NEAR(avg_out(n, c, i, j), sum * scale, 1e-12);
+        expected_max_dx(n, c, best_y, best_x) += dout(n, c, i, j);
+    }
+    for (std::size_t i = 0; i < x.size(); ++i)
+    {
+        EXPECT_NEAR(max_dx.storage()[i], expected_max_dx.storage()[i], 1e-12);
+        EXPECT_NEAR(avg_dx.storage()[i], expected_avg_dx.storage()[i], 1e-12);
+    }
+
+    // 重なりのない 2x2 の窓
+    MaxPooling pool(2, 2, 2);
+    const Tensor image = Tensor::FromArray({{{{1.0, 5.0, 2.0, 0.0},
+                                              {3.0, 4.0, 8.0, 1.0},
+                                              {0.0, 0.0, 7.0, 6.0},
+                                              {9.0, 1.0, 5.0, 5.0}}}});
+    const Tensor pooled = pool.forward(image);
+    EXPECT_EQ(pooled.storage(), (std::vector<double>{5.0, 8.0, 9.0, 7.0}));
+    const Tensor grad = pool.backward(Tensor::FromArray({{{{1.0, 2.0}, {3.0, 4.0}}}}));
+    EXPECT_EQ(grad.storage(), (std::vector<double>{0, 1, 0, 0, 0, 0, 2, 0, 0, 0, 4, 0, 3, 0, 0, 0}));
+
+    EXPECT_THROW(MaxPooling(2, 2, 1, 2).forward(x), std::invalid_argument);
+}
+
+// 要素型の変換で値が正しく変換されるか確認する
+TEST(TensorDtypeTest, AsType) {
+    Tensor a = Tensor::FromArray({-1.5, 0.0, 2.7, 3.0});
+    Tensori i = a.AsType<std::int32_t>();
+    EXPECT_EQ(i.storage(), (std::vector<std::int32_t>{-1, 0, 2, 3}));
+
+    Tensorb b = a.AsType<Bool>();
+    EXPECT_TRUE(b(0));
+    EXPECT_FALSE(b(1));
+    EXPECT_TRUE(b(2));
+
+    Tensorf f(i);
+    EXPECT_EQ(f.storage(), (std::vector<float>{-1.0f, 0.0f, 2.0f, 3.0f}));
+    EXPECT_EQ(sizeof(Tensorb::value_type), 1u);
+    EXPECT_EQ(sizeof(Tensoru8::value_type), 1u);
+}
+
+// 異なる要素型の演算で型が昇格するか確認する
+TEST(TensorDtypeTest, Promotion) {
+    Tensori a = Tensori::FromArray({1, 2, 3});
+    Tensorf b = Tensorf::FromArray({0.5f, 0.5f, 0.5f});
+    static_assert(std::is_same_v<decltype(a + b)::value_type, float>);
+    Tensorf c = a + b;
+    EXPECT_EQ(c.storage(), (std::vector<float>{1.5f, 2.5f, 3.5f}));
+
+    Tensoru8 d = Tensoru8::FromArray({1, 2, 3});
+    static_assert(std::is_same_v<decltype(d * a)::value_type, std::int32_t>);
+    Tensori e = d * a;
+    EXPECT_EQ(e.storage(), (std::vector<std::int32_t>{1, 4, 9}));
+
+    static_assert(std::is_same_v<decltype(b / Tensor::FromArray({1.0, 2.0, 4.0}))::value_type, double>);
+    Tensor g = b / Tensor::FromArray({1.0, 2.0, 4.0});
+    EXPECT_NEAR(g(2), 0.125, 1e-6);
+}
+
+// 整数型の演算と等号演算子のマスクを確認する
+TEST(TensorDtypeTest, IntegerOpsAndMask) {
+    Tensori a = Tensori::FromArray({{1, 2}, {3, 4}});
+    Tensori b = Tensori::FromArray({{1, 0}, {3, 0}});
+
+    Tensori m = Tensori::Matmul(a, a);
+    EXPECT_EQ(m.storage(), (std::vector<std::int32_t>{7, 10, 15, 22}));
+
+    // 0 除算は 0 になる
+    Tensori q = a / b;
+    EXPECT_EQ(q.storage(), (std::vector<std::int32_t>{1, 0, 1, 0}));
+
+    Tensorb mask = a == b;
+    EXPECT_EQ(mask.storage(), (std::vector<Bool>{true, false, true, false}));
+    EXPECT_EQ(Tensori::Sum(mask.AsType<std::int32_t>()).storage(), (std::vector<std::int32_t>{1, 1}));
+}
+
+// 単精度のネットワークで学習が進むか確認する
+TEST(TensorDtypeTest, FloatTrainingLossDecreases) {
+    Tensorf x = Tensorf::FromArray({1.0f, 2.0f}).Reshape({1, 2});
+    Tensorf t = Tensorf::FromArray({0.0f, 1.0f}).Reshape({1, 2});
+
+    TwoLayerNetf net(2, 3, 2, 0.1);
+    SGDf sgd(0.01);
+    const float initial_loss = net.loss(x, t)(0);
+    for (int i = 0; i < 1000; ++i) {
+        auto grads = net.gradient(x, t);
+        sgd.update(net.params, grads);
+    }
+    const float final_loss = net.loss(x, t)(0);
+    EXPECT_LT(final_loss, initial_loss);
+    EXPECT_FLOAT_EQ(net.accuracy(x, t), 1.0f);
+}
+
+// 16 ビットの浮動小数点数のテンソルの変換, 演算, 行列積を確認する
+TEST(TensorDtypeTest, ReducedPrecisionTensors) {
+    const Tensorf a = Tensorf::Random({37, 65});
+    const Tensorf b = Tensorf::Random({65, 29});
+
+    // 変換は各要素を最も近い値に丸める
+    const Tensorh ah = a.AsType<Half>();
+    const Tensorbf16 ab = a.AsType<BFloat16>();
+    const Tensorf ah_back = ah.AsType<float>();
+    const Tensorf ab_back = ab.AsType<float>();
+    for (std::size_t i = 0; i < a.size(); ++i) {
+        EXPECT_NEAR(ah_back.data()[i], a.data()[i], 0x1p-11f);
+        EXPECT_NEAR(ab_back.data()[i], a.data()[i], 0x1p-8f);
+    }
+
+    // 要素ごとの演算は float で計算して丸める. 要素型の異なる場合は promote_t に従う
+    const Tensorh sum = ah + ah;
+    EXPECT_EQ(static_cast<float>(sum(3, 4)), 2.0f * static_cast<float>(ah(3, 4)));
+    static_assert(std::is_same_v<decltype(ah + a)::value_type, float>);
+    static_assert(std::is_same_v<decltype(ah + ab)::value_type, float>);
+    static_assert(std::is_same_v<decltype(ah * 2.0f)::value_type, Half>);
+    EXPECT_FALSE(Tensorh::IsNan(ah));
+    EXPECT_TRUE(Tensorh::IsNan(Tensorh::FromArray({Half(1.0f), Half(std::nanf(""))})));
+
+    // 行列積は float で累積する. MixedMatmul は丸めずに float で返す
+    const Tensorf expected = Tensorf::Matmul(ah_back, b.AsType<Half>().AsType<float>());
+    const Tensorf mixed = MixedMatmul(ah, b.AsType<Half>());
+    const Tensorh product = Tensorh::Matmul(ah, b.AsType<Half>());
+    ASSERT_EQ(mixed.shape(), Shape({37, 29}));
+    for (std::size_t i = 0; i < expected.size(); ++i) {
+        EXPECT_NEAR(mixed.data()[i], expected.data()[i], 1e-4f);
+        EXPECT_EQ(product.data()[i].bits, FloatToHalfBits(mixed.data()[i]));
+    }
+    const Tensorf mixed_bf16 = MixedMatmul(Tensorbf16::Transpose(ab), b.AsType<BFloat16>().Slice(0, 36));
+    EXPECT_EQ(mixed_bf16.shape(), Shape({65, 29}));
+    EXPECT_THROW(MixedMatmul(ah, ah), std::invalid_argument);
+}
+
+// 混合精度のネットワークで学習が進み, 勾配がオーバーフローすると損失スケールを下げるか確認する
+TEST(TensorDtypeTest, MixedPrecisionTraining) {
+    Tensorf x = Tensorf::FromArray({{1.0f, 2.0f}, {-1.0f, 0.5f}});
+    Tensorf t = Tensorf::FromArray({{0.0f, 1.0f}, {1.0f, 0.0f}});
+
+    for (const auto precision : {TrainingPrecision::Half, TrainingPrecision::BFloat16}) {
+        TwoLayerNetf net(2, 8, 2, 0.1, precision);
+        SGDf sgd(0.1);
+        const float initial_loss = net.loss(x, t)(0);
+        for (int i = 0; i < 300; ++i) {
+            auto grads = net.gradient(x, t);
+            sgd.update(net.params, grads);
+        }
+        EXPECT_LT(net.loss(x, t)(0), initial_loss * 0.5f);
+        EXPECT_FLOAT_EQ(net.accuracy(x, t), 1.0f);
+        EXPECT_FLOAT_EQ(net.get_loss_scale(), precision == TrainingPrecision::Half ? 65536.0f : 1.0f);
+    }
+
+    // 大きな重みでは拡大した勾配が半精度で表現できず, その回の勾配は 0 になる
+    TwoLayerNetf net(2, 8, 2, 0.1, TrainingPrecision::Half);
+    *net.params[0].second = Tensorf::Zeros({2, 8});
+    *net.params[1].second = Tensorf::Zeros({1, 8}) + 1.0f;
+    Tensorf W2 = Tensorf::Zeros({8, 2});
+    for (std::size_t j = 0; j < 8; ++j) {
+        W2(j, 0) = 1000.0f;
+        W2(j, 1) = -1000.0f;
+    }
+    *net.params[2].second = W2;
+    const auto grads = net.gradient(x, t);
+    EXPECT_FLOAT_EQ(net.get_loss_scale(), 32768.0f);
+    for (const auto &grad : grads) {
+        EXPECT_FLOAT_EQ(Tensorf::Sum(Tensorf::Abs(grad.second), {})(0), 0.0f) << grad.first;
+    }
+}
+
+// Slice, Reshape, Transpose がデータ領域を共有するビューを返すか確認する
+TEST(TensorViewTest, ViewsShareStorage) {
+    Tensor a = Tensor::FromArray({{1, 2, 3}, {4, 5, 6}});
+    const Tensor &ca = a;
+
+    const Tensor row = ca.Slice(1);
+    EXPECT_EQ(row.data(), ca.data() + 3);
+    EXPECT_EQ(row.offset(), 3u);
+    EXPECT_EQ(row.shape(), (std::vector<std::size_t>{3}));
+    EXPECT_EQ(row(2), 6);
+
+    const Tensor reshaped = ca.Reshape({3, 2});
+    EXPECT_EQ(reshaped.data(), ca.data());
+    EXPECT_EQ(reshaped(2, 1), 6);
+
+    const Tensor transposed = Tensor::Transpose(ca);
+    EXPECT_EQ(transposed.data(), ca.data());
+    EXPECT_FALSE(transposed.IsContiguous());
+    EXPECT_EQ(transposed.strides(), (std::vector<std::size_t>{1, 3}));
+    EXPECT_EQ(transposed(2, 0), 3);
+
+    // 連続していないビューを Contiguous で詰め直す
+    const Tensor packed = transposed.Contiguous();
+    EXPECT_TRUE(packed.IsContiguous());
+    EXPECT_NE(packed.data(), ca.data());
+    EXPECT_EQ(packed.storage(), (std::vector<Tensor::value_type>{1, 4, 2, 5, 3, 6}));
+
+    // 連続したテンソルはコピーしない
+    const Tensor same = ca.Contiguous();
+    EXPECT_EQ(same.data(), ca.data());
+
+    // const のビューからはデータ領域を詰め直さない
+    EXPECT_THROW(transposed.storage(), std::logic_error);
+    EXPECT_EQ(transposed.data(), ca.data());
+    EXPECT_EQ(transposed.strides(), (std::vector<std::size_t>{1, 3}));
+
+    // 詰め直さずに読み出す演算もビューの順に要素をたどる
+    EXPECT_EQ(Tensor::ReLU(transposed).storage(), (std::vector<Tensor::value_type>{1, 4, 2, 5, 3, 6}));
+    EXPECT_EQ(Tensor::Tile(transposed, 2).storage(),
+              (std::vector<Tensor::value_type>{1, 4, 2, 5, 3, 6, 1, 4, 2, 5, 3, 6}));
+    EXPECT_TRUE(Tensor::Equal(transposed, packed));
+    EXPECT_FALSE(Tensor::IsNan(transposed));
+}
+
+// ビューへの書き込みは元のテンソルに影響しない (コピーオンライト)
+TEST(TensorViewTest, CopyOnWrite) {
+    Tensor a = Tensor::FromArray({{1, 2}, {3, 4}});
+    Tensor view = a.Slice(0);
+    Tensor copy = a;
+
+    view(1) = 10;
+    copy(0, 0) = 20;
+
+    EXPECT_EQ(a.storage(), (std::vector<Tensor::value_type>{1, 2, 3, 4}));
+    EXPECT_EQ(view.storage(), (std::vector<Tensor::value_type>{1, 10}));
+    EXPECT_EQ(copy.storage(), (std::vector<Tensor::value_type>{20, 2, 3, 4}));
+}
+
+// 転置したビューや軸を入れ替えたビューの演算結果が正しいか確認する
+TEST(TensorViewTest, OperationsOnViews) {
+    Tensor a = Tensor::FromArray({{1, 2, 3}, {4, 5, 6}});
+    Tensor b = Tensor::FromArray({{1, 0}, {0, 1}, {1, 1}});
+
+    // (3, 2) の転置ビュー同士の行列積
+    Tensor c = Tensor::Matmul(Tensor::Transpose(b), Tensor::Transpose(a));
+    EXPECT_EQ(c.storage(), (std::vector<Tensor::value_type>{4, 10, 5, 11}));
+
+    // ビューとの要素ごとの演算
+    Tensor d = Tensor::Transpose(a) + b;
+    EXPECT_EQ(d.storage(), (std::vector<Tensor::value_type>{2, 4, 2, 6, 4, 7}));
+
+    // 軸を入れ替えたビューをさらに Reshape する
+    Tensor e = Tensor::Transpose(a.Reshape({1, 2, 3}), {2, 0, 1}).Reshape({6});
+    EXPECT_EQ(e.storage(), (std::vector<Tensor::value_type>{1, 4, 2, 5, 3, 6}));
+
+    // 範囲指定の Slice をまとめる
+    Tensor f = Tensor::Concat({a.Slice(1), a.Slice(0)});
+    EXPECT_EQ(f.shape(), (std::vector<std::size_t>{2, 3}));
+    EXPECT_EQ(f.storage(), (std::vector<Tensor::value_type>{4, 5, 6, 1, 2, 3}));
+}
+
+// 四則演算と Exp/Log/Abs を組み合わせた式を 1 回で評価できるか確認する
+TEST(TensorExpressionTest, FusedElementwise)
+{
+  Tensor x = Tensor::FromArray({{-1.0, 0.0}, {1.0, 2.0}});
+
+  // Sigmoid レイヤーと同じ式
+  Tensor y = 1.0 / (1.0 + Tensor::Exp(-x));
+  for (std::size_t i = 0; i < 2; ++i)
+  {
+    for (std::size_t j = 0; j < 2; ++j)
+    {
+      EXPECT_NEAR(y(i, j), 1.0 / (1.0 + std::exp(-x(i, j))), 1e-6);
+    }
+  }
+
+  Tensor z = Tensor::Abs(x * 2.0 - 1.0) + Tensor::Log(Tensor::Exp(x));
+  for (std::size_t i = 0; i < 2; ++i)
+  {
+    for (std::size_t j = 0; j < 2; ++j)
+    {
+      EXPECT_NEAR(z(i, j), std::abs(x(i, j) * 2.0 - 1.0) + x(i, j), 1e-6);
+    }
+  }
+}
+
+// ブロードキャストやビューを含む式を評価できるか確認する
+TEST(TensorExpressionTest, BroadcastAndViews)
+{
+  Tensor a = Tensor::FromArray({{1, 2, 3}, {4, 5, 6}});
+  Tensor row = Tensor::FromArray({10, 20, 30}).Reshape({1, 3});
+  Tensor col = Tensor::FromArray({100, 200}).Reshape({2, 1});
+
+  Tensor b = a * 2.0 + row - col;
+  EXPECT_EQ(b.shape(), (std::vector<std::size_t>{2, 3}));
+  EXPECT_EQ(b.storage(), (std::vector<Tensor::value_type>{-88, -76, -64, -182, -170, -158}));
+
+  // 転置ビューを含む式
+  Tensor c = Tensor::Transpose(a) - 1.0;
+  EXPECT_EQ(c.storage(), (std::vector<Tensor::value_type>{0, 3, 1, 4, 2, 5}));
+
+  // 右辺に自分自身を含む代入
+  a = a * a + a;
+  EXPECT_EQ(a.storage(), (std::vector<Tensor::value_type>{2, 6, 12, 20, 30, 42}));
+
+  // ブロードキャストできない形状は例外を送出する
+  EXPECT_THROW(Tensor(a + Tensor::Ones({2, 2})), std::invalid_argument);
+}
+
+// 式は代入されるまで評価されないことを確認する
+TEST(TensorExpressionTest, LazyEvaluation)
+{
+  Tensor a = Tensor::FromArray({1, 2, 3});
+  Tensor b = Tensor::FromArray({4, 5, 6});
+
+  auto expression = a + b * 2.0;
+  EXPECT_EQ(expression.shape(), (std::vector<std::size_t>{3}));
+
+  b(0) = 0;
+  Tensor c = expression;
+  EXPECT_EQ(c.storage(), (std::vector<Tensor::value_type>{1, 12, 15}));
+}
+
+// 複合代入演算子がブロードキャストしつつ確保済みの領域に書き込むか確認する
+TEST(TensorInPlaceTest, CompoundAssignment)
+{
+  Tensor a = Tensor::FromArray({{1, 2, 3}, {4, 5, 6}});
+  const double *buffer = std::as_const(a).data();
+
+  a += Tensor::FromArray({10, 20, 30});
+  a -= 1.0;
+  a *= Tensor::FromArray({2, 3}).Reshape({2, 1});
+  a /= 2;
+  EXPECT_EQ(std::as_const(a).data(), buffer);
+  for (std::size_t i = 0; i < 3; ++i)
+  {
+    EXPECT_NEAR(a(0, i), (1.0 + i + 10.0 * (i + 1) - 1.0) * 2.0 / 2.0, 1e-5);
+    EXPECT_NEAR(a(1, i), (4.0 + i + 10.0 * (i + 1) - 1.0) * 3.0 / 2.0, 1e-5);
+  }
+
+  // 式を右辺にとる場合と, 自身の転置ビューを右辺にとる場合
+  Tensor b = Tensor::FromArray({{1, 2}, {3, 4}});
+  b += b * 2.0;
+  EXPECT_EQ(b.storage(), (std::vector<Tensor::value_type>{3, 6, 9, 12}));
+  b += Tensor::Transpose(b);
+  EXPECT_EQ(b.storage(), (std::vector<Tensor::value_type>{6, 15, 15, 24}));
+
+  // 他のテンソルと共有している領域は書き換えない
+  Tensor c = b;
+  c -= 6.0;
+  EXPECT_EQ(b.storage(), (std::vector<Tensor::value_type>{6, 15, 15, 24}));
+  EXPECT_EQ(c.storage(), (std::vector<Tensor::value_type>{0, 9, 9, 18}));
+
+  // 左辺の形状が変わるブロードキャストはできない
+  Tensor row = Tensor::FromArray({1, 2});
+  EXPECT_THROW(row += b, std::invalid_argument);
+}
+
+// その場で計算する活性化関数が元の関数と一致するか確認する
+TEST(TensorInPlaceTest, Activations)
+{
+  Tensor x = Tensor::FromArray({{-2.0, -0.5}, {0.5, 2.0}});
+  Tensor relu = x;
+  Tensor sigmoid = x;
+  Tensor exp = x;
+  relu.ReLU_();
+  sigmoid.Sigmoid_();
+  exp.Exp_();
+  EXPECT_TRUE(Tensor::Equal(relu, Tensor::ReLU(x)));
+  EXPECT_TRUE(Tensor::Equal(sigmoid, Tensor::Sigmoid(x)));
+  EXPECT_TRUE(Tensor::Equal(exp, Tensor(Tensor::Exp(x))));
+
+  // 式の代入は形状が同じなら確保済みの領域を使い回す
+  const double *buffer = std::as_const(exp).data();
+  exp = exp * 0.5 + x;
+  EXPECT_EQ(std::as_const(exp).data(), buffer);
+  EXPECT_NEAR(exp(1, 1), std::exp(2.0) * 0.5 + 2.0, 1e-6);
+}
+
+// 軸をまとめる処理やブロックの分割を含むブロードキャストが素朴な計算と一致するか確認する
+TEST(TensorExpressionTest, BroadcastPatterns)
+{
+  // 行方向, 列方向, 外積, 3 次元の中間軸, 長い行 (行の途中でブロックを分割する) の組み合わせ
+  const std::vector<std::pair<std::vector<std::size_t>, std::vector<std::size_t>>> shapes = {
+    {{7, 5}, {1, 5}},
+    {{7, 5}, {7, 1}},
+    {{1, 5}, {7, 1}},
+    {{3, 4, 5}, {4, 1}},
+    {{3, 4, 5}, {3, 1, 5}},
+    {{2, 1, 3, 5}, {4, 1, 5}},
+    {{3, 10000}, {1, 10000}},
+    {{3, 10000}, {3, 1}},
+  };
+
+  for (const auto &[shape_a, shape_b] : shapes)
+  {
+    Tensor a = Tensor::Random(shape_a);
+    Tensor b = Tensor::Random(shape_b);
+    Tensor c = a * 2.0 - b;
+
+    const auto shape = BroadcastShape(shape_a, shape_b);
+    ASSERT_EQ(c.shape(), shape);
+
+    // 出力のインデックスから各入力の要素の位置を求めて比較する
+    const auto at = [&](const Tensor &t, std::size_t flat)
+    {
+      std::size_t offset = 0;
+      std::size_t stride = 1;
+      for (std::size_t d = shape.size(); d-- > 0;)
+      {
+        const std::size_t index = flat % shape[d];
+        flat /= shape[d];
+        const std::size_t pad = shape.size() - t.shape().size();
+        if (d >= pad && t.shape()[d - pad] != 1)
+        {
+          offset += index * stride;
+        }
+        if (d >= pad)
+        {
+          stride *= t.shape()[d - pad];
+        }
+      }
+      return t.storage()[offset];
+    };
+    for (std::size_t i = 0; i < c.size(); ++i)
+    {
+      ASSERT_DOUBLE_EQ(c.storage()[i], at(a, i) * 2.0 - at(b, i)) << "index " << i;
+    }
+  }
+}
+
+/**
+ * @brief 比較用の素朴な縮約. 出力のインデックスごとに縮約する軸を総当たりする
+ */
+template<typename F>
+std::vector<double> ReferenceReduce(const Tensor &a,
+                                    const std::vector<std::size_t> &axes,
+                                    double init,
+                                    F combine)
+{
+  const std::vector<std::size_t> shape = a.shape();
+  std::vector<bool> reduced(shape.size(), false);
+  for (const auto axis : axes)
+  {
+    reduced[axis] = true;
+  }
+
+  std::size_t outputs = 1;
+  for (std::size_t d = 0; d < shape.size(); ++d)
+  {
+    outputs *= reduced[d] ? 1 : shape[d];
+  }
+  std::vector<double> result(outputs, init);
+
+  const Tensor source = a.Contiguous();
+  for (std::size_t i = 0; i < source.size(); ++i)
+  {
+    // 入力のインデックスから出力のインデックスを求める
+    std::size_t rest = i;
+    std::size_t output = 0;
+    std::size_t stride = 1;
+    for (std::size_t d = shape.size(); d-- > 0;)
+    {
+      const std::size_t index = rest % shape[d];
+      rest /= shape[d];
+      if (!reduced[d])
+      {
+        output += index * stride;
+        stride *= shape[d];
+      }
+    }
+    result[output] = combine(result[output], source.data()[i]);
+  }
+  return result;
+}
+
+// 任意の次元数と軸の組み合わせで素朴な実装と一致するか確認する
+TEST(TensorReductionTest, MatchesReference)
+{
+  const Tensor a = Tensor::Random({3, 4, 5, 6});
+  const Tensor transposed = Tensor::Transpose(a, {2, 0, 3, 1});
+  const std::vector<std::vector<std::size_t>> axes_list = {
+    {0}, {1}, {3}, {0, 1}, {1, 3}, {0, 2}, {0, 1, 2, 3}, {2, 3}, {0, 3}
+  };
+
+  for (const Tensor *x : {&a, &transposed})
+  {
+    for (const auto &axes : axes_list)
+    {
+      const auto sum = ReferenceReduce(*x, axes, 0.0, [](double acc, double v) { return acc + v; });
+      const auto max = ReferenceReduce(*x, axes, -1e300, [](double acc, double v) { return std::max(acc, v); });
+      const auto min = ReferenceReduce(*x, axes, 1e300, [](double acc, double v) { return std::min(acc, v); });
+      const auto prod = ReferenceReduce(*x, axes, 1.0, [](double acc, double v) { return acc * (v + 0.5); });
+      std::size_t count = 1;
+      for (const auto axis : axes)
+      {
+        count *= x->shape()[axis];
+      }
+
+      const Tensor sum_result = Tensor::Sum(*x, axes);
+      const Tensor mean_result = Tensor::Mean(*x, axes);
+      const Tensor max_result = Tensor::Max(*x, axes);
+      const Tensor min_result = Tensor::Min(*x, axes);
+      const Tensor prod_result = Tensor::Prod(Tensor(*x + 0.5), axes);
+      ASSERT_EQ(sum_result.size(), sum.size());
+      for (std::size_t i = 0; i < sum.size(); ++i)
+      {
+        ASSERT_NEAR(sum_result.storage()[i], sum[i], 1e-9);
+        ASSERT_NEAR(mean_result.storage()[i], sum[i] / count, 1e-9);
+        ASSERT_EQ(max_result.storage()[i], max[i]);
+        ASSERT_EQ(min_result.storage()[i], min[i]);
+        ASSERT_NEAR(prod_result.storage()[i], prod[i], 1e-9);
+      }
+    }
+  }
+}
+
+// keepdims と形状の扱い, 分散, Argmax/Argmin を確認する
+TEST(TensorReductionTest, KeepdimsVarianceAndArg)
+{
+  Tensor a = Tensor::FromArray({{{1, 5, 3}, {4, 2, 6}}, {{9, 7, 8}, {0, 0, -1}}});
+
+  EXPECT_EQ(Tensor::Sum(a, {0, 2}, true).shape(), (std::vector<std::size_t>{1, 2, 1}));
+  EXPECT_EQ(Tensor::Sum(a, {0, 2}).storage(), (std::vector<Tensor::value_type>{33, 11}));
+  EXPECT_EQ(Tensor::Sum(a, {}).shape(), (std::vector<std::size_t>{1}));
+  EXPECT_EQ(Tensor::Sum(a, {}).storage(), (std::vector<Tensor::value_type>{44}));
+  EXPECT_EQ(Tensor::Max(a), 9);
+  EXPECT_EQ(Tensor::Min(a), -1);
+
+  // 4 次元のテンソルも最後の軸の総和を求められる
+  Tensor b = Tensor::Ones({2, 3, 4, 5});
+  EXPECT_EQ(Tensor::Sum(b).shape(), (std::vector<std::size_t>{2, 3, 4}));
+  EXPECT_EQ(Tensor::Sum(b, 1)(1, 2, 3), 3);
+
+  // 分散 (母分散と不偏分散)
+  Tensor v = Tensor::FromArray({{1, 2, 3, 4}, {2, 2, 2, 2}});
+  EXPECT_NEAR(Tensor::Var(v, {1})(0), 1.25, 1e-12);
+  EXPECT_NEAR(Tensor::Var(v, {1})(1), 0.0, 1e-12);
+  EXPECT_NEAR(Tensor::Var(v, {1}, false, 1)(0), 5.0 / 3.0, 1e-12);
+  EXPECT_EQ(Tensor::Var(v, {1}, true).shape(), (std::vector<std::size_t>{2, 1}));
+
+  // 整数のテンソルの分散は切り捨てずに double で求める
+  const Tensori integers = Tensori::FromArray({1, 2, 3, 4, 5, 6, 7, 8});
+  const Tensor integer_var = Tensori::Var(integers, {0});
+  EXPECT_DOUBLE_EQ(integer_var(0), 5.25);
+  EXPECT_DOUBLE_EQ(Tensori::Var(integers, {0}, false, 1)(0), 6.0);
+  static_assert(std::is_same_v<decltype(Tensorf::Var(Tensorf(), {})), Tensorf>);
+
+  // 最後の軸と途中の軸に沿ったインデックス
+  EXPECT_EQ(Tensor::Argmax(a, 2).storage(), (std::vector<Tensori::value_type>{1, 2, 0, 0}));
+  EXPECT_EQ(Tensor::Argmin(a, 2).storage(), (std::vector<Tensori::value_type>{0, 1, 1, 2}));
+  EXPECT_EQ(Tensor::Argmax(a, 0).storage(), (std::vector<Tensori::value_type>{1, 1, 1, 0, 0, 0}));
+  EXPECT_EQ(Tensor::Argmin(a, 1, true).shape(), (std::vector<std::size_t>{2, 1, 3}));
+  EXPECT_EQ(a.Argmax().storage(), Tensor::Argmax(a, 2).storage());
+
+  // インデックスは要素型で表せない値でも整数で返す
+  Tensor pixels = Tensor::Zeros({1, 784});
+  pixels(0, 300) = 255;
+  EXPECT_EQ(pixels.AsType<std::uint8_t>().Argmax()(0), 300);
+  Tensor wide = Tensor::Zeros({1, 3000});
+  wide(0, 2999) = 1;
+  EXPECT_EQ(wide.AsType<Half>().Argmax()(0), 2999);
+  EXPECT_EQ(Tensorb::FromArray({Bool(false), Bool(false), Bool(true), Bool(false)}).Argmax()(0), 2);
+
+  // 途中の軸に沿ったインデックスと Argmin も要素型によらず整数で返す
+  Tensor columns = Tensor::Zeros({600, 2});
+  columns(300, 0) = 255;
+  columns(599, 1) = 1;
+  const Tensoru8 bytes = columns.AsType<std::uint8_t>();
+  EXPECT_EQ(Tensoru8::Argmax(bytes, 0).storage(), (std::vector<Tensori::value_type>{300, 599}));
+  EXPECT_EQ(Tensoru8::Argmin(bytes, 1).Argmax()(0), 300);
+  const Tensorh halves = Tensor(columns * -1.0).AsType<Half>();
+  EXPECT_EQ(Tensorh::Argmin(halves, 0, true).shape(), (std::vector<std::size_t>{1, 2}));
+  EXPECT_EQ(Tensorh::Argmin(halves, 0, true).storage(), (std::vector<Tensori::value_type>{300, 599}));
+  const Tensorb flags = Tensorb::FromArray({{Bool(true), Bool(false), Bool(true)},
+                                            {Bool(true), Bool(true), Bool(true)},
+                                            {Bool(true), Bool(true), Bool(false)}});
+  EXPECT_EQ(Tensorb::Argmin(flags, 0).storage(), (std::vector<Tensori::value_type>{0, 0, 2}));
+  EXPECT_EQ(Tensorb::Argmin(flags, 1).storage(), (std::vector<Tensori::value_type>{1, 0, 2}));
+
+  EXPECT_THROW(Tensor::Sum(a, {3}), std::invalid_argument);
+  EXPECT_THROW(Tensor::Sum(a, {1, 1}), std::invalid_argument);
+}
+
+// Softmax と交差エントロピー誤差をまとめた計算が個別に計算した値と一致するか確認する
+TEST(SoftmaxCrossEntropyTest, MatchesSeparateKernels)
+{
+  const Tensor x = Tensor::RandomNormal({7, 5}) * 3.0;
+  Tensor labels({7});
+  Tensor t = Tensor::Zeros({7, 5});
+  for (std::size_t i = 0; i < 7; ++i)
+  {
+    labels(i) = static_cast<double>((i * 3) % 5);
+    t(i, (i * 3) % 5) = 1.0;
+  }
+
+  const Tensor y = Tensor::Softmax(x);
+  double expected_loss = 0;
+  for (std::size_t i = 0; i < 7; ++i)
+  {
+    expected_loss -= std::log(y(i, (i * 3) % 5));
+  }
+  expected_loss /= 7;
+  const Tensor expected_grad = (y - t) * (1.0 / 7.0);
+
+  // one-hot とクラス番号のどちらでも同じ結果になる
+  for (const Tensor &target : {t, labels})
+  {
+    Tensor grad;
+    const Tensor loss = SoftmaxCrossEntropy(x, target, &grad);
+    EXPECT_NEAR(loss(0), expected_loss, 1e-10);
+    ASSERT_EQ(grad.shape(), x.shape());
+    for (std::size_t i = 0; i < x.size(); ++i)
+    {
+      EXPECT_NEAR(grad.storage()[i], expected_grad.storage()[i], 1e-12);
+    }
+  }
+
+  // 大きなロジットでもオーバーフローしない
+  const Tensor large = Tensor::FromArray({{1000.0, 0.0}, {-1000.0, 0.0}});
+  const Tensor loss = SoftmaxCrossEntropy(large, Tensor::FromArray({1.0, 0.0}));
+  EXPECT_NEAR(loss(0), 1000.0, 1e-9);
+
+  // クラス数が 1 の場合も形状でクラス番号と one-hot を区別する
+  const Tensor single = Tensor::RandomNormal({3, 1});
+  Tensor single_grad;
+  SoftmaxCrossEntropy(single, Tensor::Zeros({3}), &single_grad);
+  EXPECT_TRUE(Tensor::Equal(single_grad, Tensor::Zeros({3, 1})));
+  SoftmaxCrossEntropy(single, Tensor::Zeros({3, 1}), &single_grad);
+  EXPECT_TRUE(Tensor::Equal(single_grad, Tensor::Fill({3, 1}, 1.0 / 3.0)));
+
+  EXPECT_THROW(SoftmaxCrossEntropy(x, Tensor::FromArray({0.0, 1.0})), std::invalid_argument);
+  EXPECT_THROW(SoftmaxCrossEntropy(x, Tensor(labels + 5.0)), std::invalid_argument);
+  EXPECT_THROW(SoftmaxCrossEntropy(x, Tensor::Zeros({35})), std::invalid_argument);
+  labels(2) = std::numeric_limits<double>::quiet_NaN();
+  EXPECT_THROW(SoftmaxCrossEntropy(x, labels), std::invalid_argument);
+  labels(2) = 1e30;
+  EXPECT_THROW(SoftmaxCrossEntropy(x, labels), std::invalid_argument);
+}
+
+// CSV の読み込みで空行, 改行コード, 列の選択, 要素型の変換を扱えるか確認する
+TEST(TensorCSVTest, OptionsAndErrors)
+{
+  const std::string path = ::testing::TempDir() + "nagato_tensor.csv";
+  {
+    std::ofstream file(path, std::ios::binary);
+    file << "\xEF\xBB\xBF" << "id, \"x\", y\r\n"
+         << "1, 0.5, -2e3\r\n"
+         << "\r\n"
+         << "2,+1.25,\"7\"\n"
+         << "3,-0.125,8.9";
+  }
+
+  CSVOptions options;
+  options.header = true;
+  const Tensorf all = Tensorf::FromCSV(path, options);
+  ASSERT_EQ(all.shape(), Shape({3, 3}));
+  EXPECT_FLOAT_EQ(all(0, 2), -2000.0f);
+  EXPECT_FLOAT_EQ(all(1, 1), 1.25f);
+  EXPECT_FLOAT_EQ(all(2, 2), 8.9f);
+
+  // 列名で選んだ順に並べ, 整数型では小数点以下を切り捨てる
+  options.column_names = {"y", "id"};
+  const BasicTensor<std::int32_t> selected = BasicTensor<std::int32_t>::FromCSV(path, options);
+  ASSERT_EQ(selected.shape(), Shape({3, 2}));
+  EXPECT_EQ(selected(0, 0), -2000);
+  EXPECT_EQ(selected(1, 0), 7);
+  EXPECT_EQ(selected(2, 0), 8);
+  EXPECT_EQ(selected(2, 1), 3);
+
+  // ブロックの境界をまたぐ大きなファイルも行の順に読み込む
+  const std::size_t rows = 60000;
+  {
+    std::ofstream file(path, std::ios::binary);
+    for (std::size_t i = 0; i < rows; ++i)
+    {
+      file << i << ",0.25," << (i % 7) << ",1234567.5\n";
+    }
+  }
+  CSVOptions columns;
+  columns.columns = {2, 0};
+  const Tensor large = Tensor::FromCSV(path, columns);
+  ASSERT_EQ(large.shape(), Shape({rows, 2}));
+  for (std::size_t i = 0; i < rows; i += 997)
+  {
+    EXPECT_EQ(large(i, 0), static_cast<double>(i % 7));
+    EXPECT_EQ(large(i, 1), static_cast<double>(i));
+  }
+  EXPECT_EQ(Tensor::FromCSV(path).shape(), Shape({rows, 4}));
+
+  // 列数の不一致と変換できない値は例外を投げる
+  {
+    std::ofstream file(path, std::ios::binary);
+    file << "1,2\n3\n";
+  }
+  EXPECT_THROW(Tensor::FromCSV(path), std::invalid_argument);
+  {
+    std::ofstream file(path, std::ios::binary);
+    file << "1,2\n3,abc\n";
+  }
+  EXPECT_THROW(Tensor::FromCSV(path), std::invalid_argument);
+  columns.columns = {5};
+  EXPECT_THROW(Tensor::FromCSV(path, columns), std::invalid_argument);
+}
+
+// IndexSelect, Gather と, その逆方向の ScatterAdd を直接のループと比較する
+TEST(TensorIndexTest, SelectGatherScatter)
+{
+  const Tensor a = Tensor::Random({3, 4, 5});
+
+  // 中間の軸から重複を含めて取り出す
+  const std::vector<std::size_t> indices = {3, 0, 3};
+  const Tensor selected = Tensor::IndexSelect(a, 1, indices);
+  ASSERT_EQ(selected.shape(), Shape({3, 3, 5}));
+  for (std::size_t i = 0; i < 3; ++i)
+  {
+    for (std::size_t k = 0; k < 3; ++k)
+    {
+      for (std::size_t j = 0; j < 5; ++j)
+      {
+        EXPECT_EQ(selected(i, k, j), a(i, indices[k], j));
+      }
+    }
+  }
+
+  // 転置したビューから最後の軸に沿って取り出し, 同じ形状のバッファへ確保せずに書き込む
+  const Tensor at = Tensor::Transpose(a, {2, 0, 1});
+  Tensor buffer({5, 3, 2});
+  const Tensor::value_type *buffer_data = std::as_const(buffer).data();
+  Tensor::IndexSelect(at, 2, {1, 2}, buffer);
+  EXPECT_EQ(std::as_const(buffer).data(), buffer_data);
+  EXPECT_EQ(buffer(4, 2, 1), a(2, 2, 4));
+  EXPECT_EQ(buffer(0, 1, 0), a(1, 1, 0));
+
+  // ScatterAdd は IndexSelect の随伴: <IndexSelect(x), y> == <x, ScatterAdd(y)>
+  const Tensor y = Tensor::Random(selected.shape());
+  Tensor scattered = Tensor::Zeros(a.shape());
+  Tensor::ScatterAdd(scattered, 1, indices, y);
+  EXPECT_NEAR(Tensor::Sum(selected * y, {})(0), Tensor::Sum(a * scattered, {})(0), 1e-12);
+  EXPECT_EQ(scattered(2, 3, 1), y(2, 0, 1) + y(2, 2, 1));
+  EXPECT_EQ(scattered(2, 1, 1), 0.0);
+
+  // Gather は要素ごとに位置を指定する
+  BasicTensor<std::int32_t> index({3, 2, 5});
+  for (std::size_t i = 0; i < index.size(); ++i)
+  {
+    index.data()[i] = static_cast<std::int32_t>((i * 7) % 4);
+  }
+  const Tensor gathered = Tensor::Gather(a, 1, index);
+  ASSERT_EQ(gathered.shape(), Shape({3, 2, 5}));
+  for (std::size_t i = 0; i < 3; ++i)
+  {
+    for (std::size_t k = 0; k < 2; ++k)
+    {
+      for (std::size_t j = 0; j < 5; ++j)
+      {
+        EXPECT_EQ(gathered(i, k, j), a(i, static_cast<std::size_t>(index(i, k, j)), j));
+      }
+    }
+  }
+  const Tensor z = Tensor::Random(gathered.shape());
+  Tensor gather_grad = Tensor::Zeros(a.shape());
+  Tensor::ScatterAdd(gather_grad, 1, index, z);
+  EXPECT_NEAR(Tensor::Sum(gathered * z, {})(0), Tensor::Sum(a * gather_grad, {})(0), 1e-12);
+
+  // 出力先に入力自身を渡しても, 形状が変わる場合と変わらない場合の両方で正しく取り出せる
+  Tensor x = Tensor::FromArray({{0.0, 1.0, 2.0}, {3.0, 4.0, 5.0}, {6.0, 7.0, 8.0}, {9.0, 10.0, 11.0}});
+  Tensor::IndexSelect(x, 0, {3, 1}, x);
+  EXPECT_TRUE(Tensor::Equal(x, Tensor::FromArray({{9.0, 10.0, 11.0}, {3.0, 4.0, 5.0}})));
+  Tensor::IndexSelect(x, 1, {2, 0, 1}, x);
+  EXPECT_TRUE(Tensor::Equal(x, Tensor::FromArray({{11.0, 9.0, 10.0}, {5.0, 3.0, 4.0}})));
+
+  EXPECT_THROW(Tensor::IndexSelect(a, 1, {4}), std::out_of_range);
+  EXPECT_THROW(Tensor::IndexSelect(a, 3, {0}), std::invalid_argument);
+  index(0, 0, 0) = -1;
+  EXPECT_THROW(Tensor::Gather(a, 1, index), std::out_of_range);
+}
+
+// 軸を指定した Concat と Stack を直接のループと比較する
+TEST(TensorConcatTest, AxisAndStack)
+{
+  const Tensor a = Tensor::Random({2, 3, 4});
+  const Tensor b = Tensor::Random({2, 1, 4});
+  const Tensor c = Tensor::Transpose(Tensor::Random({4, 2, 2}), {1, 2, 0});
+
+  // 軸 1 の長さが異なるテンソルと, 連続していないビューを連結する
+  const Tensor joined = Tensor::Concat({a, b, c}, 1);
+  ASSERT_EQ(joined.shape(), Shape({2, 6, 4}));
+  for (std::size_t i = 0; i < 2; ++i)
+  {
+    for (std::size_t k = 0; k < 4; ++k)
+    {
+      EXPECT_EQ(joined(i, 0, k), a(i, 0, k));
+      EXPECT_EQ(joined(i, 2, k), a(i, 2, k));
+      EXPECT_EQ(joined(i, 3, k), b(i, 0, k));
+      EXPECT_EQ(joined(i, 5, k), c(i, 1, k));
+    }
+  }
+
+  // 同じ形状の出力先には確保せずに書き込む
+  Tensor out({2, 3, 8});
+  const Tensor::value_type *out_data = std::as_const(out).data();
+  Tensor::Concat({a, a}, 2, out);
+  EXPECT_EQ(std::as_const(out).data(), out_data);
+  EXPECT_EQ(out(1, 2, 7), a(1, 2, 3));
+  EXPECT_EQ(out(1, 2, 3), a(1, 2, 3));
+
+  // 新しい軸を途中と最後に挿入する
+  const Tensor d = Tensor::Random({2, 3, 4});
+  const Tensor middle = Tensor::Stack({a, d}, 1);
+  const Tensor last = Tensor::Stack({a, d}, 3);
+  ASSERT_EQ(middle.shape(), Shape({2, 2, 3, 4}));
+  ASSERT_EQ(last.shape(), Shape({2, 3, 4, 2}));
+  for (std::size_t i = 0; i < 2; ++i)
+  {
+    for (std::size_t j = 0; j < 3; ++j)
+    {
+      for (std::size_t k = 0; k < 4; ++k)
+      {
+        EXPECT_EQ(middle(i, 0, j, k), a(i, j, k));
+        EXPECT_EQ(middle(i, 1, j, k), d(i, j, k));
+        EXPECT_EQ(last(i, j, k, 0), a(i, j, k));
+        EXPECT_EQ(last(i, j, k, 1), d(i, j, k));
+      }
+    }
+  }
+
+  EXPECT_THROW(Tensor::Concat({a, Tensor::Random({3, 3, 4})}, 1), std::invalid_argument);
+  EXPECT_THROW(Tensor::Concat({a, b}, 3), std::invalid_argument);
+  EXPECT_THROW(Tensor::Stack({a, b}, 0), std::invalid_argument);
+  EXPECT_THROW(Tensor::Stack({a}, 4), std::invalid_argument);
+}
+
+// シードを指定した乱数は同じシードから同じ値になり, 要素型によらず同じ乱数の列を使うか確認する
+TEST(TensorRandomTest, SeededRandom)
+{
+  const Tensorf a = Tensorf::Random({37, 29}, 5);
+  const Tensorf b = Tensorf::Random({37, 29}, 5);
+  const Tensorf c = Tensorf::Random({37, 29}, 6);
+  EXPECT_TRUE(std::equal(a.data(), a.data() + a.size(), b.data()));
+  EXPECT_FALSE(std::equal(a.data(), a.data() + a.size(), c.data()));
+  EXPECT_GE(Tensorf::Min(a, {})(0), -1.0f);
+  EXPECT_LT(Tensorf::Max(a, {})(0), 1.0f);
+
+  // 16 ビットの浮動小数点数は float で生成して変換する
+  const Tensorh h = Tensorh::RandomNormal({37, 29}, 5);
+  const Tensorf n = Tensorf::RandomNormal({37, 29}, 5);
+  for (std::size_t i = 0; i < n.size(); ++i)
+  {
+    EXPECT_EQ(h.data()[i].bits, Half(n.data()[i]).bits);
+  }
+
+  const Tensor d = Tensor::RandomNormal({1000, 100}, 1);
+  EXPECT_NEAR(Tensor::Sum(d, {})(0) / 1e5, 0.0, 0.02);
+  EXPECT_NEAR(Tensor::Sum(d * d, {})(0) / 1e5, 1.0, 0.02);
+}
@@ -0,0 +1,278 @@
+//
+// Created by toru on 2026/10/17.
+//
+
+#include <gtest/gtest.h>
+#include <bit>
+#include <cmath>
+#include <limits>
+#include <random>
+
+#include "nagatolib.hpp"
+using namespace nagato;
+
+/**
+ * @brief long double で計算した値との差を ULP 単位で返す
+ */
+template<typename T>
+double UlpError(T actual, long double expected)
+{
+  const T rounded = static_cast<T>(expected);
+  const T ulp = std::nextafter(std::fabs(rounded), std::numeric_limits<T>::infinity()) - std::fabs(rounded);
+  return static_cast<double>(std::fabs(static_cast<long double>(actual) - expected) / ulp);
+}
+
+/**
+ * @brief 各カーネルの最大誤差 (ULP) を測定する. 要素数は SIMD 幅の端数を含むようにする
+ */
+template<typename T>
+void ExpectKernelError(double exp_bound, double log_bound, double sigmoid_bound)
+{
+  std::mt19937 gen(7);
+  std::uniform_real_distribution<double> dis(-80.0, 80.0);
+  const std::size_t n = 10007;
+  std::vector<T> x(n), log_x(n), y(n);
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    x[i] = static_cast<T>(dis(gen));
+    log_x[i] = static_cast<T>(std::exp(dis(gen)));
+  }
+
+  double exp_error = 0;
+  VectorExp(x.data(), y.data(), n);
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    exp_error = std::max(exp_error, UlpError(y[i], std::exp(static_cast<long double>(x[i]))));
+  }
+
+  double log_error = 0;
+  VectorLog(log_x.data(), y.data(), n);
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    log_error = std::max(log_error, UlpError(y[i], std::log(static_cast<long double>(log_x[i]))));
+  }
+
+  // 入力と出力が同じ配列でもよい
+  double sigmoid_error = 0;
+  y = x;
+  VectorSigmoid(y.data(), y.data(), n);
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    const long double expected = 1.0L / (1.0L + std::exp(-static_cast<long double>(x[i])));
+    sigmoid_error = std::max(sigmoid_error, UlpError(y[i], expected));
+  }
+
+  EXPECT_LE(exp_error, exp_bound);
+  EXPECT_LE(log_error, log_bound);
+  EXPECT_LE(sigmoid_error, sigmoid_bound);
+}
+
+// 精度ごとに誤差が仕様の範囲に収まるか確認する
+TEST(VectorMathTest, ErrorBounds)
+{
+  ExpectKernelError<float>(1.5, 1.0, 3.0);
+  ExpectKernelError<double>(1.5, 1.0, 3.0);
+
+  const auto previous = SetMathPrecision(MathPrecision::Fast);
+  EXPECT_EQ(previous, MathPrecision::Precise);
+  EXPECT_EQ(GetMathPrecision(), MathPrecision::Fast);
+  ExpectKernelError<float>(3.5, 6.5, 5.0);
+  // double は相対誤差 2^-39 以内 (2^13 ULP)
+  ExpectKernelError<double>(8192.0, 8192.0, 8192.0);
+  SetMathPrecision(previous);
+}
+
+// 特殊な値 (0, inf, NaN, 負の値, 非正規化数) を正しく扱うか確認する
+TEST(VectorMathTest, SpecialValues)
+{
+  constexpr float inf = std::numeric_limits<float>::infinity();
+  const std::vector<float> x = {0.0f, -1.0f, inf, -inf, std::numeric_limits<float>::quiet_NaN(), 1e-40f, 100.0f, -100.0f};
+  std::vector<float> y(x.size());
+
+  VectorLog(x.data(), y.data(), x.size());
+  EXPECT_EQ(y[0], -inf);
+  EXPECT_TRUE(std::isnan(y[1]));
+  EXPECT_EQ(y[2], inf);
+  EXPECT_TRUE(std::isnan(y[3]));
+  EXPECT_TRUE(std::isnan(y[4]));
+  EXPECT_FLOAT_EQ(y[5], std::log(1e-40f));
+
+  VectorExp(x.data(), y.data(), x.size());
+  EXPECT_EQ(y[0], 1.0f);
+  EXPECT_EQ(y[2], inf);
+  EXPECT_EQ(y[3], 0.0f);
+  EXPECT_TRUE(std::isnan(y[4]));
+  EXPECT_EQ(y[6], inf);
+  EXPECT_FLOAT_EQ(y[7], std::exp(-100.0f));
+
+  VectorSigmoid(x.data(), y.data(), x.size());
+  EXPECT_EQ(y[0], 0.5f);
+  EXPECT_EQ(y[2], 1.0f);
+  EXPECT_EQ(y[3], 0.0f);
+  EXPECT_EQ(y[6], 1.0f);
+}
+
+// テンソルの Exp, Log, Softmax がベクトル化したカーネルで計算した値と一致するか確認する
+TEST(VectorMathTest, TensorKernels)
+{
+  const Tensorf a = Tensorf::Random({3, 4, 5}) * 5.0f;
+  Tensorf exp = Tensorf::Exp(a - 1.0f);
+  Tensorf log = Tensorf::Log(Tensorf::Abs(a));
+  const Tensorf shifted = a - 1.0f;
+  const Tensorf absolute = Tensorf::Abs(a);
+  for (std::size_t i = 0; i < a.size(); ++i)
+  {
+    EXPECT_NEAR(std::as_const(exp).data()[i], std::exp(shifted.data()[i]), 1e-6f * std::exp(shifted.data()[i]));
+    EXPECT_NEAR(std::as_const(log).data()[i], std::log(absolute.data()[i] + 1e-7f), 1e-5f);
+  }
+
+  // 3 次元以上は最後の軸に沿って計算する. 転置したビューも扱える
+  const Tensorf t = Tensorf::Transpose(a, {2, 0, 1});
+  const Tensorf softmax = Tensorf::Softmax(t);
+  const Tensorf dense = t.Contiguous();
+  const std::size_t cols = t.shape().back();
+  for (std::size_t r = 0; r < t.size() / cols; ++r)
+  {
+    const float *row = dense.data() + r * cols;
+    const float max = *std::max_element(row, row + cols);
+    double sum = 0;
+    for (std::size_t j = 0; j < cols; ++j)
+    {
+      sum += std::exp(row[j] - max);
+    }
+    for (std::size_t j = 0; j < cols; ++j)
+    {
+      EXPECT_NEAR(softmax.data()[r * cols + j], std::exp(row[j] - max) / sum, 1e-6);
+    }
+  }
+}
+
+// 16 ビットの浮動小数点数への変換の丸めと特殊な値を確認する
+TEST(VectorMathTest, HalfAndBFloat16Conversion)
+{
+  constexpr float inf = std::numeric_limits<float>::infinity();
+  EXPECT_EQ(FloatToHalfBits(1.0f), 0x3c00);
+  EXPECT_EQ(FloatToHalfBits(-2.0f), 0xc000);
+  EXPECT_EQ(FloatToHalfBits(65504.0f), 0x7bff);
+  EXPECT_EQ(FloatToHalfBits(65519.0f), 0x7bff);
+  EXPECT_EQ(FloatToHalfBits(65520.0f), 0x7c00);
+  EXPECT_EQ(FloatToHalfBits(-inf), 0xfc00);
+  EXPECT_EQ(FloatToHalfBits(0x1p-24f), 0x0001);
+  EXPECT_EQ(FloatToHalfBits(0x1p-25f), 0x0000);
+  EXPECT_EQ(FloatToHalfBits(0x1.8p-25f), 0x0001);
+  // 1 + 2^-11 は 1 と 1 + 2^-10 の中点なので偶数側の 1 に丸める
+  EXPECT_EQ(FloatToHalfBits(1.0f + 0x1p-11f), 0x3c00);
+  EXPECT_EQ(FloatToHalfBits(1.0f + 0x1.8p-10f), 0x3c02);
+  EXPECT_EQ(HalfBitsToFloat(0x0001), 0x1p-24f);
+  EXPECT_TRUE(std::isnan(HalfBitsToFloat(FloatToHalfBits(std::numeric_limits<float>::quiet_NaN()))));
+
+  EXPECT_EQ(FloatToBFloat16Bits(1.0f), 0x3f80);
+  EXPECT_EQ(FloatToBFloat16Bits(1.0f + 0x1p-8f), 0x3f80);
+  EXPECT_EQ(FloatToBFloat16Bits(1.0f + 0x1.8p-7f), 0x3f82);
+  EXPECT_EQ(FloatToBFloat16Bits(std::numeric_limits<float>::max()), 0x7f80);
+  EXPECT_EQ(FloatToBFloat16Bits(-1e-40f), 0x8000);
+  EXPECT_EQ(BFloat16BitsToFloat(0xc040), -3.0f);
+  EXPECT_TRUE(std::isnan(BFloat16BitsToFloat(FloatToBFloat16Bits(std::numeric_limits<float>::quiet_NaN()))));
+
+  // SIMD のカーネルと 1 要素ずつの変換の結果が一致する. 要素数は SIMD 幅の端数を含むようにする
+  std::mt19937 gen(11);
+  std::uniform_int_distribution<std::uint32_t> bits;
+  const std::size_t n = 10007;
+  std::vector<float> x(n), back(n);
+  for (auto &v : x)
+  {
+    v = std::bit_cast<float>(bits(gen));
+  }
+  x[0] = inf;
+  x[1] = 1e-40f;
+  std::vector<Half> h(n);
+  std::vector<BFloat16> b(n);
+  VectorConvert(x.data(), h.data(), n);
+  VectorConvert(x.data(), b.data(), n);
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    ASSERT_EQ(h[i].bits, FloatToHalfBits(x[i])) << i;
+    ASSERT_EQ(b[i].bits, FloatToBFloat16Bits(x[i])) << i;
+  }
+  VectorConvert(h.data(), back.data(), n);
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    ASSERT_EQ(std::bit_cast<std::uint32_t>(back[i]), std::bit_cast<std::uint32_t>(HalfBitsToFloat(h[i].bits))) << i;
+  }
+  VectorConvert(b.data(), back.data(), n);
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    ASSERT_EQ(std::bit_cast<std::uint32_t>(back[i]), std::bit_cast<std::uint32_t>(BFloat16BitsToFloat(b[i].bits))) << i;
+  }
+}
+
+// Philox4x32-10 の既知の値と, ベクトルで計算した乱数がブロックごとの計算と一致するか確認する
+TEST(VectorMathTest, PhiloxRandom)
+{
+  // Random123 の既知解答ベクトル
+  using Counter = Philox4x32::counter_type;
+  EXPECT_EQ(Philox4x32::generate(Counter{0, 0, 0, 0}, {0, 0}), (Counter{0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8}));
+  EXPECT_EQ(Philox4x32::generate(Counter{0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff}, {0xffffffff, 0xffffffff}),
+            (Counter{0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd}));
+  EXPECT_EQ(Philox4x32::generate(Counter{0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344}, {0xa4093822, 0x299f31d0}),
+            (Counter{0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}));
+
+  // 16 ブロックのグループの中で, j 番目の値はブロックの j 番目の値 (double は 2 語ずつ) から作る
+  const std::uint64_t seed = 0x0123456789abcdefULL;
+  const std::size_t n = 10007;
+  const auto word = [seed](std::size_t i, std::size_t values, std::size_t j)
+  {
+    const std::size_t group = i / (16 * values);
+    return Philox4x32::generate(seed, group * 16 + i % 16)[j];
+  };
+  const auto unit_float = [](std::uint32_t w) { return std::bit_cast<float>((w >> 9) | 0x3f800000u) - 1.0f; };
+  const auto unit_double = [](std::uint32_t hi, std::uint32_t lo)
+  {
+    const std::uint64_t bits = (static_cast<std::uint64_t>(hi) << 20) | (lo >> 12);
+    return std::bit_cast<double>(bits | 0x3ff0000000000000ULL) - 1.0;
+  };
+
+  std::vector<float> f(n), fn(n);
+  std::vector<double> d(n), dn(n);
+  VectorRandomUniform(seed, -1.0f, 1.0f, f.data(), n);
+  VectorRandomUniform(seed, 2.0, 5.0, d.data(), n);
+  VectorRandomNormal(seed, 0.0f, 1.0f, fn.data(), n);
+  VectorRandomNormal(seed, 1.0, 2.0, dn.data(), n);
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    const std::size_t jf = i % 64 / 16;
+    ASSERT_EQ(f[i], unit_float(word(i, 4, jf)) * 2.0f - 1.0f) << i;
+    const std::size_t jd = i % 32 / 16;
+    ASSERT_EQ(d[i], unit_double(word(i, 2, 2 * jd), word(i, 2, 2 * jd + 1)) * 3.0 + 2.0) << i;
+
+    const std::size_t pf = jf & ~std::size_t(1);
+    const double u1 = unit_float(word(i, 4, pf));
+    const double u2 = unit_float(word(i, 4, pf + 1));
+    const double r = std::sqrt(-2.0 * std::log(1.0 - u1));
+    ASSERT_NEAR(fn[i], (jf % 2 == 0 ? std::cos(2 * M_PI * u2) : std::sin(2 * M_PI * u2)) * r, 1e-5) << i;
+
+    const double v1 = unit_double(word(i, 2, 0), word(i, 2, 1));
+    const double v2 = unit_double(word(i, 2, 2), word(i, 2, 3));
+    const double s = std::sqrt(-2.0 * std::log(1.0 - v1));
+    ASSERT_NEAR(dn[i], (jd == 0 ? std::cos(2 * M_PI * v2) : std::sin(2 * M_PI * v2)) * s * 2.0 + 1.0, 1e-12) << i;
+  }
+
+  // 短い配列は長い配列の先頭と一致する
+  std::vector<float> prefix(1000);
+  VectorRandomNormal(seed, 0.0f, 1.0f, prefix.data(), prefix.size());
+  EXPECT_TRUE(std::equal(prefix.begin(), prefix.end(), fn.begin()));
+
+  // 正規乱数の平均と分散
+  std::vector<double> large(1 << 20);
+  VectorRandomNormal(std::uint64_t(42), 0.0, 1.0, large.data(), large.size());
+  double sum = 0;
+  double square = 0;
+  for (const double v : large)
+  {
+    sum += v;
+    square += v * v;
+  }
+  const double mean = sum / static_cast<double>(large.size());
+  EXPECT_NEAR(mean, 0.0, 5e-3);
+  EXPECT_NEAR(square / static_cast<double>(large.size()) - mean * mean, 1.0, 5e-3);
+}
@@ -9,7 +9,7 @@ template<typename Primitive, std::size_t size>
 std::vector<Primitive> MakeVector()
 {
   std::random_device random_device;
-  Random rnd(random_device());
+  Random<> rnd(random_device());
   std::vector<Primitive> v;
   v.reserve(size);
   for (int i = 0; i < size; i++)
@@ -23,7 +23,7 @@ template<typename Primitive, std::size_t size>
 std::vector<Primitive> MakeVectorHasNonZero()
 {
   std::random_device random_device;
-  Random rnd(random_device());
+  Random<> rnd(random_device());
   std::vector<Primitive> v;
   v.reserve(size);
   for (int i = 0; i < size; i++)
@@ -114,7 +114,7 @@ TEST(VECTOR, PLUS)
   constexpr int MAX_TEST_CASE = 10000;
 
   std::random_device random_device;
-  Random rnd(random_device());
+  Random<> rnd(random_device());
 
   std::vector<std::vector<Primitive>> test_case_1;
   std::vector<std::vector<Primitive>> test_case_2;
@@ -150,7 +150,7 @@ TEST(VECTOR, MINUS)
   constexpr int MAX_TEST_CASE = 10000;
 
   std::random_device random_device;
-  Random rnd(random_device());
+  Random<> rnd(random_device());
 
   std::vector<std::vector<Primitive>> test_case_1;
   std::vector<std::vector<Primitive>> test_case_2;
@@ -186,7 +186,7 @@ TEST(VECTOR, MULTI)
   constexpr int MAX_TEST_CASE = 10000;
 
   std::random_device random_device;
-  Random rnd(random_device());
+  Random<> rnd(random_device());
 
   std::vector<std::vector<Primitive>> test_case_1;
   std::vector<std::vector<Primitive>> test_case_2;
@@ -222,7 +222,7 @@ TEST(VECTOR, Division)
   constexpr int MAX_TEST_CASE = 10000;
 
   std::random_device random_device;
-  Random rnd(random_device());
+  Random<> rnd(random_device());
 
   std::vector<std::vector<Primitive>> test_case_1;
   std::vector<std::vector<Primitive>> test_case_2;